@@ -0,0 +1,128 @@
+/*
+ * Arduino.cpp
+ * Host Arduino core implementation
+ */
+
+#include "Arduino.h"
+#include "Simulation.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+static uint8_t pinLevels[64];
+
+//=====================================================================
+// PINS
+//=====================================================================
+void pinMode(int, int) {
+}
+
+void digitalWrite(int pin, int value) {
+    if (pin >= 0 && pin < (int)sizeof(pinLevels)) {
+        pinLevels[pin] = value;
+    }
+}
+
+int digitalRead(int pin) {
+    return pin >= 0 && pin < (int)sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+int analogRead(int pin) {
+    if (pin == A0)
+        return simScenario().gasAdc;
+    if (pin == A1)
+        return simScenario().batteryAdc;
+    return 0;
+}
+
+void attachInterrupt(int interrupt, void (*callback)(), int) {
+    simAttachInterrupt(interrupt, callback);
+}
+
+//=====================================================================
+// TIME
+//=====================================================================
+unsigned long millis() {
+    return simMillis();
+}
+
+unsigned long micros() {
+    return (unsigned long)simMicros();
+}
+
+void delay(unsigned long ms) {
+    simAdvance(ms);
+}
+
+//=====================================================================
+// PRINT
+//=====================================================================
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+static size_t printFormatted(Print& out, const char* format, ...) {
+    char text[48];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0)
+        return 0;
+    return out.write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(int value) {
+    return printFormatted(*this, "%d", value);
+}
+
+size_t Print::print(unsigned int value) {
+    return printFormatted(*this, "%u", value);
+}
+
+size_t Print::print(long value) {
+    return printFormatted(*this, "%ld", value);
+}
+
+size_t Print::print(unsigned long value) {
+    return printFormatted(*this, "%lu", value);
+}
+
+size_t Print::print(double value, int digits) {
+    return printFormatted(*this, "%.*f", digits, value);
+}
+
+size_t Print::println() {
+    return print("\r\n");
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (simSerialEcho() && c != '\r') {
+        putchar(c);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (simSerialEcho()) {
+        for (size_t i = 0; i < size; i++) {
+            if (buffer[i] != '\r') {
+                putchar(buffer[i]);
+            }
+        }
+    }
+    return size;
+}
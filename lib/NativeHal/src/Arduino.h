@@ -0,0 +1,101 @@
+/*
+ * Arduino.h
+ * Host implementation of the Arduino core API used by the sensor hub
+ *
+ * Time comes from the simulation's virtual clock: delay() advances it
+ * instead of sleeping. Serial writes to stdout unless echo is turned off.
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <cmath>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Arduino's abs() works on floats too
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+//=====================================================================
+// PINS
+//=====================================================================
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define A0 26
+#define A1 27
+#define RISING 3
+
+#define constrain(value, low, high) \
+    ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)))
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+// Gas sensor on A0 and battery divider on A1, from the scenario
+int analogRead(int pin);
+
+// Only the IMU's INT1 line is wired to anything: see simAttachInterrupt()
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(int interrupt, void (*callback)(), int mode);
+
+//=====================================================================
+// TIME
+//=====================================================================
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+//=====================================================================
+// PRINT
+//=====================================================================
+class Print {
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    size_t print(const char* text);
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    template <typename T>
+    size_t println(T value) {
+        size_t n = print(value);
+        return n + println();
+    }
+};
+
+class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+};
+
+extern HardwareSerial Serial;
+
+// Network client base, as in the Arduino core
+class Client {
+  public:
+    virtual ~Client() {}
+};
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,27 @@
+/*
+ * Arduino_LSM6DSOX.cpp
+ * Host IMU implementation
+ */
+
+#include "Arduino_LSM6DSOX.h"
+#include "Simulation.h"
+
+LSM6DSOXClass IMU;
+
+int LSM6DSOXClass::begin() {
+    // Like the library: 104 Hz, FIFO off
+    const uint8_t bypass = 0;
+    simImuWrite(0x0A, &bypass, 1);
+    simImuWrite(0x09, &bypass, 1);
+    return 1;
+}
+
+int LSM6DSOXClass::readAcceleration(float& x, float& y, float& z) {
+    simAcceleration(x, y, z);
+    return 1;
+}
+
+int LSM6DSOXClass::readGyroscope(float& x, float& y, float& z) {
+    simGyroscope(x, y, z);
+    return 1;
+}
@@ -0,0 +1,27 @@
+/*
+ * Arduino_LSM6DSOX.h
+ * Host IMU: single-sample reads from the simulated motion
+ *
+ * The FIFO driver talks to the same simulated device through Wire.
+ */
+
+#ifndef NATIVE_ARDUINO_LSM6DSOX_H
+#define NATIVE_ARDUINO_LSM6DSOX_H
+
+class LSM6DSOXClass {
+  public:
+    int begin();
+    void end() {}
+
+    int accelerationAvailable() { return 1; }
+    int readAcceleration(float& x, float& y, float& z);
+    float accelerationSampleRate() { return 104.0f; }
+
+    int gyroscopeAvailable() { return 1; }
+    int readGyroscope(float& x, float& y, float& z);
+    float gyroscopeSampleRate() { return 104.0f; }
+};
+
+extern LSM6DSOXClass IMU;
+
+#endif // NATIVE_ARDUINO_LSM6DSOX_H
@@ -0,0 +1,73 @@
+/*
+ * DHT.cpp
+ * Host DHT sensor implementation
+ */
+
+#include "DHT.h"
+#include "Arduino.h"
+#include "Simulation.h"
+#include <math.h>
+
+// The DHT11 reports whole degrees and percent
+static float quantize(float value, uint8_t type) {
+    return type == DHT11 ? roundf(value) : roundf(value * 10) / 10;
+}
+
+void DHT::begin() {
+    // The first read goes to the sensor
+    lastReadTime = simMillis() - SIM_DHT_CACHE_TIME;
+}
+
+bool DHT::read(bool force) {
+    unsigned long now = simMillis();
+    if (!force && now - lastReadTime < SIM_DHT_CACHE_TIME)
+        return lastResult;
+
+    lastReadTime = now;
+    delay(SIM_DHT_READ_TIME);
+
+    const SimScenario& scenario = simScenario();
+    lastResult = scenario.dhtPresent;
+    if (lastResult) {
+        double day = now / 86400000.0;
+        temperature = quantize(
+            scenario.temperature + scenario.temperatureSwing * sin(2.0 * M_PI * day), type);
+        humidity = quantize(scenario.humidity, type);
+    }
+    return lastResult;
+}
+
+float DHT::readTemperature(bool fahrenheit, bool force) {
+    if (!read(force))
+        return NAN;
+
+    return fahrenheit ? temperature * 1.8f + 32 : temperature;
+}
+
+float DHT::readHumidity(bool force) {
+    if (!read(force))
+        return NAN;
+
+    return humidity;
+}
+
+float DHT::computeHeatIndex(float temperature, float humidity, bool fahrenheit) {
+    float t = fahrenheit ? temperature : temperature * 1.8f + 32;
+    float index = 0.5 * (t + 61.0 + ((t - 68.0) * 1.2) + (humidity * 0.094));
+
+    if (index > 79) {
+        index = -42.379 + 2.04901523 * t + 10.14333127 * humidity +
+                -0.22475541 * t * humidity + -0.00683783 * t * t +
+                -0.05481717 * humidity * humidity + 0.00122874 * t * t * humidity +
+                0.00085282 * t * humidity * humidity +
+                -0.00000199 * t * t * humidity * humidity;
+
+        if (humidity < 13 && t >= 80.0 && t <= 112.0) {
+            index -= ((13.0 - humidity) * 0.25) * sqrt((17.0 - fabs(t - 95.0)) * 0.05882);
+        } else if (humidity > 85.0 && t >= 80.0 && t <= 87.0) {
+            index += ((humidity - 85.0) * 0.1) * ((87.0 - t) * 0.2);
+        }
+    }
+
+    return fahrenheit ? index : (index - 32) * 0.55555;
+}
@@ -0,0 +1,46 @@
+/*
+ * DHT.h
+ * Host DHT sensor: temperature and humidity from the simulation scenario
+ */
+
+#ifndef NATIVE_DHT_H
+#define NATIVE_DHT_H
+
+#include <stdint.h>
+
+#define DHT11 11
+#define DHT22 22
+
+// As in the Adafruit library: a read holds the line low for the start
+// signal and clocks in 40 bits, and reads within the cache time of the
+// last one return its result without touching the sensor
+#define SIM_DHT_READ_TIME 23    // ms
+#define SIM_DHT_CACHE_TIME 2000 // ms
+
+class DHT {
+  public:
+    DHT(uint8_t pin, uint8_t type)
+        : pin(pin), type(type), lastReadTime(0), lastResult(false), temperature(0),
+          humidity(0) {}
+
+    void begin();
+
+    // NaN while the scenario has the sensor disconnected
+    float readTemperature(bool fahrenheit = false, bool force = false);
+    float readHumidity(bool force = false);
+
+    // Same formula as the Adafruit library (Rothfusz regression)
+    float computeHeatIndex(float temperature, float humidity, bool fahrenheit = true);
+
+  private:
+    bool read(bool force);
+
+    uint8_t pin;
+    uint8_t type;
+    unsigned long lastReadTime;
+    bool lastResult;
+    float temperature; // °C
+    float humidity;
+};
+
+#endif // NATIVE_DHT_H
@@ -0,0 +1,8 @@
+/*
+ * EEPROM.cpp
+ * Host EEPROM emulation instance
+ */
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
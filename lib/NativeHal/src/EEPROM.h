@@ -0,0 +1,45 @@
+/*
+ * EEPROM.h
+ * Host EEPROM emulation held in memory
+ */
+
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NATIVE_EEPROM_SIZE 4096
+
+class EEPROMClass {
+  public:
+    // Starts erased, like a fresh board
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+
+    void begin(size_t = NATIVE_EEPROM_SIZE) {}
+    bool commit() { return true; }
+
+    template <typename T>
+    T& get(int address, T& value) {
+        if (address >= 0 && address + sizeof(T) <= sizeof(data)) {
+            memcpy(&value, data + address, sizeof(T));
+        }
+        return value;
+    }
+
+    template <typename T>
+    const T& put(int address, const T& value) {
+        if (address >= 0 && address + sizeof(T) <= sizeof(data)) {
+            memcpy(data + address, &value, sizeof(T));
+        }
+        return value;
+    }
+
+  private:
+    uint8_t data[NATIVE_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // NATIVE_EEPROM_H
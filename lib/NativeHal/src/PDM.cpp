@@ -0,0 +1,29 @@
+/*
+ * PDM.cpp
+ * Host PDM microphone implementation
+ */
+
+#include "PDM.h"
+#include "Simulation.h"
+
+PDMClass PDM;
+
+int PDMClass::begin(int channels, int sampleRate) {
+    if (channels != 1 || callback == NULL)
+        return 0;
+
+    simMicrophoneBegin(callback, sampleRate);
+    return 1;
+}
+
+void PDMClass::end() {
+    simMicrophoneBegin(NULL, 0);
+}
+
+int PDMClass::available() {
+    return (int)simMicrophoneAvailable();
+}
+
+int PDMClass::read(void* buffer, size_t size) {
+    return (int)simMicrophoneRead(buffer, size);
+}
@@ -0,0 +1,34 @@
+/*
+ * PDM.h
+ * Host PDM microphone: blocks of simulated audio on the virtual clock
+ *
+ * The receive callback runs from simAdvance() whenever a 256-sample block
+ * is due, where the PDM interrupt would fire on the device.
+ */
+
+#ifndef NATIVE_PDM_H
+#define NATIVE_PDM_H
+
+#include <stddef.h>
+
+class PDMClass {
+  public:
+    PDMClass() : callback(NULL) {}
+
+    void onReceive(void (*function)()) { callback = function; }
+    int begin(int channels, int sampleRate);
+    void end();
+
+    int available();
+    int read(void* buffer, size_t size);
+
+    void setGain(int) {}
+    void setBufferSize(int) {}
+
+  private:
+    void (*callback)();
+};
+
+extern PDMClass PDM;
+
+#endif // NATIVE_PDM_H
@@ -0,0 +1,134 @@
+/*
+ * PubSubClient.cpp
+ * Host MQTT client implementation
+ */
+
+#include "PubSubClient.h"
+#include "Simulation.h"
+
+PubSubClient::PubSubClient(Client&)
+    : messageCallback(NULL), isConnected(false), socketTimeout(MQTT_SOCKET_TIMEOUT),
+      streamLength(0), streamRetained(false) {
+    streamTopic[0] = '\0';
+}
+
+PubSubClient& PubSubClient::setServer(const char*, uint16_t) {
+    return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(void (*callback)(char*, uint8_t*, unsigned int)) {
+    messageCallback = callback;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
+    socketTimeout = timeout;
+    return *this;
+}
+
+bool PubSubClient::connect(const char*) {
+    isConnected = simBrokerConnected();
+
+    // Joined to WiFi but no broker: nothing answers until the timeout
+    if (!isConnected && simScenario().wifiAvailable) {
+        delay((unsigned long)socketTimeout * 1000);
+    }
+    return isConnected;
+}
+
+void PubSubClient::disconnect() {
+    isConnected = false;
+}
+
+bool PubSubClient::connected() {
+    // A dropped network is noticed on the next call, like a failed keepalive
+    if (isConnected && !simBrokerConnected()) {
+        isConnected = false;
+    }
+    return isConnected;
+}
+
+bool PubSubClient::loop() {
+    if (!connected())
+        return false;
+
+    const char* topic;
+    const uint8_t* payload;
+    size_t length;
+    if (messageCallback != NULL && simBrokerReceive(topic, payload, length)) {
+        // The library hands the callback its own packet buffer
+        static char topicBuffer[MQTT_MAX_PACKET_SIZE];
+        static uint8_t payloadBuffer[MQTT_MAX_PACKET_SIZE];
+        if (strlen(topic) < sizeof(topicBuffer) && length <= sizeof(payloadBuffer)) {
+            strcpy(topicBuffer, topic);
+            memcpy(payloadBuffer, payload, length);
+            messageCallback(topicBuffer, payloadBuffer, length);
+        }
+    }
+    return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    if (!connected())
+        return false;
+
+    simBrokerSubscribe(topic);
+    return true;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+    return publish(topic, (const uint8_t*)payload, strlen(payload), false);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, strlen(payload), retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length) {
+    return publish(topic, payload, length, false);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length,
+                           bool retained) {
+    if (!connected())
+        return false;
+
+    if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length > MQTT_MAX_PACKET_SIZE)
+        return false;
+
+    return simBrokerPublish(topic, payload, length, retained);
+}
+
+bool PubSubClient::beginPublish(const char* topic, unsigned int length, bool retained) {
+    if (!connected() || strlen(topic) >= sizeof(streamTopic))
+        return false;
+
+    strcpy(streamTopic, topic);
+    streamLength = length;
+    streamRetained = retained;
+    stream.clear();
+    return true;
+}
+
+size_t PubSubClient::write(uint8_t c) {
+    stream.push_back(c);
+    return 1;
+}
+
+size_t PubSubClient::write(const uint8_t* buffer, size_t size) {
+    stream.insert(stream.end(), buffer, buffer + size);
+    return size;
+}
+
+int PubSubClient::endPublish() {
+    // The announced length is already on the wire, so a mismatch corrupts
+    // the stream on a real broker
+    if (stream.size() != streamLength) {
+        fprintf(stderr, "MQTT: %s announced %u bytes, wrote %zu\n", streamTopic, streamLength,
+                stream.size());
+        isConnected = false;
+        return 0;
+    }
+
+    return simBrokerPublish(streamTopic, stream.data(), stream.size(), streamRetained) ? 1 : 0;
+}
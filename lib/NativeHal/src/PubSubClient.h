@@ -0,0 +1,60 @@
+/*
+ * PubSubClient.h
+ * Host MQTT client publishing into the simulation's broker sink
+ *
+ * Keeps the library's limits so size problems show up off-device too:
+ * publish() refuses messages larger than MQTT_MAX_PACKET_SIZE, while
+ * beginPublish()/endPublish() stream any length. loop() hands at most
+ * one incoming message to the callback per call. connect() to a broker
+ * that does not answer waits out the socket timeout, as on the device.
+ */
+
+#ifndef NATIVE_PUBSUBCLIENT_H
+#define NATIVE_PUBSUBCLIENT_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_KEEPALIVE 15
+#define MQTT_SOCKET_TIMEOUT 15
+#define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
+
+class PubSubClient : public Print {
+  public:
+    explicit PubSubClient(Client& client);
+
+    PubSubClient& setServer(const char* domain, uint16_t port);
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+    PubSubClient& setSocketTimeout(uint16_t timeout);
+
+    bool connect(const char* id);
+    void disconnect();
+    bool connected();
+    bool loop();
+    bool subscribe(const char* topic);
+
+    bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+    // Streamed publish of exactly length bytes
+    bool beginPublish(const char* topic, unsigned int length, bool retained);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    int endPublish();
+
+  private:
+    void (*messageCallback)(char*, uint8_t*, unsigned int);
+    bool isConnected;
+    uint16_t socketTimeout; // s
+
+    char streamTopic[64];
+    unsigned int streamLength;
+    bool streamRetained;
+    std::vector<uint8_t> stream;
+};
+
+#endif // NATIVE_PUBSUBCLIENT_H
@@ -0,0 +1,679 @@
+/*
+ * Simulation.cpp
+ * Virtual clock, device models and MQTT sink implementation
+ */
+
+#include "Simulation.h"
+#include "DHT.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SIM_MIC_BLOCK_SAMPLES 256
+#define SIM_MIC_DC_OFFSET 200
+#define SIM_IMU_ODR_HZ 417
+#define SIM_IMU_FIFO_WORDS 512
+#define SIM_IMU_WORD_SIZE 7
+#define SIM_IMU_ACCEL_LSB_PER_G (1 / 0.000122)
+#define SIM_IMU_GYRO_LSB_PER_DPS (1 / 0.070)
+#define SIM_SECONDS_PER_DAY 86400.0
+
+// LSM6DSOX registers the firmware touches
+#define REG_WHO_AM_I 0x0F
+#define REG_FIFO_CTRL3 0x09
+#define REG_FIFO_CTRL4 0x0A
+#define REG_FIFO_STATUS1 0x3A
+#define REG_FIFO_DATA_OUT_TAG 0x78
+#define REG_CTRL1_XL 0x10
+#define REG_TAP_CFG2 0x58
+#define REG_WAKE_UP_THS 0x5B
+#define REG_WAKE_UP_DUR 0x5C
+#define REG_MD1_CFG 0x5E
+#define WHO_AM_I_VALUE 0x6C
+#define FIFO_MODE_CONTINUOUS 0x6
+#define FIFO_OVR_LATCHED 0x08
+#define INTERRUPTS_ENABLE 0x80
+#define INT1_WU 0x20
+#define WAKE_THS_W 0x10
+
+static const SimScenario DEFAULT_SCENARIO = {
+    22.0,  // temperature
+    1.5,   // temperatureSwing
+    45.0,  // humidity
+    true,  // dhtPresent
+    0.0,   // dhtErrorRate
+    300,   // gasAdc
+    1000,  // batteryAdc (USB powered)
+    25.0,  // vibrationFrequency
+    0.02,  // vibrationAmplitude
+    440.0, // toneFrequency
+    300.0, // toneLevel
+    100.0, // noiseLevel
+    true,  // wifiAvailable
+    true,  // brokerAvailable
+    true,  // linkAvailable
+    1767225600, // epoch (2026-01-01)
+};
+
+struct ScriptEvent {
+    unsigned long time;
+    bool message; // mqtt line rather than set line
+    std::string key;
+    std::string value;
+};
+
+//=====================================================================
+// STATE
+//=====================================================================
+static uint64_t nowMicros = 0;
+static SimScenario scenario;
+static uint32_t noiseState = 1;
+static bool serialEcho = true;
+
+// Script, sorted by time; events before nextScriptEvent have been applied
+static std::vector<ScriptEvent> script;
+static size_t nextScriptEvent = 0;
+
+// Microphone: one block pending at a time, like the PDM driver's buffer
+static void (*micCallback)() = NULL;
+static long micSampleRate = 0;
+static uint64_t nextMicBlock = 0;
+static double micPhase = 0;
+static int16_t micBlock[SIM_MIC_BLOCK_SAMPLES];
+static size_t micPending = 0;
+
+// IMU FIFO
+static uint8_t imuRegisters[128];
+static uint8_t fifo[SIM_IMU_FIFO_WORDS][SIM_IMU_WORD_SIZE];
+static uint16_t fifoHead = 0;
+static uint16_t fifoCount = 0;
+static uint8_t fifoByte = 0; // Read position within the word at the head
+static bool fifoOverrun = false;
+static uint64_t fifoSamples = 0; // Samples generated since the FIFO was enabled
+static uint64_t fifoStart = 0;
+
+// Wake-up interrupt on INT1
+static void (*imuInterrupt)() = NULL;
+static bool imuWakeLevel = false;
+
+// Broker
+static std::vector<std::string> subscriptions;
+static std::vector<ScriptEvent> incoming;
+static ScriptEvent delivered;
+static SimMessageCallback messageCallback = NULL;
+static FILE* messageLog = NULL;
+static unsigned long messageCount = 0;
+static unsigned long messageBytes = 0;
+static unsigned long messagesLost = 0;
+static unsigned long linkDownSince = 0;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static void updateImuWake();
+
+float simNoise() {
+    // xorshift32: cheap, and the same sequence on every host
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return (float)((double)noiseState / 2147483648.0 - 1.0);
+}
+
+static double seconds() {
+    return nowMicros / 1e6;
+}
+
+static int16_t clampSample(double value) {
+    if (value > 32767)
+        return 32767;
+    if (value < -32768)
+        return -32768;
+    return (int16_t)lround(value);
+}
+
+static void putInt16(uint8_t* out, int16_t value) {
+    out[0] = (uint16_t)value & 0xFF;
+    out[1] = (uint16_t)value >> 8;
+}
+
+//=====================================================================
+// SCENARIO AND SCRIPT
+//=====================================================================
+void simReset() {
+    nowMicros = 0;
+    scenario = DEFAULT_SCENARIO;
+    noiseState = 0x12345678;
+    script.clear();
+    nextScriptEvent = 0;
+    micCallback = NULL;
+    micPending = 0;
+    micPhase = 0;
+    memset(imuRegisters, 0, sizeof(imuRegisters));
+    imuRegisters[REG_WHO_AM_I] = WHO_AM_I_VALUE;
+    fifoHead = fifoCount = 0;
+    fifoByte = 0;
+    fifoOverrun = false;
+    imuInterrupt = NULL;
+    imuWakeLevel = false;
+    subscriptions.clear();
+    incoming.clear();
+    messageCount = messageBytes = messagesLost = 0;
+    linkDownSince = 0;
+}
+
+SimScenario& simScenario() {
+    return scenario;
+}
+
+bool simSet(const char* key, const char* value) {
+    double number = atof(value);
+
+    if (strcmp(key, "temperature") == 0) {
+        scenario.temperature = number;
+    } else if (strcmp(key, "temperature_swing") == 0) {
+        scenario.temperatureSwing = number;
+    } else if (strcmp(key, "humidity") == 0) {
+        scenario.humidity = number;
+    } else if (strcmp(key, "dht") == 0) {
+        scenario.dhtPresent = number != 0;
+    } else if (strcmp(key, "dht_errors") == 0) {
+        scenario.dhtErrorRate = number;
+    } else if (strcmp(key, "gas_adc") == 0) {
+        scenario.gasAdc = (uint16_t)number;
+    } else if (strcmp(key, "battery_adc") == 0) {
+        scenario.batteryAdc = (uint16_t)number;
+    } else if (strcmp(key, "vibration_hz") == 0) {
+        scenario.vibrationFrequency = number;
+    } else if (strcmp(key, "vibration_g") == 0) {
+        scenario.vibrationAmplitude = number;
+    } else if (strcmp(key, "tone_hz") == 0) {
+        scenario.toneFrequency = number;
+    } else if (strcmp(key, "tone_level") == 0) {
+        scenario.toneLevel = number;
+    } else if (strcmp(key, "noise_level") == 0) {
+        scenario.noiseLevel = number;
+    } else if (strcmp(key, "wifi") == 0) {
+        scenario.wifiAvailable = number != 0;
+    } else if (strcmp(key, "broker") == 0) {
+        scenario.brokerAvailable = number != 0;
+    } else if (strcmp(key, "link") == 0) {
+        if (scenario.linkAvailable && number == 0) {
+            linkDownSince = simMillis();
+        }
+        scenario.linkAvailable = number != 0;
+    } else if (strcmp(key, "epoch") == 0) {
+        scenario.epoch = (uint32_t)number;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseScriptLine(char* line, ScriptEvent& event) {
+    char* end;
+    event.time = strtoul(line, &end, 10);
+    if (end == line)
+        return false;
+
+    char command[8];
+    char key[64];
+    int consumed = 0;
+    if (sscanf(end, " %7s %63s %n", command, key, &consumed) < 2)
+        return false;
+
+    char* value = end + consumed;
+    value[strcspn(value, "\r\n")] = '\0';
+
+    event.message = strcmp(command, "mqtt") == 0;
+    if (!event.message && strcmp(command, "set") != 0)
+        return false;
+
+    event.key = key;
+    event.value = value;
+    return true;
+}
+
+bool simLoadScript(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    char line[1024];
+    int number = 0;
+    bool valid = true;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        char* text = line + strspn(line, " \t");
+        if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0')
+            continue;
+
+        ScriptEvent event;
+        if (!parseScriptLine(text, event)) {
+            fprintf(stderr, "%s:%d: malformed script line\n", path, number);
+            valid = false;
+            break;
+        }
+
+        // Keep the script sorted; lines with equal times stay in order
+        size_t at = script.size();
+        while (at > nextScriptEvent && script[at - 1].time > event.time) {
+            at--;
+        }
+        script.insert(script.begin() + at, event);
+    }
+
+    fclose(file);
+    return valid;
+}
+
+static void applyScriptEvent(const ScriptEvent& event) {
+    if (event.message) {
+        incoming.push_back(event);
+    } else if (!simSet(event.key.c_str(), event.value.c_str())) {
+        fprintf(stderr, "script: unknown key %s\n", event.key.c_str());
+    }
+}
+
+//=====================================================================
+// CLOCK
+//=====================================================================
+uint64_t simMicros() {
+    return nowMicros;
+}
+
+unsigned long simMillis() {
+    return (unsigned long)(nowMicros / 1000);
+}
+
+static uint64_t scriptEventTime() {
+    if (nextScriptEvent < script.size())
+        return (uint64_t)script[nextScriptEvent].time * 1000;
+    return UINT64_MAX;
+}
+
+static uint64_t micEventTime() {
+    return micCallback != NULL ? nextMicBlock : UINT64_MAX;
+}
+
+static void deliverMicBlock() {
+    double step = 2.0 * M_PI * scenario.toneFrequency / micSampleRate;
+    for (int i = 0; i < SIM_MIC_BLOCK_SAMPLES; i++) {
+        micBlock[i] = clampSample(SIM_MIC_DC_OFFSET + scenario.toneLevel * sin(micPhase) +
+                                  scenario.noiseLevel * simNoise());
+        micPhase = fmod(micPhase + step, 2.0 * M_PI);
+    }
+    micPending = sizeof(micBlock);
+    nextMicBlock += (uint64_t)SIM_MIC_BLOCK_SAMPLES * 1000000 / micSampleRate;
+
+    // Runs where the PDM interrupt would
+    micCallback();
+}
+
+void simAdvance(unsigned long ms) {
+    uint64_t target = nowMicros + (uint64_t)ms * 1000;
+
+    for (;;) {
+        uint64_t scriptTime = scriptEventTime();
+        uint64_t micTime = micEventTime();
+        uint64_t next = scriptTime < micTime ? scriptTime : micTime;
+        if (next > target)
+            break;
+
+        if (next > nowMicros) {
+            nowMicros = next;
+        }
+        if (scriptTime == next) {
+            applyScriptEvent(script[nextScriptEvent++]);
+            updateImuWake();
+        } else {
+            deliverMicBlock();
+        }
+    }
+
+    nowMicros = target;
+}
+
+unsigned long simNextEvent() {
+    uint64_t scriptTime = scriptEventTime();
+    uint64_t micTime = micEventTime();
+    uint64_t next = scriptTime < micTime ? scriptTime : micTime;
+    if (next == UINT64_MAX)
+        return (unsigned long)-1;
+    if (next <= nowMicros)
+        return 0;
+    return (unsigned long)((next - nowMicros + 999) / 1000);
+}
+
+void simSetSerialEcho(bool echo) {
+    serialEcho = echo;
+}
+
+bool simSerialEcho() {
+    return serialEcho;
+}
+
+//=====================================================================
+// DHT
+//=====================================================================
+// Same values as the DHT library shim reads, encoded as the sensor sends them
+static void dhtFrame(uint8_t type, uint8_t* data) {
+    double day = seconds() / SIM_SECONDS_PER_DAY;
+    double temperature = scenario.temperature + scenario.temperatureSwing * sin(2.0 * M_PI * day);
+
+    if (type == DHT11) {
+        long t = lround(fabs(temperature));
+        data[0] = (uint8_t)lround(scenario.humidity);
+        data[1] = 0;
+        data[2] = (uint8_t)t;
+        data[3] = temperature < 0 && t > 0 ? 0x80 : 0;
+    } else {
+        long h = lround(scenario.humidity * 10);
+        long t = lround(fabs(temperature) * 10);
+        data[0] = (uint8_t)(h >> 8);
+        data[1] = (uint8_t)h;
+        data[2] = (uint8_t)((t >> 8) | (temperature < 0 && t > 0 ? 0x80 : 0));
+        data[3] = (uint8_t)t;
+    }
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+}
+
+size_t simDhtCapture(uint8_t type, uint32_t* pulses, size_t count, unsigned long& frameUs) {
+    frameUs = 0;
+    if (!scenario.dhtPresent || count == 0)
+        return 0;
+
+    uint8_t data[5];
+    dhtFrame(type, data);
+    if ((simNoise() + 1) / 2 < scenario.dhtErrorRate) {
+        int bit = (int)((simNoise() + 1) * 20) % 40;
+        data[bit / 8] ^= 0x80 >> (bit % 8);
+    }
+
+    // Release to the response, 80 us low, then the response pulse
+    pulses[0] = (uint32_t)lround(80 + 4 * simNoise());
+    frameUs = 30 + 80 + pulses[0];
+
+    size_t written = 1;
+    for (int bit = 0; bit < 40 && written < count; bit++, written++) {
+        bool one = data[bit / 8] & (0x80 >> (bit % 8));
+        pulses[written] = (uint32_t)lround(one ? 70 + 4 * simNoise() : 27 + 2 * simNoise());
+        frameUs += 50 + pulses[written];
+    }
+    frameUs += 50; // Final low before the line is released
+    return written;
+}
+
+//=====================================================================
+// MICROPHONE
+//=====================================================================
+void simMicrophoneBegin(void (*callback)(), long sampleRate) {
+    micCallback = sampleRate > 0 ? callback : NULL;
+    micSampleRate = sampleRate;
+    micPending = 0;
+    if (micCallback != NULL) {
+        nextMicBlock = nowMicros + (uint64_t)SIM_MIC_BLOCK_SAMPLES * 1000000 / sampleRate;
+    }
+}
+
+size_t simMicrophoneAvailable() {
+    return micPending;
+}
+
+size_t simMicrophoneRead(void* buffer, size_t bytes) {
+    if (bytes > micPending) {
+        bytes = micPending;
+    }
+    memcpy(buffer, micBlock, bytes);
+    micPending = 0;
+    return bytes;
+}
+
+//=====================================================================
+// IMU
+//=====================================================================
+static void accelerationAt(double t, float& x, float& y, float& z) {
+    x = 0.002 * simNoise();
+    y = 0.002 * simNoise();
+    z = 1.0 + scenario.vibrationAmplitude * sin(2.0 * M_PI * scenario.vibrationFrequency * t) +
+        0.002 * simNoise();
+}
+
+void simAcceleration(float& x, float& y, float& z) {
+    accelerationAt(seconds(), x, y, z);
+}
+
+void simGyroscope(float& x, float& y, float& z) {
+    x = 0.5 * simNoise();
+    y = 0.5 * simNoise();
+    z = 0.5 * simNoise();
+}
+
+static bool fifoEnabled() {
+    return (imuRegisters[REG_FIFO_CTRL4] & 0x07) == FIFO_MODE_CONTINUOUS &&
+           imuRegisters[REG_FIFO_CTRL3] != 0;
+}
+
+static void pushFifoWord(uint8_t tag, float x, float y, float z, double scale) {
+    if (fifoCount == SIM_IMU_FIFO_WORDS) {
+        // Continuous mode keeps the newest words
+        fifoHead = (fifoHead + 1) % SIM_IMU_FIFO_WORDS;
+        fifoCount--;
+        fifoByte = 0;
+        fifoOverrun = true;
+    }
+
+    uint8_t* word = fifo[(fifoHead + fifoCount) % SIM_IMU_FIFO_WORDS];
+    word[0] = tag << 3;
+    putInt16(word + 1, clampSample(x * scale));
+    putInt16(word + 3, clampSample(y * scale));
+    putInt16(word + 5, clampSample(z * scale));
+    fifoCount++;
+}
+
+// Batch every sample due since the last access
+static void fillFifo() {
+    if (!fifoEnabled())
+        return;
+
+    uint64_t due = (nowMicros - fifoStart) * SIM_IMU_ODR_HZ / 1000000;
+    for (; fifoSamples < due; fifoSamples++) {
+        double t = (fifoStart + fifoSamples * 1000000 / SIM_IMU_ODR_HZ) / 1e6;
+        float x, y, z;
+        simGyroscope(x, y, z);
+        pushFifoWord(0x01, x, y, z, SIM_IMU_GYRO_LSB_PER_DPS);
+        accelerationAt(t, x, y, z);
+        pushFifoWord(0x02, x, y, z, SIM_IMU_ACCEL_LSB_PER_G);
+    }
+}
+
+bool simImuWrite(uint8_t reg, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length && reg + i < sizeof(imuRegisters); i++) {
+        bool wasEnabled = fifoEnabled();
+        imuRegisters[reg + i] = data[i];
+
+        if ((uint8_t)(reg + i) == REG_FIFO_CTRL4 && (data[i] & 0x07) == 0) {
+            // Bypass mode empties the FIFO
+            fifoHead = fifoCount = 0;
+            fifoByte = 0;
+            fifoOverrun = false;
+        }
+        if (!wasEnabled && fifoEnabled()) {
+            fifoStart = nowMicros;
+            fifoSamples = 0;
+        }
+    }
+
+    updateImuWake();
+    return true;
+}
+
+// The high-pass filtered acceleration is the vibration; compare its
+// amplitude with the wake-up threshold
+static bool imuWakeCondition() {
+    static const double FULL_SCALE_G[] = {2, 16, 4, 8};
+
+    if (!(imuRegisters[REG_TAP_CFG2] & INTERRUPTS_ENABLE) ||
+        !(imuRegisters[REG_MD1_CFG] & INT1_WU))
+        return false;
+
+    double fullScale = FULL_SCALE_G[(imuRegisters[REG_CTRL1_XL] >> 2) & 0x03];
+    double weight = fullScale / (imuRegisters[REG_WAKE_UP_DUR] & WAKE_THS_W ? 256 : 64);
+    return scenario.vibrationAmplitude > (imuRegisters[REG_WAKE_UP_THS] & 0x3F) * weight;
+}
+
+static void updateImuWake() {
+    bool level = imuWakeCondition();
+    if (level && !imuWakeLevel && imuInterrupt != NULL) {
+        imuInterrupt();
+    }
+    imuWakeLevel = level;
+}
+
+void simAttachInterrupt(int pin, void (*callback)()) {
+    if (pin == SIM_IMU_INT1_PIN) {
+        imuInterrupt = callback;
+    }
+}
+
+size_t simImuRead(uint8_t reg, uint8_t* data, size_t length) {
+    fillFifo();
+
+    if (reg == REG_FIFO_STATUS1) {
+        uint8_t overrun = fifoOverrun ? FIFO_OVR_LATCHED : 0;
+        uint8_t status[2] = {(uint8_t)(fifoCount & 0xFF),
+                             (uint8_t)(((fifoCount >> 8) & 0x03) | overrun)};
+        fifoOverrun = false;
+        memcpy(data, status, length < 2 ? length : 2);
+        return length;
+    }
+
+    if (reg == REG_FIFO_DATA_OUT_TAG) {
+        // The address wraps within the output word, popping one per 7 bytes
+        for (size_t i = 0; i < length; i++) {
+            data[i] = fifoCount > 0 ? fifo[fifoHead][fifoByte] : 0;
+            if (++fifoByte == SIM_IMU_WORD_SIZE) {
+                fifoByte = 0;
+                if (fifoCount > 0) {
+                    fifoHead = (fifoHead + 1) % SIM_IMU_FIFO_WORDS;
+                    fifoCount--;
+                }
+            }
+        }
+        return length;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        data[i] = reg + i < sizeof(imuRegisters) ? imuRegisters[reg + i] : 0;
+    }
+    return length;
+}
+
+//=====================================================================
+// BROKER
+//=====================================================================
+bool simBrokerConnected() {
+    if (!scenario.wifiAvailable || !scenario.brokerAvailable)
+        return false;
+    return scenario.linkAvailable || simMillis() - linkDownSince < SIM_LINK_DETECT_TIME;
+}
+
+void simBrokerSubscribe(const char* topic) {
+    subscriptions.push_back(topic);
+}
+
+static bool subscribed(const std::string& topic) {
+    for (size_t i = 0; i < subscriptions.size(); i++) {
+        if (subscriptions[i] == topic)
+            return true;
+    }
+    return false;
+}
+
+static bool printable(const uint8_t* payload, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (payload[i] < 0x20 || payload[i] > 0x7E)
+            return false;
+    }
+    return true;
+}
+
+bool simBrokerPublish(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    if (!simBrokerConnected())
+        return false;
+
+    // Accepted by the client, lost on the way
+    if (!scenario.linkAvailable) {
+        messagesLost++;
+        return true;
+    }
+
+    SimMessage message;
+    message.time = simMillis();
+    strncpy(message.topic, topic, sizeof(message.topic) - 1);
+    message.topic[sizeof(message.topic) - 1] = '\0';
+    message.payload = (uint8_t*)payload;
+    message.length = length;
+    message.retained = retained;
+
+    messageCount++;
+    messageBytes += length;
+
+    if (messageLog != NULL) {
+        fprintf(messageLog, "%lu %s ", message.time, topic);
+        if (printable(payload, length)) {
+            fwrite(payload, 1, length, messageLog);
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                fprintf(messageLog, "%02x", payload[i]);
+            }
+        }
+        fputc('\n', messageLog);
+    }
+
+    if (messageCallback != NULL) {
+        messageCallback(message);
+    }
+    return true;
+}
+
+bool simBrokerReceive(const char*& topic, const uint8_t*& payload, size_t& length) {
+    while (!incoming.empty()) {
+        delivered = incoming.front();
+        incoming.erase(incoming.begin());
+
+        // The broker drops messages nobody has subscribed to
+        if (subscribed(delivered.key)) {
+            topic = delivered.key.c_str();
+            payload = (const uint8_t*)delivered.value.data();
+            length = delivered.value.size();
+            return true;
+        }
+    }
+    return false;
+}
+
+void simSetMessageCallback(SimMessageCallback callback) {
+    messageCallback = callback;
+}
+
+void simSetMessageLog(FILE* log) {
+    messageLog = log;
+}
+
+unsigned long simMessageCount() {
+    return messageCount;
+}
+
+unsigned long simMessageBytes() {
+    return messageBytes;
+}
+
+unsigned long simMessagesLost() {
+    return messagesLost;
+}
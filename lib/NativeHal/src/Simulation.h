@@ -0,0 +1,156 @@
+/*
+ * Simulation.h
+ * Virtual clock, simulated devices and MQTT sink for the native build
+ *
+ * The Arduino, sensor, WiFi and MQTT headers in this library implement
+ * just the API the sensor hub uses, on top of the state kept here. Time
+ * only moves when the firmware waits (delay()) or the host loop idles
+ * to the next due task, so hours of operation run in seconds and every
+ * run with the same script is identical.
+ *
+ * Sensor values follow a scenario that a script can change over time:
+ *
+ *   # time_ms  command
+ *   0          set temperature 21.5
+ *   60000      set gas_adc 620
+ *   120000     set wifi 0
+ *   180000     set wifi 1
+ *   30000      mqtt sensors/arduino/config {"batch_size": 16}
+ *
+ * A recorded trace is replayed the same way, as one set line per value.
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct SimScenario {
+    // Environment (DHT11): a daily sine around the mean
+    float temperature; // °C
+    float temperatureSwing;
+    float humidity; // %
+    bool dhtPresent;
+    float dhtErrorRate; // Share of frames with one bit flipped on the line
+
+    // Analog inputs, as raw 10-bit codes
+    uint16_t gasAdc;
+    uint16_t batteryAdc;
+
+    // Motion: 1 g on Z plus a sinusoid along Z
+    float vibrationFrequency; // Hz
+    float vibrationAmplitude; // g
+
+    // Microphone: a tone plus white noise on a DC offset, in sample counts
+    float toneFrequency; // Hz
+    float toneLevel;
+    float noiseLevel;
+
+    // Network
+    bool wifiAvailable;
+    bool brokerAvailable;
+    bool linkAvailable; // 0 drops packets silently until the keepalive notices
+    uint32_t epoch;     // Unix time at simulated time zero, 0 if NTP never answers
+};
+
+// A message the firmware published, as the broker would have seen it
+struct SimMessage {
+    unsigned long time;
+    char topic[64];
+    uint8_t* payload;
+    size_t length;
+    bool retained;
+};
+
+typedef void (*SimMessageCallback)(const SimMessage& message);
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Reset the clock, devices and scenario to their defaults
+void simReset();
+
+SimScenario& simScenario();
+
+// Change one scenario value by name (as in a script set line)
+bool simSet(const char* key, const char* value);
+
+// Load timed set and mqtt lines. Returns false if the file can't be read
+// or has a malformed line.
+bool simLoadScript(const char* path);
+
+// Virtual clock
+uint64_t simMicros();
+unsigned long simMillis();
+
+// Move the clock forward, delivering microphone blocks and script
+// events as their time comes
+void simAdvance(unsigned long ms);
+
+// Time until the next device or script event, in ms
+unsigned long simNextEvent();
+
+// Host-side console: Serial output can be silenced for long runs
+void simSetSerialEcho(bool echo);
+bool simSerialEcho();
+
+// MQTT sink: every accepted publish is passed to the callback and
+// counted; a log file, if set, gets one line per message (binary
+// payloads in hex)
+void simSetMessageCallback(SimMessageCallback callback);
+void simSetMessageLog(FILE* log);
+unsigned long simMessageCount();
+unsigned long simMessageBytes();
+// Publishes the client accepted while the link was silently down
+unsigned long simMessagesLost();
+
+//=====================================================================
+// DEVICE MODEL ACCESS (used by the API shims)
+//=====================================================================
+// Next microphone block if one is pending
+size_t simMicrophoneRead(void* buffer, size_t bytes);
+size_t simMicrophoneAvailable();
+// Deliver blocks to the callback from now on; NULL or a rate of 0 stops them
+void simMicrophoneBegin(void (*callback)(), long sampleRate);
+
+// DHT pulse train for a read started now: the width of each high pulse
+// in us, as the PIO driver captures them, and the frame length after the
+// start signal. Returns 0 while the sensor is disconnected.
+size_t simDhtCapture(uint8_t type, uint32_t* pulses, size_t count, unsigned long& frameUs);
+
+// Instantaneous IMU readings
+void simAcceleration(float& x, float& y, float& z);
+void simGyroscope(float& x, float& y, float& z);
+
+// LSM6DSOX register model behind Wire
+bool simImuWrite(uint8_t reg, const uint8_t* data, size_t length);
+size_t simImuRead(uint8_t reg, uint8_t* data, size_t length);
+
+// Pin interrupts. The IMU's INT1 (SIM_IMU_INT1_PIN) rises when the
+// vibration amplitude first exceeds the wake-up threshold, once the
+// firmware has routed the wake-up event to INT1.
+#define SIM_IMU_INT1_PIN 24
+void simAttachInterrupt(int pin, void (*callback)());
+
+// Broker model behind PubSubClient. A link that goes down silently
+// (set link 0) still looks connected for SIM_LINK_DETECT_TIME, like a
+// TCP connection whose keepalive has not failed yet; publishes in that
+// time succeed but never arrive.
+#define SIM_LINK_DETECT_TIME 22500 // ms, 1.5 x the client keepalive
+bool simBrokerConnected();
+void simBrokerSubscribe(const char* topic);
+bool simBrokerPublish(const char* topic, const uint8_t* payload, size_t length, bool retained);
+
+// Next scripted incoming message whose time has come on a subscribed
+// topic. The returned pointers stay valid until the following call.
+bool simBrokerReceive(const char*& topic, const uint8_t*& payload, size_t& length);
+
+// Next pseudo-random value in [-1, 1); seeded by simReset()
+float simNoise();
+
+#endif // SIMULATION_H
@@ -0,0 +1,55 @@
+/*
+ * WiFiNINA.cpp
+ * Host WiFi implementation
+ */
+
+#include "WiFiNINA.h"
+#include "Simulation.h"
+
+WiFiClass WiFi;
+
+int WiFiClass::begin(const char*, const char*) {
+    started = true;
+    joined = false;
+    joinStart = millis();
+
+    unsigned long start = millis();
+    while (status() != WL_CONNECTED && millis() - start < timeout) {
+        delay(100);
+    }
+    return status();
+}
+
+uint8_t WiFiClass::status() {
+    if (!started)
+        return WL_IDLE_STATUS;
+
+    if (!simScenario().wifiAvailable) {
+        // Join from scratch once the network is back
+        if (!joined) {
+            joinStart = millis();
+        }
+        return joined ? WL_CONNECTION_LOST : WL_NO_SSID_AVAIL;
+    }
+
+    if (!joined && millis() - joinStart >= SIM_WIFI_JOIN_MS) {
+        joined = true;
+    }
+    return joined ? WL_CONNECTED : WL_IDLE_STATUS;
+}
+
+const char* WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? "192.168.4.20" : "0.0.0.0";
+}
+
+long WiFiClass::RSSI() {
+    return status() == WL_CONNECTED ? -55 : 0;
+}
+
+// The module's NTP client answers once it is joined
+unsigned long WiFiClass::getTime() {
+    if (status() != WL_CONNECTED || simScenario().epoch == 0)
+        return 0;
+
+    return simScenario().epoch + simMillis() / 1000;
+}
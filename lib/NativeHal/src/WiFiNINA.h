@@ -0,0 +1,52 @@
+/*
+ * WiFiNINA.h
+ * Host WiFi: association follows the scenario's wifi setting
+ *
+ * Joining takes SIM_WIFI_JOIN_MS of virtual time once the network is
+ * available. As in the library, begin() waits for the outcome for up to
+ * the setTimeout() value (0 returns at once, leaving status() to poll).
+ */
+
+#ifndef NATIVE_WIFININA_H
+#define NATIVE_WIFININA_H
+
+#include "Arduino.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_CONNECTION_LOST 5
+#define WL_DISCONNECTED 6
+
+#define SIM_WIFI_JOIN_MS 2000
+#define SIM_WIFI_DEFAULT_TIMEOUT 10000
+
+class WiFiClass {
+  public:
+    WiFiClass()
+        : started(false), joined(false), joinStart(0), timeout(SIM_WIFI_DEFAULT_TIMEOUT) {}
+
+    int begin(const char* ssid, const char* password);
+    void disconnect() { started = false; }
+    void end() { started = false; }
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    void lowPowerMode() {}
+    void noLowPowerMode() {}
+    uint8_t status();
+    const char* localIP();
+    long RSSI();
+    unsigned long getTime();
+
+  private:
+    bool started;
+    bool joined; // Associated since begin(); the module rejoins by itself
+    unsigned long joinStart;
+    unsigned long timeout;
+};
+
+class WiFiClient : public Client {};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFININA_H
@@ -0,0 +1,55 @@
+/*
+ * Wire.cpp
+ * Host I2C bus implementation
+ */
+
+#include "Wire.h"
+#include "Simulation.h"
+
+// Address of the simulated LSM6DSOX
+#define SIM_IMU_ADDRESS 0x6A
+
+TwoWire Wire;
+
+void TwoWire::beginTransmission(uint8_t target) {
+    address = target;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (txLength == sizeof(txBuffer))
+        return 0;
+
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    if (address != SIM_IMU_ADDRESS)
+        return 2;
+
+    // First byte selects the register, any others are written from there
+    if (txLength > 0) {
+        registerPointer = txBuffer[0];
+    }
+    if (txLength > 1) {
+        simImuWrite(registerPointer, txBuffer + 1, txLength - 1);
+    }
+    return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t target, size_t length, bool) {
+    rxLength = rxIndex = 0;
+    if (target != SIM_IMU_ADDRESS)
+        return 0;
+
+    if (length > sizeof(rxBuffer)) {
+        length = sizeof(rxBuffer);
+    }
+    rxLength = simImuRead(registerPointer, rxBuffer, length);
+    return rxLength;
+}
+
+int TwoWire::read() {
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
@@ -0,0 +1,42 @@
+/*
+ * Wire.h
+ * Host I2C bus with the simulated LSM6DSOX as its only device
+ */
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NATIVE_WIRE_BUFFER_SIZE 256
+
+class TwoWire {
+  public:
+    TwoWire() : address(0), txLength(0), rxLength(0), rxIndex(0), registerPointer(0) {}
+
+    void begin() {}
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+
+    // 0 on success, 2 if no device answers at the address
+    uint8_t endTransmission(bool stop = true);
+
+    size_t requestFrom(uint8_t address, size_t length, bool stop = true);
+    int available() { return rxLength - rxIndex; }
+    int read();
+
+  private:
+    uint8_t address;
+    uint8_t txBuffer[NATIVE_WIRE_BUFFER_SIZE];
+    size_t txLength;
+    uint8_t rxBuffer[NATIVE_WIRE_BUFFER_SIZE];
+    size_t rxLength;
+    size_t rxIndex;
+    uint8_t registerPointer;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
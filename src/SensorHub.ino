@@ -18,147 +18,198 @@
 #include "Config.h"
 #include "Constants.h"
 #include "DataProcessing.h"
+#include "DhtPio.h"
+#include "HealthMetrics.h"
+#include "LedPatterns.h"
+#include "LineProtocol.h"
 #include "Network.h"
+#include "OutboundQueue.h"
+#include "Pipeline.h"
+#include "PowerSave.h"
+#include "Scheduler.h"
 #include "Sensors.h"
+#include "TelemetryBatch.h"
 
 //=====================================================================
-// GLOBAL VARIABLES
+// TASKS
 //=====================================================================
+int sensorTaskId = -1;
+int imuTaskId = -1;
+int publishTaskId = -1;
+int drainTaskId = -1;
+
+void mqttTask() {
+    maintainMQTT();
+    outboundService();
+}
 
-// Timing Control
-unsigned long lastSensorReadTime = 0;
-unsigned long lastMqttPublishTime = 0;
-unsigned long lastBatteryCheckTime = 0;
-unsigned long lastConfigSaveTime = 0;
-unsigned long lastNetworkCheckTime = 0;
+void batteryTask() {
+    readBatteryStatus();
 
-//=====================================================================
-// SETUP AND MAIN LOOP
-//=====================================================================
+    if (batteryPercentage < LOW_BATTERY_THRESHOLD && !lowBatteryWarning) {
+        lowBatteryWarning = true;
 
-void setup() {
-    Serial.begin(9600);
-    while (!Serial && millis() < 5000)
-        ;
+        // Flash red LED to indicate low battery
+        startLedPattern(LEDR, 5, LED_BLINK_MEDIUM, LED_BLINK_MEDIUM);
 
-    setupLEDs();
-    EEPROM.begin();
-    loadConfigFromEEPROM();
-
-    initializeOfflineBuffer();
-    setupSensors();
-    readBatteryStatus();
-    setupNetworking();
+        // Queued until the network is back if offline
+        publishLowBatteryAlert();
+    } else if (batteryPercentage >= BATTERY_RECOVERED_THRESHOLD) {
+        lowBatteryWarning = false;
+    }
+}
 
-    // Blink to indicate ready
-    for (int i = 0; i < 3; i++) {
-        digitalWrite(LEDG, HIGH);
-        delay(LED_BLINK_MEDIUM);
-        digitalWrite(LEDG, LOW);
-        delay(LED_BLINK_MEDIUM);
+// Publish as soon as the batch fills rather than at the end of the window
+void sendFullBatch() {
+    if (telemetryBatchFull()) {
+        triggerTask(publishTaskId);
     }
+}
+
+void sensorTask() {
+    // The scheduler times the next run from when this one was due
+    unsigned long due = getTask(sensorTaskId)->nextRun;
+    acquireSample();
 
-    // Send initial configuration status
-    publishDeviceStatus();
+    // Run again when the next channel is due or the DHT transfer has
+    // finished, following remote and adaptive changes to the intervals
+    setTaskPeriod(sensorTaskId, untilNextAcquisition(due));
+
+    processSamples();
+    sendFullBatch();
 }
 
-void loop() {
-    unsigned long currentMillis = millis();
+void samplesTask() {
+    processSamples();
+    sendFullBatch();
+}
 
-    // Check network status regularly
-    if (currentMillis - lastNetworkCheckTime >= NETWORK_CHECK_INTERVAL) {
-        lastNetworkCheckTime = currentMillis;
-        checkNetworkStatus();
-    }
+void publishTask() {
+    // The publish interval bounds how long a batched sample waits
+    setTaskPeriod(publishTaskId, config.mqttPublishInterval);
 
-    // Maintain MQTT connection if network is up
-    if (networkConnected && !mqttClient.connected()) {
-        connectMQTT();
+    if (networkConnected) {
+        // If there was a network outage, start draining the buffered data
+        if (networkWasDown) {
+            networkWasDown = false;
+            triggerTask(drainTaskId);
+        }
+
+        publishTelemetryBatch();
     }
 
-    if (networkConnected) {
-        mqttClient.loop();
+    // Spectra and band levels are taken off the queues with or without a
+    // link, so the band history and its anomaly checks keep running
+    // through an outage; the publishes themselves skip while offline
+    VibrationFeatures features;
+    while (vibrationQueue.pop(features)) {
+        publishVibrationFeatures(features);
     }
 
-    // Check battery status regularly
-    if (currentMillis - lastBatteryCheckTime >= BATTERY_CHECK_INTERVAL) {
-        lastBatteryCheckTime = currentMillis;
-        readBatteryStatus();
-
-        if (batteryPercentage < LOW_BATTERY_THRESHOLD && !lowBatteryWarning) {
-            lowBatteryWarning = true;
-
-            // Flash red LED to indicate low battery
-            for (int i = 0; i < 5; i++) {
-                digitalWrite(LEDR, HIGH);
-                delay(LED_BLINK_MEDIUM);
-                digitalWrite(LEDR, LOW);
-                delay(LED_BLINK_MEDIUM);
-            }
-
-            // Send alert if connected
-            if (networkConnected) {
-                publishLowBatteryAlert();
-            }
-        } else if (batteryPercentage >= BATTERY_RECOVERED_THRESHOLD) {
-            lowBatteryWarning = false;
+    OctaveLevels levels;
+    while (acousticQueue.pop(levels)) {
+        updateAcousticHistory(levels);
+        if (config.anomalyDetectionEnabled) {
+            checkForAcousticAnomalies(levels);
         }
+        publishOctaveLevels(levels);
     }
+}
 
-    // Read sensors at regular intervals
-    if (currentMillis - lastSensorReadTime >= config.sensorReadInterval) {
-        lastSensorReadTime = currentMillis;
-        readSensors();
+// The IMU saw motion during a power-save sleep: sample it now. With two
+// cores the acquisition loop on core1 does this itself.
+void motionWake() {
+#if !SENSORHUB_DUAL_CORE
+    requestMotionSample();
+    triggerTask(imuTaskId);
+    triggerTask(sensorTaskId);
+#endif
+}
 
-        // Detect spikes and anomalies
-        vibrationSpikeDetected = checkForVibrationSpike();
-        soundSpikeDetected = checkForSoundSpike();
+void metricsTask() {
+    publishHealthMetrics();
+}
 
-        if (config.anomalyDetectionEnabled && historyFilled) {
-            checkForAnomalies();
-        }
+void drainTask() {
+    // Runs with nothing left to send too, to confirm what was sent
+    if (networkConnected) {
+        sendBufferedData();
+    }
+}
 
-        // If network is down, store readings in buffer
-        if (!networkConnected) {
-            storeReadingInBuffer();
-            networkWasDown = true;
+//=====================================================================
+// SETUP AND MAIN LOOP
+//=====================================================================
 
-            // Blue LED blink pattern indicates offline storage
-            digitalWrite(LEDB, HIGH);
-            delay(LED_BLINK_SHORT);
-            digitalWrite(LEDB, LOW);
-        }
+void setup() {
+    metricsStackBegin(0);
 
-        // Visual indicator for spikes
-        if (vibrationSpikeDetected || soundSpikeDetected) {
-            digitalWrite(LEDB, HIGH);
+    Serial.begin(9600);
+    while (!Serial && millis() < 5000)
+        ;
 
-            // Send immediate alert if connected
-            if (networkConnected) {
-                publishSpikeAlert();
-            }
+    setupLEDs();
+    EEPROM.begin();
+    loadConfigFromEEPROM();
 
-            delay(LED_BLINK_LONG);
-            digitalWrite(LEDB, LOW);
-        }
-    }
+    initializeOfflineBuffer();
+    initializeSensorHistory();
+    setupSensors();
+    readBatteryStatus();
+    setupNetworking();
 
-    // Publish data at regular intervals when connected
-    if (networkConnected && (currentMillis - lastMqttPublishTime >= config.mqttPublishInterval)) {
-        lastMqttPublishTime = currentMillis;
+    initScheduler(millis);
+    metricsBegin();
+    powerSaveBegin();
+    schedulePeriodic("leds", updateLedPatterns, LED_UPDATE_INTERVAL, DEFAULT_TASK_DEADLINE);
+    schedulePeriodic("mqtt", mqttTask, MQTT_LOOP_INTERVAL, DEFAULT_TASK_DEADLINE);
+    schedulePeriodic("network", serviceNetwork, NETWORK_SERVICE_INTERVAL, DEFAULT_TASK_DEADLINE);
+    schedulePeriodic("battery", batteryTask, BATTERY_CHECK_INTERVAL, DEFAULT_TASK_DEADLINE);
+#if SENSORHUB_DUAL_CORE
+    // Acquisition runs on core1; core0 only consumes the queued samples
+    schedulePeriodic("samples", samplesTask, PIPELINE_SERVICE_INTERVAL, DEFAULT_TASK_DEADLINE);
+#else
+    sensorTaskId = schedulePeriodic("sensors", sensorTask, config.sensorReadInterval,
+                                    DEFAULT_TASK_DEADLINE);
+    imuTaskId = schedulePeriodic("imu", drainImu, IMU_FIFO_DRAIN_INTERVAL,
+                                 DEFAULT_TASK_DEADLINE);
+    schedulePeriodic("audio", drainAudio, AUDIO_SERVICE_INTERVAL, DEFAULT_TASK_DEADLINE);
+#endif
+    publishTaskId = schedulePeriodic("publish", publishTask, config.mqttPublishInterval,
+                                     DEFAULT_TASK_DEADLINE);
+    drainTaskId = schedulePeriodic("drain", drainTask, BUFFER_DRAIN_INTERVAL,
+                                   DEFAULT_TASK_DEADLINE);
+    schedulePeriodic("metrics", metricsTask, METRICS_PUBLISH_INTERVAL, DEFAULT_TASK_DEADLINE,
+                     METRICS_PUBLISH_INTERVAL);
+    schedulePeriodic("power", powerSaveService, POWER_SAVE_CHECK_INTERVAL,
+                     DEFAULT_TASK_DEADLINE);
+
+    // Blink to indicate ready; the device status goes out once the
+    // network task has connected
+    startLedPattern(LEDG, 3, LED_BLINK_MEDIUM, LED_BLINK_MEDIUM);
+
+    startPipeline();
+}
 
-        // If there was a network outage, send buffered data first
-        if (networkWasDown) {
-            sendBufferedData();
-            networkWasDown = false;
-        }
+void loop() {
+    metricsLoopIteration();
 
-        publishToMQTT();
+    // In power save, sleep until the next task is due
+    unsigned long idle = runScheduler();
+    if (powerSaveSleep(idle)) {
+        motionWake();
     }
+}
 
-    // Save configuration if it was changed
-    if (lastConfigSaveTime > 0 && (currentMillis - lastConfigSaveTime) >= CONFIG_SAVE_DELAY) {
-        saveConfigToEEPROM();
-        lastConfigSaveTime = 0;
-    }
+#if SENSORHUB_DUAL_CORE
+//=====================================================================
+// ACQUISITION CORE
+//=====================================================================
+void setup1() {
+    metricsStackBegin(1);
+}
+
+void loop1() {
+    runAcquisitionLoop();
 }
+#endif
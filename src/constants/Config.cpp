@@ -5,7 +5,13 @@
 
 #include "Config.h"
 #include "Buffer.h"
+#include "ChannelSchedule.h"
 #include "Communication.h"
+#include "LineProtocol.h"
+#include "PowerSave.h"
+#include "TelemetryBatch.h"
+#include "Profiler.h"
+#include "Scheduler.h"
 #include <ArduinoJson.h>
 #include <EEPROM.h>
 
@@ -14,18 +20,36 @@ Config config;
 
 // Default configuration
 const Config DEFAULT_CONFIG = {
-    1.2,              // accelSpikeThreshold
-    10000,            // soundSpikeThreshold
-    1000,             // sensorReadInterval (1 sec)
-    5000,             // mqttPublishInterval (5 sec)
-    true,             // anomalyDetectionEnabled
-    3.0,              // anomalyThresholdMultiplier (3 sigma)
-    20,               // offlineBufferSize (entries)
-    CONFIG_SAVED_FLAG // configSaved flag
+    1.2,                 // accelSpikeThreshold
+    10000,               // soundSpikeThreshold
+    1000,                // sensorReadInterval (1 sec)
+    5000,                // mqttPublishInterval (5 sec, longest a sample waits)
+    true,                // anomalyDetectionEnabled
+    3.0,                 // anomalyThresholdMultiplier (3 sigma)
+    86400,               // offlineBufferSize (readings, one day at 1 sec)
+    32,                  // telemetryBatchSize (samples per telemetry message)
+    true,                // imuFifoEnabled (burst-read the IMU FIFO)
+    PAYLOAD_FORMAT_JSON, // payloadFormat
+    false,               // adaptiveSamplingEnabled
+    250,                 // minSensorReadInterval (4 Hz during activity)
+    10000,               // maxSensorReadInterval (10 sec when stable)
+    10,                  // adaptiveQuietReads
+    2.0,                 // activityThreshold (2 sigma)
+    false,               // deadbandEnabled
+    300000,              // heartbeatInterval (5 min)
+    // deadbandAbsolute: temperature, humidity, accel x/y/z, gyro x/y/z, gas ratio, sound
+    {0.2, 1.0, 0.02, 0.02, 0.02, 1.0, 1.0, 1.0, 0, 0},
+    // deadbandPercent: gas and sound levels vary over decades, so relative
+    {0, 0, 0, 0, 0, 0, 0, 0, 2.0, 10.0},
+    POWER_SAVE_AUTO,     // powerSaveMode (engage on battery)
+    300000,              // uploadInterval (5 min)
+    8192,                // drainRate (bytes/s, ~50 JSON readings/s)
+    1024,                // influxMessageSize (bytes, ~8 points per message)
+    // channelInterval: environment at the DHT11's pace, the others on sensorReadInterval
+    {DHT_MIN_INTERVAL, 0, 0, 0},
+    CONFIG_SAVED_FLAG    // configSaved flag
 };
 
-// Timestamp of last config change
-extern unsigned long lastConfigSaveTime;
 
 void loadConfigFromEEPROM() {
     EEPROM.get(0, config);
@@ -40,6 +64,37 @@ void loadConfigFromEEPROM() {
     if (config.offlineBufferSize <= 0 || config.offlineBufferSize > MAX_BUFFER_SIZE) {
         config.offlineBufferSize = DEFAULT_CONFIG.offlineBufferSize;
     }
+
+    if (config.telemetryBatchSize <= 0 || config.telemetryBatchSize > TELEMETRY_BATCH_CAPACITY) {
+        config.telemetryBatchSize = DEFAULT_CONFIG.telemetryBatchSize;
+    }
+
+    if (config.payloadFormat != PAYLOAD_FORMAT_JSON &&
+        config.payloadFormat != PAYLOAD_FORMAT_BINARY) {
+        config.payloadFormat = DEFAULT_CONFIG.payloadFormat;
+    }
+
+    if (config.minSensorReadInterval == 0 ||
+        config.minSensorReadInterval > config.maxSensorReadInterval) {
+        config.minSensorReadInterval = DEFAULT_CONFIG.minSensorReadInterval;
+        config.maxSensorReadInterval = DEFAULT_CONFIG.maxSensorReadInterval;
+    }
+
+    if (config.adaptiveQuietReads == 0) {
+        config.adaptiveQuietReads = DEFAULT_CONFIG.adaptiveQuietReads;
+    }
+
+    if (config.heartbeatInterval == 0) {
+        config.heartbeatInterval = DEFAULT_CONFIG.heartbeatInterval;
+    }
+
+    if (config.powerSaveMode > POWER_SAVE_AUTO) {
+        config.powerSaveMode = DEFAULT_CONFIG.powerSaveMode;
+    }
+
+    if (config.uploadInterval == 0) {
+        config.uploadInterval = DEFAULT_CONFIG.uploadInterval;
+    }
 }
 
 void saveConfigToEEPROM() {
@@ -94,8 +149,147 @@ void processConfigMessage(char* payload, unsigned int length) {
         }
     }
 
+    if (jsonDoc.containsKey("batch_size")) {
+        int newSize = jsonDoc["batch_size"].as<int>();
+        if (newSize > 0 && newSize <= TELEMETRY_BATCH_CAPACITY) {
+            config.telemetryBatchSize = newSize;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("imu_fifo")) {
+        config.imuFifoEnabled = jsonDoc["imu_fifo"].as<bool>();
+        configChanged = true;
+    }
+
+    if (jsonDoc.containsKey("adaptive_sampling")) {
+        config.adaptiveSamplingEnabled = jsonDoc["adaptive_sampling"].as<bool>();
+        configChanged = true;
+    }
+
+    // Both bounds are checked together so either can be sent alone
+    if (jsonDoc.containsKey("min_interval") || jsonDoc.containsKey("max_interval")) {
+        unsigned long newMin = config.minSensorReadInterval;
+        unsigned long newMax = config.maxSensorReadInterval;
+        if (jsonDoc.containsKey("min_interval")) {
+            newMin = jsonDoc["min_interval"].as<unsigned long>();
+        }
+        if (jsonDoc.containsKey("max_interval")) {
+            newMax = jsonDoc["max_interval"].as<unsigned long>();
+        }
+        if (newMin > 0 && newMin <= newMax) {
+            config.minSensorReadInterval = newMin;
+            config.maxSensorReadInterval = newMax;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("quiet_reads")) {
+        int quietReads = jsonDoc["quiet_reads"].as<int>();
+        if (quietReads > 0 && quietReads <= UINT16_MAX) {
+            config.adaptiveQuietReads = quietReads;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("activity_threshold")) {
+        float threshold = jsonDoc["activity_threshold"].as<float>();
+        if (threshold > 0) {
+            config.activityThreshold = threshold;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("deadband")) {
+        config.deadbandEnabled = jsonDoc["deadband"].as<bool>();
+        configChanged = true;
+    }
+
+    if (jsonDoc.containsKey("heartbeat_interval")) {
+        unsigned long heartbeat = jsonDoc["heartbeat_interval"].as<unsigned long>();
+        if (heartbeat > 0) {
+            config.heartbeatInterval = heartbeat;
+            configChanged = true;
+        }
+    }
+
+    // Per channel: "deadband_<channel>" (absolute) and "deadband_<channel>_pct"
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        char key[32];
+        snprintf(key, sizeof(key), "deadband_%s", TELEMETRY_CHANNEL_NAMES[channel]);
+        if (jsonDoc.containsKey(key)) {
+            float threshold = jsonDoc[key].as<float>();
+            if (threshold >= 0) {
+                config.deadbandAbsolute[channel] = threshold;
+                configChanged = true;
+            }
+        }
+
+        strncat(key, "_pct", sizeof(key) - strlen(key) - 1);
+        if (jsonDoc.containsKey(key)) {
+            float threshold = jsonDoc[key].as<float>();
+            if (threshold >= 0) {
+                config.deadbandPercent[channel] = threshold;
+                configChanged = true;
+            }
+        }
+    }
+
+    if (jsonDoc.containsKey("payload_format")) {
+        const char* format = jsonDoc["payload_format"];
+        if (format != NULL && strcmp(format, "json") == 0) {
+            config.payloadFormat = PAYLOAD_FORMAT_JSON;
+            configChanged = true;
+        } else if (format != NULL && strcmp(format, "binary") == 0) {
+            config.payloadFormat = PAYLOAD_FORMAT_BINARY;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("power_save")) {
+        const char* mode = jsonDoc["power_save"];
+        if (parsePowerSaveMode(mode, config.powerSaveMode)) {
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("upload_interval")) {
+        unsigned long interval = jsonDoc["upload_interval"].as<unsigned long>();
+        if (interval > 0) {
+            config.uploadInterval = interval;
+            configChanged = true;
+        }
+    }
+
+    if (jsonDoc.containsKey("drain_rate")) {
+        config.drainRate = jsonDoc["drain_rate"].as<unsigned long>();
+        configChanged = true;
+    }
+
+    // Per channel: "<channel>_interval", 0 to follow sensor_interval
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        char key[32];
+        snprintf(key, sizeof(key), "%s_interval", SENSOR_CHANNEL_NAMES[channel]);
+        if (jsonDoc.containsKey(key)) {
+            unsigned long interval = jsonDoc[key].as<unsigned long>();
+            if (interval == 0 || interval >= SENSOR_INTERVAL_MIN) {
+                config.channelInterval[channel] = interval;
+                configChanged = true;
+            }
+        }
+    }
+
+    if (jsonDoc.containsKey("influx_message_size")) {
+        unsigned long size = jsonDoc["influx_message_size"].as<unsigned long>();
+        if (size >= LINE_PROTOCOL_MESSAGE_MIN && size <= LINE_PROTOCOL_MESSAGE_MAX) {
+            config.influxMessageSize = size;
+            configChanged = true;
+        }
+    }
+
     if (configChanged) {
-        lastConfigSaveTime = millis();
+        // Debounced: further changes within the delay push the save out
+        scheduleOnce("config_save", saveConfigToEEPROM, CONFIG_SAVE_DELAY, DEFAULT_TASK_DEADLINE);
         publishDeviceStatus();
     }
 }
@@ -138,12 +332,29 @@ void processCommandMessage(char* payload, unsigned int length) {
     } else if (strcmp(command, "request_data") == 0) {
         publishToMQTT();
     } else if (strcmp(command, "clear_buffer") == 0) {
-        initializeOfflineBuffer();
+        clearOfflineBuffer();
         mqttClient.publish(MQTT_STATUS_TOPIC, "{\"status\":\"buffer_cleared\"}");
+    } else if (strcmp(command, "profile") == 0) {
+        // {"command": "profile", "reset": true} starts a fresh window after reporting
+        publishProfileReport();
+        if (jsonDoc["reset"]) {
+            profileReset();
+        }
     } else if (strcmp(command, "power_save") == 0) {
-        bool enable = jsonDoc["enable"];
-        // Implementation depends on specific power saving capabilities of your hardware
-        mqttClient.publish(MQTT_STATUS_TOPIC, enable ? "{\"status\":\"power_save_enabled\"}"
-                                                     : "{\"status\":\"power_save_disabled\"}");
+        // {"command": "power_save", "enable": true|false} or {"mode": "auto"};
+        // the power task applies the change within POWER_SAVE_CHECK_INTERVAL
+        uint8_t mode = config.powerSaveMode;
+        if (jsonDoc.containsKey("mode")) {
+            const char* name = jsonDoc["mode"];
+            parsePowerSaveMode(name, mode);
+        } else if (jsonDoc.containsKey("enable")) {
+            mode = jsonDoc["enable"].as<bool>() ? POWER_SAVE_ON : POWER_SAVE_OFF;
+        }
+        if (mode != config.powerSaveMode) {
+            config.powerSaveMode = mode;
+            scheduleOnce("config_save", saveConfigToEEPROM, CONFIG_SAVE_DELAY,
+                         DEFAULT_TASK_DEADLINE);
+        }
+        publishPowerSaveStatus();
     }
 }
@@ -12,6 +12,15 @@
 //=====================================================================
 // CONFIGURATION STRUCTURE
 //=====================================================================
+// Payload encodings for telemetry, buffered data and alerts
+#define PAYLOAD_FORMAT_JSON 0
+#define PAYLOAD_FORMAT_BINARY 1
+
+// Power save: off, always on, or on while running from the battery
+#define POWER_SAVE_OFF 0
+#define POWER_SAVE_ON 1
+#define POWER_SAVE_AUTO 2
+
 struct Config {
     float accelSpikeThreshold;
     int soundSpikeThreshold;
@@ -20,6 +29,25 @@ struct Config {
     bool anomalyDetectionEnabled;
     float anomalyThresholdMultiplier;
     int offlineBufferSize;
+    int telemetryBatchSize;
+    bool imuFifoEnabled;
+    uint8_t payloadFormat;
+    bool adaptiveSamplingEnabled;
+    unsigned long minSensorReadInterval; // Adaptive bounds; sensorReadInterval
+    unsigned long maxSensorReadInterval; // is the starting point
+    uint16_t adaptiveQuietReads;         // Hysteresis before each slow-down
+    float activityThreshold;             // Deviation in std devs that counts as activity
+    bool deadbandEnabled;
+    unsigned long heartbeatInterval; // Longest a channel goes unreported in deadband mode
+    float deadbandAbsolute[TELEMETRY_CHANNELS]; // Per channel, 0 = off
+    float deadbandPercent[TELEMETRY_CHANNELS];  // % of the last reported value, 0 = off
+    uint8_t powerSaveMode;
+    unsigned long uploadInterval; // Radio off time between upload windows in power save
+    unsigned long drainRate;      // Backlog payload bytes per second, 0 = unlimited
+    uint16_t influxMessageSize;   // Line-protocol bytes packed into one MQTT message
+    // ms between reads of each sensor channel (ChannelSchedule.h); 0 follows
+    // sensorReadInterval, or the adaptive interval when that is enabled
+    unsigned long channelInterval[SENSOR_CHANNELS];
     byte configSaved;
 };
 
@@ -24,17 +24,17 @@ const char* MQTT_ALERTS_TOPIC = "sensors/arduino/alerts";
 const char* MQTT_ANOMALIES_TOPIC = "sensors/arduino/anomalies";
 const char* MQTT_BUFFERED_DATA_TOPIC = "sensors/arduino/buffered_data";
 const char* MQTT_INFLUX_TOPIC = "sensors/influx/environment";
+const char* MQTT_VIBRATION_TOPIC = "sensors/arduino/vibration";
+const char* MQTT_ACOUSTIC_TOPIC = "sensors/arduino/acoustic";
+const char* MQTT_PROFILE_TOPIC = "sensors/arduino/profile";
+const char* MQTT_METRICS_TOPIC = "sensors/arduino/metrics";
 
 //=====================================================================
 // SENSOR CONSTANTS
 //=====================================================================
-// Gas Sensor Calibration
-const float R0 = 1.21;
-
 // Microphone Configuration
 const int MIC_CHANNELS = 1;
 const int MIC_FREQUENCY = 16000;
-const int MIC_BUFFER_SIZE = 512;
 
 // Battery Monitoring Configuration
 const float BATTERY_MAX_VOLTAGE = 4.2;
@@ -44,29 +44,36 @@ const float EXTERNAL_POWER_THRESHOLD = 4.8;
 const float LOW_BATTERY_THRESHOLD = 20.0;
 const float BATTERY_RECOVERED_THRESHOLD = 30.0;
 
-//=====================================================================
-// BUFFER CONFIGURATION
-//=====================================================================
-const int BUFFER_BATCH_SIZE = 5;
-
 //=====================================================================
 // ANOMALY DETECTION CONFIGURATION
 //=====================================================================
-const int HISTORY_SIZE = 10;
 const float MIN_TEMP_STD_DEV = 0.1;
-const float MIN_GAS_STD_DEV = 0.01;
+const float MIN_GAS_STD_DEV = 1.0;         // CO ppm, about three ADC codes at 20 ppm
+const float MIN_SOUND_BAND_STD_DEV = 0.5;  // dB
+const float MIN_ACCEL_STD_DEV = 0.005;     // g
+const float MIN_SOUND_STD_DEV = 5.0;       // sample counts
 
 //=====================================================================
 // TIMING CONSTANTS
 //=====================================================================
-const unsigned long NETWORK_CHECK_INTERVAL = 10000; // 10 seconds
+const unsigned long NETWORK_SERVICE_INTERVAL = 100; // 100 ms
 const unsigned long BATTERY_CHECK_INTERVAL = 30000; // 30 seconds
 const unsigned long CONFIG_SAVE_DELAY = 5000;       // 5 seconds
 const unsigned long LED_BLINK_SHORT = 50;           // 50 ms
 const unsigned long LED_BLINK_MEDIUM = 100;         // 100 ms
 const unsigned long LED_BLINK_LONG = 200;           // 200 ms
+const unsigned long LED_UPDATE_INTERVAL = 10;       // 10 ms
+const unsigned long MQTT_LOOP_INTERVAL = 10;        // 10 ms
+const unsigned long BUFFER_DRAIN_INTERVAL = 100;    // 100 ms between batches
+const unsigned long BUFFER_FLUSH_DELAY = 10000;     // 10 seconds in RAM at most
+const unsigned long DEFAULT_TASK_DEADLINE = 50;     // 50 ms
+const unsigned long PIPELINE_SERVICE_INTERVAL = 10; // 10 ms
+const unsigned long IMU_FIFO_DRAIN_INTERVAL = 250;  // 250 ms, ~200 words at 417 Hz
+const unsigned long AUDIO_SERVICE_INTERVAL = 50;    // 50 ms, queue holds >= 128 ms
+const unsigned long METRICS_PUBLISH_INTERVAL = 60000; // 1 minute
+const unsigned long POWER_SAVE_CHECK_INTERVAL = 1000; // 1 second
 
 //=====================================================================
 // EEPROM CONSTANTS
 //=====================================================================
-const byte CONFIG_SAVED_FLAG = 0xAA;
+const uint8_t CONFIG_SAVED_FLAG = 0xB4;
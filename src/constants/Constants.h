@@ -6,17 +6,29 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <stdint.h>
+
 //=====================================================================
 // PIN DEFINITIONS
 //=====================================================================
 #define DHTPIN 13
 #define DHTTYPE DHT11
+// The DHT library returns its cached result for reads closer together,
+// and the sensor itself needs about as long between two reads
+#define DHT_MIN_INTERVAL 2000
 #define GAS_SENSOR_PIN A0
 #define BATTERY_PIN A1
 #define LEDR 22
 #define LEDG 23
 #define LEDB 24
 
+// LSM6DSOX INT1 (GPIO24 on the Nano RP2040 Connect)
+#ifdef INT_IMU
+#define IMU_INT_PIN INT_IMU
+#else
+#define IMU_INT_PIN 24
+#endif
+
 //=====================================================================
 // NETWORK CONFIGURATION
 //=====================================================================
@@ -36,17 +48,24 @@ extern const char* MQTT_ALERTS_TOPIC;
 extern const char* MQTT_ANOMALIES_TOPIC;
 extern const char* MQTT_BUFFERED_DATA_TOPIC;
 extern const char* MQTT_INFLUX_TOPIC;
+extern const char* MQTT_VIBRATION_TOPIC;
+extern const char* MQTT_ACOUSTIC_TOPIC;
+extern const char* MQTT_PROFILE_TOPIC;
+extern const char* MQTT_METRICS_TOPIC;
 
 //=====================================================================
 // SENSOR CONSTANTS
 //=====================================================================
-// Gas Sensor Calibration
-extern const float R0;
+// Gas Sensor Calibration: clean-air Rs/RL, and the ADC codes the gas
+// lookup tables cover
+#define GAS_R0 1.21
+#define GAS_ADC_LEVELS 1024
 
 // Microphone Configuration
 extern const int MIC_CHANNELS;
 extern const int MIC_FREQUENCY;
-extern const int MIC_BUFFER_SIZE;
+#define MIC_BUFFER_SIZE 512
+#define AUDIO_BLOCK_QUEUE_SIZE 8
 
 // Battery Monitoring Configuration
 extern const float BATTERY_MAX_VOLTAGE;
@@ -59,29 +78,66 @@ extern const float BATTERY_RECOVERED_THRESHOLD;
 //=====================================================================
 // BUFFER CONFIGURATION
 //=====================================================================
-#define MAX_BUFFER_SIZE 50
-extern const int BUFFER_BATCH_SIZE;
+#define MAX_BUFFER_SIZE 100000
+
+// Flash region holding the offline log: 4 MB starting 8 MB into the
+// 16 MB QSPI flash, clear of the sketch and of the EEPROM emulation
+// and filesystem areas at the end of flash
+#define FLASH_LOG_OFFSET 0x800000
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_SECTORS 1024
+#define FLASH_LOG_PAGE_SIZE 256
+#define BUFFER_BATCH_SIZE 5
+
+//=====================================================================
+// TELEMETRY BATCHING
+//=====================================================================
+// Most samples one telemetry message can carry
+#define TELEMETRY_BATCH_CAPACITY 64
+// Float columns per sample (TELEMETRY_CHANNEL_NAMES)
+#define TELEMETRY_CHANNELS 10
+#define TELEMETRY_ALL_CHANNELS ((1 << TELEMETRY_CHANNELS) - 1)
+
+//=====================================================================
+// SENSOR CHANNELS
+//=====================================================================
+// Independently scheduled sensors (ChannelSchedule.h)
+#define SENSOR_CHANNELS 4
+#define SENSOR_ALL_CHANNELS ((1 << SENSOR_CHANNELS) - 1)
 
 //=====================================================================
 // ANOMALY DETECTION CONFIGURATION
 //=====================================================================
-extern const int HISTORY_SIZE;
+#define HISTORY_SIZE 100
 extern const float MIN_TEMP_STD_DEV;
 extern const float MIN_GAS_STD_DEV;
+extern const float MIN_SOUND_BAND_STD_DEV;
+extern const float MIN_ACCEL_STD_DEV;
+extern const float MIN_SOUND_STD_DEV;
 
 //=====================================================================
 // TIMING CONSTANTS
 //=====================================================================
-extern const unsigned long NETWORK_CHECK_INTERVAL;
+extern const unsigned long NETWORK_SERVICE_INTERVAL;
 extern const unsigned long BATTERY_CHECK_INTERVAL;
 extern const unsigned long CONFIG_SAVE_DELAY;
 extern const unsigned long LED_BLINK_SHORT;
 extern const unsigned long LED_BLINK_MEDIUM;
 extern const unsigned long LED_BLINK_LONG;
+extern const unsigned long LED_UPDATE_INTERVAL;
+extern const unsigned long MQTT_LOOP_INTERVAL;
+extern const unsigned long BUFFER_DRAIN_INTERVAL;
+extern const unsigned long BUFFER_FLUSH_DELAY;
+extern const unsigned long DEFAULT_TASK_DEADLINE;
+extern const unsigned long PIPELINE_SERVICE_INTERVAL;
+extern const unsigned long IMU_FIFO_DRAIN_INTERVAL;
+extern const unsigned long AUDIO_SERVICE_INTERVAL;
+extern const unsigned long METRICS_PUBLISH_INTERVAL;
+extern const unsigned long POWER_SAVE_CHECK_INTERVAL;
 
 //=====================================================================
 // EEPROM CONSTANTS
 //=====================================================================
-extern const byte CONFIG_SAVED_FLAG;
+extern const uint8_t CONFIG_SAVED_FLAG;
 
 #endif // CONSTANTS_H
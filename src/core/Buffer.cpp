@@ -4,102 +4,511 @@
  */
 
 #include "Buffer.h"
+#include "BinaryTelemetry.h"
+#include "Communication.h"
 #include "Config.h"
+#include "EpochClock.h"
+#include "FlashLog.h"
+#include "Network.h"
+#include "OutboundQueue.h"
+#include "Profiler.h"
+#include "ReadingCodec.h"
+#include "Scheduler.h"
 #include "Sensors.h"
-#include <ArduinoJson.h>
 
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
-SensorReading offlineBuffer[MAX_BUFFER_SIZE];
-int bufferWriteIndex = 0;
-int bufferReadIndex = 0;
 int bufferCount = 0;
 bool networkWasDown = false;
 
-// External MQTT client
-extern PubSubClient mqttClient;
+// Block currently being filled in RAM, and the logged block being sent
+static uint8_t openBlock[COMPRESSED_BLOCK_SIZE];
+static BlockEncoder openEncoder;
+static uint8_t sendBlock[COMPRESSED_BLOCK_SIZE];
+
+// Numbers this boot's blocks, one past the last boot found in the log
+// (never 0, which is what version 1 blocks decode as)
+static uint16_t bootNumber = 1;
+
+// Sent batches waiting for their session to be confirmed, merged into one
+// mark per DRAIN_MARK_SPAN; each holds the send position after its batches
+struct DrainMark {
+    FlashLogCursor record;
+    uint16_t offset;
+    uint16_t entries;
+    uint32_t session;
+    unsigned long opened;
+    unsigned long sentAt;
+};
+
+// The send position runs ahead of the log's consumed point, which only
+// moves once the batches before it are confirmed. A lost session sends
+// again from the last confirmed reading.
+static FlashLogCursor sendCursor;   // Record being sent
+static uint16_t sentFromBlock = 0;  // Readings of it already sent
+static uint16_t ackedFromBlock = 0; // Readings of the oldest record confirmed
+static DrainMark marks[DRAIN_MARKS];
+static uint8_t markHead = 0;
+static uint8_t markCount = 0;
+static uint32_t droppedSeen = 0;
+
+// A batch whose JSON went out but whose line protocol did not: the retry
+// sends the line protocol only, unless the JSON's session has ended
+static bool influxOwed = false;
+static uint32_t owedSession = 0;
+static size_t owedBytes = 0;
+
+// Started when a batch first waits for the time; past BUFFER_EPOCH_WAIT
+// the batches still without it go out as JSON only
+static bool epochWaitStarted = false;
+static unsigned long epochWaitStart = 0;
+
+// Byte budget for DRAIN_RATE pacing; may go negative after a large batch
+static long drainBudget = 0;
+static unsigned long budgetUpdated = 0;
+
+static DrainStats drainStats;
+
+// First byte of a logged message; never a reading block version
+static const uint8_t MESSAGE_RECORD = 0xA5;
+static const uint8_t MESSAGE_TOPIC_MAX = 64;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+// Message record: MESSAGE_RECORD, topic length, topic, payload
+static bool isMessageRecord(const uint8_t* record, uint16_t length) {
+    return length >= 2 && record[0] == MESSAGE_RECORD && record[1] <= MESSAGE_TOPIC_MAX &&
+           2 + record[1] <= length;
+}
+
+// Entries a logged record adds to bufferCount
+static uint16_t recordEntryCount(const uint8_t* record, uint16_t length) {
+    if (isMessageRecord(record, length))
+        return 1;
+
+    BlockDecoder decoder;
+    return blockDecoderBegin(decoder, record, length) ? decoder.count : 0;
+}
+
+static void flushOpenBlock() {
+    if (openEncoder.count == 0)
+        return;
+
+    // Stamp the Unix time if it is known by now; if not, it may be by the
+    // time the block is sent, as long as that is still in this boot
+    blockEncoderSetOrigin(openEncoder, bootNumber,
+                          epochAt(epochClock(), openEncoder.firstTimestamp));
+
+    if (!flashLogAppend(openBlock, blockEncoderSize(openEncoder))) {
+        Serial.println("Failed to store block in offline log");
+        bufferCount -= openEncoder.count;
+    }
+    blockEncoderBegin(openEncoder, openBlock);
+}
+
+// Forget what is in flight and send again from the last confirmed reading
+static void rewindDrain() {
+    flashLogRewind(sendCursor);
+    sentFromBlock = ackedFromBlock;
+    markCount = 0;
+    influxOwed = false;
+    bufferCount += drainStats.unconfirmed;
+    drainStats.unconfirmed = 0;
+}
+
+// Drop the oldest logged block to stay within the configured retention
+static void dropOldestBlock() {
+    rewindDrain();
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+
+    uint16_t length = flashLogRead(cursor, sendBlock, sizeof(sendBlock));
+    if (length == 0)
+        return;
+
+    bufferCount -= recordEntryCount(sendBlock, length) - ackedFromBlock;
+    ackedFromBlock = 0;
+    sentFromBlock = 0;
+    flashLogConsume(cursor);
+    flashLogRewind(sendCursor);
+}
+
+// Consume what confirmed sessions carried; rewind if a session was lost
+static void confirmMarks() {
+    while (markCount > 0) {
+        DrainMark& mark = marks[markHead];
+        MqttDelivery delivery = mqttDelivery(mark.session, mark.sentAt);
+        if (delivery == DELIVERY_PENDING)
+            return;
+
+        if (delivery == DELIVERY_LOST) {
+            Serial.print("Backlog session lost, resending ");
+            Serial.print(drainStats.unconfirmed);
+            Serial.println(" unconfirmed entries");
+            drainStats.rewinds++;
+            drainStats.resent += drainStats.unconfirmed;
+            rewindDrain();
+            return;
+        }
+
+        flashLogConsume(mark.record);
+        ackedFromBlock = mark.offset;
+        drainStats.unconfirmed -= mark.entries;
+        markHead = (markHead + 1) % DRAIN_MARKS;
+        markCount--;
+    }
+}
+
+// Note the send position after a published batch (or a skipped record)
+static void markSent(uint16_t entries, size_t bytes, unsigned long now) {
+    uint32_t session = mqttSession();
+    DrainMark* mark = markCount > 0 ? &marks[(markHead + markCount - 1) % DRAIN_MARKS] : NULL;
+
+    // confirmMarks() has settled every older session, so a full ring can
+    // always merge into its newest mark
+    if (markCount < DRAIN_MARKS && (mark == NULL || mark->session != session ||
+                                    now - mark->opened >= DRAIN_MARK_SPAN)) {
+        mark = &marks[(markHead + markCount) % DRAIN_MARKS];
+        markCount++;
+        mark->entries = 0;
+        mark->session = session;
+        mark->opened = now;
+    }
+
+    mark->record = sendCursor;
+    mark->offset = sentFromBlock;
+    mark->entries += entries;
+    mark->sentAt = now;
+
+    drainStats.unconfirmed += entries;
+    if (entries > 0) {
+        drainStats.batches++;
+        drainStats.bytes += bytes;
+        drainBudget -= (long)bytes;
+    }
+}
+
+static void refillBudget(unsigned long now) {
+    unsigned long elapsed = now - budgetUpdated;
+    budgetUpdated = now;
+    if (elapsed > 1000) {
+        elapsed = 1000;
+    }
+
+    // Allow a short burst, so a budget below one batch still gets through
+    long cap = (long)(config.drainRate * DRAIN_BURST_TIME / 1000);
+    drainBudget += (long)(config.drainRate * elapsed / 1000);
+    if (drainBudget > cap) {
+        drainBudget = cap;
+    }
+}
+
+// Returns the payload size, or 0 if the publish failed
+static size_t publishBatch(const SensorReading* batch, int count) {
+    if (binaryPayloadsEnabled()) {
+        uint8_t payload[BINARY_TELEMETRY_HEADER_SIZE + 2 +
+                        BUFFER_BATCH_SIZE * BINARY_BUFFERED_READING_SIZE];
+        size_t length = beginBufferedBatch(payload, sizeof(payload), millis(), isOnBattery);
+        for (int i = 0; i < count; i++) {
+            length = addBufferedReading(payload, sizeof(payload), length, batch[i]);
+        }
+        return mqttClient.publish(MQTT_BUFFERED_DATA_TOPIC, payload, length) ? length : 0;
+    }
+
+    size_t length = 0;
+    bool published = publishJson(MQTT_BUFFERED_DATA_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.beginArray("buffered_data");
+        for (int i = 0; i < count; i++) {
+            const SensorReading& reading = batch[i];
+            json.beginObject();
+            json.field("timestamp", reading.timestamp);
+            json.field("temperature", reading.temperature);
+            json.field("humidity", reading.humidity);
+            json.field("accel_magnitude", reading.accelMagnitude);
+            json.field("gas_ratio", reading.gasRatio);
+            json.field("sound_level", reading.soundLevel);
+            json.field("battery", reading.batteryPercentage);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    }, false, &length);
+    return published ? length : 0;
+}
 
 //=====================================================================
 // BUFFER FUNCTIONS
 //=====================================================================
 void initializeOfflineBuffer() {
-    for (int i = 0; i < MAX_BUFFER_SIZE; i++) {
-        offlineBuffer[i].valid = false;
+    if (!flashLogBegin()) {
+        Serial.println("Offline log unavailable!");
     }
-    bufferWriteIndex = 0;
-    bufferReadIndex = 0;
+
+    blockEncoderBegin(openEncoder, openBlock);
+    sentFromBlock = 0;
+    ackedFromBlock = 0;
+    markCount = 0;
+    droppedSeen = flashLogStats().dropped;
+
+    // Count the readings held in blocks kept across the reset
+    FlashLogCursor cursor;
+    uint16_t length;
+    uint16_t lastBoot = 0;
     bufferCount = 0;
-}
+    flashLogRewind(cursor);
+    while ((length = flashLogRead(cursor, sendBlock, sizeof(sendBlock))) > 0) {
+        bufferCount += recordEntryCount(sendBlock, length);
 
-void storeReadingInBuffer() {
-    if (bufferCount >= config.offlineBufferSize) {
-        // Buffer is full, oldest data will be overwritten
-        bufferReadIndex = (bufferReadIndex + 1) % config.offlineBufferSize;
-    } else {
-        bufferCount++;
+        BlockDecoder decoder;
+        if (!isMessageRecord(sendBlock, length) &&
+            blockDecoderBegin(decoder, sendBlock, length)) {
+            lastBoot = decoder.boot;
+        }
     }
+    bootNumber = lastBoot == 0xFFFF ? 1 : lastBoot + 1;
+
+    flashLogRewind(sendCursor);
 
-    // Store current sensor data
-    offlineBuffer[bufferWriteIndex].timestamp = millis();
-    offlineBuffer[bufferWriteIndex].temperature = temperature;
-    offlineBuffer[bufferWriteIndex].humidity = humidity;
-    offlineBuffer[bufferWriteIndex].accelMagnitude = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-    offlineBuffer[bufferWriteIndex].gasRatio = gasRatio;
-    offlineBuffer[bufferWriteIndex].soundLevel = soundLevel;
-    offlineBuffer[bufferWriteIndex].batteryPercentage = batteryPercentage;
-    offlineBuffer[bufferWriteIndex].valid = true;
+    Serial.print("Offline log mounted. Pending readings: ");
+    Serial.println(bufferCount);
+}
+
+void clearOfflineBuffer() {
+    flashLogClear();
+    blockEncoderBegin(openEncoder, openBlock);
+    flashLogRewind(sendCursor);
+    sentFromBlock = 0;
+    ackedFromBlock = 0;
+    markCount = 0;
+    drainStats.unconfirmed = 0;
+    bufferCount = 0;
+}
+
+void storeReadingInBuffer(const SensorSample& sample) {
+    SensorReading reading;
+    reading.timestamp = sample.timestamp;
+    reading.temperature = sample.environmentValid ? sample.temperature : NAN;
+    reading.humidity = sample.environmentValid ? sample.humidity : NAN;
+    reading.accelMagnitude =
+        sample.accelValid ? sqrt(sample.Ax * sample.Ax + sample.Ay * sample.Ay +
+                                 sample.Az * sample.Az)
+                          : NAN;
+    reading.gasRatio = sample.gasValid ? sample.gasRatio : NAN;
+    reading.soundLevel = sample.soundValid ? sample.soundLevel : NAN;
+    reading.batteryPercentage = batteryPercentage;
+
+    // Readings are compressed into a RAM block that goes to flash when
+    // full, or once its first reading has waited BUFFER_FLUSH_DELAY
+    if (!blockEncoderAdd(openEncoder, reading)) {
+        flushOpenBlock();
+        blockEncoderAdd(openEncoder, reading);
+    }
+    if (openEncoder.count == 1) {
+        scheduleOnce("buffer_flush", flushOpenBlock, BUFFER_FLUSH_DELAY, DEFAULT_TASK_DEADLINE);
+    }
+    bufferCount++;
 
-    // Move write pointer
-    bufferWriteIndex = (bufferWriteIndex + 1) % config.offlineBufferSize;
+    // Keep within the configured retention, dropping the oldest first
+    if (bufferCount > config.offlineBufferSize && flashLogPending() > 0) {
+        dropOldestBlock();
+    }
 
     Serial.print("Reading stored in buffer. Count: ");
     Serial.println(bufferCount);
 }
 
-void sendBufferedData() {
-    Serial.print("Sending buffered data (");
-    Serial.print(bufferCount);
-    Serial.println(" readings)");
+bool storeMessageInBuffer(const char* topic, const uint8_t* payload, uint16_t length) {
+    uint8_t record[2 + MESSAGE_TOPIC_MAX + OUTBOUND_PAYLOAD_SIZE];
+    size_t topicLength = strlen(topic);
+    if (topicLength > MESSAGE_TOPIC_MAX || length > OUTBOUND_PAYLOAD_SIZE)
+        return false;
+
+    record[0] = MESSAGE_RECORD;
+    record[1] = (uint8_t)topicLength;
+    memcpy(record + 2, topic, topicLength);
+    memcpy(record + 2 + topicLength, payload, length);
+
+    if (!flashLogAppend(record, 2 + topicLength + length))
+        return false;
+
+    bufferCount++;
+    networkWasDown = true;
+
+    // Keep within the configured retention, dropping the oldest first
+    if (bufferCount > config.offlineBufferSize && flashLogPending() > 1) {
+        dropOldestBlock();
+    }
+    return true;
+}
+
+// Returns the payload size, or 0 if the publish failed
+static size_t publishMessageRecord(const uint8_t* record, uint16_t length) {
+    char topic[MESSAGE_TOPIC_MAX + 1];
+    uint8_t topicLength = record[1];
+    memcpy(topic, record + 2, topicLength);
+    topic[topicLength] = '\0';
+
+    size_t size = length - 2 - topicLength;
+    return mqttClient.publish(topic, record + 2 + topicLength, size) ? size : 0;
+}
+
+// Publish the next batch from the send position. Returns false when
+// there is nothing more to send now.
+static bool sendNextBatch(unsigned long now) {
+    FlashLogCursor next = sendCursor;
+    uint16_t length = flashLogRead(next, sendBlock, sizeof(sendBlock));
+
+    // Readings still in the RAM block go out once the log has been sent
+    if (length == 0 && openEncoder.count > 0) {
+        flushOpenBlock();
+        next = sendCursor;
+        length = flashLogRead(next, sendBlock, sizeof(sendBlock));
+    }
+    if (length == 0) {
+        bufferCount = openEncoder.count;
+        return false;
+    }
+
+    if (isMessageRecord(sendBlock, length)) {
+        size_t bytes = publishMessageRecord(sendBlock, length);
+        if (bytes == 0)
+            return false;
+
+        sendCursor = next;
+        sentFromBlock = 0;
+        bufferCount--;
+        markSent(1, bytes, now);
+        return true;
+    }
+
+    BlockDecoder decoder;
+    if (!blockDecoderBegin(decoder, sendBlock, length)) {
+        // Unreadable block: skip it rather than stall the backlog
+        sendCursor = next;
+        sentFromBlock = 0;
+        markSent(0, 0, now);
+        return true;
+    }
 
-    // Send each buffered reading in batches
+    // Where the block's device timestamps fall in Unix time. Without it
+    // the line protocol would land at the time of sending, so for a block
+    // of this boot it waits a while for the clock (the JSON does not); a
+    // block of an earlier boot never will place, and goes out as JSON only.
+    EpochReference clock = {decoder.firstEpoch, decoder.firstTimestamp};
+    bool waitForClock = false;
+    if (clock.epochMs == 0 && decoder.boot == bootNumber) {
+        clock = epochClock();
+        if (clock.epochMs == 0) {
+            if (!epochWaitStarted) {
+                epochWaitStarted = true;
+                epochWaitStart = now;
+            }
+            waitForClock = now - epochWaitStart < BUFFER_EPOCH_WAIT;
+        }
+    }
+
+    SensorReading batch[BUFFER_BATCH_SIZE];
+    SensorReading reading;
     int sentCount = 0;
 
-    while (bufferCount > 0) {
-        StaticJsonDocument<1024> jsonDoc;
-        JsonArray dataArray = jsonDoc.createNestedArray("buffered_data");
-
-        // Create a batch of readings
-        for (int i = 0; i < BUFFER_BATCH_SIZE && bufferCount > 0; i++) {
-            if (offlineBuffer[bufferReadIndex].valid) {
-                JsonObject reading = dataArray.createNestedObject();
-                reading["timestamp"] = offlineBuffer[bufferReadIndex].timestamp;
-                reading["temperature"] = offlineBuffer[bufferReadIndex].temperature;
-                reading["humidity"] = offlineBuffer[bufferReadIndex].humidity;
-                reading["accel_magnitude"] = offlineBuffer[bufferReadIndex].accelMagnitude;
-                reading["gas_ratio"] = offlineBuffer[bufferReadIndex].gasRatio;
-                reading["sound_level"] = offlineBuffer[bufferReadIndex].soundLevel;
-                reading["battery"] = offlineBuffer[bufferReadIndex].batteryPercentage;
-
-                sentCount++;
+    // Skip what earlier batches already sent from this block
+    uint16_t skipped = 0;
+    while (skipped < sentFromBlock && blockDecoderNext(decoder, reading)) {
+        skipped++;
+    }
+
+    while (sentCount < BUFFER_BATCH_SIZE && blockDecoderNext(decoder, batch[sentCount])) {
+        sentCount++;
+    }
+
+    // The decoder stopping short of a full batch means the block is done
+    // (or the rest of it is unreadable)
+    bool blockDone = sentCount < BUFFER_BATCH_SIZE;
+    size_t bytes = 0;
+
+    if (sentCount > 0) {
+        // The block stays in the log until all of it is confirmed
+        if (!influxOwed || owedSession != mqttSession()) {
+            owedBytes = publishBatch(batch, sentCount);
+            if (owedBytes == 0)
+                return false;
+            owedSession = mqttSession();
+        }
+
+        // The same readings as line protocol, retried on its own
+        if (waitForClock) {
+            influxOwed = true;
+            return false;
+        }
+        size_t lines = 0;
+        if (clock.epochMs != 0) {
+            lines = publishInfluxReadings(batch, sentCount, clock);
+            if (lines == 0) {
+                influxOwed = true;
+                return false;
             }
+        }
+        influxOwed = false;
+        bytes = owedBytes + lines;
 
-            // Mark as invalid and move read pointer
-            offlineBuffer[bufferReadIndex].valid = false;
-            bufferReadIndex = (bufferReadIndex + 1) % config.offlineBufferSize;
-            bufferCount--;
+        sentFromBlock += sentCount;
+        bufferCount -= sentCount;
+    }
+
+    if (blockDone) {
+        if (sentFromBlock < decoder.count) {
+            bufferCount -= decoder.count - sentFromBlock;
         }
+        sendCursor = next;
+        sentFromBlock = 0;
+    }
+
+    markSent(sentCount, bytes, now);
+    return true;
+}
+
+void sendBufferedData() {
+    // Alerts waiting in the outbound queue go first
+    if (!outboundService())
+        return;
 
-        // Send the batch
-        char jsonBuffer[1024];
-        serializeJson(jsonDoc, jsonBuffer);
-        mqttClient.publish(MQTT_BUFFERED_DATA_TOPIC, jsonBuffer);
+    confirmMarks();
 
-        // Brief delay to prevent overwhelming the broker
-        delay(100);
+    // Records under the send position went when the ring wrapped
+    if (flashLogStats().dropped != droppedSeen) {
+        droppedSeen = flashLogStats().dropped;
+        ackedFromBlock = 0;
+        rewindDrain();
     }
 
-    Serial.print("Sent ");
-    Serial.print(sentCount);
-    Serial.println(" buffered readings");
+    unsigned long now = millis();
+    refillBudget(now);
+    if (bufferCount == 0)
+        return;
+
+    PROFILE_SCOPE(PROFILE_BUFFER_DRAIN);
+
+    // A few batches per run at most, within the byte budget, so live
+    // telemetry and sampling keep their share
+    int batches = 0;
+    while (batches < BUFFER_DRAIN_BATCHES && (config.drainRate == 0 || drainBudget > 0) &&
+           bufferCount > 0 && sendNextBatch(now)) {
+        batches++;
+    }
+
+    if (batches > 0) {
+        Serial.print("Sent ");
+        Serial.print(batches);
+        Serial.print(" buffered batches, ");
+        Serial.print(bufferCount);
+        Serial.println(" remaining");
+    }
+}
+
+void bufferDrainTakeStats(DrainStats& stats) {
+    stats = drainStats;
 }
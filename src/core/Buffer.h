@@ -1,48 +1,80 @@
 /*
  * Buffer.h
  * Offline data buffer management
+ *
+ * Readings taken while offline are appended to a persistent log in
+ * flash, so an outage of hours survives a reset. They are compressed
+ * into a RAM block first, which goes to flash when it fills or
+ * BUFFER_FLUSH_DELAY after its first reading, whichever is sooner: a
+ * reset loses at most the readings of the last BUFFER_FLUSH_DELAY
+ * (10 s). Alerts the outbound queue could not deliver are logged
+ * alongside them as whole messages and republished on their own topic
+ * when the backlog drains.
+ *
+ * The backlog drains in the background, a few batches per drain task run
+ * within a config.drainRate byte budget, so live telemetry keeps its
+ * rate alongside it. Sent batches stay in the log until the MQTT session
+ * that carried them is confirmed (mqttDelivery() in Network.h); if it is
+ * lost the drain resumes from the last confirmed reading.
  */
 
 #ifndef BUFFER_H
 #define BUFFER_H
 
 #include "Constants.h"
+#include "SensorReading.h"
 #include <Arduino.h>
 
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define BUFFER_DRAIN_BATCHES 8  // Most batches one drain run may send
+#define DRAIN_MARKS 32          // Unconfirmed positions kept, one per span
+#define DRAIN_MARK_SPAN 1000    // ms; covers MQTT_CONFIRM_TIME with DRAIN_MARKS
+#define DRAIN_BURST_TIME 250    // ms of config.drainRate that may be sent at once
+#define BUFFER_EPOCH_WAIT 60000 // ms this boot's line protocol waits for the time
+
 //=====================================================================
 // DATA STRUCTURES
 //=====================================================================
-// Network buffer for offline storage
-struct SensorReading {
-    unsigned long timestamp;
-    float temperature;
-    float humidity;
-    float accelMagnitude;
-    float gasRatio;
-    float soundLevel;
-    float batteryPercentage;
-    bool valid;
+// Counters run from boot so dashboards can difference them
+struct DrainStats {
+    uint32_t batches;   // Batches and buffered messages published
+    uint32_t bytes;     // Their payload bytes
+    uint32_t rewinds;   // Sessions lost with batches unconfirmed
+    uint32_t resent;    // Entries sent again after a rewind
+    int unconfirmed;    // Entries sent but not yet confirmed
 };
 
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
-extern SensorReading offlineBuffer[MAX_BUFFER_SIZE];
-extern int bufferWriteIndex;
-extern int bufferReadIndex;
-extern int bufferCount;
+extern int bufferCount; // Readings and messages not yet sent
 extern bool networkWasDown;
 
 //=====================================================================
 // FUNCTION PROTOTYPES
 //=====================================================================
-// Initialize the offline buffer
+// Mount the offline log and recover readings kept across a reset
 void initializeOfflineBuffer();
 
-// Store current sensor readings in buffer
-void storeReadingInBuffer();
+// Discard all buffered readings
+void clearOfflineBuffer();
 
-// Send all buffered data to MQTT broker
+// Store a sample in the buffer at its own timestamp. Channels it did not
+// read are stored as NaN; the battery level is the latest one.
+struct SensorSample;
+void storeReadingInBuffer(const SensorSample& sample);
+
+// Log a message for publishing with the backlog. topic must be one of
+// the constant topic strings.
+bool storeMessageInBuffer(const char* topic, const uint8_t* payload, uint16_t length);
+
+// Confirm what earlier runs sent, then send the next batches of buffered
+// data and buffered messages as the budget allows. Runs as the drain task
+// while online.
 void sendBufferedData();
 
+void bufferDrainTakeStats(DrainStats& stats);
+
 #endif // BUFFER_H
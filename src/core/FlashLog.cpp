@@ -0,0 +1,438 @@
+/*
+ * FlashLog.cpp
+ * Append-only flash record log implementation
+ */
+
+#include "FlashLog.h"
+#include "FlashStorage.h"
+#include <stddef.h>
+#include <string.h>
+
+//=====================================================================
+// ON-FLASH LAYOUT
+//=====================================================================
+static const uint32_t SECTOR_MAGIC = 0x474C4853; // "SHLG"
+static const uint8_t SECTOR_IN_USE = 0xFF;
+static const uint8_t SECTOR_DRAINED = 0x00;      // Every record consumed
+static const uint8_t RECORD_VALID = 0xA5;
+static const uint8_t RECORD_CONSUMED = 0x00;
+static const uint8_t RECORD_ERASED = 0xFF;
+
+struct SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint8_t state;
+    uint8_t reserved[3];
+    uint32_t crc; // Over magic and sequence
+};
+
+struct RecordHeader {
+    uint8_t state;
+    uint8_t reserved;
+    uint16_t length;
+    uint32_t crc; // Over length and payload
+};
+
+static const uint16_t SECTOR_HEADER_SIZE = sizeof(SectorHeader);
+static const uint16_t RECORD_HEADER_SIZE = sizeof(RecordHeader);
+static const uint16_t MAX_RECORD_LENGTH =
+    FLASH_LOG_SECTOR_SIZE - SECTOR_HEADER_SIZE - RECORD_HEADER_SIZE;
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+static bool mounted = false;
+static bool hasHead = false;
+static uint16_t headSector = 0;
+static uint32_t headSequence = 0;
+static uint16_t writeOffset = FLASH_LOG_SECTOR_SIZE;
+static FlashLogCursor readCursor = {0, SECTOR_HEADER_SIZE};
+static uint32_t pendingRecords = 0;
+static FlashLogStats stats;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static uint32_t crc32Update(uint32_t crc, const void* data, uint32_t length) {
+    // Nibble-wise table keeps the footprint small on the Cortex-M0+
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static uint16_t paddedLength(uint16_t length) {
+    return (length + 3) & ~3;
+}
+
+static uint32_t sectorAddress(uint16_t sector) {
+    return (uint32_t)sector * FLASH_LOG_SECTOR_SIZE;
+}
+
+static uint16_t nextSector(uint16_t sector) {
+    return (sector + 1) % FLASH_LOG_SECTORS;
+}
+
+static bool readSectorHeader(uint16_t sector, SectorHeader& header) {
+    if (!flashStorageRead(sectorAddress(sector), &header, sizeof(header)))
+        return false;
+
+    return header.magic == SECTOR_MAGIC && header.crc == crc32Update(0, &header, 8);
+}
+
+static bool readRecordHeader(const FlashLogCursor& cursor, RecordHeader& header) {
+    return flashStorageRead(sectorAddress(cursor.sector) + cursor.offset, &header,
+                            sizeof(header));
+}
+
+static bool isErased(const RecordHeader& header) {
+    return header.state == RECORD_ERASED && header.reserved == 0xFF &&
+           header.length == 0xFFFF && header.crc == 0xFFFFFFFF;
+}
+
+static bool atWriteEnd(const FlashLogCursor& cursor) {
+    return !hasHead || (cursor.sector == headSector && cursor.offset >= writeOffset);
+}
+
+// Move the cursor to the next record header at or after its position,
+// crossing into newer sectors as needed. Returns false at the write end.
+static bool locateRecord(FlashLogCursor& cursor, RecordHeader& header) {
+    while (!atWriteEnd(cursor)) {
+        bool sectorDone = cursor.offset + RECORD_HEADER_SIZE > FLASH_LOG_SECTOR_SIZE;
+
+        if (!sectorDone) {
+            readRecordHeader(cursor, header);
+            if (isErased(header)) {
+                sectorDone = true;
+            } else if (header.length > MAX_RECORD_LENGTH ||
+                       cursor.offset + RECORD_HEADER_SIZE + paddedLength(header.length) >
+                           FLASH_LOG_SECTOR_SIZE) {
+                // Damaged header: the rest of this sector cannot be trusted
+                stats.corrupt++;
+                sectorDone = true;
+            }
+        }
+
+        if (!sectorDone)
+            return true;
+        if (cursor.sector == headSector)
+            break;
+
+        cursor.sector = nextSector(cursor.sector);
+        cursor.offset = SECTOR_HEADER_SIZE;
+    }
+
+    return false;
+}
+
+static void skipRecord(FlashLogCursor& cursor, const RecordHeader& header) {
+    cursor.offset += RECORD_HEADER_SIZE + paddedLength(header.length);
+}
+
+static void markSectorDrained(uint16_t sector) {
+    uint8_t state = SECTOR_DRAINED;
+    flashStorageProgram(sectorAddress(sector) + offsetof(SectorHeader, state), &state, 1);
+}
+
+// Count unconsumed records in one sector
+static uint32_t countPending(uint16_t sector, FlashLogCursor* firstPending) {
+    uint32_t count = 0;
+    FlashLogCursor cursor = {sector, SECTOR_HEADER_SIZE};
+    RecordHeader header;
+
+    while (locateRecord(cursor, header) && cursor.sector == sector) {
+        if (header.state == RECORD_VALID) {
+            if (count == 0 && firstPending != NULL)
+                *firstPending = cursor;
+            count++;
+        }
+        skipRecord(cursor, header);
+    }
+
+    return count;
+}
+
+// Start a fresh sector after the head, reclaiming the oldest if needed
+static bool openNextSector() {
+    uint16_t sector = hasHead ? nextSector(headSector) : 0;
+    SectorHeader header;
+
+    if (hasHead && readSectorHeader(sector, header) && header.state != SECTOR_DRAINED) {
+        // Ring is full: the oldest sector is about to be overwritten
+        uint32_t lost = countPending(sector, NULL);
+        stats.dropped += lost;
+        pendingRecords -= lost;
+    }
+
+    if (readCursor.sector == sector) {
+        readCursor.sector = nextSector(sector);
+        readCursor.offset = SECTOR_HEADER_SIZE;
+    }
+
+    if (!flashStorageEraseSector(sector))
+        return false;
+    stats.erases++;
+
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = SECTOR_MAGIC;
+    header.sequence = headSequence + 1;
+    header.state = SECTOR_IN_USE;
+    header.crc = crc32Update(0, &header, 8);
+    if (!flashStorageProgram(sectorAddress(sector), &header, sizeof(header)))
+        return false;
+
+    bool wasEmpty = pendingRecords == 0;
+    hasHead = true;
+    headSector = sector;
+    headSequence = header.sequence;
+    writeOffset = SECTOR_HEADER_SIZE;
+
+    if (wasEmpty) {
+        readCursor.sector = headSector;
+        readCursor.offset = writeOffset;
+    }
+
+    return true;
+}
+
+// Find where the head sector's written area ends
+static void recoverWriteOffset() {
+    FlashLogCursor cursor = {headSector, SECTOR_HEADER_SIZE};
+    RecordHeader header;
+    static uint8_t payload[MAX_RECORD_LENGTH];
+
+    writeOffset = FLASH_LOG_SECTOR_SIZE;
+    while (cursor.offset + RECORD_HEADER_SIZE <= FLASH_LOG_SECTOR_SIZE) {
+        readRecordHeader(cursor, header);
+
+        if (isErased(header)) {
+            // Anything programmed past this point is a torn write
+            uint8_t tail[64];
+            uint32_t position = cursor.offset;
+            bool clean = true;
+
+            while (clean && position < FLASH_LOG_SECTOR_SIZE) {
+                uint32_t chunk = FLASH_LOG_SECTOR_SIZE - position;
+                if (chunk > sizeof(tail))
+                    chunk = sizeof(tail);
+                flashStorageRead(sectorAddress(headSector) + position, tail, chunk);
+                for (uint32_t i = 0; i < chunk; i++) {
+                    clean = clean && tail[i] == 0xFF;
+                }
+                position += chunk;
+            }
+
+            if (clean)
+                writeOffset = cursor.offset;
+            else
+                stats.corrupt++;
+            return;
+        }
+
+        if (header.length > MAX_RECORD_LENGTH ||
+            cursor.offset + RECORD_HEADER_SIZE + paddedLength(header.length) >
+                FLASH_LOG_SECTOR_SIZE) {
+            stats.corrupt++;
+            return;
+        }
+
+        flashStorageRead(sectorAddress(headSector) + cursor.offset + RECORD_HEADER_SIZE, payload,
+                         header.length);
+        uint32_t crc = crc32Update(0, &header.length, sizeof(header.length));
+        if (crc32Update(crc, payload, header.length) != header.crc) {
+            // Torn record: retire it so readers skip over it
+            uint8_t consumedState = RECORD_CONSUMED;
+            flashStorageProgram(sectorAddress(headSector) + cursor.offset, &consumedState, 1);
+            stats.corrupt++;
+            return;
+        }
+
+        skipRecord(cursor, header);
+    }
+}
+
+//=====================================================================
+// LOG FUNCTIONS
+//=====================================================================
+bool flashLogBegin() {
+    memset(&stats, 0, sizeof(stats));
+    mounted = flashStorageBegin();
+    hasHead = false;
+    headSequence = 0;
+    pendingRecords = 0;
+
+    if (!mounted)
+        return false;
+
+    // The newest sector carries the highest sequence number
+    SectorHeader header;
+    for (uint16_t sector = 0; sector < FLASH_LOG_SECTORS; sector++) {
+        if (readSectorHeader(sector, header) &&
+            (!hasHead || (int32_t)(header.sequence - headSequence) > 0)) {
+            hasHead = true;
+            headSector = sector;
+            headSequence = header.sequence;
+        }
+    }
+
+    if (!hasHead) {
+        writeOffset = FLASH_LOG_SECTOR_SIZE;
+        readCursor.sector = 0;
+        readCursor.offset = SECTOR_HEADER_SIZE;
+        return true;
+    }
+
+    recoverWriteOffset();
+
+    // Walk from the oldest sector to the head, counting what is left to send
+    readCursor.sector = headSector;
+    readCursor.offset = writeOffset;
+    bool foundPending = false;
+    uint16_t sector = headSector;
+
+    do {
+        sector = nextSector(sector);
+        if (!readSectorHeader(sector, header) || header.state == SECTOR_DRAINED)
+            continue;
+
+        FlashLogCursor first;
+        uint32_t count = countPending(sector, &first);
+        if (count > 0 && !foundPending) {
+            readCursor = first;
+            foundPending = true;
+        }
+        pendingRecords += count;
+    } while (sector != headSector);
+
+    return true;
+}
+
+void flashLogClear() {
+    if (!mounted || !hasHead)
+        return;
+
+    // Retire whole sectors with a single bit-clear each; only records in
+    // the head sector are marked individually
+    SectorHeader header;
+    for (uint16_t sector = 0; sector < FLASH_LOG_SECTORS; sector++) {
+        if (sector != headSector && readSectorHeader(sector, header) &&
+            header.state != SECTOR_DRAINED) {
+            markSectorDrained(sector);
+        }
+    }
+
+    if (readCursor.sector != headSector) {
+        readCursor.sector = headSector;
+        readCursor.offset = SECTOR_HEADER_SIZE;
+    }
+
+    FlashLogCursor end = {headSector, writeOffset};
+    flashLogConsume(end);
+    pendingRecords = 0;
+}
+
+bool flashLogAppend(const void* data, uint16_t length) {
+    if (!mounted || length > MAX_RECORD_LENGTH)
+        return false;
+
+    uint16_t total = RECORD_HEADER_SIZE + paddedLength(length);
+    if (!hasHead || writeOffset + total > FLASH_LOG_SECTOR_SIZE) {
+        if (!openNextSector())
+            return false;
+    }
+
+    // Header and payload go out in one program operation
+    static uint8_t record[FLASH_LOG_SECTOR_SIZE];
+    RecordHeader* header = (RecordHeader*)record;
+    memset(record, 0xFF, total);
+    header->state = RECORD_VALID;
+    header->length = length;
+    memcpy(record + RECORD_HEADER_SIZE, data, length);
+    uint32_t crc = crc32Update(0, &header->length, sizeof(header->length));
+    header->crc = crc32Update(crc, data, length);
+
+    if (!flashStorageProgram(sectorAddress(headSector) + writeOffset, record, total))
+        return false;
+
+    writeOffset += total;
+    pendingRecords++;
+    stats.appended++;
+    return true;
+}
+
+uint16_t flashLogMaxRecordLength() {
+    return MAX_RECORD_LENGTH;
+}
+
+void flashLogRewind(FlashLogCursor& cursor) {
+    cursor = readCursor;
+}
+
+uint16_t flashLogRead(FlashLogCursor& cursor, void* data, uint16_t maxLength) {
+    RecordHeader header;
+
+    while (locateRecord(cursor, header)) {
+        FlashLogCursor record = cursor;
+        skipRecord(cursor, header);
+
+        if (header.state != RECORD_VALID || header.length > maxLength)
+            continue;
+
+        flashStorageRead(sectorAddress(record.sector) + record.offset + RECORD_HEADER_SIZE, data,
+                         header.length);
+        uint32_t crc = crc32Update(0, &header.length, sizeof(header.length));
+        if (crc32Update(crc, data, header.length) != header.crc) {
+            stats.corrupt++;
+            continue;
+        }
+
+        return header.length;
+    }
+
+    return 0;
+}
+
+void flashLogConsume(const FlashLogCursor& upTo) {
+    if (!mounted)
+        return;
+
+    RecordHeader header;
+    uint8_t consumedState = RECORD_CONSUMED;
+
+    while (!(readCursor.sector == upTo.sector && readCursor.offset >= upTo.offset)) {
+        uint16_t sector = readCursor.sector;
+        if (!locateRecord(readCursor, header))
+            break;
+
+        // Crossed into a newer sector: the previous one is fully consumed
+        if (readCursor.sector != sector) {
+            markSectorDrained(sector);
+            continue;
+        }
+
+        if (header.state == RECORD_VALID) {
+            flashStorageProgram(sectorAddress(readCursor.sector) + readCursor.offset,
+                                &consumedState, 1);
+            pendingRecords--;
+            stats.consumed++;
+        }
+        skipRecord(readCursor, header);
+    }
+}
+
+uint32_t flashLogPending() {
+    return pendingRecords;
+}
+
+const FlashLogStats& flashLogStats() {
+    return stats;
+}
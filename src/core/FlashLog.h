@@ -0,0 +1,66 @@
+/*
+ * FlashLog.h
+ * Append-only, wear-levelled record log on flash
+ *
+ * The region is used as a ring of sectors. Each sector starts with a
+ * header carrying a sequence number, so the newest and oldest sectors can
+ * be found again after a reset. Records are CRC-checked; a record torn by
+ * a power loss is detected on recovery and the writer moves on to a fresh
+ * sector. Consumed records are marked in place by clearing bits, so
+ * nothing is rewritten until its sector comes round again in the ring.
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include "Constants.h"
+#include <stdint.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Position in the log, used to read ahead of the consumed point
+struct FlashLogCursor {
+    uint16_t sector;
+    uint16_t offset;
+};
+
+struct FlashLogStats {
+    uint32_t appended;
+    uint32_t consumed;
+    uint32_t dropped;  // Unconsumed records lost when the ring wrapped
+    uint32_t corrupt;  // Torn or damaged records skipped during recovery
+    uint32_t erases;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Mount the log and recover the read and write positions after a reset
+bool flashLogBegin();
+
+// Discard every pending record
+void flashLogClear();
+
+// Append one record. Fails if the log is not mounted or the record is too big.
+bool flashLogAppend(const void* data, uint16_t length);
+
+// Largest record that fits in a sector
+uint16_t flashLogMaxRecordLength();
+
+// Start reading at the oldest unconsumed record
+void flashLogRewind(FlashLogCursor& cursor);
+
+// Read the record at the cursor and advance it. Returns the record length,
+// or 0 when there are no more records.
+uint16_t flashLogRead(FlashLogCursor& cursor, void* data, uint16_t maxLength);
+
+// Mark every record before the cursor as consumed
+void flashLogConsume(const FlashLogCursor& upTo);
+
+// Number of records appended but not yet consumed
+uint32_t flashLogPending();
+
+const FlashLogStats& flashLogStats();
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,198 @@
+/*
+ * FlashStorage.cpp
+ * Flash backend implementation (RP2040 QSPI flash or host image file)
+ */
+
+#include "FlashStorage.h"
+#include <string.h>
+
+static const uint32_t FLASH_LOG_SIZE = (uint32_t)FLASH_LOG_SECTORS * FLASH_LOG_SECTOR_SIZE;
+
+static bool inRange(uint32_t offset, uint32_t length) {
+    return offset <= FLASH_LOG_SIZE && length <= FLASH_LOG_SIZE - offset;
+}
+
+#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+//=====================================================================
+// RP2040 QSPI FLASH
+//=====================================================================
+#include "Pipeline.h"
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+
+// While flash is being written XIP is unavailable, so interrupts are
+// masked and, with the dual-core pipeline, core1 is parked in RAM
+static uint32_t beginFlashWrite() {
+#if SENSORHUB_DUAL_CORE
+    rp2040.idleOtherCore();
+#endif
+    return save_and_disable_interrupts();
+}
+
+static void endFlashWrite(uint32_t interrupts) {
+    restore_interrupts(interrupts);
+#if SENSORHUB_DUAL_CORE
+    rp2040.resumeOtherCore();
+#endif
+}
+
+bool flashStorageBegin() {
+    return true;
+}
+
+bool flashStorageRead(uint32_t offset, void* data, uint32_t length) {
+    if (!inRange(offset, length))
+        return false;
+
+    memcpy(data, (const void*)(XIP_BASE + FLASH_LOG_OFFSET + offset), length);
+    return true;
+}
+
+bool flashStorageProgram(uint32_t offset, const void* data, uint32_t length) {
+    if (!inRange(offset, length))
+        return false;
+
+    // The SDK programs whole pages; pad with 0xFF, which leaves bits untouched
+    static uint8_t page[FLASH_LOG_PAGE_SIZE];
+    const uint8_t* source = (const uint8_t*)data;
+
+    while (length > 0) {
+        uint32_t pageStart = offset & ~(uint32_t)(FLASH_LOG_PAGE_SIZE - 1);
+        uint32_t pageOffset = offset - pageStart;
+        uint32_t chunk = FLASH_LOG_PAGE_SIZE - pageOffset;
+        if (chunk > length)
+            chunk = length;
+
+        memset(page, 0xFF, sizeof(page));
+        memcpy(page + pageOffset, source, chunk);
+
+        uint32_t interrupts = beginFlashWrite();
+        flash_range_program(FLASH_LOG_OFFSET + pageStart, page, FLASH_LOG_PAGE_SIZE);
+        endFlashWrite(interrupts);
+
+        offset += chunk;
+        source += chunk;
+        length -= chunk;
+    }
+
+    return true;
+}
+
+bool flashStorageEraseSector(uint32_t sector) {
+    if (sector >= FLASH_LOG_SECTORS)
+        return false;
+
+    uint32_t interrupts = beginFlashWrite();
+    flash_range_erase(FLASH_LOG_OFFSET + sector * FLASH_LOG_SECTOR_SIZE, FLASH_LOG_SECTOR_SIZE);
+    endFlashWrite(interrupts);
+    return true;
+}
+
+#elif !defined(ARDUINO)
+//=====================================================================
+// HOST FLASH IMAGE
+//=====================================================================
+#include <stdio.h>
+
+static const char* imagePath = "flash_log.img";
+static FILE* image = NULL;
+
+void flashStorageSetImage(const char* path) {
+    if (image != NULL) {
+        fclose(image);
+        image = NULL;
+    }
+    imagePath = path;
+}
+
+bool flashStorageBegin() {
+    if (image != NULL)
+        return true;
+
+    image = fopen(imagePath, "r+b");
+    if (image == NULL) {
+        // New image: start out fully erased like factory flash
+        image = fopen(imagePath, "w+b");
+        if (image == NULL)
+            return false;
+
+        uint8_t erased[FLASH_LOG_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (uint32_t i = 0; i < FLASH_LOG_SECTORS; i++) {
+            fwrite(erased, 1, sizeof(erased), image);
+        }
+        fflush(image);
+    }
+
+    return true;
+}
+
+bool flashStorageRead(uint32_t offset, void* data, uint32_t length) {
+    if (image == NULL || !inRange(offset, length))
+        return false;
+
+    fseek(image, offset, SEEK_SET);
+    return fread(data, 1, length, image) == length;
+}
+
+bool flashStorageProgram(uint32_t offset, const void* data, uint32_t length) {
+    if (image == NULL || !inRange(offset, length))
+        return false;
+
+    // Emulate NOR programming: bits can only go from 1 to 0
+    uint8_t current[FLASH_LOG_PAGE_SIZE];
+    const uint8_t* source = (const uint8_t*)data;
+
+    while (length > 0) {
+        uint32_t chunk = length < sizeof(current) ? length : sizeof(current);
+
+        fseek(image, offset, SEEK_SET);
+        if (fread(current, 1, chunk, image) != chunk)
+            return false;
+        for (uint32_t i = 0; i < chunk; i++) {
+            current[i] &= source[i];
+        }
+        fseek(image, offset, SEEK_SET);
+        fwrite(current, 1, chunk, image);
+
+        offset += chunk;
+        source += chunk;
+        length -= chunk;
+    }
+
+    fflush(image);
+    return true;
+}
+
+bool flashStorageEraseSector(uint32_t sector) {
+    if (image == NULL || sector >= FLASH_LOG_SECTORS)
+        return false;
+
+    uint8_t erased[FLASH_LOG_SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    fseek(image, sector * FLASH_LOG_SECTOR_SIZE, SEEK_SET);
+    fwrite(erased, 1, sizeof(erased), image);
+    fflush(image);
+    return true;
+}
+
+#else
+//=====================================================================
+// NO FLASH BACKEND
+//=====================================================================
+bool flashStorageBegin() {
+    return false;
+}
+
+bool flashStorageRead(uint32_t, void*, uint32_t) {
+    return false;
+}
+
+bool flashStorageProgram(uint32_t, const void*, uint32_t) {
+    return false;
+}
+
+bool flashStorageEraseSector(uint32_t) {
+    return false;
+}
+#endif
@@ -0,0 +1,37 @@
+/*
+ * FlashStorage.h
+ * Raw access to the flash region reserved for the offline log
+ *
+ * Offsets are relative to the start of the reserved region. Programming
+ * follows NOR semantics (bits can only be cleared) and erasing works on
+ * whole sectors. On the RP2040 this maps onto the onboard QSPI flash; on
+ * the host it is backed by a flash image file.
+ */
+
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include "Constants.h"
+#include <stdint.h>
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Prepare the backend. Returns false if no flash is available.
+bool flashStorageBegin();
+
+// Read bytes from the region
+bool flashStorageRead(uint32_t offset, void* data, uint32_t length);
+
+// Program bytes into erased (or bit-compatible) flash
+bool flashStorageProgram(uint32_t offset, const void* data, uint32_t length);
+
+// Erase one sector back to 0xFF
+bool flashStorageEraseSector(uint32_t sector);
+
+#ifndef ARDUINO
+// Host only: select the flash image file used by flashStorageBegin()
+void flashStorageSetImage(const char* path);
+#endif
+
+#endif // FLASH_STORAGE_H
@@ -0,0 +1,163 @@
+/*
+ * HealthMetrics.cpp
+ * Loop latency, sampling jitter and memory high-water mark implementation
+ */
+
+#include "HealthMetrics.h"
+#include <Arduino.h>
+#include <atomic>
+#include <malloc.h>
+#include <string.h>
+
+#define STACK_PAINT_PATTERN 0xC0FFEE5Au
+#define STACK_PAINT_WORDS (STACK_PAINT_BYTES / 4)
+#define STACK_PAINT_MARGIN_WORDS 32 // Left for the painting function's own frame
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+static unsigned long windowStart = 0;
+
+// Main loop (core0 only)
+static LoopMetrics loopMetrics;
+static unsigned long lastIteration = 0;
+static bool iterationSeen = false;
+
+// Sensor reads (acquisition core)
+static SensorReadMetrics readMetrics;
+static unsigned long lastRead = 0;
+static bool readSeen = false;
+static std::atomic<bool> readResetRequested(false);
+
+// Painted stack regions, lowest address first
+static volatile uint32_t* stackBottom[METRICS_CORES];
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static void resetReadMetrics() {
+    memset(&readMetrics, 0, sizeof(readMetrics));
+}
+
+static void heapUsage(size_t& used, size_t& peak) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    used = info.uordblks;
+    peak = info.arena;
+}
+
+static size_t stackUsed(int core) {
+    volatile uint32_t* bottom = stackBottom[core];
+    if (bottom == NULL)
+        return 0;
+
+    size_t untouched = 0;
+    while (untouched < STACK_PAINT_WORDS && bottom[untouched] == STACK_PAINT_PATTERN) {
+        untouched++;
+    }
+    return (STACK_PAINT_WORDS - untouched + STACK_PAINT_MARGIN_WORDS) * 4;
+}
+
+//=====================================================================
+// METRICS FUNCTIONS
+//=====================================================================
+void metricsBegin() {
+    windowStart = millis();
+    memset(&loopMetrics, 0, sizeof(loopMetrics));
+    iterationSeen = false;
+    resetReadMetrics();
+    readSeen = false;
+}
+
+void metricsLoopIteration() {
+    unsigned long now = micros();
+
+    if (iterationSeen) {
+        uint32_t elapsed = now - lastIteration;
+        loopMetrics.iterations++;
+        loopMetrics.totalUs += elapsed;
+        if (elapsed > loopMetrics.maxUs) {
+            loopMetrics.maxUs = elapsed;
+        }
+    }
+
+    lastIteration = now;
+    iterationSeen = true;
+}
+
+void metricsSensorRead(unsigned long timestamp, unsigned long nominal) {
+    if (readResetRequested.load(std::memory_order_acquire)) {
+        resetReadMetrics();
+        readResetRequested.store(false, std::memory_order_release);
+    }
+
+    unsigned long interval = timestamp - lastRead;
+    bool measured = readSeen;
+    lastRead = timestamp;
+    readSeen = true;
+    if (!measured || nominal == 0)
+        return;
+
+    long jitter = (long)(interval - nominal);
+    SensorReadMetrics& m = readMetrics;
+    if (m.count == 0 || jitter > m.maxJitter) {
+        m.maxJitter = jitter;
+    }
+    if (m.count == 0 || jitter < m.minJitter) {
+        m.minJitter = jitter;
+    }
+    m.count++;
+    m.nominal = nominal;
+    m.totalAbsJitter += jitter < 0 ? -jitter : jitter;
+
+    if (jitter > SENSOR_READ_LATE_TOLERANCE) {
+        m.late++;
+    }
+    if (interval >= 2 * nominal) {
+        m.missed += interval / nominal - 1;
+    }
+}
+
+// Not inlined, so the frame being painted below is this function's only
+void __attribute__((noinline)) metricsStackBegin(int core) {
+    if (core < 0 || core >= METRICS_CORES)
+        return;
+
+    volatile uint32_t marker = 0;
+    volatile uint32_t* top = (volatile uint32_t*)((uintptr_t)&marker & ~(uintptr_t)3) -
+                             STACK_PAINT_MARGIN_WORDS;
+    volatile uint32_t* bottom = top - STACK_PAINT_WORDS;
+
+    for (volatile uint32_t* word = bottom; word < top; word++) {
+        *word = STACK_PAINT_PATTERN;
+    }
+    stackBottom[core] = bottom;
+}
+
+void metricsTake(HealthMetrics& metrics) {
+    unsigned long now = millis();
+
+    metrics.windowStart = windowStart;
+    metrics.windowEnd = now;
+    metrics.loop = loopMetrics;
+
+    // Skip the copy while the acquisition core still owes a reset:
+    // there has been no read since the last window
+    if (readResetRequested.load(std::memory_order_acquire)) {
+        memset(&metrics.reads, 0, sizeof(metrics.reads));
+    } else {
+        metrics.reads = readMetrics;
+    }
+
+    heapUsage(metrics.heapUsed, metrics.heapPeak);
+    for (int core = 0; core < METRICS_CORES; core++) {
+        metrics.stackUsed[core] = stackUsed(core);
+    }
+
+    windowStart = now;
+    memset(&loopMetrics, 0, sizeof(loopMetrics));
+    readResetRequested.store(true, std::memory_order_release);
+}
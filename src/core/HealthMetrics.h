@@ -0,0 +1,82 @@
+/*
+ * HealthMetrics.h
+ * Loop latency, sampling jitter and memory high-water marks
+ *
+ * Collected continuously and taken as one window per metrics publish:
+ * - loop: time between successive loop() iterations, i.e. how long a
+ *   due task can wait before the scheduler even looks at it
+ * - sensor reads: spacing of actual reads against the configured
+ *   interval; reads later than SENSOR_READ_LATE_TOLERANCE count as late
+ *   and gaps of whole intervals count as missed reads
+ * - memory: heap in use and its peak (the heap never returns memory to
+ *   the system, so the arena size is the high-water mark), and per-core
+ *   stack depth found by painting the stack below setup(). A depth of
+ *   STACK_PAINT_BYTES or more means the painted region was used up.
+ *
+ * Sensor reads are recorded on the acquisition core; the window is
+ * restarted there on the next read after metricsTake(), so neither core
+ * waits on the other.
+ */
+
+#ifndef HEALTH_METRICS_H
+#define HEALTH_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SENSOR_READ_LATE_TOLERANCE 20 // ms past the nominal interval
+#define STACK_PAINT_BYTES 2048        // Depth checked below setup()'s frame
+#define METRICS_CORES 2
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct LoopMetrics {
+    uint32_t iterations;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+struct SensorReadMetrics {
+    uint32_t count;
+    uint32_t late;
+    uint32_t missed;
+    unsigned long nominal; // ms, the interval in force at the last read
+    long maxJitter;        // ms, actual minus nominal spacing
+    long minJitter;
+    uint64_t totalAbsJitter;
+};
+
+struct HealthMetrics {
+    unsigned long windowStart;
+    unsigned long windowEnd;
+    LoopMetrics loop;
+    SensorReadMetrics reads;
+    size_t heapUsed;
+    size_t heapPeak;
+    size_t stackUsed[METRICS_CORES]; // 0 if the core's stack was not painted
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Start a window; call from setup()
+void metricsBegin();
+
+// Record one pass of the main loop (core0)
+void metricsLoopIteration();
+
+// Record a sensor read that started at timestamp (acquisition core)
+void metricsSensorRead(unsigned long timestamp, unsigned long nominal);
+
+// Fill the stack below the caller with a pattern so its depth can be
+// measured later. Call once, early, on each core.
+void metricsStackBegin(int core);
+
+// Copy the current window and start the next one
+void metricsTake(HealthMetrics& metrics);
+
+#endif // HEALTH_METRICS_H
@@ -4,8 +4,11 @@
  */
 
 #include "Network.h"
+#include "Backoff.h"
 #include "Communication.h"
 #include "Config.h"
+#include "EpochClock.h"
+#include "LedPatterns.h"
 
 //=====================================================================
 // GLOBAL VARIABLES
@@ -14,6 +17,22 @@ bool networkConnected = false;
 WiFiClient wifiClient;
 PubSubClient mqttClient(wifiClient);
 
+static bool radioSuspended = false;
+
+static WifiState wifi = WIFI_OFF;
+static MqttState mqtt = MQTT_OFFLINE;
+static Backoff wifiBackoff;
+static Backoff mqttBackoff;
+static unsigned long joinStarted = 0;
+static uint32_t session = 0;
+static uint32_t closedSession = 0; // Last session ended by a clean disconnect
+
+// Outage accounting; an outage is open while the radio is on but the
+// broker connection is not up
+static NetworkStats stats;
+static bool outageOpen = false;
+static unsigned long outageStart = 0;
+
 //=====================================================================
 // LED SETUP
 //=====================================================================
@@ -32,78 +51,262 @@ void setupLEDs() {
 // NETWORK SETUP
 //=====================================================================
 void setupNetworking() {
-    connectWiFi();
+    // begin() returns at once; serviceNetwork() polls for the join
+    WiFi.setTimeout(0);
 
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
     mqttClient.setCallback(mqttCallback);
-    connectMQTT();
+    mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT);
+
+    // Seed from the clock so a fleet restarted together spreads its retries
+    uint32_t seed = micros();
+    backoffBegin(wifiBackoff, WIFI_RETRY_MIN, WIFI_RETRY_MAX, seed);
+    backoffBegin(mqttBackoff, MQTT_RETRY_MIN, MQTT_RETRY_MAX, seed ^ 0x9E3779B9);
+
+    outageOpen = true;
+    outageStart = millis();
+    serviceNetwork();
 }
 
-void connectWiFi() {
-    Serial.print("Connecting to WiFi...");
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+//=====================================================================
+// STATISTICS
+//=====================================================================
+static void recordBlocked(unsigned long start) {
+    unsigned long blocked = millis() - start;
+    stats.blockedTime += blocked;
+    if (blocked > stats.maxBlocked) {
+        stats.maxBlocked = blocked;
+    }
+}
 
-    // Wait for connection with timeout
-    int connectionAttempts = 0;
-    while (WiFi.status() != WL_CONNECTED && connectionAttempts < 20) {
-        delay(500);
-        Serial.print(".");
-        connectionAttempts++;
-        digitalWrite(LEDG, !digitalRead(LEDG)); // Toggle green LED while connecting
-    }
-
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nWiFi connected!");
-        Serial.print("IP address: ");
-        Serial.println(WiFi.localIP());
-
-        // Print signal strength
-        long rssi = WiFi.RSSI();
-        Serial.print("Signal strength (RSSI): ");
-        Serial.print(rssi);
-        Serial.println(" dBm");
-    } else {
-        Serial.println("\nWiFi connection failed!");
-        digitalWrite(LEDR, HIGH); // Red LED on indicates error
+static void closeOutage(unsigned long now) {
+    if (!outageOpen)
+        return;
+
+    unsigned long outage = now - outageStart;
+    stats.offlineTime += outage;
+    if (outage > stats.longestOutage) {
+        stats.longestOutage = outage;
+    }
+    outageOpen = false;
+}
+
+static void updateConnected(unsigned long now) {
+    bool previousStatus = networkConnected;
+
+    networkConnected = wifi == WIFI_CONNECTED && mqtt == MQTT_CONNECTED;
+
+    if (networkConnected && !previousStatus) {
+        // Just came back online
+        closeOutage(now);
+        Serial.println("Network connection restored");
+        startLedPattern(LEDG, 1, LED_BLINK_LONG, 0);
+    } else if (!networkConnected && previousStatus) {
+        // Just went offline
+        outageOpen = true;
+        outageStart = now;
+        Serial.println("Network connection lost");
+        startLedPattern(LEDR, 1, LED_BLINK_LONG, 0);
+    }
+}
+
+void networkTakeStats(NetworkStats& out) {
+    unsigned long now = millis();
+
+    out = stats;
+    if (outageOpen) {
+        unsigned long outage = now - outageStart;
+        out.offlineTime += outage;
+        if (outage > out.longestOutage) {
+            out.longestOutage = outage;
+        }
+    }
+
+    out.nextRetry = 0;
+    if (radioSuspended)
+        return;
+    if (wifi == WIFI_WAITING) {
+        out.nextRetry = backoffRemaining(wifiBackoff, now);
+    } else if (wifi == WIFI_CONNECTED && mqtt == MQTT_WAITING) {
+        out.nextRetry = backoffRemaining(mqttBackoff, now);
     }
 }
 
-void connectMQTT() {
-    Serial.print("Connecting to MQTT broker...");
-    int attempts = 0;
+//=====================================================================
+// WIFI
+//=====================================================================
+static void startJoin(unsigned long now) {
+    Serial.println("Connecting to WiFi...");
+    stats.wifiAttempts++;
+
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    recordBlocked(now);
+
+    wifi = WIFI_JOINING;
+    joinStarted = now;
+}
+
+static void wifiFailed(unsigned long now) {
+    unsigned long delay = backoffFail(wifiBackoff, now);
+    wifi = WIFI_WAITING;
 
-    while (!mqttClient.connected() && attempts < 5) {
-        if (mqttClient.connect(MQTT_CLIENT_ID)) {
-            Serial.println("\nConnected to MQTT broker");
+    Serial.print("WiFi connection failed, retrying in ");
+    Serial.print(delay);
+    Serial.println(" ms");
+    digitalWrite(LEDR, HIGH); // Red LED on indicates error
+}
+
+static void serviceWiFi(unsigned long now) {
+    switch (wifi) {
+    case WIFI_OFF:
+        startJoin(now);
+        break;
 
-            // Publish a connection message
-            StaticJsonDocument<256> jsonDoc;
-            jsonDoc["device_id"] = MQTT_CLIENT_ID;
-            jsonDoc["status"] = "online";
+    case WIFI_WAITING:
+        if (backoffDue(wifiBackoff, now)) {
+            startJoin(now);
+        }
+        break;
+
+    case WIFI_JOINING: {
+        uint8_t status = WiFi.status();
+        if (status == WL_CONNECTED) {
+            wifi = WIFI_CONNECTED;
+            backoffReset(wifiBackoff, now);
+
+            Serial.println("WiFi connected!");
+            Serial.print("IP address: ");
+            Serial.println(WiFi.localIP());
+
+            // Print signal strength
+            long rssi = WiFi.RSSI();
+            Serial.print("Signal strength (RSSI): ");
+            Serial.print(rssi);
+            Serial.println(" dBm");
+        } else if (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL ||
+                   now - joinStarted >= WIFI_CONNECT_TIMEOUT) {
+            stats.wifiFailures++;
+            wifiFailed(now);
+        }
+        break;
+    }
+
+    case WIFI_CONNECTED:
+        if (WiFi.status() != WL_CONNECTED) {
+            stats.wifiDrops++;
+            Serial.println("WiFi connection lost");
+
+            // Drop the dead socket so the next connect() starts afresh
+            mqttClient.disconnect();
+            mqtt = MQTT_OFFLINE;
+            wifiFailed(now);
+        } else if (epochClockDue(now)) {
+            // 0 until the module's NTP client has the time
+            epochClockUpdate(WiFi.getTime(), now);
+        }
+        break;
+    }
+}
+
+//=====================================================================
+// MQTT
+//=====================================================================
+static void onMqttConnected(unsigned long now) {
+    Serial.println("Connected to MQTT broker");
+    mqtt = MQTT_CONNECTED;
+    session++;
+    backoffReset(mqttBackoff, now);
 
+    // Publish a connection message (retained)
+    publishJson(
+        MQTT_STATUS_TOPIC,
+        [](JsonStream& json) {
             // Get access to battery percentage from Sensors.cpp
             extern float batteryPercentage;
-            jsonDoc["battery"] = batteryPercentage;
 
-            char jsonBuffer[256];
-            serializeJson(jsonDoc, jsonBuffer);
-            mqttClient.publish(MQTT_STATUS_TOPIC, jsonBuffer, true); // retained message
+            json.beginObject();
+            json.field("device_id", MQTT_CLIENT_ID);
+            json.field("status", "online");
+            json.field("battery", batteryPercentage);
+            json.endObject();
+        },
+        true);
 
-            // Subscribe to command and config topics
-            mqttClient.subscribe(MQTT_CONFIG_TOPIC);
-            mqttClient.subscribe(MQTT_COMMAND_TOPIC);
+    // Consumers may have lost state while we were away: the next
+    // telemetry message carries every channel
+    resetTelemetryDeadband();
 
-            Serial.println("Subscribed to configuration and command topics");
-        } else {
-            Serial.print(".");
-            delay(2000);
-            attempts++;
+    // Subscribe to command and config topics
+    mqttClient.subscribe(MQTT_CONFIG_TOPIC);
+    mqttClient.subscribe(MQTT_COMMAND_TOPIC);
+
+    Serial.println("Subscribed to configuration and command topics");
+
+    // Configuration may have changed while offline
+    updateConnected(now);
+    publishDeviceStatus();
+}
+
+static void connectMQTT(unsigned long now) {
+    // Single attempt, blocking for at most MQTT_CONNECT_TIMEOUT
+    Serial.println("Connecting to MQTT broker...");
+    stats.mqttAttempts++;
+
+    bool connected = mqttClient.connect(MQTT_CLIENT_ID);
+    recordBlocked(now);
+
+    now = millis();
+    if (connected) {
+        onMqttConnected(now);
+        return;
+    }
+
+    stats.mqttFailures++;
+    unsigned long delay = backoffFail(mqttBackoff, now);
+    mqtt = MQTT_WAITING;
+
+    Serial.print("MQTT connection failed, retrying in ");
+    Serial.print(delay);
+    Serial.println(" ms");
+    digitalWrite(LEDR, HIGH); // Red LED on indicates error
+}
+
+static void mqttDropped(unsigned long now) {
+    stats.mqttDrops++;
+    Serial.println("MQTT connection lost");
+
+    mqtt = MQTT_WAITING;
+    backoffFail(mqttBackoff, now);
+}
+
+void serviceNetwork() {
+    if (radioSuspended)
+        return;
+
+    unsigned long now = millis();
+    serviceWiFi(now);
+
+    if (wifi == WIFI_CONNECTED) {
+        if (mqtt == MQTT_CONNECTED) {
+            if (!mqttClient.connected()) {
+                mqttDropped(now);
+            }
+        } else if (backoffDue(mqttBackoff, now)) {
+            connectMQTT(now);
         }
     }
 
-    if (!mqttClient.connected()) {
-        Serial.println("\nMQTT connection failed!");
-        digitalWrite(LEDR, HIGH); // Red LED on indicates error
+    updateConnected(millis());
+}
+
+void maintainMQTT() {
+    if (mqtt != MQTT_CONNECTED)
+        return;
+
+    if (!mqttClient.loop()) {
+        unsigned long now = millis();
+        mqttDropped(now);
+        updateConnected(now);
     }
 }
 
@@ -119,22 +322,97 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
     }
 }
 
-void checkNetworkStatus() {
-    bool previousStatus = networkConnected;
+//=====================================================================
+// RADIO POWER
+//=====================================================================
+void suspendNetwork() {
+    if (radioSuspended)
+        return;
 
-    networkConnected = (WiFi.status() == WL_CONNECTED) && mqttClient.connected();
+    // A clean disconnect delivers what was already published
+    if (mqtt == MQTT_CONNECTED) {
+        closedSession = session;
+    }
 
-    if (networkConnected && !previousStatus) {
-        // Just came back online
-        Serial.println("Network connection restored");
-        digitalWrite(LEDG, HIGH);
-        delay(LED_BLINK_LONG);
-        digitalWrite(LEDG, LOW);
-    } else if (!networkConnected && previousStatus) {
-        // Just went offline
-        Serial.println("Network connection lost");
-        digitalWrite(LEDR, HIGH);
-        delay(LED_BLINK_LONG);
-        digitalWrite(LEDR, LOW);
+    mqttClient.disconnect();
+    WiFi.end(); // Holds the WiFi module in reset
+    radioSuspended = true;
+    wifi = WIFI_OFF;
+    mqtt = MQTT_OFFLINE;
+    networkConnected = false;
+    closeOutage(millis());
+}
+
+void resumeNetwork(bool lowPower) {
+    if (radioSuspended) {
+        radioSuspended = false;
+
+        // A fresh window: the failures of the last one do not carry over
+        unsigned long now = millis();
+        backoffReset(wifiBackoff, now);
+        backoffReset(mqttBackoff, now);
+        outageOpen = true;
+        outageStart = now;
+
+        // Starts the join without waiting for it
+        serviceNetwork();
+    }
+
+    // Modem sleep between beacons while connected
+    if (lowPower) {
+        WiFi.lowPowerMode();
+    } else {
+        WiFi.noLowPowerMode();
+    }
+}
+
+bool networkSuspended() {
+    return radioSuspended;
+}
+
+uint32_t mqttSession() {
+    return session;
+}
+
+MqttDelivery mqttDelivery(uint32_t sentSession, unsigned long sentAt) {
+    if (sentSession != session)
+        return sentSession == closedSession ? DELIVERY_CONFIRMED : DELIVERY_LOST;
+
+    if (mqtt == MQTT_CONNECTED && millis() - sentAt >= MQTT_CONFIRM_TIME)
+        return DELIVERY_CONFIRMED;
+    return DELIVERY_PENDING;
+}
+
+WifiState wifiState() {
+    return wifi;
+}
+
+MqttState mqttState() {
+    return mqtt;
+}
+
+const char* wifiStateName(WifiState state) {
+    switch (state) {
+    case WIFI_OFF:
+        return "off";
+    case WIFI_JOINING:
+        return "joining";
+    case WIFI_CONNECTED:
+        return "connected";
+    case WIFI_WAITING:
+        return "waiting";
+    }
+    return "unknown";
+}
+
+const char* mqttStateName(MqttState state) {
+    switch (state) {
+    case MQTT_OFFLINE:
+        return "offline";
+    case MQTT_CONNECTED:
+        return "connected";
+    case MQTT_WAITING:
+        return "waiting";
     }
+    return "unknown";
 }
@@ -1,6 +1,15 @@
 /*
  * Network.h
  * WiFi and MQTT connection management
+ *
+ * Two state machines, advanced a step at a time by serviceNetwork() so
+ * no call waits on the network for long:
+ * - WiFi: begin() returns at once and status() is polled until the join
+ *   succeeds or WIFI_CONNECT_TIMEOUT passes
+ * - MQTT: one connect attempt per step, only while WiFi is up, bounded by
+ *   MQTT_CONNECT_TIMEOUT (PubSubClient has no asynchronous connect)
+ * Failed attempts and drops are retried after a jittered exponential
+ * backoff (Backoff.h), separately for each layer.
  */
 
 #ifndef NETWORK_H
@@ -11,6 +20,59 @@
 #include <PubSubClient.h>
 #include <WiFiNINA.h>
 
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define WIFI_CONNECT_TIMEOUT 20000 // ms to wait for a join before backing off
+#define WIFI_RETRY_MIN 2000        // ms, first retry after a failed join or a drop
+#define WIFI_RETRY_MAX 120000      // ms, retry cap
+#define MQTT_CONNECT_TIMEOUT 3     // s, longest a broker connect may block
+#define MQTT_RETRY_MIN 2000        // ms
+#define MQTT_RETRY_MAX 60000       // ms
+
+// A session that stays up this long after a publish has delivered it:
+// the client's keepalive would have noticed a dead connection by then
+#define MQTT_CONFIRM_TIME (2UL * MQTT_KEEPALIVE * 1000) // ms
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+enum WifiState : uint8_t {
+    WIFI_OFF,        // Not started, or suspended by power save
+    WIFI_JOINING,    // begin() issued, polling status()
+    WIFI_CONNECTED,
+    WIFI_WAITING     // Backing off before the next begin()
+};
+
+enum MqttState : uint8_t {
+    MQTT_OFFLINE,    // WiFi is down
+    MQTT_CONNECTED,
+    MQTT_WAITING     // Backing off before the next connect()
+};
+
+// PubSubClient publishes at QoS 0 only, so delivery is judged by the
+// session that carried a message rather than by a PUBACK
+enum MqttDelivery : uint8_t {
+    DELIVERY_PENDING,
+    DELIVERY_CONFIRMED,
+    DELIVERY_LOST // The session ended without a clean disconnect
+};
+
+// Counters run from boot so dashboards can difference them
+struct NetworkStats {
+    uint32_t wifiAttempts;
+    uint32_t wifiFailures;
+    uint32_t wifiDrops;
+    uint32_t mqttAttempts;
+    uint32_t mqttFailures;
+    uint32_t mqttDrops;
+    unsigned long blockedTime;    // ms spent inside begin() and connect() calls
+    unsigned long maxBlocked;     // ms, the longest single call
+    unsigned long offlineTime;    // ms not connected, excluding power-save suspension
+    unsigned long longestOutage;  // ms
+    unsigned long nextRetry;      // ms until the next attempt, 0 if none is pending
+};
+
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
@@ -25,14 +87,36 @@ extern PubSubClient mqttClient;
 void setupLEDs();
 void setupNetworking();
 
-// WiFi connection
-void connectWiFi();
+// Advance the WiFi and MQTT state machines by one step; runs every
+// NETWORK_SERVICE_INTERVAL
+void serviceNetwork();
 
-// MQTT connection and callback
-void connectMQTT();
+// Let the MQTT client process incoming messages and keepalives; runs
+// every MQTT_LOOP_INTERVAL
+void maintainMQTT();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 
-// Network status check
-void checkNetworkStatus();
+// Power the WiFi module down between power-save upload windows. While
+// suspended the network is deliberately offline: no reconnect attempts
+// and no lost-connection indication.
+void suspendNetwork();
+
+// Power the module back up if suspended, and select its modem sleep
+void resumeNetwork(bool lowPower);
+
+bool networkSuspended();
+
+// Broker connections made since boot; changes whenever the session does
+uint32_t mqttSession();
+
+// Whether a message published at sentAt in session has reached the broker
+MqttDelivery mqttDelivery(uint32_t session, unsigned long sentAt);
+
+// Connection states and reconnect statistics
+WifiState wifiState();
+MqttState mqttState();
+const char* wifiStateName(WifiState state);
+const char* mqttStateName(MqttState state);
+void networkTakeStats(NetworkStats& stats);
 
 #endif // NETWORK_H
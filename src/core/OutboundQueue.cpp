@@ -0,0 +1,174 @@
+/*
+ * OutboundQueue.cpp
+ * Alert queue implementation
+ */
+
+#include "OutboundQueue.h"
+#include "Buffer.h"
+#include "Network.h"
+#include "PowerSave.h"
+
+//=====================================================================
+// STATE
+//=====================================================================
+// Only used from core0: the network task and the processing that raises alerts
+static OutboundMessage slots[OUTBOUND_QUEUE_SLOTS];
+static uint32_t nextSequence = 1;
+static OutboundStats stats;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+size_t OutboundWriter::write(uint8_t c) {
+    if (message.length >= OUTBOUND_PAYLOAD_SIZE) {
+        overflow = true;
+        return 0;
+    }
+
+    message.payload[message.length++] = c;
+    return 1;
+}
+
+// Oldest message in the given state, by sequence number
+static OutboundMessage* oldest(OutboundState state) {
+    OutboundMessage* found = NULL;
+    for (int i = 0; i < OUTBOUND_QUEUE_SLOTS; i++) {
+        OutboundMessage& message = slots[i];
+        if (message.state == state &&
+            (found == NULL || (int32_t)(message.sequence - found->sequence) < 0)) {
+            found = &message;
+        }
+    }
+    return found;
+}
+
+static void moveToBuffer(OutboundMessage& message) {
+    if (storeMessageInBuffer(message.topic, message.payload, message.length)) {
+        stats.buffered++;
+    } else {
+        stats.lost++;
+        Serial.println("Alert lost: offline buffer unavailable");
+    }
+    message.state = OUTBOUND_FREE;
+}
+
+static void confirm(OutboundMessage& message) {
+    stats.delivered++;
+    message.state = OUTBOUND_FREE;
+}
+
+//=====================================================================
+// QUEUE
+//=====================================================================
+OutboundMessage& outboundReserve(const char* topic) {
+    OutboundMessage* message = oldest(OUTBOUND_FREE);
+
+    if (message == NULL) {
+        // The oldest message makes room and goes out later with the
+        // backlog. A published one goes first, as it has most likely
+        // arrived already; it is not counted as delivered, and consumers
+        // drop the repeat by its sequence number.
+        message = oldest(OUTBOUND_SENT);
+        if (message == NULL) {
+            message = oldest(OUTBOUND_QUEUED);
+        }
+        moveToBuffer(*message);
+    }
+
+    message->attempts = 0;
+    message->length = 0;
+    message->sequence = nextSequence++;
+    message->session = 0;
+    message->queuedAt = millis();
+    message->sentAt = 0;
+    message->topic = topic;
+    return *message;
+}
+
+bool outboundCommit(OutboundMessage& message, bool overflowed) {
+    if (overflowed) {
+        Serial.print("Alert too large for the queue: ");
+        Serial.println(message.topic);
+        return false;
+    }
+
+    message.state = OUTBOUND_QUEUED;
+    stats.queued++;
+
+    // With the radio parked, bring it up for the alert
+    if (networkSuspended()) {
+        powerSaveRequestUpload();
+    }
+
+    outboundService();
+    return true;
+}
+
+bool outboundQueue(const char* topic, const uint8_t* payload, uint16_t length) {
+    if (length > OUTBOUND_PAYLOAD_SIZE)
+        return false;
+
+    OutboundMessage& message = outboundReserve(topic);
+    memcpy(message.payload, payload, length);
+    message.length = length;
+    return outboundCommit(message, false);
+}
+
+bool outboundService() {
+    unsigned long now = millis();
+    uint32_t current = mqttSession();
+
+    for (int i = 0; i < OUTBOUND_QUEUE_SLOTS; i++) {
+        OutboundMessage& message = slots[i];
+        if (message.state != OUTBOUND_SENT)
+            continue;
+
+        MqttDelivery delivery = mqttDelivery(message.session, message.sentAt);
+        if (delivery == DELIVERY_LOST) {
+            // The session ended before the message was confirmed
+            message.state = OUTBOUND_QUEUED;
+            stats.resent++;
+        } else if (delivery == DELIVERY_CONFIRMED) {
+            confirm(message);
+        }
+    }
+
+    OutboundMessage* message;
+    while ((message = oldest(OUTBOUND_QUEUED)) != NULL) {
+        if (!networkConnected || !mqttClient.connected())
+            return false;
+
+        if (!mqttClient.publish(message->topic, message->payload, message->length)) {
+            stats.failures++;
+            if (++message->attempts >= OUTBOUND_MAX_ATTEMPTS) {
+                moveToBuffer(*message);
+            }
+            return false;
+        }
+
+        // Latency to the first publish; a resend keeps its original one
+        if (message->sentAt == 0) {
+            stats.published++;
+            unsigned long latency = now - message->queuedAt;
+            stats.totalLatency += latency;
+            if (latency > stats.maxLatency) {
+                stats.maxLatency = latency;
+            }
+        }
+
+        message->state = OUTBOUND_SENT;
+        message->session = current;
+        message->sentAt = now;
+    }
+    return true;
+}
+
+void outboundTakeStats(OutboundStats& out) {
+    out = stats;
+    out.pending = 0;
+    for (int i = 0; i < OUTBOUND_QUEUE_SLOTS; i++) {
+        if (slots[i].state != OUTBOUND_FREE) {
+            out.pending++;
+        }
+    }
+}
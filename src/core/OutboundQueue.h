@@ -0,0 +1,107 @@
+/*
+ * OutboundQueue.h
+ * Priority lane for alerts and anomalies, with delivery tracking
+ *
+ * Alerts are copied into a small RAM queue and published ahead of
+ * everything else: routine telemetry (TelemetryBatch.h) and the offline
+ * backlog (Buffer.h) keep their own data and are only sent while no
+ * alert is waiting. Alerts raised offline wait here for the connection.
+ *
+ * PubSubClient only publishes at QoS 0 and drops PUBACKs, so delivery is
+ * tracked at the session level instead (mqttDelivery() in Network.h): a
+ * published message is kept until the broker session that carried it
+ * has stayed up for MQTT_CONFIRM_TIME, or was closed cleanly. If the
+ * session is lost first the message is sent again; JSON alerts carry a
+ * "seq" so consumers can drop repeats.
+ * A message that cannot get a slot, or keeps failing, falls back into
+ * the offline buffer and goes out with the backlog.
+ */
+
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define OUTBOUND_QUEUE_SLOTS 8
+// Bytes. The largest JSON alert the emitters produce is a gas anomaly at
+// saturation (about 1e9 ppm CO, 13 characters of %.7g): about 200 bytes.
+// With every field at its widest it is 214.
+#define OUTBOUND_PAYLOAD_SIZE 256
+#define OUTBOUND_MAX_ATTEMPTS 3 // Failed publishes before the offline buffer takes over
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+enum OutboundState : uint8_t {
+    OUTBOUND_FREE,
+    OUTBOUND_QUEUED, // Waiting to be published
+    OUTBOUND_SENT    // Published, waiting for its session to be confirmed
+};
+
+struct OutboundMessage {
+    OutboundState state;
+    uint8_t attempts;       // Failed publishes
+    uint16_t length;
+    uint32_t sequence;
+    uint32_t session;       // mqttSession() it was last published in
+    unsigned long queuedAt;
+    unsigned long sentAt;
+    const char* topic;      // One of the constant topic strings
+    uint8_t payload[OUTBOUND_PAYLOAD_SIZE];
+};
+
+// Counters run from boot so dashboards can difference them
+struct OutboundStats {
+    uint32_t queued;
+    uint32_t published;   // Published at least once
+    uint32_t delivered;   // Confirmed
+    uint32_t resent;      // Published again after their session ended
+    uint32_t failures;    // Publishes the client refused
+    uint32_t buffered;    // Moved to the offline buffer
+    uint32_t lost;        // Could not be buffered either
+    unsigned long totalLatency; // ms from queueing to the first publish, summed
+    unsigned long maxLatency;
+    uint16_t pending;     // In the queue now, sent or not
+};
+
+// Print that fills a message payload, for JsonStream
+class OutboundWriter : public Print {
+  public:
+    explicit OutboundWriter(OutboundMessage& message) : message(message), overflow(false) {}
+
+    using Print::write;
+    size_t write(uint8_t c);
+    bool overflowed() const { return overflow; }
+
+  private:
+    OutboundMessage& message;
+    bool overflow;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Take a slot for a message to topic, with its sequence number assigned.
+// If every slot is taken the oldest message makes room by going to the
+// offline buffer, published or not.
+OutboundMessage& outboundReserve(const char* topic);
+
+// Queue a reserved message once its payload is written and try to send
+// it. Returns false, freeing the slot, if the payload did not fit.
+bool outboundCommit(OutboundMessage& message, bool overflowed);
+
+// Queue a ready-made payload
+bool outboundQueue(const char* topic, const uint8_t* payload, uint16_t length);
+
+// Confirm or resend published messages and send queued ones in order.
+// Returns true when nothing is left waiting to be sent, i.e. lower
+// priority traffic may go.
+bool outboundService();
+
+void outboundTakeStats(OutboundStats& stats);
+
+#endif // OUTBOUND_QUEUE_H
@@ -0,0 +1,307 @@
+/*
+ * Pipeline.cpp
+ * Sample handoff implementation
+ */
+
+#include "Pipeline.h"
+#include "Buffer.h"
+#include "Communication.h"
+#include "Config.h"
+#include "DataProcessing.h"
+#include "HealthMetrics.h"
+#include "LedPatterns.h"
+#include "Network.h"
+#include "PowerSave.h"
+#include "TelemetryBatch.h"
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+SampleQueue<SensorSample, SAMPLE_QUEUE_SIZE> sampleQueue;
+SampleQueue<VibrationFeatures, VIBRATION_QUEUE_SIZE> vibrationQueue;
+SampleQueue<OctaveLevels, ACOUSTIC_QUEUE_SIZE> acousticQueue;
+
+AdaptiveSampler adaptiveSampler;
+ChannelSchedule channelSchedule;
+
+static std::atomic<bool> pipelineStarted(false);
+static std::atomic<bool> motionRequested(false);
+static bool scheduleStarted = false; // Producer only
+static uint32_t reportedDrops = 0;
+
+// Producer only: the last sample, held while its DHT transfer runs
+static SensorSample pendingSample;
+static bool samplePending = false;
+// Published by the consumer, read by the producer; 0 until the first sample
+static std::atomic<unsigned long> adaptiveInterval(0);
+
+//=====================================================================
+// READ INTERVAL
+//=====================================================================
+unsigned long currentReadInterval() {
+    unsigned long interval = adaptiveInterval.load(std::memory_order_relaxed);
+    if (!config.adaptiveSamplingEnabled || interval == 0)
+        return config.sensorReadInterval;
+
+    return interval;
+}
+
+unsigned long channelReadInterval(uint8_t channel) {
+    unsigned long interval = config.channelInterval[channel];
+    if (interval == 0) {
+        interval = currentReadInterval();
+    }
+    if (channel == SENSOR_ENVIRONMENT && interval < DHT_MIN_INTERVAL) {
+        interval = DHT_MIN_INTERVAL;
+    }
+    return interval;
+}
+
+// Channels on the shared read interval, which adaptive sampling drives
+static uint8_t sharedIntervalChannels() {
+    uint8_t channels = 0;
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        if (config.channelInterval[channel] == 0) {
+            channels |= 1 << channel;
+        }
+    }
+    return channels;
+}
+
+static void adaptSampling() {
+    // Restart from the configured interval whenever the mode is turned on
+    static bool wasEnabled = false;
+    if (!config.adaptiveSamplingEnabled) {
+        wasEnabled = false;
+        adaptiveInterval.store(0, std::memory_order_relaxed);
+        return;
+    }
+    if (!wasEnabled) {
+        adaptiveSamplerBegin(adaptiveSampler, config.sensorReadInterval);
+        wasEnabled = true;
+    }
+
+    AdaptiveLimits limits;
+    limits.minInterval = config.minSensorReadInterval;
+    limits.maxInterval = config.maxSensorReadInterval;
+    limits.quietReads = config.adaptiveQuietReads;
+
+    unsigned long interval = adaptiveSamplerUpdate(adaptiveSampler, detectActivity(), limits);
+    adaptiveInterval.store(interval, std::memory_order_relaxed);
+}
+
+//=====================================================================
+// PRODUCER (ACQUISITION CORE)
+//=====================================================================
+void startPipeline() {
+    pipelineStarted.store(true, std::memory_order_release);
+}
+
+// Follow remote and adaptive changes to the channel intervals
+static void updateChannelSchedule() {
+    unsigned long now = millis();
+    if (!scheduleStarted) {
+        channelScheduleBegin(channelSchedule, now);
+        scheduleStarted = true;
+    }
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        channelScheduleSetInterval(channelSchedule, channel, channelReadInterval(channel), now);
+    }
+}
+
+// ms from now until the next channel is due or the DHT result is ready
+static unsigned long untilNextEvent(unsigned long now) {
+    unsigned long wait = channelScheduleUntilNext(channelSchedule, now);
+    unsigned long ready = untilEnvironmentReady();
+    return ready < wait ? ready : wait;
+}
+
+unsigned long untilNextAcquisition(unsigned long since) {
+    updateChannelSchedule();
+
+    unsigned long wait = channelScheduleUntilNext(channelSchedule, since);
+
+    // The DHT transfer is timed from now rather than since
+    unsigned long ready = untilEnvironmentReady();
+    if (ready != (unsigned long)-1) {
+        ready += millis() - since;
+        if (ready < wait) {
+            wait = ready;
+        }
+    }
+    return wait > 0 ? wait : 1;
+}
+
+void requestMotionSample() {
+    motionRequested.store(true);
+}
+
+void acquireSample() {
+    updateChannelSchedule();
+
+    uint8_t channels = channelScheduleTake(channelSchedule, millis());
+    if (motionRequested.load()) {
+        motionRequested.store(false);
+        channels |= 1 << SENSOR_MOTION;
+    }
+
+    // The held sample goes once its DHT result is in, or without it when
+    // the next pass is already due; the result then joins that pass
+    if (samplePending && (finishEnvironmentRead(pendingSample) || channels != 0)) {
+        sampleQueue.push(pendingSample);
+        samplePending = false;
+    }
+    if (channels == 0)
+        return;
+
+    SensorSample sample;
+    readSensors(sample, channels);
+
+    // Read timing is measured on the fastest channel
+    int fastest = 0;
+    for (int channel = 1; channel < SENSOR_CHANNELS; channel++) {
+        if (channelSchedule.interval[channel] < channelSchedule.interval[fastest]) {
+            fastest = channel;
+        }
+    }
+    if (channels & (1 << fastest)) {
+        metricsSensorRead(sample.timestamp, channelSchedule.interval[fastest]);
+    }
+
+    if (untilEnvironmentReady() != (unsigned long)-1) {
+        pendingSample = sample;
+        samplePending = true;
+    } else {
+        sampleQueue.push(sample);
+    }
+}
+
+void drainImu() {
+    static unsigned long lastFeaturesTime = 0;
+
+    serviceImu();
+
+    // Spectra are averaged over the telemetry interval
+    unsigned long now = millis();
+    if (now - lastFeaturesTime >= config.mqttPublishInterval) {
+        lastFeaturesTime = now;
+
+        VibrationFeatures features;
+        if (takeVibrationFeatures(features)) {
+            vibrationQueue.push(features);
+        }
+    }
+}
+
+void drainAudio() {
+    static unsigned long lastLevelsTime = 0;
+
+    serviceAudio();
+
+    // Band levels cover the telemetry interval, like the vibration spectra
+    unsigned long now = millis();
+    if (now - lastLevelsTime >= config.mqttPublishInterval) {
+        lastLevelsTime = now;
+
+        OctaveLevels levels;
+        if (takeOctaveLevels(levels)) {
+            acousticQueue.push(levels);
+        }
+    }
+}
+
+static unsigned long untilDue(unsigned long last, unsigned long interval, unsigned long now) {
+    unsigned long elapsed = now - last;
+    return elapsed < interval ? interval - elapsed : 0;
+}
+
+void runAcquisitionLoop() {
+    static unsigned long lastImuDrainTime = 0;
+    static unsigned long lastAudioTime = 0;
+    static bool motion = false;
+
+    if (!pipelineStarted.load(std::memory_order_acquire))
+        return;
+
+    // Motion seen during a power-save sleep is sampled straight away
+    unsigned long now = millis();
+    if (motion || now - lastImuDrainTime >= IMU_FIFO_DRAIN_INTERVAL) {
+        lastImuDrainTime = now;
+        drainImu();
+    }
+
+    if (now - lastAudioTime >= AUDIO_SERVICE_INTERVAL) {
+        lastAudioTime = now;
+        drainAudio();
+    }
+
+    if (motion) {
+        requestMotionSample();
+    }
+    acquireSample();
+
+    now = millis();
+    unsigned long idle = untilDue(lastImuDrainTime, IMU_FIFO_DRAIN_INTERVAL, now);
+    unsigned long next = untilDue(lastAudioTime, AUDIO_SERVICE_INTERVAL, now);
+    if (next < idle) {
+        idle = next;
+    }
+    next = untilNextEvent(now);
+    if (next < idle) {
+        idle = next;
+    }
+    motion = powerSaveSleep(idle);
+}
+
+//=====================================================================
+// CONSUMER (NETWORK CORE)
+//=====================================================================
+void processSamples() {
+    SensorSample sample;
+
+    while (sampleQueue.pop(sample)) {
+        applySensorSample(sample);
+
+        if (config.anomalyDetectionEnabled) {
+            checkForAnomalies(sample);
+        }
+
+        // Only reads on the shared interval count toward adapting it
+        if (sample.channels & sharedIntervalChannels()) {
+            adaptSampling();
+        }
+
+        // Online, samples wait in the telemetry batch for the next publish.
+        // Offline, or if publishing has fallen a whole batch behind, they
+        // go to the offline buffer instead so none are lost.
+        if (!networkConnected || !telemetryBatchAdd(sample)) {
+            storeReadingInBuffer(sample);
+            networkWasDown = true;
+
+            // Blue LED blink pattern indicates offline storage, except
+            // while power save keeps the radio off on purpose
+            if (!networkSuspended()) {
+                startLedPattern(LEDB, 1, LED_BLINK_SHORT, 0);
+            }
+        }
+
+        // Visual indicator for spikes
+        if (vibrationSpikeDetected || soundSpikeDetected) {
+            startLedPattern(LEDB, 1, LED_BLINK_LONG, 0);
+
+            // Send immediate alert, or queue it until the network is back
+            publishSpikeAlert();
+
+            // In power save, bring the radio up (or keep it up) for the
+            // readings that follow
+            powerSaveRequestUpload();
+        }
+    }
+
+    uint32_t drops = sampleQueue.droppedCount();
+    if (drops != reportedDrops) {
+        Serial.print("Sample queue overflow, dropped: ");
+        Serial.println(drops - reportedDrops);
+        reportedDrops = drops;
+    }
+}
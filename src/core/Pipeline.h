@@ -0,0 +1,93 @@
+/*
+ * Pipeline.h
+ * Sample handoff between acquisition and networking
+ *
+ * With the arduino-pico core, acquisition and spike detection run on
+ * core1 (setup1/loop1) and push samples into a lock-free queue that the
+ * scheduler on core0 drains. On cores without a second Arduino context
+ * (e.g. the mbed-based core) both halves run from the same sensor task.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "AdaptiveSampling.h"
+#include "ChannelSchedule.h"
+#include "Constants.h"
+#include "SampleQueue.h"
+#include "Sensors.h"
+#include <Arduino.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#if defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
+#define SENSORHUB_DUAL_CORE 1
+#else
+#define SENSORHUB_DUAL_CORE 0
+#endif
+
+#define SAMPLE_QUEUE_SIZE 32
+#define VIBRATION_QUEUE_SIZE 4
+#define ACOUSTIC_QUEUE_SIZE 4
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+extern SampleQueue<SensorSample, SAMPLE_QUEUE_SIZE> sampleQueue;
+extern SampleQueue<VibrationFeatures, VIBRATION_QUEUE_SIZE> vibrationQueue;
+extern SampleQueue<OctaveLevels, ACOUSTIC_QUEUE_SIZE> acousticQueue;
+
+// Adaptive sampling state, updated by the consumer for every sample
+extern AdaptiveSampler adaptiveSampler;
+
+// Channel due times and read statistics, kept by the producer
+extern ChannelSchedule channelSchedule;
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Allow the acquisition side to start once setup() has finished
+void startPipeline();
+
+// Producer: read the channels that are due and enqueue them as one sample.
+// While a DHT transfer runs the sample is held, and completed by a later
+// call once the transfer has finished.
+void acquireSample();
+
+// Producer: read the motion channel at the next acquisition whether due
+// or not, after the IMU woke the board
+void requestMotionSample();
+
+// Producer: drain the IMU FIFO, queueing vibration features once per
+// publish interval
+void drainImu();
+
+// Producer: filter queued microphone blocks, queueing octave band levels
+// once per publish interval
+void drainAudio();
+
+// Interval between sensor reads: config.sensorReadInterval, or the
+// adaptive interval when adaptive sampling is enabled. Safe on either core.
+unsigned long currentReadInterval();
+
+// Interval of one sensor channel: config.channelInterval, or
+// currentReadInterval() where that is 0. The environment channel is held
+// to DHT_MIN_INTERVAL. Safe on either core.
+unsigned long channelReadInterval(uint8_t channel);
+
+// Producer: ms from since, when the last acquisition was due, until the
+// next channel is due or the running DHT transfer should have finished;
+// at least 1. Follows config changes.
+unsigned long untilNextAcquisition(unsigned long since);
+
+// Producer loop body for core1, paced by the channel schedule;
+// also drains the IMU FIFO and microphone blocks between readings, and
+// in power save sleeps until the next of them is due
+void runAcquisitionLoop();
+
+// Consumer: apply queued samples, detect anomalies, adapt the read
+// interval, batch or buffer and alert
+void processSamples();
+
+#endif // PIPELINE_H
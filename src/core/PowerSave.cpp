@@ -0,0 +1,325 @@
+/*
+ * PowerSave.cpp
+ * Low-power operation implementation
+ */
+
+#include "PowerSave.h"
+#include "Buffer.h"
+#include "Communication.h"
+#include "Config.h"
+#include "Network.h"
+#include "OutboundQueue.h"
+#include "Pipeline.h"
+#include "Sensors.h"
+#include <atomic>
+
+#if SENSORHUB_DUAL_CORE
+#include <hardware/sync.h>
+#include <pico/time.h>
+#elif defined(ARDUINO_ARCH_MBED)
+#include <mbed.h>
+#define POWER_SAVE_WAKE_FLAG 0x1
+#elif !defined(ARDUINO)
+#include "Simulation.h"
+#endif
+
+//=====================================================================
+// STATE
+//=====================================================================
+static const char* const MODE_NAMES[] = {"off", "on", "auto"};
+
+static std::atomic<bool> active(false);
+
+// Set by the wake-up ISR, one flag per core so each sleeping core sees it
+static std::atomic<bool> motionPending[POWER_SAVE_CORES];
+static unsigned long lastMotion[POWER_SAVE_CORES];
+static bool motionHandled[POWER_SAVE_CORES];
+
+// Counters only grow, each with a single writer (its core, or the ISR);
+// a mode period reports the difference from the values at its start
+static std::atomic<unsigned long> asleepMs[POWER_SAVE_CORES];
+static std::atomic<uint32_t> sleepCount[POWER_SAVE_CORES];
+static std::atomic<uint32_t> motionWakes(0);
+static uint32_t asleepRemainderUs[POWER_SAVE_CORES];
+static PowerSaveStats baseline;
+
+// Mode period, radio and upload window; core0 only
+static unsigned long periodStart = 0;
+static unsigned long radioOnTotal = 0;
+static unsigned long radioOnSince = 0;
+static uint32_t uploadWindows = 0;
+
+static bool windowOpen = false;
+static bool windowConnected = false;
+static bool uploadRequested = false;
+static unsigned long windowOpened = 0;
+static unsigned long windowConnectedAt = 0;
+static unsigned long windowClosed = 0;
+
+#if defined(ARDUINO_ARCH_MBED) && !SENSORHUB_DUAL_CORE
+static osThreadId_t sleepingThread = NULL;
+#endif
+
+//=====================================================================
+// SLEEP
+//=====================================================================
+static int currentCore() {
+#if SENSORHUB_DUAL_CORE
+    return get_core_num();
+#else
+    return 0;
+#endif
+}
+
+static void onImuWake() {
+    if (!active.load(std::memory_order_relaxed))
+        return;
+
+    motionWakes.store(motionWakes.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    for (int core = 0; core < POWER_SAVE_CORES; core++) {
+        motionPending[core].store(true, std::memory_order_release);
+    }
+
+#if SENSORHUB_DUAL_CORE
+    __sev();
+#elif defined(ARDUINO_ARCH_MBED)
+    osThreadFlagsSet(sleepingThread, POWER_SAVE_WAKE_FLAG);
+#endif
+}
+
+static void sleepFor(int core, unsigned long ms) {
+#if SENSORHUB_DUAL_CORE
+    // Any interrupt ends a WFE; go back to sleep unless it was the IMU
+    absolute_time_t until = make_timeout_time_ms(ms);
+    while (!motionPending[core].load(std::memory_order_acquire) &&
+           !best_effort_wfe_or_timeout(until)) {
+    }
+#elif defined(ARDUINO_ARCH_MBED)
+    (void)core;
+    rtos::ThisThread::flags_wait_any_for(POWER_SAVE_WAKE_FLAG,
+                                         rtos::Kernel::Clock::duration_u32(ms));
+#elif !defined(ARDUINO)
+    // Host: run the virtual clock one device event at a time so the
+    // simulated IMU interrupt can end the sleep early
+    unsigned long start = millis();
+    while (!motionPending[core].load(std::memory_order_acquire) && millis() - start < ms) {
+        unsigned long left = ms - (millis() - start);
+        unsigned long event = simNextEvent();
+        simAdvance(event == 0 ? 1 : (event < left ? event : left));
+    }
+#else
+    (void)core;
+    delay(ms);
+#endif
+}
+
+bool powerSaveSleep(unsigned long ms) {
+    if (!active.load(std::memory_order_relaxed))
+        return false;
+
+    int core = currentCore();
+    if (!motionPending[core].load(std::memory_order_acquire) && ms >= POWER_SAVE_MIN_SLEEP) {
+        unsigned long start = micros();
+        sleepFor(core, ms);
+
+        uint32_t slept = asleepRemainderUs[core] + (micros() - start);
+        asleepMs[core].store(asleepMs[core].load(std::memory_order_relaxed) + slept / 1000,
+                             std::memory_order_relaxed);
+        asleepRemainderUs[core] = slept % 1000;
+        sleepCount[core].store(sleepCount[core].load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+    }
+
+    if (!motionPending[core].load(std::memory_order_acquire))
+        return false;
+    motionPending[core].store(false, std::memory_order_relaxed);
+
+    // A running machine keeps raising the interrupt; sample it at most
+    // once per holdoff rather than on every pulse
+    unsigned long now = millis();
+    if (motionHandled[core] && now - lastMotion[core] < POWER_SAVE_MOTION_HOLDOFF)
+        return false;
+
+    motionHandled[core] = true;
+    lastMotion[core] = now;
+    return true;
+}
+
+//=====================================================================
+// STATISTICS
+//=====================================================================
+static void readCounters(PowerSaveStats& stats) {
+    stats.sleeps = 0;
+    for (int core = 0; core < POWER_SAVE_CORES; core++) {
+        stats.asleep[core] = asleepMs[core].load(std::memory_order_relaxed);
+        stats.sleeps += sleepCount[core].load(std::memory_order_relaxed);
+    }
+    stats.motionWakes = motionWakes.load(std::memory_order_relaxed);
+}
+
+static void startPeriod(unsigned long now) {
+    readCounters(baseline);
+    periodStart = now;
+    radioOnTotal = 0;
+    radioOnSince = now;
+    uploadWindows = 0;
+}
+
+void powerSaveTake(PowerSaveStats& stats) {
+    unsigned long now = millis();
+
+    readCounters(stats);
+    for (int core = 0; core < POWER_SAVE_CORES; core++) {
+        stats.asleep[core] -= baseline.asleep[core];
+    }
+    stats.sleeps -= baseline.sleeps;
+    stats.motionWakes -= baseline.motionWakes;
+
+    stats.active = active.load(std::memory_order_relaxed);
+    stats.since = periodStart;
+    stats.elapsed = now - periodStart;
+    stats.radioOn = radioOnTotal + (networkSuspended() ? 0 : now - radioOnSince);
+    stats.uploadWindows = uploadWindows;
+}
+
+//=====================================================================
+// UPLOAD WINDOWS
+//=====================================================================
+static void openWindow(unsigned long now) {
+    windowOpen = true;
+    windowConnected = false;
+    windowOpened = now;
+    uploadRequested = false;
+
+    if (networkSuspended()) {
+        uploadWindows++;
+        radioOnSince = now;
+        resumeNetwork(true);
+    }
+}
+
+static void closeWindow(unsigned long now) {
+    windowOpen = false;
+    windowClosed = now;
+
+    if (networkConnected) {
+        // Samples batched while online go out before the radio does
+        publishTelemetryBatch();
+
+        publishJson(
+            MQTT_STATUS_TOPIC,
+            [](JsonStream& json) {
+                json.beginObject();
+                json.field("device_id", MQTT_CLIENT_ID);
+                json.field("status", "sleeping");
+                json.field("next_upload_ms", config.uploadInterval);
+                json.endObject();
+            },
+            true);
+    }
+
+    if (!networkSuspended()) {
+        suspendNetwork();
+        radioOnTotal += now - radioOnSince;
+    }
+}
+
+void powerSaveRequestUpload() {
+    if (active.load(std::memory_order_relaxed)) {
+        uploadRequested = true;
+    }
+}
+
+//=====================================================================
+// MODE
+//=====================================================================
+void powerSaveBegin() {
+#if defined(ARDUINO_ARCH_MBED) && !SENSORHUB_DUAL_CORE
+    sleepingThread = rtos::ThisThread::get_id();
+#endif
+
+    pinMode(IMU_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(IMU_INT_PIN), onImuWake, RISING);
+    startPeriod(millis());
+}
+
+bool powerSaveActive() {
+    return active.load(std::memory_order_relaxed);
+}
+
+static bool powerSaveWanted() {
+    return config.powerSaveMode == POWER_SAVE_ON ||
+           (config.powerSaveMode == POWER_SAVE_AUTO && isOnBattery);
+}
+
+void powerSaveService() {
+    unsigned long now = millis();
+    bool wanted = powerSaveWanted();
+
+    if (wanted != active.load(std::memory_order_relaxed)) {
+        if (wanted) {
+            Serial.println("Power save on");
+            resumeNetwork(true);
+            startPeriod(now);
+            active.store(true, std::memory_order_relaxed);
+
+            // Upload what is queued before the radio first goes off
+            openWindow(now);
+        } else {
+            Serial.println("Power save off");
+            active.store(false, std::memory_order_relaxed);
+            windowOpen = false;
+            resumeNetwork(false);
+            startPeriod(now);
+        }
+        return;
+    }
+
+    if (!wanted)
+        return;
+
+    if (!windowOpen) {
+        if (uploadRequested || now - windowClosed >= config.uploadInterval) {
+            openWindow(now);
+        }
+        return;
+    }
+
+    if (networkConnected && !windowConnected) {
+        windowConnected = true;
+        windowConnectedAt = now;
+    }
+
+    // Spikes keep coming: stay online so their alerts go out as they happen
+    if (uploadRequested) {
+        uploadRequested = false;
+        windowOpened = now;
+        windowConnectedAt = now;
+    }
+
+    // Stay up until the alerts are out and the buffer is drained, and long
+    // enough for the broker to deliver retained config
+    bool uploaded = windowConnected && outboundService() && bufferCount == 0 &&
+                    now - windowConnectedAt >= UPLOAD_WINDOW_MIN_CONNECTED;
+    if (uploaded || now - windowOpened >= UPLOAD_WINDOW_TIMEOUT) {
+        closeWindow(now);
+    }
+}
+
+const char* powerSaveModeName(uint8_t mode) {
+    return mode <= POWER_SAVE_AUTO ? MODE_NAMES[mode] : "unknown";
+}
+
+bool parsePowerSaveMode(const char* name, uint8_t& mode) {
+    if (name == NULL)
+        return false;
+
+    for (uint8_t i = 0; i <= POWER_SAVE_AUTO; i++) {
+        if (strcmp(name, MODE_NAMES[i]) == 0) {
+            mode = i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+/*
+ * PowerSave.h
+ * Low-power operation between samples and upload windows
+ *
+ * Power save is active when config.powerSaveMode is POWER_SAVE_ON, or
+ * POWER_SAVE_AUTO while the board runs from its battery. While active:
+ * - each core sleeps until its next scheduled task: WFE on the RP2040
+ *   with the arduino-pico core, an RTOS thread-flag wait (so the idle
+ *   thread can sleep) with the mbed core. The clocks keep running, so
+ *   the timer, PDM DMA and IMU FIFO pacing are unaffected.
+ * - the WiFi module is held in reset and readings go to the offline
+ *   buffer. Every config.uploadInterval, or at once after a spike, the
+ *   radio comes up for an upload window that drains the buffer.
+ * - the LSM6DSOX wake-up interrupt on INT1 ends a sleep as soon as the
+ *   board vibrates, so motion is sampled without waiting for the next read
+ *
+ * Time asleep and with the radio on is measured from the last mode change
+ * and reported as awake ratios on the metrics topic.
+ */
+
+#ifndef POWER_SAVE_H
+#define POWER_SAVE_H
+
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define POWER_SAVE_CORES 2
+#define POWER_SAVE_MIN_SLEEP 2           // ms; shorter waits stay awake
+#define POWER_SAVE_MOTION_HOLDOFF 1000   // ms between motion wakes acted on, per core
+#define UPLOAD_WINDOW_MIN_CONNECTED 2000 // ms online before the radio may go off again
+#define UPLOAD_WINDOW_TIMEOUT 30000      // ms before a window closes regardless
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct PowerSaveStats {
+    bool active;
+    unsigned long since;                    // millis() at the last mode change
+    unsigned long elapsed;                  // ms since then
+    unsigned long asleep[POWER_SAVE_CORES]; // ms each core spent asleep
+    unsigned long radioOn;                  // ms the WiFi module was powered
+    uint32_t sleeps;
+    uint32_t motionWakes;   // Wake-up interrupts from the IMU
+    uint32_t uploadWindows; // Times the radio was brought back up
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Attach the IMU wake-up interrupt; call from setup() on core0
+void powerSaveBegin();
+
+// Follow the mode and battery state, and open and close upload windows.
+// Runs as a task every POWER_SAVE_CHECK_INTERVAL.
+void powerSaveService();
+
+bool powerSaveActive();
+
+// Sleep the calling core for up to ms, or until the IMU reports motion.
+// Returns true if motion is pending, in which case the caller should
+// sample now. Does nothing and returns false while power save is inactive.
+bool powerSaveSleep(unsigned long ms);
+
+// Bring the radio up for an upload window at the next service run, or
+// keep the open window from closing
+void powerSaveRequestUpload();
+
+// Copy the statistics for the current mode period
+void powerSaveTake(PowerSaveStats& stats);
+
+// "off", "on" or "auto"
+const char* powerSaveModeName(uint8_t mode);
+bool parsePowerSaveMode(const char* name, uint8_t& mode);
+
+#endif // POWER_SAVE_H
@@ -0,0 +1,346 @@
+/*
+ * ReadingCodec.cpp
+ * Delta-of-delta / XOR block codec implementation
+ */
+
+#include "ReadingCodec.h"
+#include <string.h>
+
+static const uint32_t CAPACITY_BITS = (COMPRESSED_BLOCK_SIZE - READING_CODEC_HEADER_SIZE) * 8;
+static const uint8_t NO_WINDOW = 0xFF;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static void readingToChannels(const SensorReading& reading, uint32_t* values) {
+    const float floats[READING_CODEC_CHANNELS] = {
+        reading.temperature, reading.humidity,   reading.accelMagnitude,
+        reading.gasRatio,    reading.soundLevel, reading.batteryPercentage,
+    };
+    memcpy(values, floats, sizeof(floats));
+}
+
+static void channelsToReading(const uint32_t* values, SensorReading& reading) {
+    float floats[READING_CODEC_CHANNELS];
+    memcpy(floats, values, sizeof(floats));
+    reading.temperature = floats[0];
+    reading.humidity = floats[1];
+    reading.accelMagnitude = floats[2];
+    reading.gasRatio = floats[3];
+    reading.soundLevel = floats[4];
+    reading.batteryPercentage = floats[5];
+}
+
+static void writeCount(uint8_t* data, uint16_t count) {
+    data[2] = count & 0xFF;
+    data[3] = count >> 8;
+}
+
+static void writeHeader(uint8_t* data, uint16_t count, uint32_t firstTimestamp) {
+    data[0] = READING_CODEC_VERSION;
+    data[1] = 0;
+    writeCount(data, count);
+    data[4] = firstTimestamp & 0xFF;
+    data[5] = (firstTimestamp >> 8) & 0xFF;
+    data[6] = (firstTimestamp >> 16) & 0xFF;
+    data[7] = firstTimestamp >> 24;
+}
+
+static bool writeBits(BlockEncoder& encoder, uint32_t value, uint8_t bits) {
+    if (encoder.bitPosition + bits > CAPACITY_BITS)
+        return false;
+
+    uint8_t* stream = encoder.data + READING_CODEC_HEADER_SIZE;
+    while (bits > 0) {
+        uint8_t space = 8 - (encoder.bitPosition & 7);
+        uint8_t take = bits < space ? bits : space;
+        uint8_t shift = space - take;
+        uint8_t mask = ((1u << take) - 1) << shift;
+        uint8_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+        uint8_t& target = stream[encoder.bitPosition >> 3];
+
+        // Overwrite rather than OR, so bits left by a rolled-back add vanish
+        target = (target & ~mask) | (chunk << shift);
+        bits -= take;
+        encoder.bitPosition += take;
+    }
+
+    return true;
+}
+
+static bool readBits(BlockDecoder& decoder, uint8_t bits, uint32_t& value) {
+    if (decoder.bitPosition + bits > decoder.bitLength)
+        return false;
+
+    const uint8_t* stream = decoder.stream;
+    value = 0;
+    while (bits > 0) {
+        uint8_t space = 8 - (decoder.bitPosition & 7);
+        uint8_t take = bits < space ? bits : space;
+        uint8_t chunk = (stream[decoder.bitPosition >> 3] >> (space - take)) & ((1u << take) - 1);
+
+        value = (value << take) | chunk;
+        bits -= take;
+        decoder.bitPosition += take;
+    }
+
+    return true;
+}
+
+static bool encodeTimestamp(BlockEncoder& encoder, uint32_t timestamp) {
+    int32_t delta = (int32_t)(timestamp - encoder.previousTimestamp);
+    int32_t dod = delta - encoder.previousDelta;
+    encoder.previousTimestamp = timestamp;
+    encoder.previousDelta = delta;
+
+    if (dod == 0)
+        return writeBits(encoder, 0x0, 1);
+    if (dod >= -63 && dod <= 64)
+        return writeBits(encoder, 0x2, 2) && writeBits(encoder, dod + 63, 7);
+    if (dod >= -255 && dod <= 256)
+        return writeBits(encoder, 0x6, 3) && writeBits(encoder, dod + 255, 9);
+    if (dod >= -2047 && dod <= 2048)
+        return writeBits(encoder, 0xE, 4) && writeBits(encoder, dod + 2047, 12);
+    return writeBits(encoder, 0xF, 4) && writeBits(encoder, (uint32_t)dod, 32);
+}
+
+static bool decodeTimestamp(BlockDecoder& decoder, uint32_t& timestamp) {
+    uint32_t bit;
+    uint32_t raw;
+    int32_t dod = 0;
+    uint8_t prefix = 0;
+
+    // Count leading ones of the prefix, at most four
+    while (prefix < 4) {
+        if (!readBits(decoder, 1, bit))
+            return false;
+        if (bit == 0)
+            break;
+        prefix++;
+    }
+
+    switch (prefix) {
+    case 0:
+        break;
+    case 1:
+        if (!readBits(decoder, 7, raw))
+            return false;
+        dod = (int32_t)raw - 63;
+        break;
+    case 2:
+        if (!readBits(decoder, 9, raw))
+            return false;
+        dod = (int32_t)raw - 255;
+        break;
+    case 3:
+        if (!readBits(decoder, 12, raw))
+            return false;
+        dod = (int32_t)raw - 2047;
+        break;
+    default:
+        if (!readBits(decoder, 32, raw))
+            return false;
+        dod = (int32_t)raw;
+        break;
+    }
+
+    decoder.previousDelta += dod;
+    decoder.previousTimestamp += decoder.previousDelta;
+    timestamp = decoder.previousTimestamp;
+    return true;
+}
+
+static bool encodeValue(BlockEncoder& encoder, ReadingChannelState& channel, uint32_t value) {
+    uint32_t xorValue = value ^ channel.previous;
+    channel.previous = value;
+
+    if (xorValue == 0)
+        return writeBits(encoder, 0x0, 1);
+
+    uint8_t leading = __builtin_clz(xorValue);
+    uint8_t trailing = __builtin_ctz(xorValue);
+    if (leading > 31)
+        leading = 31;
+
+    // Reuse the previous window when the meaningful bits fit inside it
+    if (channel.leading != NO_WINDOW && leading >= channel.leading &&
+        trailing >= channel.trailing) {
+        uint8_t length = 32 - channel.leading - channel.trailing;
+        return writeBits(encoder, 0x2, 2) &&
+               writeBits(encoder, xorValue >> channel.trailing, length);
+    }
+
+    uint8_t length = 32 - leading - trailing;
+    channel.leading = leading;
+    channel.trailing = trailing;
+    return writeBits(encoder, 0x3, 2) && writeBits(encoder, leading, 5) &&
+           writeBits(encoder, length, 6) && writeBits(encoder, xorValue >> trailing, length);
+}
+
+static bool decodeValue(BlockDecoder& decoder, ReadingChannelState& channel, uint32_t& value) {
+    uint32_t bit;
+    if (!readBits(decoder, 1, bit))
+        return false;
+
+    if (bit == 0) {
+        value = channel.previous;
+        return true;
+    }
+
+    if (!readBits(decoder, 1, bit))
+        return false;
+
+    if (bit == 1) {
+        uint32_t leading;
+        uint32_t length;
+        if (!readBits(decoder, 5, leading) || !readBits(decoder, 6, length) || length == 0 ||
+            leading + length > 32)
+            return false;
+        channel.leading = leading;
+        channel.trailing = 32 - leading - length;
+    } else if (channel.leading == NO_WINDOW) {
+        return false;
+    }
+
+    uint32_t meaningful;
+    if (!readBits(decoder, 32 - channel.leading - channel.trailing, meaningful))
+        return false;
+
+    value = channel.previous ^ (meaningful << channel.trailing);
+    channel.previous = value;
+    return true;
+}
+
+//=====================================================================
+// ENCODER
+//=====================================================================
+void blockEncoderBegin(BlockEncoder& encoder, uint8_t* buffer) {
+    memset(&encoder, 0, sizeof(encoder));
+    encoder.data = buffer;
+    for (int i = 0; i < READING_CODEC_CHANNELS; i++) {
+        encoder.channels[i].leading = NO_WINDOW;
+    }
+    writeHeader(buffer, 0, 0);
+    blockEncoderSetOrigin(encoder, 0, 0);
+}
+
+bool blockEncoderAdd(BlockEncoder& encoder, const SensorReading& reading) {
+    if (encoder.count == 0xFFFF)
+        return false;
+
+    uint32_t values[READING_CODEC_CHANNELS];
+    readingToChannels(reading, values);
+    uint32_t timestamp = (uint32_t)reading.timestamp;
+
+    if (encoder.count == 0) {
+        // First reading: raw values, timestamp in the header
+        if (encoder.bitPosition + READING_CODEC_CHANNELS * 32 > CAPACITY_BITS)
+            return false;
+
+        for (int i = 0; i < READING_CODEC_CHANNELS; i++) {
+            writeBits(encoder, values[i], 32);
+            encoder.channels[i].previous = values[i];
+        }
+        encoder.firstTimestamp = timestamp;
+        encoder.previousTimestamp = timestamp;
+        encoder.previousDelta = 0;
+        encoder.count = 1;
+        writeHeader(encoder.data, encoder.count, timestamp);
+        return true;
+    }
+
+    // Encode against a copy so a full block can be rolled back cleanly
+    BlockEncoder attempt = encoder;
+    bool fits = encodeTimestamp(attempt, timestamp);
+    for (int i = 0; fits && i < READING_CODEC_CHANNELS; i++) {
+        fits = encodeValue(attempt, attempt.channels[i], values[i]);
+    }
+
+    if (!fits)
+        return false;
+
+    encoder = attempt;
+    encoder.count++;
+    writeCount(encoder.data, encoder.count);
+    return true;
+}
+
+uint16_t blockEncoderSize(const BlockEncoder& encoder) {
+    return READING_CODEC_HEADER_SIZE + (encoder.bitPosition + 7) / 8;
+}
+
+void blockEncoderSetOrigin(BlockEncoder& encoder, uint16_t boot, uint64_t firstEpoch) {
+    encoder.boot = boot;
+    encoder.firstEpoch = firstEpoch;
+
+    uint8_t* data = encoder.data;
+    data[8] = boot & 0xFF;
+    data[9] = boot >> 8;
+    for (int i = 0; i < 6; i++) {
+        data[10 + i] = (firstEpoch >> (8 * i)) & 0xFF;
+    }
+}
+
+//=====================================================================
+// DECODER
+//=====================================================================
+bool blockDecoderBegin(BlockDecoder& decoder, const uint8_t* data, uint16_t length) {
+    memset(&decoder, 0, sizeof(decoder));
+
+    uint16_t headerSize;
+    if (length >= 1 && data[0] == READING_CODEC_VERSION) {
+        headerSize = READING_CODEC_HEADER_SIZE;
+    } else if (length >= 1 && data[0] == 1) {
+        headerSize = READING_CODEC_V1_HEADER_SIZE;
+    } else {
+        return false;
+    }
+    if (length < headerSize)
+        return false;
+
+    decoder.data = data;
+    decoder.stream = data + headerSize;
+    decoder.bitLength = (uint32_t)(length - headerSize) * 8;
+    decoder.count = data[2] | (data[3] << 8);
+    decoder.firstTimestamp = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+                             ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    decoder.previousTimestamp = decoder.firstTimestamp;
+    if (headerSize == READING_CODEC_HEADER_SIZE) {
+        decoder.boot = data[8] | (data[9] << 8);
+        for (int i = 5; i >= 0; i--) {
+            decoder.firstEpoch = (decoder.firstEpoch << 8) | data[10 + i];
+        }
+    }
+    for (int i = 0; i < READING_CODEC_CHANNELS; i++) {
+        decoder.channels[i].leading = NO_WINDOW;
+    }
+    return true;
+}
+
+bool blockDecoderNext(BlockDecoder& decoder, SensorReading& reading) {
+    if (decoder.index >= decoder.count)
+        return false;
+
+    uint32_t values[READING_CODEC_CHANNELS];
+
+    if (decoder.index == 0) {
+        for (int i = 0; i < READING_CODEC_CHANNELS; i++) {
+            if (!readBits(decoder, 32, values[i]))
+                return false;
+            decoder.channels[i].previous = values[i];
+        }
+    } else {
+        uint32_t timestamp;
+        if (!decodeTimestamp(decoder, timestamp))
+            return false;
+        for (int i = 0; i < READING_CODEC_CHANNELS; i++) {
+            if (!decodeValue(decoder, decoder.channels[i], values[i]))
+                return false;
+        }
+    }
+
+    reading.timestamp = decoder.previousTimestamp;
+    channelsToReading(values, reading);
+    decoder.index++;
+    return true;
+}
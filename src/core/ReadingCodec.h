@@ -0,0 +1,100 @@
+/*
+ * ReadingCodec.h
+ * Compressed block encoding for buffered readings
+ *
+ * Readings are packed into self-contained blocks of at most
+ * COMPRESSED_BLOCK_SIZE bytes. Timestamps are stored as delta-of-delta
+ * and each float channel as the XOR against its previous value, with
+ * only the meaningful bits written (the scheme used by Facebook's
+ * Gorilla TSDB). Every block starts from raw values, so any block can be
+ * decoded on its own.
+ *
+ * Block layout (little endian):
+ *   byte 0       format version (READING_CODEC_VERSION)
+ *   byte 1       reserved (0)
+ *   bytes 2-3    number of readings
+ *   bytes 4-7    timestamp of the first reading (device ms)
+ *   bytes 8-9    boot the readings were taken in
+ *   bytes 10-15  Unix time of the first reading in ms, 0 if not known
+ *   bytes 16-    bit stream, most significant bit first
+ *
+ * Timestamps are millis(), which restarts at every boot; the boot number
+ * and Unix time let a block written before a reset still be placed.
+ * Version 1 blocks, with the bit stream from byte 8, decode as boot 0
+ * with no Unix time.
+ */
+
+#ifndef READING_CODEC_H
+#define READING_CODEC_H
+
+#include "SensorReading.h"
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define COMPRESSED_BLOCK_SIZE 512
+#define READING_CODEC_VERSION 2
+#define READING_CODEC_CHANNELS 6
+#define READING_CODEC_HEADER_SIZE 16
+#define READING_CODEC_V1_HEADER_SIZE 8
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct ReadingChannelState {
+    uint32_t previous;
+    uint8_t leading;
+    uint8_t trailing;
+};
+
+struct BlockEncoder {
+    uint8_t* data;
+    uint32_t bitPosition;
+    uint16_t count;
+    uint32_t previousTimestamp;
+    int32_t previousDelta;
+    ReadingChannelState channels[READING_CODEC_CHANNELS];
+    uint32_t firstTimestamp;
+    uint16_t boot;
+    uint64_t firstEpoch;
+};
+
+struct BlockDecoder {
+    const uint8_t* data;
+    const uint8_t* stream;
+    uint32_t bitLength;
+    uint32_t bitPosition;
+    uint16_t count;
+    uint16_t index;
+    uint32_t previousTimestamp;
+    int32_t previousDelta;
+    ReadingChannelState channels[READING_CODEC_CHANNELS];
+    uint32_t firstTimestamp; // From the header
+    uint16_t boot;
+    uint64_t firstEpoch;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Start a new block in a buffer of COMPRESSED_BLOCK_SIZE bytes
+void blockEncoderBegin(BlockEncoder& encoder, uint8_t* buffer);
+
+// Append a reading. Returns false, leaving the block unchanged, when full.
+bool blockEncoderAdd(BlockEncoder& encoder, const SensorReading& reading);
+
+// Bytes of the buffer in use
+uint16_t blockEncoderSize(const BlockEncoder& encoder);
+
+// Record the boot and the Unix time in ms of the first reading (0 if not
+// known) in the header; before writing the block out
+void blockEncoderSetOrigin(BlockEncoder& encoder, uint16_t boot, uint64_t firstEpoch);
+
+// Open a block for reading. Returns false if the header is not recognised.
+bool blockDecoderBegin(BlockDecoder& decoder, const uint8_t* data, uint16_t length);
+
+// Decode the next reading. Returns false at the end of the block.
+bool blockDecoderNext(BlockDecoder& decoder, SensorReading& reading);
+
+#endif // READING_CODEC_H
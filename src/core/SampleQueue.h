@@ -0,0 +1,71 @@
+/*
+ * SampleQueue.h
+ * Lock-free single-producer/single-consumer queue
+ *
+ * Used to hand samples from the acquisition core to the network core.
+ * Only plain atomic loads and stores are needed, which the Cortex-M0+
+ * provides without LDREX/STREX, so neither side ever takes a lock or
+ * waits on the other. Header-only and free of Arduino dependencies so
+ * it can be exercised with two threads on the host.
+ */
+
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T, uint32_t Capacity>
+class SampleQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SampleQueue capacity must be a power of two");
+
+  public:
+    SampleQueue() : head(0), tail(0), dropped(0) {}
+
+    // Producer side. Returns false and counts a drop when the queue is full.
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+
+        if (h - t >= Capacity) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+            return false;
+        }
+
+        items[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the queue is empty.
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+
+        if (h == t)
+            return false;
+
+        item = items[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    T items[Capacity];
+    std::atomic<uint32_t> head;    // Written only by the producer
+    std::atomic<uint32_t> tail;    // Written only by the consumer
+    std::atomic<uint32_t> dropped; // Written only by the producer
+};
+
+#endif // SAMPLE_QUEUE_H
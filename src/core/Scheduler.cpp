@@ -0,0 +1,193 @@
+/*
+ * Scheduler.cpp
+ * Cooperative task scheduler implementation
+ */
+
+#include "Scheduler.h"
+#include <string.h>
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+static ScheduledTask tasks[MAX_SCHEDULED_TASKS];
+static int taskCount = 0;
+static SchedulerClock schedulerClock = 0;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+// Wraparound-safe "a is at or after b" for millis() style counters
+static bool timeReached(unsigned long now, unsigned long due) {
+    return (long)(now - due) >= 0;
+}
+
+static int allocateTask() {
+    for (int i = 0; i < taskCount; i++) {
+        if (!tasks[i].active) {
+            return i;
+        }
+    }
+
+    if (taskCount < MAX_SCHEDULED_TASKS) {
+        return taskCount++;
+    }
+
+    return -1;
+}
+
+static int addTask(const char* name, TaskCallback callback, unsigned long period,
+                   unsigned long deadline, unsigned long delay) {
+    int id = allocateTask();
+    if (id < 0)
+        return -1;
+
+    ScheduledTask& task = tasks[id];
+    memset(&task, 0, sizeof(task));
+    task.name = name;
+    task.callback = callback;
+    task.period = period;
+    task.deadline = deadline;
+    task.nextRun = schedulerClock() + delay;
+    task.active = true;
+    return id;
+}
+
+static bool validTask(int taskId) {
+    return taskId >= 0 && taskId < taskCount && tasks[taskId].active;
+}
+
+//=====================================================================
+// SCHEDULER FUNCTIONS
+//=====================================================================
+void initScheduler(SchedulerClock clock) {
+    memset(tasks, 0, sizeof(tasks));
+    taskCount = 0;
+    schedulerClock = clock;
+}
+
+int schedulePeriodic(const char* name, TaskCallback callback, unsigned long period,
+                     unsigned long deadline, unsigned long initialDelay) {
+    if (period == 0)
+        return -1;
+
+    return addTask(name, callback, period, deadline, initialDelay);
+}
+
+int scheduleOnce(const char* name, TaskCallback callback, unsigned long delay,
+                 unsigned long deadline) {
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].active && tasks[i].period == 0 && strcmp(tasks[i].name, name) == 0) {
+            tasks[i].nextRun = schedulerClock() + delay;
+            return i;
+        }
+    }
+
+    return addTask(name, callback, 0, deadline, delay);
+}
+
+void setTaskPeriod(int taskId, unsigned long period) {
+    if (!validTask(taskId) || period == 0 || tasks[taskId].period == period)
+        return;
+
+    tasks[taskId].period = period;
+    tasks[taskId].nextRun = schedulerClock() + period;
+}
+
+void triggerTask(int taskId) {
+    if (validTask(taskId)) {
+        tasks[taskId].nextRun = schedulerClock();
+    }
+}
+
+void cancelTask(int taskId) {
+    if (validTask(taskId)) {
+        tasks[taskId].active = false;
+    }
+}
+
+unsigned long runScheduler() {
+    unsigned long now = schedulerClock();
+
+    for (int i = 0; i < taskCount; i++) {
+        ScheduledTask& task = tasks[i];
+        if (!task.active || !timeReached(now, task.nextRun))
+            continue;
+
+        unsigned long due = task.nextRun;
+        unsigned long jitter = now - due;
+
+        task.callback();
+
+        unsigned long finished = schedulerClock();
+        unsigned long duration = finished - now;
+
+        task.runCount++;
+        task.lastJitter = jitter;
+        task.totalJitter += jitter;
+        if (jitter > task.maxJitter)
+            task.maxJitter = jitter;
+        if (duration > task.maxDuration)
+            task.maxDuration = duration;
+        if (finished - due > task.deadline)
+            task.overrunCount++;
+
+        if (task.period == 0) {
+            // One-shot tasks may have re-armed themselves from the callback
+            if (task.nextRun == due)
+                task.active = false;
+        } else {
+            task.nextRun = due + task.period;
+
+            // Skip whole periods we are already past instead of bursting
+            if (timeReached(finished, task.nextRun + task.period)) {
+                unsigned long missed = (finished - task.nextRun) / task.period;
+                task.missedCount += missed;
+                task.nextRun += missed * task.period;
+            }
+        }
+
+        now = finished;
+    }
+
+    // Report how long the caller may idle before the next task is due
+    unsigned long idle = (unsigned long)-1;
+    for (int i = 0; i < taskCount; i++) {
+        if (!tasks[i].active)
+            continue;
+
+        if (timeReached(now, tasks[i].nextRun))
+            return 0;
+
+        unsigned long wait = tasks[i].nextRun - now;
+        if (wait < idle)
+            idle = wait;
+    }
+
+    return idle;
+}
+
+//=====================================================================
+// STATISTICS
+//=====================================================================
+const ScheduledTask* getTask(int taskId) {
+    if (taskId < 0 || taskId >= taskCount)
+        return 0;
+
+    return &tasks[taskId];
+}
+
+int getTaskCount() {
+    return taskCount;
+}
+
+void resetTaskStats() {
+    for (int i = 0; i < taskCount; i++) {
+        tasks[i].runCount = 0;
+        tasks[i].overrunCount = 0;
+        tasks[i].missedCount = 0;
+        tasks[i].lastJitter = 0;
+        tasks[i].maxJitter = 0;
+        tasks[i].totalJitter = 0;
+        tasks[i].maxDuration = 0;
+    }
+}
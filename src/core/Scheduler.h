@@ -0,0 +1,78 @@
+/*
+ * Scheduler.h
+ * Cooperative, non-blocking task scheduler
+ *
+ * Tasks are plain functions that must return quickly; anything that
+ * would wait (LED patterns, retries, batching) is expressed as another
+ * task run later instead of a delay(). The scheduler does not depend on
+ * Arduino.h so it can be built on the host against a fake clock.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define MAX_SCHEDULED_TASKS 16
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+typedef void (*TaskCallback)();
+typedef unsigned long (*SchedulerClock)();
+
+struct ScheduledTask {
+    const char* name;
+    TaskCallback callback;
+    unsigned long period;   // 0 for one-shot tasks
+    unsigned long deadline; // Must finish within this many ms of being due
+    unsigned long nextRun;
+    bool active;
+
+    // Statistics
+    unsigned long runCount;
+    unsigned long overrunCount; // Runs that finished after their deadline
+    unsigned long missedCount;  // Whole periods skipped because the task ran late
+    unsigned long lastJitter;   // Start time minus due time of the last run
+    unsigned long maxJitter;
+    unsigned long totalJitter;
+    unsigned long maxDuration;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Reset the task table and select the time source (millis() on the device)
+void initScheduler(SchedulerClock clock);
+
+// Register a task that runs every period ms, first after initialDelay ms.
+// Returns the task id, or -1 if the table is full.
+int schedulePeriodic(const char* name, TaskCallback callback, unsigned long period,
+                     unsigned long deadline, unsigned long initialDelay = 0);
+
+// Register a task that runs once after delay ms. If an active task with the
+// same name exists its due time is pushed out instead (debounce).
+int scheduleOnce(const char* name, TaskCallback callback, unsigned long delay,
+                 unsigned long deadline);
+
+// Change the period of a periodic task; the next run is re-based on now
+void setTaskPeriod(int taskId, unsigned long period);
+
+// Make a task due immediately
+void triggerTask(int taskId);
+
+// Remove a task from the table
+void cancelTask(int taskId);
+
+// Run every task that is due. Returns the number of ms until the next one.
+unsigned long runScheduler();
+
+// Statistics access
+const ScheduledTask* getTask(int taskId);
+int getTaskCount();
+void resetTaskStats();
+
+#endif // SCHEDULER_H
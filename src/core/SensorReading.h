@@ -0,0 +1,22 @@
+/*
+ * SensorReading.h
+ * Reading record kept in the offline buffer
+ */
+
+#ifndef SENSOR_READING_H
+#define SENSOR_READING_H
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct SensorReading {
+    unsigned long timestamp;
+    float temperature;
+    float humidity;
+    float accelMagnitude;
+    float gasRatio;
+    float soundLevel;
+    float batteryPercentage;
+};
+
+#endif // SENSOR_READING_H
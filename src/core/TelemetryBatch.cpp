@@ -0,0 +1,48 @@
+/*
+ * TelemetryBatch.cpp
+ * Telemetry batching implementation
+ */
+
+#include "TelemetryBatch.h"
+#include "Config.h"
+#include "Sensors.h"
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+TelemetryBatch telemetryBatch;
+
+const char* const TELEMETRY_CHANNEL_NAMES[TELEMETRY_CHANNELS] = {
+    "temperature", "humidity", "accel_x", "accel_y",   "accel_z",
+    "gyro_x",      "gyro_y",   "gyro_z",  "gas_ratio", "sound_level",
+};
+
+//=====================================================================
+// BATCH FUNCTIONS
+//=====================================================================
+bool telemetryBatchAdd(const SensorSample& sample) {
+    if (telemetryBatch.count >= TELEMETRY_BATCH_CAPACITY)
+        return false;
+
+    uint16_t i = telemetryBatch.count++;
+    telemetryBatch.timestamps[i] = sample.timestamp;
+    telemetryBatch.temperature[i] = sample.environmentValid ? sample.temperature : NAN;
+    telemetryBatch.humidity[i] = sample.environmentValid ? sample.humidity : NAN;
+    telemetryBatch.accelX[i] = sample.accelValid ? sample.Ax : NAN;
+    telemetryBatch.accelY[i] = sample.accelValid ? sample.Ay : NAN;
+    telemetryBatch.accelZ[i] = sample.accelValid ? sample.Az : NAN;
+    telemetryBatch.gyroX[i] = sample.gyroValid ? sample.Gx : NAN;
+    telemetryBatch.gyroY[i] = sample.gyroValid ? sample.Gy : NAN;
+    telemetryBatch.gyroZ[i] = sample.gyroValid ? sample.Gz : NAN;
+    telemetryBatch.gasRatio[i] = sample.gasValid ? sample.gasRatio : NAN;
+    telemetryBatch.soundLevel[i] = sample.soundValid ? sample.soundLevel : NAN;
+    return true;
+}
+
+bool telemetryBatchFull() {
+    return telemetryBatch.count >= config.telemetryBatchSize;
+}
+
+void telemetryBatchClear() {
+    telemetryBatch.count = 0;
+}
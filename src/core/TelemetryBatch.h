@@ -0,0 +1,91 @@
+/*
+ * TelemetryBatch.h
+ * Samples collected between telemetry publishes
+ *
+ * Every sample taken while online is kept until the next telemetry
+ * message, which carries the whole window column by column: one array
+ * per field instead of one message per sample. The batch is sent when
+ * it holds config.telemetryBatchSize samples or when the publish
+ * interval (its maximum latency) elapses, whichever comes first.
+ *
+ * Fields a sample could not read are stored as NaN and sent as null.
+ * In deadband mode a message may leave out channels that have not
+ * moved (Deadband.h).
+ */
+
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include "Constants.h"
+#include <stdint.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Stored by column, the order the message is written in
+struct TelemetryBatch {
+    uint16_t count;
+    uint32_t timestamps[TELEMETRY_BATCH_CAPACITY];
+    float temperature[TELEMETRY_BATCH_CAPACITY];
+    float humidity[TELEMETRY_BATCH_CAPACITY];
+    float accelX[TELEMETRY_BATCH_CAPACITY];
+    float accelY[TELEMETRY_BATCH_CAPACITY];
+    float accelZ[TELEMETRY_BATCH_CAPACITY];
+    float gyroX[TELEMETRY_BATCH_CAPACITY];
+    float gyroY[TELEMETRY_BATCH_CAPACITY];
+    float gyroZ[TELEMETRY_BATCH_CAPACITY];
+    float gasRatio[TELEMETRY_BATCH_CAPACITY];
+    float soundLevel[TELEMETRY_BATCH_CAPACITY];
+};
+
+// Channel indices and bits of a channel mask, in message order
+enum TelemetryChannel : uint8_t {
+    CHANNEL_TEMPERATURE,
+    CHANNEL_HUMIDITY,
+    CHANNEL_ACCEL_X,
+    CHANNEL_ACCEL_Y,
+    CHANNEL_ACCEL_Z,
+    CHANNEL_GYRO_X,
+    CHANNEL_GYRO_Y,
+    CHANNEL_GYRO_Z,
+    CHANNEL_GAS_RATIO,
+    CHANNEL_SOUND_LEVEL,
+};
+
+// The float column holding a channel
+inline const float* telemetryBatchColumn(const TelemetryBatch& batch, int channel) {
+    const float* columns[TELEMETRY_CHANNELS] = {
+        batch.temperature, batch.humidity, batch.accelX, batch.accelY,   batch.accelZ,
+        batch.gyroX,       batch.gyroY,    batch.gyroZ,  batch.gasRatio, batch.soundLevel,
+    };
+    return columns[channel];
+}
+
+inline float* telemetryBatchColumn(TelemetryBatch& batch, int channel) {
+    return const_cast<float*>(telemetryBatchColumn(const_cast<const TelemetryBatch&>(batch),
+                                                   channel));
+}
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+extern TelemetryBatch telemetryBatch;
+
+// JSON field and config key name of each channel
+extern const char* const TELEMETRY_CHANNEL_NAMES[TELEMETRY_CHANNELS];
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+struct SensorSample;
+
+// Add a sample. Returns false if the batch is already at capacity.
+bool telemetryBatchAdd(const SensorSample& sample);
+
+// True once the batch holds config.telemetryBatchSize samples
+bool telemetryBatchFull();
+
+// Start a new, empty window
+void telemetryBatchClear();
+
+#endif // TELEMETRY_BATCH_H
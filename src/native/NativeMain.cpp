@@ -0,0 +1,247 @@
+/*
+ * NativeMain.cpp
+ * Host entry point: runs the firmware's setup()/loop() on a virtual clock
+ *
+ * Built only by the native environment, against the simulated devices
+ * in lib/NativeHal. The loop idles straight to the next due task or
+ * device event, so an hour of operation takes seconds.
+ *
+ *   .pio/build/native/program --duration 86400 --script outage.txt \
+ *       --mqtt-log messages.log
+ */
+
+#ifndef ARDUINO
+
+#include "../SensorHub.ino"
+#include "FlashStorage.h"
+#include "Simulation.h"
+#include <chrono>
+#include <stdlib.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define DEFAULT_DURATION_S 3600
+
+// Test suites link the firmware and simulation and bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--duration seconds] [--script file] [--set key=value]...\n"
+            "          [--mqtt-log file] [--flash file] [--quiet]\n",
+            program);
+}
+
+// Time until the earliest active task is due
+static unsigned long nextTaskDue() {
+    unsigned long now = millis();
+    unsigned long idle = (unsigned long)-1;
+
+    for (int i = 0; i < getTaskCount(); i++) {
+        const ScheduledTask* task = getTask(i);
+        if (task == NULL || !task->active)
+            continue;
+
+        long until = (long)(task->nextRun - now);
+        if (until <= 0)
+            return 0;
+        if ((unsigned long)until < idle) {
+            idle = until;
+        }
+    }
+    return idle;
+}
+
+static void printSummary(double wallSeconds) {
+    double virtualSeconds = millis() / 1000.0;
+
+    fprintf(stderr, "\nSimulated %.1f s in %.3f s (%.0fx real time)\n", virtualSeconds,
+            wallSeconds, wallSeconds > 0 ? virtualSeconds / wallSeconds : 0);
+    fprintf(stderr, "MQTT: %lu messages, %lu payload bytes\n", simMessageCount(),
+            simMessageBytes());
+    if (simMessagesLost() > 0) {
+        fprintf(stderr, "MQTT: %lu messages lost on a silently dropped link\n",
+                simMessagesLost());
+    }
+
+    if (config.adaptiveSamplingEnabled) {
+        const AdaptiveSampler& sampler = adaptiveSampler;
+        uint32_t fixedReads = adaptiveSamplerFixedReads(sampler, config.sensorReadInterval);
+        fprintf(stderr,
+                "Adaptive sampling: %lu reads, %lu at a fixed %lu ms (%.1f%% saved), "
+                "%lu active reads in %lu events\n",
+                (unsigned long)sampler.reads, (unsigned long)fixedReads, config.sensorReadInterval,
+                fixedReads > 0 ? 100.0 * ((double)fixedReads - sampler.reads) / fixedReads : 0.0,
+                (unsigned long)sampler.activeReads, (unsigned long)sampler.events);
+    }
+
+    // Savings over the current mode period; a mode change (e.g. moving
+    // to battery) restarts it
+    PowerSaveStats power;
+    powerSaveTake(power);
+    if (power.active && power.elapsed > 0) {
+        fprintf(stderr,
+                "Power save (%s) for %.1f s: awake %.1f%%, radio on %.1f%%, %lu sleeps, "
+                "%lu motion wakes, %lu upload windows\n",
+                powerSaveModeName(config.powerSaveMode), power.elapsed / 1000.0,
+                100.0 * (power.elapsed - power.asleep[0]) / power.elapsed,
+                100.0 * power.radioOn / power.elapsed, (unsigned long)power.sleeps,
+                (unsigned long)power.motionWakes, (unsigned long)power.uploadWindows);
+    }
+
+    NetworkStats network;
+    networkTakeStats(network);
+    fprintf(stderr,
+            "Network: wifi %lu attempts, %lu failed, %lu drops; mqtt %lu attempts, %lu failed, "
+            "%lu drops; blocked %lu ms (max %lu), offline %.1f s (longest %.1f s)\n",
+            (unsigned long)network.wifiAttempts, (unsigned long)network.wifiFailures,
+            (unsigned long)network.wifiDrops, (unsigned long)network.mqttAttempts,
+            (unsigned long)network.mqttFailures, (unsigned long)network.mqttDrops,
+            network.blockedTime, network.maxBlocked, network.offlineTime / 1000.0,
+            network.longestOutage / 1000.0);
+
+    OutboundStats outbound;
+    outboundTakeStats(outbound);
+    fprintf(stderr,
+            "Alerts: %lu queued, %lu delivered, %lu resent, %lu to the offline buffer, %lu lost, "
+            "%u pending; latency mean %.1f ms, max %lu ms\n",
+            (unsigned long)outbound.queued, (unsigned long)outbound.delivered,
+            (unsigned long)outbound.resent, (unsigned long)outbound.buffered,
+            (unsigned long)outbound.lost, (unsigned int)outbound.pending,
+            outbound.published > 0 ? (double)outbound.totalLatency / outbound.published : 0.0,
+            outbound.maxLatency);
+
+    DrainStats drain;
+    bufferDrainTakeStats(drain);
+    fprintf(stderr,
+            "Backlog: %d pending, %d unconfirmed; %lu batches, %lu bytes sent, %lu rewinds "
+            "resending %lu\n",
+            bufferCount, drain.unconfirmed, (unsigned long)drain.batches,
+            (unsigned long)drain.bytes, (unsigned long)drain.rewinds,
+            (unsigned long)drain.resent);
+
+    const ChannelSchedule& schedule = channelSchedule;
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        fprintf(stderr, "%s %s every %lu ms: %lu reads, %lu missed, max %lu ms late\n",
+                channel == 0 ? "Channels:" : "         ", SENSOR_CHANNEL_NAMES[channel],
+                schedule.interval[channel], (unsigned long)schedule.reads[channel],
+                (unsigned long)schedule.missed[channel], schedule.maxLate[channel]);
+    }
+
+    DhtPioStats dhtReads;
+    dhtPioTakeStats(dhtReads);
+    fprintf(stderr, "DHT: %lu transfers:", (unsigned long)dhtReads.transfers);
+    for (int status = 0; status < DHT_STATUS_COUNT; status++) {
+        fprintf(stderr, " %lu %s", (unsigned long)dhtReads.results[status],
+                dhtStatusName((DhtStatus)status));
+    }
+    fprintf(stderr, "\n");
+
+    LineProtocolStats influx;
+    lineProtocolTakeStats(influx);
+    fprintf(stderr, "Influx: %lu points in %lu messages, %lu bytes, %lu failed messages\n",
+            (unsigned long)influx.lines, (unsigned long)influx.messages,
+            (unsigned long)influx.bytes, (unsigned long)influx.failures);
+
+    fprintf(stderr, "%-10s %8s %8s %8s %10s\n", "task", "runs", "overrun", "missed",
+            "max jitter");
+    for (int i = 0; i < getTaskCount(); i++) {
+        const ScheduledTask* task = getTask(i);
+        if (task == NULL || task->name == NULL)
+            continue;
+
+        fprintf(stderr, "%-10s %8lu %8lu %8lu %10lu\n", task->name, task->runCount,
+                task->overrunCount, task->missedCount, task->maxJitter);
+    }
+}
+
+//=====================================================================
+// MAIN
+//=====================================================================
+int main(int argc, char** argv) {
+    unsigned long duration = DEFAULT_DURATION_S;
+    FILE* mqttLog = NULL;
+
+    simReset();
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(option, "--quiet") == 0) {
+            simSetSerialEcho(false);
+            continue;
+        }
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        i++;
+
+        if (strcmp(option, "--duration") == 0) {
+            duration = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--script") == 0) {
+            if (!simLoadScript(value)) {
+                fprintf(stderr, "Cannot load script %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(option, "--set") == 0) {
+            char key[64];
+            const char* equals = strchr(value, '=');
+            size_t length = equals != NULL ? (size_t)(equals - value) : 0;
+            if (length == 0 || length >= sizeof(key)) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            memcpy(key, value, length);
+            key[length] = '\0';
+            if (!simSet(key, equals + 1)) {
+                fprintf(stderr, "Unknown scenario key %s\n", key);
+                return 2;
+            }
+        } else if (strcmp(option, "--mqtt-log") == 0) {
+            mqttLog = fopen(value, "w");
+            if (mqttLog == NULL) {
+                fprintf(stderr, "Cannot open %s\n", value);
+                return 1;
+            }
+            simSetMessageLog(mqttLog);
+        } else if (strcmp(option, "--flash") == 0) {
+            flashStorageSetImage(value);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    unsigned long end = duration * 1000;
+
+    setup();
+    while (millis() < end) {
+        loop();
+
+        // Sleep until something can happen, as the device would between tasks
+        unsigned long idle = nextTaskDue();
+        unsigned long event = simNextEvent();
+        if (event < idle) {
+            idle = event;
+        }
+        if (idle > end - millis()) {
+            idle = end - millis();
+        }
+        simAdvance(idle);
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - started;
+    printSummary(wall.count());
+
+    if (mqttLog != NULL) {
+        fclose(mqttLog);
+    }
+    return 0;
+}
+
+#endif // PIO_UNIT_TESTING
+#endif // ARDUINO
@@ -0,0 +1,63 @@
+/*
+ * AudioLevel.cpp
+ * Sound level accumulation implementation
+ */
+
+#include "AudioLevel.h"
+#include <math.h>
+#include <string.h>
+
+void audioWindowReset(AudioWindow& window) {
+    memset(&window, 0, sizeof(window));
+}
+
+void audioWindowAccumulate(AudioWindow& window, const int16_t* samples, size_t count) {
+    // The plain sum fits in 32 bits for blocks of up to 65535 samples
+    int32_t sum = 0;
+    uint64_t sumSquares = 0;
+    uint16_t peak = window.peak;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t sample = samples[i];
+        uint32_t magnitude = sample < 0 ? -sample : sample;
+
+        sum += sample;
+        sumSquares += magnitude * magnitude;
+        if (magnitude > peak) {
+            peak = magnitude;
+        }
+    }
+
+    window.sum += sum;
+    window.sumSquares += sumSquares;
+    window.samples += count;
+    window.blocks++;
+    window.peak = peak;
+}
+
+bool audioWindowLevels(const AudioWindow& window, AudioLevels& levels) {
+    levels.samples = window.samples;
+    if (window.samples == 0) {
+        levels.rms = 0;
+        levels.peak = 0;
+        levels.leq = AUDIO_LEQ_FLOOR;
+        return false;
+    }
+
+    // Variance about the mean removes the DC offset of the PDM stream
+    double mean = (double)window.sum / window.samples;
+    double meanSquare = (double)window.sumSquares / window.samples - mean * mean;
+    if (meanSquare < 0) {
+        meanSquare = 0;
+    }
+
+    levels.rms = sqrt(meanSquare);
+    levels.peak = window.peak;
+
+    float ratio = levels.rms / AUDIO_FULL_SCALE;
+    levels.leq = ratio > 0 ? 20.0f * log10f(ratio) : AUDIO_LEQ_FLOOR;
+    if (levels.leq < AUDIO_LEQ_FLOOR) {
+        levels.leq = AUDIO_LEQ_FLOOR;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * AudioLevel.h
+ * Sound level accumulation over PDM sample blocks
+ *
+ * Every block the microphone delivers is folded into an AudioWindow as it
+ * arrives, so the levels reported for a window cover all of the audio in
+ * it rather than the last block. The kernel has no Arduino dependencies
+ * and can be built and timed on a host.
+ *
+ * Levels are in raw sample units (full scale 32768). The RMS excludes the
+ * microphone's DC offset; Leq is the equivalent continuous level of the
+ * window in dB relative to full scale.
+ */
+
+#ifndef AUDIO_LEVEL_H
+#define AUDIO_LEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define AUDIO_FULL_SCALE 32768.0f
+#define AUDIO_LEQ_FLOOR -120.0f
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct AudioWindow {
+    uint64_t sumSquares;
+    int64_t sum;
+    uint32_t samples;
+    uint32_t blocks;
+    uint16_t peak;
+};
+
+struct AudioLevels {
+    float rms;
+    float peak;
+    float leq;
+    uint32_t samples;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+void audioWindowReset(AudioWindow& window);
+
+// Fold one block of samples into the window
+void audioWindowAccumulate(AudioWindow& window, const int16_t* samples, size_t count);
+
+// Levels over the window. Returns false if it holds no samples.
+bool audioWindowLevels(const AudioWindow& window, AudioLevels& levels);
+
+#endif // AUDIO_LEVEL_H
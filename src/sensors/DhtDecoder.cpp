@@ -0,0 +1,90 @@
+/*
+ * DhtDecoder.cpp
+ * DHT pulse train decoding implementation
+ */
+
+#include "DhtDecoder.h"
+#include <math.h>
+#include <string.h>
+
+static const char* const STATUS_NAMES[DHT_STATUS_COUNT] = {
+    "ok", "no_response", "truncated", "bad_pulse", "checksum",
+};
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static DhtStatus fail(DhtReading& reading, DhtStatus status) {
+    reading.status = status;
+    reading.temperature = NAN;
+    reading.humidity = NAN;
+    return status;
+}
+
+// Whole units in the first byte of each pair. Later DHT11 revisions put
+// tenths of a degree in the low nibble of byte 3 and the sign in bit 7.
+static void convertDht11(DhtReading& reading) {
+    const uint8_t* data = reading.data;
+    reading.humidity = data[0] + data[1] * 0.1f;
+    reading.temperature = data[2] + (data[3] & 0x0F) * 0.1f;
+    if (data[3] & 0x80) {
+        reading.temperature = -reading.temperature;
+    }
+}
+
+// Tenths in 16 bits, temperature as sign and magnitude
+static void convertDht22(DhtReading& reading) {
+    const uint8_t* data = reading.data;
+    reading.humidity = ((data[0] << 8) | data[1]) * 0.1f;
+    reading.temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    if (data[2] & 0x80) {
+        reading.temperature = -reading.temperature;
+    }
+}
+
+//=====================================================================
+// DECODING
+//=====================================================================
+DhtStatus dhtDecode(const uint32_t* pulses, size_t count, uint8_t type, DhtReading& reading) {
+    memset(reading.data, 0, sizeof(reading.data));
+
+    if (count == 0)
+        return fail(reading, DHT_NO_RESPONSE);
+    if (pulses[0] < DHT_RESPONSE_MIN_US || pulses[0] > DHT_RESPONSE_MAX_US)
+        return fail(reading, DHT_BAD_PULSE);
+
+    // Bits decoded as far as the capture goes, so a short frame still
+    // shows what arrived
+    size_t bits = count - 1;
+    if (bits > DHT_FRAME_BYTES * 8) {
+        bits = DHT_FRAME_BYTES * 8;
+    }
+    for (size_t bit = 0; bit < bits; bit++) {
+        uint32_t width = pulses[bit + 1];
+        if (width < DHT_BIT_MIN_US || width > DHT_BIT_MAX_US)
+            return fail(reading, DHT_BAD_PULSE);
+
+        reading.data[bit / 8] <<= 1;
+        if (width > DHT_BIT_ONE_US) {
+            reading.data[bit / 8] |= 1;
+        }
+    }
+    if (bits < DHT_FRAME_BYTES * 8)
+        return fail(reading, DHT_TRUNCATED);
+
+    const uint8_t* data = reading.data;
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+        return fail(reading, DHT_CHECKSUM);
+
+    if (type == DHT_TYPE_DHT11) {
+        convertDht11(reading);
+    } else {
+        convertDht22(reading);
+    }
+    reading.status = DHT_OK;
+    return DHT_OK;
+}
+
+const char* dhtStatusName(DhtStatus status) {
+    return status < DHT_STATUS_COUNT ? STATUS_NAMES[status] : "unknown";
+}
@@ -0,0 +1,68 @@
+/*
+ * DhtDecoder.h
+ * DHT11/DHT22 pulse train decoding
+ *
+ * After the start signal the sensor answers with 80 us low and 80 us
+ * high, then sends 40 bits, each a 50 us low followed by a high pulse
+ * of 26-28 us for a 0 or 70 us for a 1. A capture holds the width of
+ * every high pulse in us: the response pulse, then one per bit, most
+ * significant first. The five bytes are humidity, temperature and a
+ * checksum, the low byte of the sum of the other four.
+ *
+ * No Arduino dependencies: timing traces captured from the PIO driver
+ * (or a logic analyser) can be decoded on a host.
+ */
+
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define DHT_FRAME_BYTES 5
+#define DHT_FRAME_PULSES 41 // Response pulse plus one per bit
+
+// High pulse limits in us; the threshold sits between the 0 and 1 widths
+#define DHT_RESPONSE_MIN_US 40
+#define DHT_RESPONSE_MAX_US 120
+#define DHT_BIT_MIN_US 8
+#define DHT_BIT_ONE_US 48
+#define DHT_BIT_MAX_US 100
+
+// DHTTYPE of the DHT11, as in the DHT library; the other types send
+// tenths in 16 bits
+#define DHT_TYPE_DHT11 11
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+enum DhtStatus : uint8_t {
+    DHT_OK,
+    DHT_NO_RESPONSE, // No pulse at all: sensor missing or line stuck
+    DHT_TRUNCATED,   // Frame stopped before the last bit
+    DHT_BAD_PULSE,   // A pulse too short or long to be part of a frame
+    DHT_CHECKSUM,
+    DHT_STATUS_COUNT
+};
+
+struct DhtReading {
+    DhtStatus status;
+    uint8_t data[DHT_FRAME_BYTES]; // Raw bytes, as far as they were decoded
+    float temperature;             // °C, NaN unless status is DHT_OK
+    float humidity;                // %
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Decode count high pulse widths (us) from a sensor of the given DHTTYPE.
+// Returns reading.status.
+DhtStatus dhtDecode(const uint32_t* pulses, size_t count, uint8_t type, DhtReading& reading);
+
+// Short name of a status for logs and metrics, e.g. "checksum"
+const char* dhtStatusName(DhtStatus status);
+
+#endif // DHT_DECODER_H
@@ -0,0 +1,279 @@
+/*
+ * DhtPio.cpp
+ * PIO DHT driver implementation (RP2040 PIO and DMA, or simulated trace on the host)
+ */
+
+#include "DhtPio.h"
+
+//=====================================================================
+// STATE
+//=====================================================================
+static uint8_t sensorType = DHT_TYPE_DHT11;
+static uint32_t startUs = DHT_START_US_DHT11;
+static bool available = false;
+static bool running = false;
+static unsigned long startTime = 0;
+static DhtPioStats stats;
+
+// High pulse widths of the running transfer, in us
+static uint32_t pulses[DHT_FRAME_PULSES];
+
+static unsigned long startSignalTime() {
+    return (startUs + 999) / 1000;
+}
+
+#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+//=====================================================================
+// RP2040 PIO CAPTURE
+//=====================================================================
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/pio.h>
+#include <hardware/pio_instructions.h>
+
+// Assembled at begin, with addresses relative to the program start:
+//
+//    0  pull block           ; start signal length in us
+//    1  mov x, osr
+//    2  set pindirs, 1       ; drive the line low (the pin latch is 0)
+//    3  jmp x--, 3 [1]       ; 1 us per pass
+//    4  set pindirs, 0       ; release it to the pull-up
+//    5  wait 1 pin, 0
+//    6  wait 0 pin, 0        ; sensor answers low
+//    7  mov x, ~null         ; .wrap_target
+//    8  wait 1 pin, 0
+//    9  jmp x--, 10          ; count while high, 1 us per pass
+//   10  jmp pin, 9
+//   11  mov isr, ~x          ; passes counted
+//   12  push block           ; .wrap
+//
+// After the last bit the line idles high and the state machine counts
+// until it is stopped, once DMA has moved DHT_FRAME_PULSES widths.
+#define PROGRAM_LENGTH 13
+#define PROGRAM_WRAP_TARGET 7
+
+static uint16_t instructions[PROGRAM_LENGTH];
+static PIO pio = NULL;
+static int stateMachine = -1;
+static int dmaChannel = -1;
+static uint programOffset = 0;
+static uint gpio = 0;
+
+static void assembleProgram() {
+    instructions[0] = pio_encode_pull(false, true);
+    instructions[1] = pio_encode_mov(pio_x, pio_osr);
+    instructions[2] = pio_encode_set(pio_pindirs, 1);
+    instructions[3] = pio_encode_jmp_x_dec(3) | pio_encode_delay(1);
+    instructions[4] = pio_encode_set(pio_pindirs, 0);
+    instructions[5] = pio_encode_wait_pin(true, 0);
+    instructions[6] = pio_encode_wait_pin(false, 0);
+    instructions[7] = pio_encode_mov_not(pio_x, pio_null);
+    instructions[8] = pio_encode_wait_pin(true, 0);
+    instructions[9] = pio_encode_jmp_x_dec(10);
+    instructions[10] = pio_encode_jmp_pin(9);
+    instructions[11] = pio_encode_mov_not(pio_isr, pio_x);
+    instructions[12] = pio_encode_push(false, true);
+}
+
+// Either PIO block may already hold other programs (the PDM microphone
+// driver uses one); take the first with room and a free state machine
+static bool claimStateMachine(const pio_program_t& program) {
+    PIO blocks[] = {pio0, pio1};
+    for (PIO block : blocks) {
+        if (!pio_can_add_program(block, &program))
+            continue;
+
+        int sm = pio_claim_unused_sm(block, false);
+        if (sm < 0)
+            continue;
+
+        pio = block;
+        stateMachine = sm;
+        programOffset = pio_add_program(block, &program);
+        return true;
+    }
+    return false;
+}
+
+static bool captureBegin(uint8_t pin) {
+#if defined(ARDUINO_ARCH_MBED)
+    gpio = digitalPinToPinName(pin); // mbed numbers pins as on the board
+#else
+    gpio = pin;
+#endif
+
+    assembleProgram();
+    pio_program_t program = {};
+    program.instructions = instructions;
+    program.length = PROGRAM_LENGTH;
+    program.origin = -1;
+    if (!claimStateMachine(program))
+        return false;
+
+    dmaChannel = dma_claim_unused_channel(false);
+    if (dmaChannel < 0) {
+        pio_remove_program(pio, &program, programOffset);
+        pio_sm_unclaim(pio, stateMachine);
+        return false;
+    }
+
+    // Open drain: the latch stays 0 and only the direction changes
+    pio_gpio_init(pio, gpio);
+    gpio_pull_up(gpio);
+    pio_sm_set_pins_with_mask(pio, stateMachine, 0, 1u << gpio);
+    pio_sm_set_pindirs_with_mask(pio, stateMachine, 0, 1u << gpio);
+
+    pio_sm_config smConfig = pio_get_default_sm_config();
+    sm_config_set_wrap(&smConfig, programOffset + PROGRAM_WRAP_TARGET,
+                       programOffset + PROGRAM_LENGTH - 1);
+    sm_config_set_set_pins(&smConfig, gpio, 1);
+    sm_config_set_in_pins(&smConfig, gpio);
+    sm_config_set_jmp_pin(&smConfig, gpio);
+    sm_config_set_in_shift(&smConfig, false, false, 32);
+    sm_config_set_out_shift(&smConfig, false, false, 32);
+    sm_config_set_clkdiv(&smConfig, (float)clock_get_hz(clk_sys) / DHT_PIO_CLOCK_HZ);
+    pio_sm_init(pio, stateMachine, programOffset, &smConfig);
+
+    dma_channel_config dmaConfig = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&dmaConfig, DMA_SIZE_32);
+    channel_config_set_read_increment(&dmaConfig, false);
+    channel_config_set_write_increment(&dmaConfig, true);
+    channel_config_set_dreq(&dmaConfig, pio_get_dreq(pio, stateMachine, false));
+    dma_channel_configure(dmaChannel, &dmaConfig, pulses, &pio->rxf[stateMachine],
+                          DHT_FRAME_PULSES, false);
+    return true;
+}
+
+static void captureStart() {
+    pio_sm_set_enabled(pio, stateMachine, false);
+    pio_sm_clear_fifos(pio, stateMachine);
+    pio_sm_restart(pio, stateMachine);
+    pio_sm_exec(pio, stateMachine, pio_encode_jmp(programOffset));
+
+    dma_channel_transfer_to_buffer_now(dmaChannel, pulses, DHT_FRAME_PULSES);
+    pio_sm_put(pio, stateMachine, startUs);
+    pio_sm_set_enabled(pio, stateMachine, true);
+}
+
+static bool captureDone() {
+    return !dma_channel_is_busy(dmaChannel);
+}
+
+// Widths captured before the transfer completed or was stopped
+static size_t captureStop() {
+    size_t count = DHT_FRAME_PULSES - dma_hw->ch[dmaChannel].transfer_count;
+    dma_channel_abort(dmaChannel);
+
+    // Leave the line to the pull-up, wherever the program stopped
+    pio_sm_set_enabled(pio, stateMachine, false);
+    pio_sm_exec(pio, stateMachine, pio_encode_set(pio_pindirs, 0));
+    return count;
+}
+
+#elif !defined(ARDUINO)
+//=====================================================================
+// HOST CAPTURE
+//=====================================================================
+#include "Simulation.h"
+
+static size_t captured = 0;
+static uint64_t frameEnd = 0; // us
+
+static bool captureBegin(uint8_t pin) {
+    (void)pin;
+    return true;
+}
+
+// The whole pulse train is known up front; it becomes visible once the
+// virtual clock has run past the frame
+static void captureStart() {
+    unsigned long frameUs = 0;
+    captured = simDhtCapture(sensorType, pulses, DHT_FRAME_PULSES, frameUs);
+    frameEnd = simMicros() + startUs + frameUs;
+}
+
+static bool captureDone() {
+    return captured == DHT_FRAME_PULSES && simMicros() >= frameEnd;
+}
+
+static size_t captureStop() {
+    return simMicros() >= frameEnd ? captured : 0;
+}
+
+#else
+//=====================================================================
+// NO PIO
+//=====================================================================
+static bool captureBegin(uint8_t pin) {
+    (void)pin;
+    return false;
+}
+
+static void captureStart() {}
+
+static bool captureDone() {
+    return false;
+}
+
+static size_t captureStop() {
+    return 0;
+}
+#endif
+
+//=====================================================================
+// TRANSFERS
+//=====================================================================
+bool dhtPioBegin(uint8_t pin, uint8_t type) {
+    sensorType = type;
+    startUs = type == DHT_TYPE_DHT11 ? DHT_START_US_DHT11 : DHT_START_US_DHT22;
+    available = captureBegin(pin);
+    stats.active = available;
+    return available;
+}
+
+bool dhtPioStart() {
+    if (!available || running)
+        return false;
+
+    captureStart();
+    running = true;
+    startTime = millis();
+    stats.transfers++;
+    return true;
+}
+
+bool dhtPioTake(DhtReading& reading) {
+    if (!running)
+        return false;
+
+    bool timedOut = millis() - startTime >= startSignalTime() + DHT_FRAME_TIMEOUT;
+    if (!timedOut && !captureDone())
+        return false;
+
+    size_t count = captureStop();
+    running = false;
+
+    dhtDecode(pulses, count, sensorType, reading);
+    stats.results[reading.status]++;
+    return true;
+}
+
+unsigned long dhtPioUntilReady() {
+    if (!running)
+        return (unsigned long)-1;
+
+    unsigned long elapsed = millis() - startTime;
+    unsigned long ready = startSignalTime() + DHT_FRAME_TIME;
+    if (elapsed < ready)
+        return ready - elapsed;
+    if (elapsed >= startSignalTime() + DHT_FRAME_TIMEOUT || captureDone())
+        return 0;
+
+    // Late sensor: poll until the timeout
+    return 1;
+}
+
+void dhtPioTakeStats(DhtPioStats& out) {
+    out = stats;
+}
@@ -0,0 +1,62 @@
+/*
+ * DhtPio.h
+ * Non-blocking DHT reads on an RP2040 PIO state machine
+ *
+ * The DHT library bit-bangs a read with busy-wait loops and interrupts
+ * disturbed for the whole frame. Here a state machine drives the start
+ * signal, times every high pulse the sensor sends back and pushes the
+ * widths into its RX FIFO, which DMA empties into RAM. The CPU only
+ * starts the transfer and, about 25 ms later, decodes the capture with
+ * dhtDecode().
+ *
+ * On the host the simulation supplies the pulse train a sensor would
+ * send, so the same decoding runs on every simulated read.
+ */
+
+#ifndef DHT_PIO_H
+#define DHT_PIO_H
+
+#include "DhtDecoder.h"
+#include <Arduino.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define DHT_PIO_CLOCK_HZ 2000000  // Two cycles per count: widths in us
+#define DHT_START_US_DHT11 20000  // Start signal; the DHT11 needs at least 18 ms
+#define DHT_START_US_DHT22 1100
+#define DHT_FRAME_TIME 5          // ms from the end of the start signal to the last bit
+#define DHT_FRAME_TIMEOUT 10      // ms after the start signal before a capture is given up
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Counters run from boot so dashboards can difference them
+struct DhtPioStats {
+    bool active; // False when the DHT library reads the sensor instead
+    uint32_t transfers;
+    uint32_t results[DHT_STATUS_COUNT]; // By DhtStatus
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Claim a state machine and a DMA channel for the sensor of DHTTYPE type
+// on Arduino pin. Returns false if none is free, leaving the pin to the
+// DHT library.
+bool dhtPioBegin(uint8_t pin, uint8_t type);
+
+// Start a transfer. Returns false if one is still running.
+bool dhtPioStart();
+
+// The result once the transfer has finished or timed out. Returns false
+// while it is running or none was started.
+bool dhtPioTake(DhtReading& reading);
+
+// ms until the running transfer should have finished, 0 if its result
+// can be taken now, (unsigned long)-1 if none is running
+unsigned long dhtPioUntilReady();
+
+void dhtPioTakeStats(DhtPioStats& stats);
+
+#endif // DHT_PIO_H
@@ -0,0 +1,11 @@
+/*
+ * GasCurves.cpp
+ * Gas lookup tables, generated by the compiler into flash
+ */
+
+#include "GasCurves.h"
+
+constexpr GasTable gasRatioTable;
+constexpr GasTable gasCoTable(GAS_CO_CURVE_A, GAS_CO_CURVE_B);
+constexpr GasTable gasCh4Table(GAS_CH4_CURVE_A, GAS_CH4_CURVE_B);
+constexpr GasTable gasLpgTable(GAS_LPG_CURVE_A, GAS_LPG_CURVE_B);
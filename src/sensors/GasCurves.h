@@ -0,0 +1,150 @@
+/*
+ * GasCurves.h
+ * Gas sensor ADC reading to Rs/R0 and ppm, by table lookup
+ *
+ * The ADC only has GAS_ADC_LEVELS codes, so every step of the chain
+ * (code -> voltage -> Rs/R0 -> ppm = (a / ratio)^b) is evaluated for each
+ * code at compile time and the result is one array read at run time,
+ * with no soft-float pow() on the Cortex-M0+. Each table holds every
+ * code, so there is no interpolation error: entries match a double
+ * precision evaluation of the curve to float rounding (relative error
+ * below 1e-7). Four tables of 4 KB live in flash.
+ *
+ * No Arduino dependencies; the tables can be checked against pow() on
+ * a host.
+ */
+
+#ifndef GAS_CURVES_H
+#define GAS_CURVES_H
+
+#include "Constants.h"
+#include <limits>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+// ppm = (a / (Rs/R0))^b, fitted to the sensor's sensitivity curves
+#define GAS_CO_CURVE_A 4.07
+#define GAS_CO_CURVE_B 4.0
+#define GAS_CH4_CURVE_A 7.08
+#define GAS_CH4_CURVE_B 4.17
+#define GAS_LPG_CURVE_A 10.96
+#define GAS_LPG_CURVE_B 2.78
+
+//=====================================================================
+// COMPILE-TIME MATH
+//=====================================================================
+namespace gas_curves {
+
+constexpr double LN2 = 0.69314718055994530942;
+
+// Natural log for x > 0: scale into [1, 2), then 2 atanh((m - 1) / (m + 1))
+constexpr double naturalLog(double x) {
+    int exponent = 0;
+    while (x >= 2.0) {
+        x /= 2.0;
+        exponent++;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        exponent--;
+    }
+
+    double z = (x - 1.0) / (x + 1.0);
+    double term = z;
+    double sum = 0.0;
+    for (int k = 1; k < 64; k += 2) {
+        sum += term / k;
+        term *= z * z;
+    }
+    return 2.0 * sum + exponent * LN2;
+}
+
+// e^x: x = n ln 2 + r with |r| <= ln 2 / 2, Taylor series for e^r
+constexpr double exponential(double x) {
+    int n = (int)(x / LN2 + (x < 0 ? -0.5 : 0.5));
+    double r = x - n * LN2;
+
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k < 24; k++) {
+        term *= r / k;
+        sum += term;
+    }
+
+    for (; n > 0; n--) {
+        sum *= 2.0;
+    }
+    for (; n < 0; n++) {
+        sum /= 2.0;
+    }
+    return sum;
+}
+
+constexpr double power(double base, double exponent) {
+    return exponential(exponent * naturalLog(base));
+}
+
+// Rs/R0 for an ADC code: the sensor divides the 5 V supply with its load
+// resistor, so Rs/RL = (5 - V) / V = (levels - code) / code
+constexpr double ratio(int code) {
+    return (double)(GAS_ADC_LEVELS - code) / code / GAS_R0;
+}
+
+} // namespace gas_curves
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// One value per ADC code. A code of 0 reads as an open circuit: infinite
+// Rs/R0 and no gas.
+struct GasTable {
+    float values[GAS_ADC_LEVELS];
+
+    // Rs/R0 table
+    constexpr GasTable() : values() {
+        values[0] = std::numeric_limits<float>::infinity();
+        for (int code = 1; code < GAS_ADC_LEVELS; code++) {
+            values[code] = (float)gas_curves::ratio(code);
+        }
+    }
+
+    // ppm table for the curve (a / ratio)^b
+    constexpr GasTable(double a, double b) : values() {
+        values[0] = 0.0f;
+        for (int code = 1; code < GAS_ADC_LEVELS; code++) {
+            values[code] = (float)gas_curves::power(a / gas_curves::ratio(code), b);
+        }
+    }
+};
+
+extern const GasTable gasRatioTable;
+extern const GasTable gasCoTable;
+extern const GasTable gasCh4Table;
+extern const GasTable gasLpgTable;
+
+//=====================================================================
+// LOOKUPS
+//=====================================================================
+inline float gasTableLookup(const GasTable& table, uint16_t code) {
+    return table.values[code < GAS_ADC_LEVELS ? code : GAS_ADC_LEVELS - 1];
+}
+
+inline float gasRatioFromAdc(uint16_t code) {
+    return gasTableLookup(gasRatioTable, code);
+}
+
+inline float coPpmFromAdc(uint16_t code) {
+    return gasTableLookup(gasCoTable, code);
+}
+
+inline float ch4PpmFromAdc(uint16_t code) {
+    return gasTableLookup(gasCh4Table, code);
+}
+
+inline float lpgPpmFromAdc(uint16_t code) {
+    return gasTableLookup(gasLpgTable, code);
+}
+
+#endif // GAS_CURVES_H
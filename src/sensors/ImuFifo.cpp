@@ -0,0 +1,108 @@
+/*
+ * ImuFifo.cpp
+ * LSM6DSOX FIFO parsing implementation
+ */
+
+#include "ImuFifo.h"
+#include <math.h>
+#include <string.h>
+
+//=====================================================================
+// VIBRATION STATISTICS
+//=====================================================================
+float vibrationMagnitude(float ax, float ay, float az) {
+    // Deviation from 1 g, so gravity is taken out at any orientation and
+    // there is no step where a fixed band around 1 g would end
+    return fabsf(sqrtf(ax * ax + ay * ay + az * az) - 1.0f);
+}
+
+void imuWindowReset(ImuWindow& window) {
+    memset(&window, 0, sizeof(window));
+}
+
+void imuWindowAdd(ImuWindow& window, const ImuSample& sample) {
+    window.sum[0] += sample.ax;
+    window.sum[1] += sample.ay;
+    window.sum[2] += sample.az;
+    window.sum[3] += sample.gx;
+    window.sum[4] += sample.gy;
+    window.sum[5] += sample.gz;
+
+    float vibration = vibrationMagnitude(sample.ax, sample.ay, sample.az);
+    window.sumVibrationSquares += vibration * vibration;
+    if (window.samples == 0 || vibration > window.peakVibration) {
+        window.peakVibration = vibration;
+    }
+
+    window.samples++;
+}
+
+bool imuWindowMean(const ImuWindow& window, ImuSample& mean) {
+    if (window.samples == 0)
+        return false;
+
+    mean.ax = window.sum[0] / window.samples;
+    mean.ay = window.sum[1] / window.samples;
+    mean.az = window.sum[2] / window.samples;
+    mean.gx = window.sum[3] / window.samples;
+    mean.gy = window.sum[4] / window.samples;
+    mean.gz = window.sum[5] / window.samples;
+    return true;
+}
+
+float imuWindowVibrationRms(const ImuWindow& window) {
+    if (window.samples == 0)
+        return 0;
+
+    return sqrtf(window.sumVibrationSquares / window.samples);
+}
+
+//=====================================================================
+// FIFO PARSER
+//=====================================================================
+void imuFifoParserBegin(ImuFifoParser& parser, float accelScale, float gyroScale) {
+    memset(&parser, 0, sizeof(parser));
+    parser.accelScale = accelScale;
+    parser.gyroScale = gyroScale;
+}
+
+size_t imuFifoParse(ImuFifoParser& parser, const uint8_t* data, size_t length,
+                    ImuWindow& window) {
+    size_t samples = 0;
+
+    for (; length >= IMU_FIFO_WORD_SIZE; data += IMU_FIFO_WORD_SIZE, length -= IMU_FIFO_WORD_SIZE) {
+        uint8_t tag = data[0] >> 3;
+        int16_t raw[3];
+        for (int axis = 0; axis < 3; axis++) {
+            raw[axis] = (int16_t)(data[1 + axis * 2] | (data[2 + axis * 2] << 8));
+        }
+
+        if (tag == IMU_FIFO_TAG_GYRO) {
+            for (int axis = 0; axis < 3; axis++) {
+                parser.gyro[axis] = raw[axis] * parser.gyroScale;
+            }
+            parser.gyroWords++;
+        } else if (tag == IMU_FIFO_TAG_ACCEL) {
+            ImuSample sample;
+            sample.ax = raw[0] * parser.accelScale;
+            sample.ay = raw[1] * parser.accelScale;
+            sample.az = raw[2] * parser.accelScale;
+            sample.gx = parser.gyro[0];
+            sample.gy = parser.gyro[1];
+            sample.gz = parser.gyro[2];
+            imuWindowAdd(window, sample);
+            if (parser.spectrum != NULL) {
+                vibrationSpectrumAdd(*parser.spectrum, sqrt(sample.ax * sample.ax +
+                                                            sample.ay * sample.ay +
+                                                            sample.az * sample.az));
+            }
+            parser.accelWords++;
+            samples++;
+        } else {
+            // Temperature, timestamp and configuration-change words
+            parser.otherWords++;
+        }
+    }
+
+    return samples;
+}
@@ -0,0 +1,80 @@
+/*
+ * ImuFifo.h
+ * LSM6DSOX FIFO stream parsing and vibration statistics
+ *
+ * The FIFO is read as 7-byte words: a tag byte (sensor in bits 7-3)
+ * followed by X, Y and Z as little-endian int16. Accelerometer and gyro
+ * words are batched at the same rate; each accelerometer word becomes one
+ * sample, paired with the most recent gyro word. Every sample is folded
+ * into an ImuWindow, so spike detection sees the whole interval, and its
+ * magnitude into the vibration spectrum when one is attached.
+ *
+ * No Arduino dependencies: recorded FIFO dumps can be parsed on a host.
+ */
+
+#ifndef IMU_FIFO_H
+#define IMU_FIFO_H
+
+#include "VibrationSpectrum.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define IMU_FIFO_WORD_SIZE 7
+#define IMU_FIFO_TAG_GYRO 0x01
+#define IMU_FIFO_TAG_ACCEL 0x02
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Acceleration in g, angular rate in dps
+struct ImuSample {
+    float ax, ay, az;
+    float gx, gy, gz;
+};
+
+// Float sums, as the Cortex-M0+ emulates double at several times the
+// cost. A minute at 417 Hz is 25k samples, whose rounding stays below
+// the accelerometer's noise.
+struct ImuWindow {
+    uint32_t samples;
+    float sum[6];
+    float sumVibrationSquares;
+    float peakVibration;
+};
+
+struct ImuFifoParser {
+    float accelScale;
+    float gyroScale;
+    float gyro[3];
+    uint32_t accelWords;
+    uint32_t gyroWords;
+    uint32_t otherWords;
+    VibrationSpectrum* spectrum; // Optional, set after imuFifoParserBegin()
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Acceleration magnitude's deviation from 1 g, i.e. with gravity taken out
+float vibrationMagnitude(float ax, float ay, float az);
+
+void imuWindowReset(ImuWindow& window);
+void imuWindowAdd(ImuWindow& window, const ImuSample& sample);
+
+// Mean sample over the window. Returns false if the window is empty.
+bool imuWindowMean(const ImuWindow& window, ImuSample& mean);
+
+// RMS of the vibration magnitude over the window
+float imuWindowVibrationRms(const ImuWindow& window);
+
+// Scales convert raw counts to g and dps for the configured full scales
+void imuFifoParserBegin(ImuFifoParser& parser, float accelScale, float gyroScale);
+
+// Parse whole FIFO words into the window. Returns the samples added.
+size_t imuFifoParse(ImuFifoParser& parser, const uint8_t* data, size_t length,
+                    ImuWindow& window);
+
+#endif // IMU_FIFO_H
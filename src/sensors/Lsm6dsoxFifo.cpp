@@ -0,0 +1,128 @@
+/*
+ * Lsm6dsoxFifo.cpp
+ * LSM6DSOX hardware FIFO driver implementation
+ */
+
+#include "Lsm6dsoxFifo.h"
+#include <Wire.h>
+
+//=====================================================================
+// REGISTERS
+//=====================================================================
+#define LSM6DSOX_FIFO_CTRL3 0x09
+#define LSM6DSOX_FIFO_CTRL4 0x0A
+#define LSM6DSOX_CTRL1_XL 0x10
+#define LSM6DSOX_CTRL2_G 0x11
+#define LSM6DSOX_FIFO_STATUS1 0x3A
+#define LSM6DSOX_FIFO_STATUS2 0x3B
+#define LSM6DSOX_FIFO_DATA_OUT_TAG 0x78
+#define LSM6DSOX_TAP_CFG0 0x56
+#define LSM6DSOX_TAP_CFG2 0x58
+#define LSM6DSOX_WAKE_UP_THS 0x5B
+#define LSM6DSOX_WAKE_UP_DUR 0x5C
+#define LSM6DSOX_MD1_CFG 0x5E
+
+#define LSM6DSOX_ODR_417HZ 0x6
+#define LSM6DSOX_FS_XL_4G 0x2
+#define LSM6DSOX_FS_G_2000DPS 0x3
+#define LSM6DSOX_FIFO_MODE_BYPASS 0x0
+#define LSM6DSOX_FIFO_MODE_CONTINUOUS 0x6
+#define LSM6DSOX_FIFO_OVR_LATCHED 0x08
+#define LSM6DSOX_SLOPE_FDS 0x10         // TAP_CFG0: wake-up on the high-pass output
+#define LSM6DSOX_INTERRUPTS_ENABLE 0x80 // TAP_CFG2: enable the embedded functions
+#define LSM6DSOX_INT1_WU 0x20           // MD1_CFG: wake-up event on INT1
+
+static uint32_t overruns = 0;
+
+//=====================================================================
+// BUS ACCESS
+//=====================================================================
+static bool writeRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(IMU_I2C_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+}
+
+static bool readRegisters(uint8_t reg, uint8_t* data, size_t length) {
+    Wire.beginTransmission(IMU_I2C_ADDRESS);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0)
+        return false;
+
+    if (Wire.requestFrom((uint8_t)IMU_I2C_ADDRESS, length) != length)
+        return false;
+
+    for (size_t i = 0; i < length; i++) {
+        data[i] = Wire.read();
+    }
+    return true;
+}
+
+//=====================================================================
+// FIFO CONTROL
+//=====================================================================
+bool lsm6dsoxFifoBegin() {
+    // Bypass first, which also empties the FIFO
+    if (!writeRegister(LSM6DSOX_FIFO_CTRL4, LSM6DSOX_FIFO_MODE_BYPASS))
+        return false;
+
+    writeRegister(LSM6DSOX_CTRL1_XL, (LSM6DSOX_ODR_417HZ << 4) | (LSM6DSOX_FS_XL_4G << 2));
+    writeRegister(LSM6DSOX_CTRL2_G, (LSM6DSOX_ODR_417HZ << 4) | (LSM6DSOX_FS_G_2000DPS << 2));
+
+    // Batch both sensors at their output data rate, keeping the newest
+    // samples if a drain is late
+    writeRegister(LSM6DSOX_FIFO_CTRL3, (LSM6DSOX_ODR_417HZ << 4) | LSM6DSOX_ODR_417HZ);
+    return writeRegister(LSM6DSOX_FIFO_CTRL4, LSM6DSOX_FIFO_MODE_CONTINUOUS);
+}
+
+void lsm6dsoxFifoEnd() {
+    writeRegister(LSM6DSOX_FIFO_CTRL4, LSM6DSOX_FIFO_MODE_BYPASS);
+    writeRegister(LSM6DSOX_FIFO_CTRL3, 0);
+}
+
+size_t lsm6dsoxFifoDrain(ImuFifoParser& parser, ImuWindow& window) {
+    uint8_t status[2];
+    if (!readRegisters(LSM6DSOX_FIFO_STATUS1, status, sizeof(status)))
+        return 0;
+
+    if (status[1] & LSM6DSOX_FIFO_OVR_LATCHED) {
+        overruns++;
+    }
+
+    uint16_t words = status[0] | ((status[1] & 0x03) << 8);
+    size_t samples = 0;
+
+    // The output address wraps from the last data register back to the
+    // tag, so several words can be read in one transfer
+    uint8_t burst[IMU_FIFO_BURST_WORDS * IMU_FIFO_WORD_SIZE];
+    while (words > 0) {
+        uint16_t count = words < IMU_FIFO_BURST_WORDS ? words : IMU_FIFO_BURST_WORDS;
+        if (!readRegisters(LSM6DSOX_FIFO_DATA_OUT_TAG, burst, count * IMU_FIFO_WORD_SIZE))
+            break;
+
+        samples += imuFifoParse(parser, burst, count * IMU_FIFO_WORD_SIZE, window);
+        words -= count;
+    }
+
+    return samples;
+}
+
+uint32_t lsm6dsoxFifoOverruns() {
+    return overruns;
+}
+
+//=====================================================================
+// WAKE-UP INTERRUPT
+//=====================================================================
+bool lsm6dsoxWakeBegin() {
+    // Pulsed (not latched), so there is nothing to clear from the ISR
+    if (!writeRegister(LSM6DSOX_TAP_CFG0, LSM6DSOX_SLOPE_FDS))
+        return false;
+
+    // One sample over the threshold is enough; threshold weight FS / 64
+    writeRegister(LSM6DSOX_WAKE_UP_DUR, 0);
+    writeRegister(LSM6DSOX_WAKE_UP_THS, IMU_WAKE_THRESHOLD & 0x3F);
+    writeRegister(LSM6DSOX_MD1_CFG, LSM6DSOX_INT1_WU);
+    return writeRegister(LSM6DSOX_TAP_CFG2, LSM6DSOX_INTERRUPTS_ENABLE);
+}
@@ -0,0 +1,56 @@
+/*
+ * Lsm6dsoxFifo.h
+ * LSM6DSOX hardware FIFO driver
+ *
+ * Batches accelerometer and gyro samples in the IMU's FIFO at
+ * IMU_FIFO_ODR_HZ and drains them in bursts, so the bus is only touched
+ * every IMU_FIFO_DRAIN_INTERVAL instead of once per sample.
+ *
+ * Also routes the IMU's wake-up (motion) event to INT1, which power save
+ * uses to end a sleep as soon as the board starts vibrating.
+ */
+
+#ifndef LSM6DSOX_FIFO_H
+#define LSM6DSOX_FIFO_H
+
+#include "Constants.h"
+#include "ImuFifo.h"
+#include <Arduino.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define IMU_I2C_ADDRESS 0x6A
+#define IMU_FIFO_ODR_HZ 417
+#define IMU_FIFO_BURST_WORDS 32
+
+// Sensitivities for the full scales set by lsm6dsoxFifoBegin()
+#define IMU_FIFO_ACCEL_SCALE 0.000122f // g per LSB at +-4 g
+#define IMU_FIFO_GYRO_SCALE 0.070f     // dps per LSB at 2000 dps
+
+// Wake-up threshold on the high-pass filtered acceleration, in units of
+// full scale / 64: 125 mg at +-4 g, well above the idle noise
+#define IMU_WAKE_THRESHOLD 2
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Configure both sensors and the FIFO in continuous mode. Returns false if
+// the IMU does not respond.
+bool lsm6dsoxFifoBegin();
+
+// Put the FIFO back in bypass mode
+void lsm6dsoxFifoEnd();
+
+// Read everything queued in the FIFO into the window. Returns the samples added.
+size_t lsm6dsoxFifoDrain(ImuFifoParser& parser, ImuWindow& window);
+
+// Times the FIFO filled up and lost samples between drains
+uint32_t lsm6dsoxFifoOverruns();
+
+// Raise INT1 while the acceleration changes by more than
+// IMU_WAKE_THRESHOLD. Independent of the FIFO mode. Returns false if the
+// IMU does not respond.
+bool lsm6dsoxWakeBegin();
+
+#endif // LSM6DSOX_FIFO_H
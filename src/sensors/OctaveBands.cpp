@@ -0,0 +1,195 @@
+/*
+ * OctaveBands.cpp
+ * Multirate octave filter bank implementation
+ */
+
+#include "OctaveBands.h"
+#include "AudioLevel.h"
+#include <complex>
+#include <math.h>
+#include <string.h>
+
+typedef std::complex<double> Complex;
+
+struct BiquadCoefficients {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+};
+
+// Coefficients are Q30; samples enter the bank scaled up by 2^8 so the
+// integer filter outputs keep resolution well below one input count
+#define COEFFICIENT_SHIFT 30
+#define INPUT_SHIFT 8
+#define ENERGY_SHIFT 4 // Squares of 24-bit values would overflow in a long window
+
+// Cut-off of the decimating lowpass as a fraction of the stage rate: the
+// band below ends at 0.177, and what would alias into it is >55 dB down
+static const double LOWPASS_CUTOFF = 0.2;
+
+// Built once, shared by every stage
+static BiquadCoefficients bandpassCoefficients[OCTAVE_BANDPASS_SECTIONS];
+static BiquadCoefficients lowpassCoefficients[OCTAVE_LOWPASS_SECTIONS];
+static bool tablesReady = false;
+
+//=====================================================================
+// FILTER DESIGN
+//=====================================================================
+static int32_t toQ30(double value) {
+    return (int32_t)lround(value * (1 << COEFFICIENT_SHIFT));
+}
+
+// Section with a conjugate pole pair and the given numerator
+static BiquadCoefficients makeSection(Complex pole, double b0, double b1, double b2) {
+    BiquadCoefficients section;
+    section.b0 = toQ30(b0);
+    section.b1 = toQ30(b1);
+    section.b2 = toQ30(b2);
+    section.a1 = toQ30(-2.0 * pole.real());
+    section.a2 = toQ30(std::norm(pole));
+    return section;
+}
+
+// Bilinear transform of an analog pole, sample period 1
+static Complex bilinear(Complex pole) {
+    return (2.0 + pole) / (2.0 - pole);
+}
+
+// Butterworth lowpass at LOWPASS_CUTOFF, unity gain at DC
+static void designLowpass() {
+    const int order = OCTAVE_LOWPASS_SECTIONS * 2;
+    double warped = 2.0 * tan(M_PI * LOWPASS_CUTOFF);
+
+    for (int k = 0; k < OCTAVE_LOWPASS_SECTIONS; k++) {
+        Complex analog = std::polar(warped, M_PI * (2 * k + order + 1) / (2 * order));
+        Complex pole = bilinear(analog);
+        double gain = (1.0 - 2.0 * pole.real() + std::norm(pole)) / 4.0;
+        lowpassCoefficients[k] = makeSection(pole, gain, 2.0 * gain, gain);
+    }
+}
+
+// Butterworth bandpass from fs/(4 sqrt 2) to fs sqrt(2)/4, by the
+// lowpass-to-bandpass transform of a 2nd-order prototype whose cut-off
+// equals the bandwidth
+static void designBandpass() {
+    double low = 2.0 * M_PI * 0.25 / sqrt(2.0);
+    double high = 2.0 * M_PI * 0.25 * sqrt(2.0);
+    double alpha = cos((high + low) / 2) / cos((high - low) / 2);
+
+    Complex prototype = bilinear(std::polar(2.0 * tan((high - low) / 2), 0.75 * M_PI));
+
+    // Each prototype pole Z maps to the roots u = 1/z of
+    // u^2 - alpha (1 + 1/Z) u + 1/Z = 0
+    Complex inverse = 1.0 / prototype;
+    Complex b = -alpha * (1.0 + inverse);
+    Complex root = std::sqrt(b * b - 4.0 * inverse);
+    Complex poles[OCTAVE_BANDPASS_SECTIONS] = {2.0 / (-b + root), 2.0 / (-b - root)};
+
+    // Zeros at DC and Nyquist; normalise to unity gain at the centre
+    double centre = acos(alpha);
+    Complex z1 = std::polar(1.0, -centre);
+    Complex response = 1.0;
+    for (int k = 0; k < OCTAVE_BANDPASS_SECTIONS; k++) {
+        Complex denominator = 1.0 - 2.0 * poles[k].real() * z1 + std::norm(poles[k]) * z1 * z1;
+        response *= (1.0 - z1 * z1) / denominator;
+    }
+    double gain = pow(1.0 / std::abs(response), 1.0 / OCTAVE_BANDPASS_SECTIONS);
+
+    for (int k = 0; k < OCTAVE_BANDPASS_SECTIONS; k++) {
+        bandpassCoefficients[k] = makeSection(poles[k], gain, 0.0, -gain);
+    }
+}
+
+static void buildTables() {
+    if (tablesReady)
+        return;
+
+    designBandpass();
+    designLowpass();
+    tablesReady = true;
+}
+
+//=====================================================================
+// FILTERING
+//=====================================================================
+static inline int32_t runBiquad(const BiquadCoefficients& c, BiquadState& state, int32_t x) {
+    int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * state.x1 + (int64_t)c.b2 * state.x2 -
+                  (int64_t)c.a1 * state.y1 - (int64_t)c.a2 * state.y2;
+    int32_t y = (int32_t)((acc + (1 << (COEFFICIENT_SHIFT - 1))) >> COEFFICIENT_SHIFT);
+
+    state.x2 = state.x1;
+    state.x1 = x;
+    state.y2 = state.y1;
+    state.y1 = y;
+    return y;
+}
+
+// One input sample through the top stage, and on down the cascade for
+// as long as the decimators pass it
+static void processSample(OctaveFilterBank& bank, int32_t x) {
+    for (int i = 0; i < OCTAVE_BANDS; i++) {
+        OctaveStage& stage = bank.stages[i];
+
+        int32_t y = x;
+        for (int k = 0; k < OCTAVE_BANDPASS_SECTIONS; k++) {
+            y = runBiquad(bandpassCoefficients[k], stage.bandpass[k], y);
+        }
+        int32_t scaled = y >> ENERGY_SHIFT;
+        stage.sumSquares += (uint64_t)((int64_t)scaled * scaled);
+        stage.samples++;
+
+        if (i == OCTAVE_BANDS - 1)
+            return;
+
+        for (int k = 0; k < OCTAVE_LOWPASS_SECTIONS; k++) {
+            x = runBiquad(lowpassCoefficients[k], stage.lowpass[k], x);
+        }
+
+        stage.odd = !stage.odd;
+        if (!stage.odd)
+            return;
+    }
+}
+
+//=====================================================================
+// BANK
+//=====================================================================
+float octaveBandCentre(float sampleRate, int band) {
+    return sampleRate / 4 / (1 << (OCTAVE_BANDS - 1 - band));
+}
+
+void octaveBankBegin(OctaveFilterBank& bank, float sampleRate) {
+    buildTables();
+    memset(&bank, 0, sizeof(bank));
+    bank.sampleRate = sampleRate;
+}
+
+void octaveBankProcess(OctaveFilterBank& bank, const int16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        processSample(bank, (int32_t)samples[i] << INPUT_SHIFT);
+    }
+    bank.samples += count;
+}
+
+bool octaveBankTake(OctaveFilterBank& bank, OctaveLevels& levels) {
+    levels.sampleRate = bank.sampleRate;
+    levels.samples = bank.samples;
+    if (bank.samples == 0)
+        return false;
+
+    // Undo the input and energy scaling to get back to sample units
+    const double scale = (double)(1 << (INPUT_SHIFT - ENERGY_SHIFT)) * AUDIO_FULL_SCALE;
+
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        OctaveStage& stage = bank.stages[OCTAVE_BANDS - 1 - band];
+
+        double rms = stage.samples > 0 ? sqrt((double)stage.sumSquares / stage.samples) : 0;
+        float level = rms > 0 ? 20.0 * log10(rms / scale) : AUDIO_LEQ_FLOOR;
+        levels.level[band] = level > AUDIO_LEQ_FLOOR ? level : AUDIO_LEQ_FLOOR;
+
+        stage.sumSquares = 0;
+        stage.samples = 0;
+    }
+
+    bank.samples = 0;
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * OctaveBands.h
+ * Fixed-point 1/1-octave band levels for the PDM microphone
+ *
+ * The bank is a multirate cascade: every stage runs the same 4th-order
+ * Butterworth bandpass, centred on a quarter of its own sample rate,
+ * then low-passes and decimates by two for the next stage. At 16 kHz
+ * the bands are centred on 4 kHz down to 62.5 Hz, and the whole bank
+ * costs about twice its top stage per input sample however many octaves
+ * it covers. Only one set of coefficients is needed for every band.
+ *
+ * Filters are integer biquads (Q30 coefficients, 64-bit accumulation)
+ * since the RP2040 has no FPU. No Arduino dependencies; it can be fed
+ * synthetic tones and timed on a host.
+ */
+
+#ifndef OCTAVE_BANDS_H
+#define OCTAVE_BANDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define OCTAVE_BANDS 7
+#define OCTAVE_BANDPASS_SECTIONS 2
+#define OCTAVE_LOWPASS_SECTIONS 3
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct BiquadState {
+    int32_t x1, x2;
+    int32_t y1, y2;
+};
+
+struct OctaveStage {
+    BiquadState bandpass[OCTAVE_BANDPASS_SECTIONS];
+    BiquadState lowpass[OCTAVE_LOWPASS_SECTIONS];
+    bool odd; // Decimation phase: only even samples reach the next stage
+    uint64_t sumSquares;
+    uint32_t samples;
+};
+
+struct OctaveFilterBank {
+    float sampleRate;
+    OctaveStage stages[OCTAVE_BANDS]; // Highest band first
+    uint32_t samples;                 // Input samples since the last take
+};
+
+struct OctaveLevels {
+    unsigned long timestamp;
+    float sampleRate;
+    uint32_t samples;
+    float level[OCTAVE_BANDS]; // dBFS, lowest band first
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Centre frequency in Hz of band 0 (lowest) to OCTAVE_BANDS - 1
+float octaveBandCentre(float sampleRate, int band);
+
+void octaveBankBegin(OctaveFilterBank& bank, float sampleRate);
+
+// Run one block of microphone samples through every band
+void octaveBankProcess(OctaveFilterBank& bank, const int16_t* samples, size_t count);
+
+// Band levels since the last call, then start over. Filter state carries
+// on. Returns false if no samples were processed.
+bool octaveBankTake(OctaveFilterBank& bank, OctaveLevels& levels);
+
+#endif // OCTAVE_BANDS_H
@@ -6,6 +6,11 @@
 #include "Sensors.h"
 #include "Config.h"
 #include "DataProcessing.h"
+#include "DhtPio.h"
+#include "Lsm6dsoxFifo.h"
+#include "Profiler.h"
+#include "SampleQueue.h"
+#include <atomic>
 
 //=====================================================================
 // GLOBAL VARIABLES
@@ -19,14 +24,43 @@ float humidity = 0.0;
 float heatIndex = 0.0;
 float Ax = 0.0, Ay = 0.0, Az = 0.0;
 float Gx = 0.0, Gy = 0.0, Gz = 0.0;
+float vibrationPeak = 0.0;
+float vibrationRms = 0.0;
+uint16_t gasAdc = 0;
 float gasRatio = 0.0;
 float soundLevel = 0.0;
+float soundPeak = 0.0;
+float soundLeq = AUDIO_LEQ_FLOOR;
 float batteryVoltage = 0.0;
 float batteryPercentage = 0.0;
 
-// Microphone buffer
-short sampleBuffer[MIC_BUFFER_SIZE];
-volatile int samplesRead = 0;
+// Microphone block as read by the PDM callback
+struct AudioBlock {
+    uint16_t count;
+    int16_t samples[MIC_BUFFER_SIZE];
+};
+
+static AudioBlock pdmBlock;
+
+// Ping-pong audio windows: the PDM callback accumulates into the active
+// one while the reader closes and drains the other
+static AudioWindow audioWindows[2];
+static std::atomic<uint8_t> activeAudioWindow(0);
+static std::atomic<bool> audioCallbackBusy(false);
+
+// The octave filters are too costly for interrupt context, so blocks are
+// queued and filtered on the acquisition side
+static SampleQueue<AudioBlock, AUDIO_BLOCK_QUEUE_SIZE> audioBlockQueue;
+static OctaveFilterBank octaveBank;
+
+// IMU FIFO mode: samples since the last reading, folded as they are drained
+static bool imuFifoActive = false;
+static ImuFifoParser imuParser;
+static ImuWindow imuWindow;
+static VibrationSpectrum imuSpectrum;
+
+// DHT reads through the PIO driver rather than the library
+static bool dhtPioActive = false;
 
 // State Tracking
 bool vibrationSpikeDetected = false;
@@ -34,14 +68,61 @@ bool soundSpikeDetected = false;
 bool isOnBattery = false;
 bool lowBatteryWarning = false;
 
+//=====================================================================
+// IMU MODE
+//=====================================================================
+// Follow config.imuFifoEnabled, switching the IMU between FIFO bursts and
+// the library's single-sample reads
+static void updateImuMode() {
+    if (config.imuFifoEnabled == imuFifoActive)
+        return;
+
+    if (config.imuFifoEnabled) {
+        imuFifoActive = lsm6dsoxFifoBegin();
+        imuFifoParserBegin(imuParser, IMU_FIFO_ACCEL_SCALE, IMU_FIFO_GYRO_SCALE);
+        imuWindowReset(imuWindow);
+        vibrationSpectrumBegin(imuSpectrum, IMU_FIFO_ODR_HZ);
+        imuParser.spectrum = &imuSpectrum;
+        if (!imuFifoActive) {
+            Serial.println("IMU FIFO unavailable, using single reads");
+            config.imuFifoEnabled = false;
+        }
+    } else {
+        lsm6dsoxFifoEnd();
+        IMU.begin(); // Restores the library's data rates and full scales
+        imuFifoActive = false;
+    }
+}
+
+void serviceImu() {
+    PROFILE_SCOPE(PROFILE_IMU_SERVICE);
+
+    if (imuFifoActive) {
+        lsm6dsoxFifoDrain(imuParser, imuWindow);
+    }
+}
+
+bool takeVibrationFeatures(VibrationFeatures& features) {
+    if (!imuFifoActive)
+        return false;
+
+    features.timestamp = millis();
+    return vibrationSpectrumTake(imuSpectrum, features);
+}
+
 //=====================================================================
 // SENSOR FUNCTIONS
 //=====================================================================
 void setupSensors() {
     pinMode(BATTERY_PIN, INPUT);
 
-    // Initialize DHT sensor
-    dht.begin();
+    // Initialize DHT sensor: PIO transfers if a state machine is free,
+    // the library's blocking reads otherwise
+    dhtPioActive = dhtPioBegin(DHTPIN, DHTTYPE);
+    if (!dhtPioActive) {
+        Serial.println("DHT PIO unavailable, using blocking reads");
+        dht.begin();
+    }
 
     // Initialize IMU
     if (!IMU.begin()) {
@@ -50,7 +131,15 @@ void setupSensors() {
         delay(1000);
     }
 
+    updateImuMode();
+
+    // Motion on INT1 ends a power-save sleep
+    if (!lsm6dsoxWakeBegin()) {
+        Serial.println("IMU wake-up interrupt unavailable");
+    }
+
     // Initialize microphone
+    octaveBankBegin(octaveBank, MIC_FREQUENCY);
     PDM.onReceive(onPDMdata);
     if (!PDM.begin(MIC_CHANNELS, MIC_FREQUENCY)) {
         Serial.println("Failed to start PDM microphone!");
@@ -59,44 +148,158 @@ void setupSensors() {
     }
 }
 
-void readSensors() {
-    humidity = dht.readHumidity();
-    temperature = dht.readTemperature();
+static void readMotion(SensorSample& sample) {
+    updateImuMode();
+    if (imuFifoActive) {
+        // Every sample batched since the last reading: the mean for the
+        // orientation fields, the peak and RMS for vibration
+        serviceImu();
+
+        ImuSample mean;
+        sample.accelValid = imuWindowMean(imuWindow, mean);
+        sample.gyroValid = sample.accelValid && imuParser.gyroWords > 0;
+        if (sample.accelValid) {
+            sample.Ax = mean.ax;
+            sample.Ay = mean.ay;
+            sample.Az = mean.az;
+            sample.Gx = mean.gx;
+            sample.Gy = mean.gy;
+            sample.Gz = mean.gz;
+            sample.vibrationPeak = imuWindow.peakVibration;
+            sample.vibrationRms = imuWindowVibrationRms(imuWindow);
+        }
+        imuWindowReset(imuWindow);
+    } else {
+        sample.accelValid = IMU.accelerationAvailable();
+        if (sample.accelValid) {
+            IMU.readAcceleration(sample.Ax, sample.Ay, sample.Az);
+            sample.vibrationPeak = vibrationMagnitude(sample.Ax, sample.Ay, sample.Az);
+            sample.vibrationRms = sample.vibrationPeak;
+        }
 
-    if (!isnan(humidity) && !isnan(temperature)) {
-        heatIndex = dht.computeHeatIndex(temperature, humidity, false);
-        updateSensorHistory(temperature, tempHistory);
-        updateSensorHistory(humidity, humidityHistory);
+        sample.gyroValid = IMU.gyroscopeAvailable();
+        if (sample.gyroValid) {
+            IMU.readGyroscope(sample.Gx, sample.Gy, sample.Gz);
+        }
     }
+}
 
-    if (IMU.accelerationAvailable()) {
-        IMU.readAcceleration(Ax, Ay, Az);
-        float accelMag = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-        updateSensorHistory(accelMag, accelHistory);
+static void readEnvironment(SensorSample& sample) {
+    // The library bit-bangs its whole frame, typically a large share of
+    // the read; the PIO driver only starts the transfer
+    PROFILE_SCOPE(PROFILE_DHT_READ);
+    if (dhtPioActive) {
+        dhtPioStart(); // Finished by finishEnvironmentRead()
+        return;
     }
 
-    if (IMU.gyroscopeAvailable()) {
-        IMU.readGyroscope(Gx, Gy, Gz);
+    sample.humidity = dht.readHumidity();
+    sample.temperature = dht.readTemperature();
+    sample.environmentValid = !isnan(sample.humidity) && !isnan(sample.temperature);
+    if (sample.environmentValid) {
+        sample.heatIndex = dht.computeHeatIndex(sample.temperature, sample.humidity, false);
     }
+}
+
+void readSensors(SensorSample& sample, uint8_t channels) {
+    PROFILE_SCOPE(PROFILE_READ_SENSORS);
 
-    int sensorValue = analogRead(GAS_SENSOR_PIN);
-    float sensorVolt = (float)sensorValue / 1024 * 5.0;
-    float RS_gas = (5.0 - sensorVolt) / sensorVolt;
-    gasRatio = RS_gas / R0;
-    updateSensorHistory(getCO_ppm(gasRatio), gasHistory);
+    sample.timestamp = millis();
+    sample.channels = channels;
+    sample.environmentValid = false;
+    sample.accelValid = false;
+    sample.gyroValid = false;
+    sample.gasValid = false;
+    sample.soundValid = false;
+
+    if (channels & (1 << SENSOR_MOTION)) {
+        readMotion(sample);
+    }
 
-    if (samplesRead > 0) {
-        int16_t maxSample = 0;
-        for (int i = 0; i < samplesRead; i++) {
-            if (abs(sampleBuffer[i]) > abs(maxSample)) {
-                maxSample = sampleBuffer[i];
-            }
+    if (channels & (1 << SENSOR_GAS)) {
+        sample.gasAdc = analogRead(GAS_SENSOR_PIN);
+        sample.gasRatio = gasRatioFromAdc(sample.gasAdc);
+        sample.gasValid = true;
+    }
+
+    if (channels & (1 << SENSOR_SOUND)) {
+        // Levels cover every microphone block since the last sound read
+        AudioLevels audio;
+        sample.soundValid = takeAudioLevels(audio);
+        if (sample.soundValid) {
+            sample.soundLevel = audio.rms;
+            sample.soundPeak = audio.peak;
+            sample.soundLeq = audio.leq;
         }
+    }
+
+    // Slowest last, so it does not delay the others
+    if (channels & (1 << SENSOR_ENVIRONMENT)) {
+        readEnvironment(sample);
+    }
+
+    sample.vibrationSpike = sample.accelValid && checkForVibrationSpike(sample);
+    sample.soundSpike = sample.soundValid && checkForSoundSpike(sample);
+}
+
+bool finishEnvironmentRead(SensorSample& sample) {
+    DhtReading reading;
+    if (!dhtPioActive || !dhtPioTake(reading))
+        return false;
 
-        soundLevel = abs(maxSample);
-        samplesRead = 0;
-        updateSensorHistory(soundLevel, soundHistory);
+    sample.temperature = reading.temperature;
+    sample.humidity = reading.humidity;
+    sample.environmentValid = reading.status == DHT_OK;
+    if (sample.environmentValid) {
+        sample.heatIndex = dht.computeHeatIndex(sample.temperature, sample.humidity, false);
     }
+    return true;
+}
+
+unsigned long untilEnvironmentReady() {
+    return dhtPioUntilReady();
+}
+
+void applySensorSample(const SensorSample& sample) {
+    if (sample.environmentValid) {
+        temperature = sample.temperature;
+        humidity = sample.humidity;
+        heatIndex = sample.heatIndex;
+        rollingStatsAdd(tempStats, temperature);
+        rollingStatsAdd(humidityStats, humidity);
+    }
+
+    if (sample.accelValid) {
+        Ax = sample.Ax;
+        Ay = sample.Ay;
+        Az = sample.Az;
+        vibrationPeak = sample.vibrationPeak;
+        vibrationRms = sample.vibrationRms;
+        rollingStatsAdd(accelStats, sqrt(Ax * Ax + Ay * Ay + Az * Az));
+    }
+
+    if (sample.gyroValid) {
+        Gx = sample.Gx;
+        Gy = sample.Gy;
+        Gz = sample.Gz;
+    }
+
+    if (sample.gasValid) {
+        gasAdc = sample.gasAdc;
+        gasRatio = sample.gasRatio;
+        rollingStatsAdd(gasStats, coPpmFromAdc(gasAdc));
+    }
+
+    if (sample.soundValid) {
+        soundLevel = sample.soundLevel;
+        soundPeak = sample.soundPeak;
+        soundLeq = sample.soundLeq;
+        rollingStatsAdd(soundStats, soundLevel);
+    }
+
+    // Spikes are reported by the sample that read them
+    vibrationSpikeDetected = sample.vibrationSpike;
+    soundSpikeDetected = sample.soundSpike;
 }
 
 void readBatteryStatus() {
@@ -112,37 +315,56 @@ void readBatteryStatus() {
 
 void onPDMdata() {
     int bytesAvailable = PDM.available();
-    PDM.read(sampleBuffer, bytesAvailable);
-    samplesRead = bytesAvailable / 2;
-}
+    if (bytesAvailable > (int)sizeof(pdmBlock.samples)) {
+        bytesAvailable = sizeof(pdmBlock.samples);
+    }
+    PDM.read(pdmBlock.samples, bytesAvailable);
+    pdmBlock.count = bytesAvailable / 2;
 
-bool checkForVibrationSpike() {
-    float accelMagnitude = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-    float adjustedMagnitude = accelMagnitude;
+    // Flag the update so a reader on the other core waits for it to finish
+    audioCallbackBusy.store(true);
+    AudioWindow& window = audioWindows[activeAudioWindow.load()];
+    audioWindowAccumulate(window, pdmBlock.samples, pdmBlock.count);
+    audioCallbackBusy.store(false);
 
-    // Adjust for gravity (roughly 1g when stationary)
-    if (accelMagnitude > 0.8 && accelMagnitude < 1.2) {
-        adjustedMagnitude -= 1.0;
+    audioBlockQueue.push(pdmBlock);
+}
+
+bool takeAudioLevels(AudioLevels& levels) {
+    // Point the callback at the other window, then let any update it had
+    // already started on this one complete
+    uint8_t closed = activeAudioWindow.load();
+    activeAudioWindow.store(closed ^ 1);
+    while (audioCallbackBusy.load()) {
     }
 
-    return (adjustedMagnitude > config.accelSpikeThreshold);
+    bool valid = audioWindowLevels(audioWindows[closed], levels);
+    audioWindowReset(audioWindows[closed]);
+    return valid;
 }
 
-bool checkForSoundSpike() {
-    return (soundLevel >= config.soundSpikeThreshold);
+void serviceAudio() {
+    // Scratch kept off the stack, like the FFT buffers
+    static AudioBlock block;
+
+    PROFILE_SCOPE(PROFILE_AUDIO_SERVICE);
+
+    while (audioBlockQueue.pop(block)) {
+        octaveBankProcess(octaveBank, block.samples, block.count);
+    }
 }
 
-//=====================================================================
-// GAS SENSOR CALCULATIONS
-//=====================================================================
-float getCO_ppm(float ratio) {
-    return pow(4.07 / ratio, 4.0);
+bool takeOctaveLevels(OctaveLevels& levels) {
+    levels.timestamp = millis();
+    return octaveBankTake(octaveBank, levels);
 }
 
-float getCH4_ppm(float ratio) {
-    return pow(7.08 / ratio, 4.17);
+bool checkForVibrationSpike(const SensorSample& sample) {
+    // In FIFO mode the peak covers every IMU sample since the last reading
+    return (sample.vibrationPeak > config.accelSpikeThreshold);
 }
 
-float getLPG_ppm(float ratio) {
-    return pow(10.96 / ratio, 2.78);
+bool checkForSoundSpike(const SensorSample& sample) {
+    // The peak covers every block since the previous sample
+    return (sample.soundPeak >= config.soundSpikeThreshold);
 }
@@ -1,148 +1,126 @@
 /*
- * Sensors.cpp
- * Sensor reading implementation
+ * Sensors.h
+ * Sensor reading functions
  */
 
-#include "Config.h"
-#include "DataProcessing.h"
-#include "Sensors.h"
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include "AudioLevel.h"
+#include "ChannelSchedule.h"
+#include "Constants.h"
+#include "GasCurves.h"
+#include "ImuFifo.h"
+#include "OctaveBands.h"
+#include <Arduino.h>
+#include <Arduino_LSM6DSOX.h>
+#include <DHT.h>
+#include <PDM.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// One acquisition pass, handed from the sampling core to the network core.
+// Only the channels that were due are read; the rest are not valid.
+struct SensorSample {
+    unsigned long timestamp;
+    uint8_t channels; // SensorChannel bits read in this pass
+    float temperature;
+    float humidity;
+    float heatIndex;
+    float Ax, Ay, Az;
+    float Gx, Gy, Gz;
+    float vibrationPeak; // Over every IMU sample in the interval
+    float vibrationRms;
+    uint16_t gasAdc;
+    float gasRatio;
+    float soundLevel; // RMS over the sampling interval
+    float soundPeak;
+    float soundLeq;
+    bool environmentValid;
+    bool accelValid;
+    bool gyroValid;
+    bool gasValid;
+    bool soundValid;
+    bool vibrationSpike;
+    bool soundSpike;
+};
 
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
 // Sensor instance
-DHT dht(DHTPIN, DHTTYPE);
-
-// Sensor Data Variables
-float temperature = 0.0;
-float humidity = 0.0;
-float heatIndex = 0.0;
-float Ax = 0.0, Ay = 0.0, Az = 0.0;
-float Gx = 0.0, Gy = 0.0, Gz = 0.0;
-float gasRatio = 0.0;
-float soundLevel = 0.0;
-float batteryVoltage = 0.0;
-float batteryPercentage = 0.0;
-
-// Microphone buffer
-short sampleBuffer[MIC_BUFFER_SIZE];
-volatile int samplesRead = 0;
+extern DHT dht;
+
+// Latest sensor data, updated from samples on the network core
+extern float temperature;
+extern float humidity;
+extern float heatIndex;
+extern float Ax, Ay, Az;
+extern float Gx, Gy, Gz;
+extern float vibrationPeak;
+extern float vibrationRms;
+extern uint16_t gasAdc;
+extern float gasRatio;
+extern float soundLevel;
+extern float soundPeak;
+extern float soundLeq;
+extern float batteryVoltage;
+extern float batteryPercentage;
 
 // State Tracking
-bool vibrationSpikeDetected = false;
-bool soundSpikeDetected = false;
-bool isOnBattery = false;
-bool lowBatteryWarning = false;
+extern bool vibrationSpikeDetected;
+extern bool soundSpikeDetected;
+extern bool isOnBattery;
+extern bool lowBatteryWarning;
 
 //=====================================================================
-// SENSOR FUNCTIONS
+// FUNCTION PROTOTYPES
 //=====================================================================
-void setupSensors() {
-    pinMode(BATTERY_PIN, INPUT);
-
-    // Initialize DHT sensor
-    dht.begin();
-
-    // Initialize IMU
-    if (!IMU.begin()) {
-        Serial.println("Failed to initialize IMU!");
-        digitalWrite(LEDR, HIGH);
-        delay(1000);
-    }
-
-    // Initialize microphone
-    PDM.onReceive(onPDMdata);
-    if (!PDM.begin(MIC_CHANNELS, MIC_FREQUENCY)) {
-        Serial.println("Failed to start PDM microphone!");
-        digitalWrite(LEDR, HIGH);
-        delay(1000);
-    }
-}
-
-void readSensors() {
-    humidity = dht.readHumidity();
-    temperature = dht.readTemperature();
-
-    if (!isnan(humidity) && !isnan(temperature)) {
-        heatIndex = dht.computeHeatIndex(temperature, humidity, false);
-        updateSensorHistory(temperature, tempHistory);
-        updateSensorHistory(humidity, humidityHistory);
-    }
-
-    if (IMU.accelerationAvailable()) {
-        IMU.readAcceleration(Ax, Ay, Az);
-        float accelMag = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-        updateSensorHistory(accelMag, accelHistory);
-    }
-
-    if (IMU.gyroscopeAvailable()) {
-        IMU.readGyroscope(Gx, Gy, Gz);
-    }
-
-    int sensorValue = analogRead(GAS_SENSOR_PIN);
-    float sensorVolt = (float)sensorValue / 1024 * 5.0;
-    float RS_gas = (5.0 - sensorVolt) / sensorVolt;
-    gasRatio = RS_gas / R0;
-    updateSensorHistory(getCO_ppm(gasRatio), gasHistory);
-
-    if (samplesRead > 0) {
-        int16_t maxSample = 0;
-        for (int i = 0; i < samplesRead; i++) {
-            if (abs(sampleBuffer[i]) > abs(maxSample)) {
-                maxSample = sampleBuffer[i];
-            }
-        }
-
-        soundLevel = abs(maxSample);
-        samplesRead = 0;
-        updateSensorHistory(soundLevel, soundHistory);
-    }
-}
-
-void readBatteryStatus() {
-    int rawValue = analogRead(BATTERY_PIN);
-    batteryVoltage = (rawValue / 1023.0) * 5.0 * VOLTAGE_DIVIDER_RATIO;
-
-    batteryPercentage = 100.0 * (batteryVoltage - BATTERY_MIN_VOLTAGE) /
-                        (BATTERY_MAX_VOLTAGE - BATTERY_MIN_VOLTAGE);
-    batteryPercentage = constrain(batteryPercentage, 0.0, 100.0);
-
-    isOnBattery = (batteryVoltage < EXTERNAL_POWER_THRESHOLD);
-}
-
-void onPDMdata() {
-    int bytesAvailable = PDM.available();
-    PDM.read(sampleBuffer, bytesAvailable);
-    samplesRead = bytesAvailable / 2;
-}
-
-bool checkForVibrationSpike() {
-    float accelMagnitude = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-    float adjustedMagnitude = accelMagnitude;
-
-    // Adjust for gravity (roughly 1g when stationary)
-    if (accelMagnitude > 0.8 && accelMagnitude < 1.2) {
-        adjustedMagnitude -= 1.0;
-    }
-
-    return (adjustedMagnitude > config.accelSpikeThreshold);
-}
-
-bool checkForSoundSpike() {
-    return (soundLevel >= config.soundSpikeThreshold);
-}
+// Initialize all sensors
+void setupSensors();
 
-//=====================================================================
-// GAS SENSOR CALCULATIONS
-//=====================================================================
-float getCO_ppm(float ratio) {
-    return pow(4.07 / ratio, 4.0);
-}
+// Drain the IMU FIFO into the open vibration window (FIFO mode only)
+void serviceImu();
+
+// Vibration spectrum features since the last call (FIFO mode only)
+bool takeVibrationFeatures(VibrationFeatures& features);
+
+// Read the given SensorChannel bits into a sample and run spike
+// detection on it. The fast channels are read first, the DHT11 last; with
+// the PIO driver its read is only started, see finishEnvironmentRead().
+void readSensors(SensorSample& sample, uint8_t channels);
+
+// Fill in the environment channel from the PIO transfer once it has
+// finished; it stays invalid if the read failed. Returns false while the
+// transfer is running or none was started.
+bool finishEnvironmentRead(SensorSample& sample);
+
+// ms until the running DHT transfer should have finished,
+// (unsigned long)-1 if none is running
+unsigned long untilEnvironmentReady();
+
+// Publish a sample to the global sensor variables and history
+void applySensorSample(const SensorSample& sample);
+
+// Read battery voltage and charge state
+void readBatteryStatus();
+
+// PDM microphone data callback: folds each block into the open audio window
+// and queues it for the octave filter bank
+void onPDMdata();
+
+// Close the audio window, returning the levels since the previous call
+bool takeAudioLevels(AudioLevels& levels);
+
+// Run queued microphone blocks through the octave filter bank
+void serviceAudio();
+
+// Octave band levels since the last call
+bool takeOctaveLevels(OctaveLevels& levels);
 
-float getCH4_ppm(float ratio) {
-    return pow(7.08 / ratio, 4.17);
-}
+// Spike detection
+bool checkForVibrationSpike(const SensorSample& sample);
+bool checkForSoundSpike(const SensorSample& sample);
 
-float getLPG_ppm(float ratio) {
-    return pow(10.96 / ratio, 2.78);
-}
+#endif // SENSORS_H
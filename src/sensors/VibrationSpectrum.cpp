@@ -0,0 +1,222 @@
+/*
+ * VibrationSpectrum.cpp
+ * Fixed-point FFT and vibration features implementation
+ */
+
+#include "VibrationSpectrum.h"
+#include <math.h>
+#include <string.h>
+
+const float VIBRATION_BAND_EDGES[VIBRATION_BANDS] = {1.0, 10.0, 50.0, 100.0};
+
+// Tables built once: cos/sin for the N/2 twiddle factors, and the window
+static int16_t twiddleCos[VIBRATION_FFT_SIZE / 2];
+static int16_t twiddleSin[VIBRATION_FFT_SIZE / 2];
+static int16_t hannWindow[VIBRATION_FFT_SIZE];
+static bool tablesReady = false;
+
+// Mean square of the Hann window, to undo its effect on band power
+static const float HANN_POWER_GAIN = 0.375;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static inline int16_t saturate16(int32_t value) {
+    if (value > 32767)
+        return 32767;
+    if (value < -32768)
+        return -32768;
+    return (int16_t)value;
+}
+
+static inline int16_t mulQ15(int16_t a, int16_t b) {
+    return (int16_t)(((int32_t)a * b + 0x4000) >> 15);
+}
+
+static int16_t toQ15(double value) {
+    return saturate16(lround(value * 32767.0));
+}
+
+static void buildTables() {
+    if (tablesReady)
+        return;
+
+    for (int i = 0; i < VIBRATION_FFT_SIZE / 2; i++) {
+        double angle = 2.0 * M_PI * i / VIBRATION_FFT_SIZE;
+        twiddleCos[i] = toQ15(cos(angle));
+        twiddleSin[i] = toQ15(sin(angle));
+    }
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        hannWindow[i] = toQ15(0.5 - 0.5 * cos(2.0 * M_PI * i / VIBRATION_FFT_SIZE));
+    }
+    tablesReady = true;
+}
+
+//=====================================================================
+// FFT
+//=====================================================================
+void fftQ15(int16_t* re, int16_t* im, uint8_t log2n) {
+    buildTables();
+
+    uint16_t n = 1 << log2n;
+
+    // Bit-reversal permutation
+    for (uint16_t i = 1, j = 0; i < n; i++) {
+        uint16_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            int16_t t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    // Decimation in time; halving every stage keeps values in range
+    for (uint16_t span = 1; span < n; span <<= 1) {
+        uint16_t stride = VIBRATION_FFT_SIZE / (span << 1);
+
+        for (uint16_t k = 0; k < span; k++) {
+            int16_t wr = twiddleCos[k * stride];
+            int16_t wi = -twiddleSin[k * stride];
+
+            for (uint16_t i = k; i < n; i += span << 1) {
+                uint16_t j = i + span;
+                int32_t tr = ((int32_t)re[j] * wr - (int32_t)im[j] * wi + 0x4000) >> 15;
+                int32_t ti = ((int32_t)re[j] * wi + (int32_t)im[j] * wr + 0x4000) >> 15;
+
+                re[j] = (re[i] - tr) >> 1;
+                im[j] = (im[i] - ti) >> 1;
+                re[i] = (re[i] + tr) >> 1;
+                im[i] = (im[i] + ti) >> 1;
+            }
+        }
+    }
+}
+
+//=====================================================================
+// SPECTRUM ACCUMULATION
+//=====================================================================
+static void clearAccumulators(VibrationSpectrum& spectrum) {
+    memset(spectrum.power, 0, sizeof(spectrum.power));
+    spectrum.blocks = 0;
+    spectrum.sumSquares = 0;
+    spectrum.samples = 0;
+    spectrum.peak = 0;
+}
+
+static void processBlock(VibrationSpectrum& spectrum) {
+    // Scratch kept off the stack; blocks are only processed on the
+    // acquisition side
+    static int16_t re[VIBRATION_FFT_SIZE];
+    static int16_t im[VIBRATION_FFT_SIZE];
+
+    // Remove the block mean (mostly gravity) before windowing
+    int32_t sum = 0;
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        sum += spectrum.block[i];
+    }
+    int16_t mean = sum / VIBRATION_FFT_SIZE;
+
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        int32_t value = spectrum.block[i] - mean;
+        int32_t magnitude = value < 0 ? -value : value;
+
+        spectrum.sumSquares += (uint32_t)(value * value);
+        if (magnitude > spectrum.peak) {
+            spectrum.peak = magnitude;
+        }
+
+        re[i] = mulQ15(saturate16(value), hannWindow[i]);
+        im[i] = 0;
+    }
+    spectrum.samples += VIBRATION_FFT_SIZE;
+
+    fftQ15(re, im, VIBRATION_FFT_LOG2);
+
+    for (int k = 0; k < VIBRATION_FFT_SIZE / 2; k++) {
+        uint32_t real = (int32_t)re[k] * re[k];
+        uint32_t imaginary = (int32_t)im[k] * im[k];
+        spectrum.power[k] += (uint64_t)real + imaginary;
+    }
+    spectrum.blocks++;
+}
+
+void vibrationSpectrumBegin(VibrationSpectrum& spectrum, float sampleRate) {
+    buildTables();
+    spectrum.sampleRate = sampleRate;
+    spectrum.fill = 0;
+    clearAccumulators(spectrum);
+}
+
+void vibrationSpectrumAdd(VibrationSpectrum& spectrum, float magnitude) {
+    float counts = magnitude * VIBRATION_COUNTS_PER_G;
+    spectrum.block[spectrum.fill++] = counts >= 32767 ? 32767 : saturate16((int32_t)counts);
+    if (spectrum.fill == VIBRATION_FFT_SIZE) {
+        processBlock(spectrum);
+        spectrum.fill = 0;
+    }
+}
+
+//=====================================================================
+// FEATURES
+//=====================================================================
+bool vibrationSpectrumTake(VibrationSpectrum& spectrum, VibrationFeatures& features) {
+    features.sampleRate = spectrum.sampleRate;
+    features.blocks = spectrum.blocks;
+    if (spectrum.blocks == 0)
+        return false;
+
+    float binWidth = spectrum.sampleRate / VIBRATION_FFT_SIZE;
+
+    // One-sided power: every bin but DC stands for its mirror image too,
+    // and the FFT scaled by 1/N so the sum is already a mean square
+    float scale = 2.0 / (spectrum.blocks * HANN_POWER_GAIN * VIBRATION_COUNTS_PER_G *
+                         VIBRATION_COUNTS_PER_G);
+
+    uint16_t dominant = 1;
+    float bandPower[VIBRATION_BANDS] = {0};
+    for (uint16_t k = 1; k < VIBRATION_FFT_SIZE / 2; k++) {
+        if (spectrum.power[k] > spectrum.power[dominant]) {
+            dominant = k;
+        }
+
+        float frequency = k * binWidth;
+        for (int band = VIBRATION_BANDS - 1; band >= 0; band--) {
+            if (frequency >= VIBRATION_BAND_EDGES[band]) {
+                bandPower[band] += spectrum.power[k] * scale;
+                break;
+            }
+        }
+    }
+
+    // Parabolic interpolation between the neighbouring bins
+    float offset = 0;
+    if (dominant + 1 < VIBRATION_FFT_SIZE / 2) {
+        float left = spectrum.power[dominant - 1];
+        float centre = spectrum.power[dominant];
+        float right = spectrum.power[dominant + 1];
+        float denominator = left - 2 * centre + right;
+        if (denominator != 0) {
+            offset = 0.5 * (left - right) / denominator;
+        }
+    }
+    features.dominantFrequency = (dominant + offset) * binWidth;
+
+    for (int band = 0; band < VIBRATION_BANDS; band++) {
+        features.bandRms[band] = sqrt(bandPower[band]);
+    }
+
+    features.rms = sqrt((double)spectrum.sumSquares / spectrum.samples) / VIBRATION_COUNTS_PER_G;
+    features.peak = spectrum.peak / VIBRATION_COUNTS_PER_G;
+    features.crestFactor = features.rms > 0 ? features.peak / features.rms : 0;
+
+    clearAccumulators(spectrum);
+    return true;
+}
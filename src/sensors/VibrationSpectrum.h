@@ -0,0 +1,74 @@
+/*
+ * VibrationSpectrum.h
+ * Fixed-point spectral analysis of accelerometer blocks
+ *
+ * Acceleration magnitude samples from the IMU FIFO are collected into
+ * blocks of VIBRATION_FFT_SIZE, offset-removed, Hann windowed and run
+ * through a Q15 radix-2 FFT: integer only, since the RP2040 has no FPU.
+ * Power spectra of all blocks in a reporting window are averaged
+ * (Welch's method) before features are extracted: dominant frequency,
+ * RMS per band and the crest factor of the time signal.
+ *
+ * No Arduino dependencies; fftQ15() can be timed on a host for any size
+ * up to VIBRATION_FFT_SIZE.
+ */
+
+#ifndef VIBRATION_SPECTRUM_H
+#define VIBRATION_SPECTRUM_H
+
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define VIBRATION_FFT_LOG2 8
+#define VIBRATION_FFT_SIZE (1 << VIBRATION_FFT_LOG2)
+#define VIBRATION_BANDS 4
+
+// Acceleration to Q15 counts: +-4 g spans the int16 range
+#define VIBRATION_COUNTS_PER_G 8192.0f
+
+// Lower edges of the reported bands in Hz; the last runs to Nyquist
+extern const float VIBRATION_BAND_EDGES[VIBRATION_BANDS];
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct VibrationSpectrum {
+    float sampleRate;
+    int16_t block[VIBRATION_FFT_SIZE];
+    uint16_t fill;
+    uint16_t blocks;
+    uint64_t power[VIBRATION_FFT_SIZE / 2];
+    uint64_t sumSquares;
+    uint32_t samples;
+    int32_t peak;
+};
+
+struct VibrationFeatures {
+    unsigned long timestamp;
+    float sampleRate;
+    uint16_t blocks;
+    float dominantFrequency; // Hz
+    float rms;               // g, offset removed
+    float peak;              // g, offset removed
+    float crestFactor;
+    float bandRms[VIBRATION_BANDS]; // g
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// In-place complex FFT of 2^log2n Q15 points, scaled by 1/n
+void fftQ15(int16_t* re, int16_t* im, uint8_t log2n);
+
+void vibrationSpectrumBegin(VibrationSpectrum& spectrum, float sampleRate);
+
+// Add one acceleration magnitude sample (g); a full block is transformed
+void vibrationSpectrumAdd(VibrationSpectrum& spectrum, float magnitude);
+
+// Features of the blocks completed since the last call, then start over.
+// Returns false if no block was completed.
+bool vibrationSpectrumTake(VibrationSpectrum& spectrum, VibrationFeatures& features);
+
+#endif // VIBRATION_SPECTRUM_H
@@ -0,0 +1,46 @@
+/*
+ * AdaptiveSampling.cpp
+ * Activity-driven read interval implementation
+ */
+
+#include "AdaptiveSampling.h"
+#include <string.h>
+
+void adaptiveSamplerBegin(AdaptiveSampler& sampler, unsigned long interval) {
+    memset(&sampler, 0, sizeof(sampler));
+    sampler.interval = interval;
+}
+
+unsigned long adaptiveSamplerUpdate(AdaptiveSampler& sampler, bool activity,
+                                    const AdaptiveLimits& limits) {
+    // This read stands for the time until the next one
+    sampler.reads++;
+    sampler.coveredTime += sampler.interval;
+
+    if (activity) {
+        sampler.activeReads++;
+        if (!sampler.inEvent) {
+            sampler.events++;
+            sampler.inEvent = true;
+        }
+        sampler.quietRun = 0;
+        sampler.interval = limits.minInterval;
+    } else if (++sampler.quietRun >= limits.quietReads) {
+        sampler.quietRun = 0;
+        sampler.inEvent = false;
+        sampler.interval *= 2;
+    }
+
+    // Limits can change at any time through remote config
+    if (sampler.interval < limits.minInterval) {
+        sampler.interval = limits.minInterval;
+    }
+    if (sampler.interval > limits.maxInterval) {
+        sampler.interval = limits.maxInterval;
+    }
+    return sampler.interval;
+}
+
+uint32_t adaptiveSamplerFixedReads(const AdaptiveSampler& sampler, unsigned long fixedInterval) {
+    return fixedInterval > 0 ? (uint32_t)(sampler.coveredTime / fixedInterval) : 0;
+}
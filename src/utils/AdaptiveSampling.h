@@ -0,0 +1,56 @@
+/*
+ * AdaptiveSampling.h
+ * Sensor read interval that follows signal activity
+ *
+ * Any activity drops the interval straight to the fastest rate, so an
+ * event is sampled densely from its first sign. Once readings have been
+ * quiet for quietReads reads in a row the interval doubles, and keeps
+ * doubling after each further quiet run until it reaches the slowest
+ * rate. The quiet-run requirement is the hysteresis: a single calm read
+ * in the middle of an event does not slow sampling down.
+ *
+ * No Arduino dependencies, so recorded traces can be fed through it on
+ * a host.
+ */
+
+#ifndef ADAPTIVE_SAMPLING_H
+#define ADAPTIVE_SAMPLING_H
+
+#include <stdint.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct AdaptiveLimits {
+    unsigned long minInterval; // ms, used while active
+    unsigned long maxInterval; // ms, the floor rate for stable readings
+    uint16_t quietReads;       // Quiet reads before each slow-down step
+};
+
+struct AdaptiveSampler {
+    unsigned long interval;
+    uint16_t quietRun; // Consecutive quiet reads since the last step
+    bool inEvent;      // Activity seen and not yet released by a quiet run
+
+    // Statistics since begin
+    uint32_t reads;
+    uint32_t activeReads;
+    uint32_t events;      // Quiet-to-active transitions
+    uint64_t coveredTime; // ms of signal the reads stand for
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Start at the given interval with empty statistics
+void adaptiveSamplerBegin(AdaptiveSampler& sampler, unsigned long interval);
+
+// Account for one read and whether it showed activity. Returns the
+// interval until the next read, within limits.
+unsigned long adaptiveSamplerUpdate(AdaptiveSampler& sampler, bool activity,
+                                    const AdaptiveLimits& limits);
+
+// Reads a fixed interval would have taken over the same time
+uint32_t adaptiveSamplerFixedReads(const AdaptiveSampler& sampler, unsigned long fixedInterval);
+
+#endif // ADAPTIVE_SAMPLING_H
@@ -0,0 +1,56 @@
+/*
+ * Backoff.cpp
+ * Jittered exponential backoff implementation
+ */
+
+#include "Backoff.h"
+
+static uint32_t nextRandom(uint32_t& state) {
+    // xorshift32; any non-zero state works
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void backoffBegin(Backoff& backoff, unsigned long minDelay, unsigned long maxDelay,
+                  uint32_t seed) {
+    backoff.minDelay = minDelay;
+    backoff.maxDelay = maxDelay > minDelay ? maxDelay : minDelay;
+    backoff.failures = 0;
+    backoff.retryAt = 0;
+    backoff.random = seed != 0 ? seed : 1;
+}
+
+void backoffReset(Backoff& backoff, unsigned long now) {
+    backoff.failures = 0;
+    backoff.retryAt = now;
+}
+
+unsigned long backoffFail(Backoff& backoff, unsigned long now) {
+    // Double from minDelay, stopping at the cap before the shift can overflow
+    unsigned long ceiling = backoff.minDelay;
+    for (uint16_t i = 0; i < backoff.failures && ceiling < backoff.maxDelay; i++) {
+        ceiling *= 2;
+    }
+    if (ceiling > backoff.maxDelay) {
+        ceiling = backoff.maxDelay;
+    }
+
+    if (backoff.failures < UINT16_MAX) {
+        backoff.failures++;
+    }
+
+    unsigned long half = ceiling / 2;
+    unsigned long delay = ceiling - half + nextRandom(backoff.random) % (half + 1);
+    backoff.retryAt = now + delay;
+    return delay;
+}
+
+bool backoffDue(const Backoff& backoff, unsigned long now) {
+    return (long)(now - backoff.retryAt) >= 0;
+}
+
+unsigned long backoffRemaining(const Backoff& backoff, unsigned long now) {
+    return backoffDue(backoff, now) ? 0 : backoff.retryAt - now;
+}
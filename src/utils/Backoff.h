@@ -0,0 +1,48 @@
+/*
+ * Backoff.h
+ * Exponential retry backoff with jitter
+ *
+ * After n failures in a row the next attempt waits a random time between
+ * d/2 and d, where d = minDelay * 2^(n-1) capped at maxDelay. The random
+ * half keeps devices that lost the same broker from retrying in step; the
+ * fixed half keeps the wait from collapsing to nothing.
+ *
+ * No Arduino dependencies; the caller passes the clock and the seed.
+ */
+
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <stdint.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct Backoff {
+    unsigned long minDelay; // ms, after the first failure
+    unsigned long maxDelay; // ms, the cap
+    uint16_t failures;      // In a row, since the last success
+    unsigned long retryAt;  // Clock value from which the next attempt may start
+    uint32_t random;        // Jitter generator state
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Start with no failures and an attempt allowed at once
+void backoffBegin(Backoff& backoff, unsigned long minDelay, unsigned long maxDelay,
+                  uint32_t seed);
+
+// The attempt succeeded: the next one (after a later drop) may start at once
+void backoffReset(Backoff& backoff, unsigned long now);
+
+// The attempt failed: schedule the next one. Returns the delay chosen.
+unsigned long backoffFail(Backoff& backoff, unsigned long now);
+
+// True once the next attempt may start
+bool backoffDue(const Backoff& backoff, unsigned long now);
+
+// ms until the next attempt may start, 0 if it may start now
+unsigned long backoffRemaining(const Backoff& backoff, unsigned long now);
+
+#endif // BACKOFF_H
@@ -0,0 +1,359 @@
+/*
+ * BinaryTelemetry.cpp
+ * Binary payload encoder and decoder implementation
+ */
+
+#include "BinaryTelemetry.h"
+#include <math.h>
+#include <string.h>
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static void putFloat(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putUint32(out, bits);
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+static float getFloat(const uint8_t* in) {
+    uint32_t bits = getUint32(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void putHeader(uint8_t* out, TelemetryMessageType type, uint32_t timestamp,
+                      bool onBattery) {
+    out[0] = BINARY_TELEMETRY_MAGIC;
+    out[1] = BINARY_TELEMETRY_VERSION;
+    out[2] = type;
+    out[3] = onBattery ? 0x01 : 0x00;
+    putUint32(out + 4, timestamp);
+}
+
+static bool checkType(const uint8_t* data, size_t length, TelemetryMessageType type,
+                      size_t minimumLength) {
+    TelemetryHeader header;
+    return length >= minimumLength && decodeTelemetryHeader(data, length, header) &&
+           header.type == type;
+}
+
+//=====================================================================
+// ENCODING
+//=====================================================================
+size_t encodeTelemetrySnapshot(uint8_t* buffer, size_t capacity, uint32_t timestamp,
+                               bool onBattery, const TelemetrySnapshot& snapshot) {
+    if (capacity < BINARY_SNAPSHOT_SIZE)
+        return 0;
+
+    const float fields[] = {
+        snapshot.battery, snapshot.temperature, snapshot.humidity, snapshot.heatIndex,
+        snapshot.accelX,  snapshot.accelY,      snapshot.accelZ,   snapshot.gyroX,
+        snapshot.gyroY,   snapshot.gyroZ,       snapshot.gasRatio, snapshot.coPpm,
+        snapshot.ch4Ppm,  snapshot.lpgPpm,      snapshot.soundLevel,
+    };
+
+    putHeader(buffer, TELEMETRY_SNAPSHOT, timestamp, onBattery);
+    uint8_t* out = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        putFloat(out + i * 4, fields[i]);
+    }
+
+    return BINARY_SNAPSHOT_SIZE;
+}
+
+size_t encodeTelemetryAlert(uint8_t* buffer, size_t capacity, uint32_t timestamp,
+                            bool onBattery, const TelemetryAlert& alert) {
+    if (capacity < BINARY_ALERT_SIZE)
+        return 0;
+
+    putHeader(buffer, TELEMETRY_ALERT, timestamp, onBattery);
+    uint8_t* out = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    out[0] = alert.kind;
+    out[1] = alert.sensor;
+    putUint16(out + 2, 0);
+    putFloat(out + 4, alert.value);
+    putFloat(out + 8, alert.aux1);
+    putFloat(out + 12, alert.aux2);
+
+    return BINARY_ALERT_SIZE;
+}
+
+size_t encodeTelemetryBatch(uint8_t* buffer, size_t capacity, bool onBattery, float battery,
+                            const TelemetryBatch& batch, uint16_t channels) {
+    uint16_t count = batch.count;
+    if (count == 0 || count > TELEMETRY_BATCH_CAPACITY || capacity < BINARY_BATCH_SIZE(count))
+        return 0;
+
+    uint32_t base = batch.timestamps[0];
+    putHeader(buffer, TELEMETRY_BATCH, base, onBattery);
+    uint8_t* out = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    putUint16(out, count);
+    putUint16(out + 2, ~channels & TELEMETRY_ALL_CHANNELS);
+    putFloat(out + 4, battery);
+    out += 8;
+
+    for (uint16_t i = 0; i < count; i++, out += 4) {
+        putUint32(out, batch.timestamps[i] - base);
+    }
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        if ((channels & (1 << channel)) == 0)
+            continue;
+
+        const float* values = telemetryBatchColumn(batch, channel);
+        for (uint16_t i = 0; i < count; i++, out += 4) {
+            putFloat(out, values[i]);
+        }
+    }
+
+    return out - buffer;
+}
+
+size_t encodeTelemetryVibration(uint8_t* buffer, size_t capacity, bool onBattery,
+                                const VibrationFeatures& features) {
+    if (capacity < BINARY_VIBRATION_SIZE)
+        return 0;
+
+    putHeader(buffer, TELEMETRY_VIBRATION, features.timestamp, onBattery);
+    uint8_t* out = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    putUint16(out, features.blocks);
+    putUint16(out + 2, VIBRATION_FFT_SIZE);
+    putFloat(out + 4, features.sampleRate);
+    putFloat(out + 8, features.dominantFrequency);
+    putFloat(out + 12, features.rms);
+    putFloat(out + 16, features.peak);
+    putFloat(out + 20, features.crestFactor);
+    for (int band = 0; band < VIBRATION_BANDS; band++) {
+        putFloat(out + 24 + band * 4, features.bandRms[band]);
+    }
+
+    return BINARY_VIBRATION_SIZE;
+}
+
+size_t encodeTelemetryAcoustic(uint8_t* buffer, size_t capacity, bool onBattery,
+                               const OctaveLevels& levels) {
+    if (capacity < BINARY_ACOUSTIC_SIZE)
+        return 0;
+
+    putHeader(buffer, TELEMETRY_ACOUSTIC, levels.timestamp, onBattery);
+    uint8_t* out = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    putUint16(out, OCTAVE_BANDS);
+    putUint16(out + 2, 0);
+    putFloat(out + 4, levels.sampleRate);
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        putFloat(out + 8 + band * 4, levels.level[band]);
+    }
+
+    return BINARY_ACOUSTIC_SIZE;
+}
+
+size_t beginBufferedBatch(uint8_t* buffer, size_t capacity, uint32_t timestamp, bool onBattery) {
+    if (capacity < BINARY_TELEMETRY_HEADER_SIZE + 2)
+        return 0;
+
+    putHeader(buffer, TELEMETRY_BUFFERED, timestamp, onBattery);
+    putUint16(buffer + BINARY_TELEMETRY_HEADER_SIZE, 0);
+    return BINARY_TELEMETRY_HEADER_SIZE + 2;
+}
+
+size_t addBufferedReading(uint8_t* buffer, size_t capacity, size_t length,
+                          const SensorReading& reading) {
+    if (length + BINARY_BUFFERED_READING_SIZE > capacity)
+        return 0;
+
+    uint8_t* out = buffer + length;
+    putUint32(out, (uint32_t)reading.timestamp);
+    putFloat(out + 4, reading.temperature);
+    putFloat(out + 8, reading.humidity);
+    putFloat(out + 12, reading.accelMagnitude);
+    putFloat(out + 16, reading.gasRatio);
+    putFloat(out + 20, reading.soundLevel);
+    putFloat(out + 24, reading.batteryPercentage);
+
+    uint8_t* count = buffer + BINARY_TELEMETRY_HEADER_SIZE;
+    putUint16(count, getUint16(count) + 1);
+
+    return length + BINARY_BUFFERED_READING_SIZE;
+}
+
+//=====================================================================
+// DECODING
+//=====================================================================
+bool decodeTelemetryHeader(const uint8_t* data, size_t length, TelemetryHeader& header) {
+    if (length < BINARY_TELEMETRY_HEADER_SIZE || data[0] != BINARY_TELEMETRY_MAGIC ||
+        data[1] < 1 || data[1] > BINARY_TELEMETRY_VERSION)
+        return false;
+
+    header.version = data[1];
+    header.type = (TelemetryMessageType)data[2];
+    header.onBattery = (data[3] & 0x01) != 0;
+    header.timestamp = getUint32(data + 4);
+    return true;
+}
+
+bool decodeTelemetrySnapshot(const uint8_t* data, size_t length, TelemetrySnapshot& snapshot) {
+    if (!checkType(data, length, TELEMETRY_SNAPSHOT, BINARY_SNAPSHOT_SIZE))
+        return false;
+
+    float* fields[] = {
+        &snapshot.battery, &snapshot.temperature, &snapshot.humidity, &snapshot.heatIndex,
+        &snapshot.accelX,  &snapshot.accelY,      &snapshot.accelZ,   &snapshot.gyroX,
+        &snapshot.gyroY,   &snapshot.gyroZ,       &snapshot.gasRatio, &snapshot.coPpm,
+        &snapshot.ch4Ppm,  &snapshot.lpgPpm,      &snapshot.soundLevel,
+    };
+
+    const uint8_t* in = data + BINARY_TELEMETRY_HEADER_SIZE;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        *fields[i] = getFloat(in + i * 4);
+    }
+    return true;
+}
+
+bool decodeTelemetryAlert(const uint8_t* data, size_t length, TelemetryAlert& alert) {
+    if (!checkType(data, length, TELEMETRY_ALERT, BINARY_ALERT_SIZE))
+        return false;
+
+    const uint8_t* in = data + BINARY_TELEMETRY_HEADER_SIZE;
+    alert.kind = (TelemetryAlertKind)in[0];
+    alert.sensor = (TelemetrySensor)in[1];
+    alert.value = getFloat(in + 4);
+    alert.aux1 = getFloat(in + 8);
+    alert.aux2 = getFloat(in + 12);
+    return true;
+}
+
+bool decodeTelemetryBatch(const uint8_t* data, size_t length, TelemetryBatch& batch,
+                          float& battery, uint16_t* channels) {
+    if (!checkType(data, length, TELEMETRY_BATCH, BINARY_BATCH_SIZE(0)))
+        return false;
+
+    uint32_t base = getUint32(data + 4);
+    const uint8_t* in = data + BINARY_TELEMETRY_HEADER_SIZE;
+    uint16_t count = getUint16(in);
+    uint16_t present = TELEMETRY_ALL_CHANNELS;
+    if (data[1] >= 2) {
+        present &= ~getUint16(in + 2);
+    }
+
+    int columns = 0;
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        if (present & (1 << channel)) {
+            columns++;
+        }
+    }
+    size_t expected = BINARY_BATCH_SIZE(0) + (size_t)count * 4 * (1 + columns);
+    if (count > TELEMETRY_BATCH_CAPACITY || length < expected)
+        return false;
+
+    battery = getFloat(in + 4);
+    in += 8;
+
+    batch.count = count;
+    for (uint16_t i = 0; i < count; i++, in += 4) {
+        batch.timestamps[i] = base + getUint32(in);
+    }
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        float* values = telemetryBatchColumn(batch, channel);
+        bool included = (present & (1 << channel)) != 0;
+        for (uint16_t i = 0; i < count; i++) {
+            if (included) {
+                values[i] = getFloat(in);
+                in += 4;
+            } else {
+                values[i] = NAN;
+            }
+        }
+    }
+
+    if (channels != NULL) {
+        *channels = present;
+    }
+    return true;
+}
+
+bool decodeTelemetryVibration(const uint8_t* data, size_t length, VibrationFeatures& features) {
+    if (!checkType(data, length, TELEMETRY_VIBRATION, BINARY_VIBRATION_SIZE))
+        return false;
+
+    const uint8_t* in = data + BINARY_TELEMETRY_HEADER_SIZE;
+    features.timestamp = getUint32(data + 4);
+    features.blocks = getUint16(in);
+    features.sampleRate = getFloat(in + 4);
+    features.dominantFrequency = getFloat(in + 8);
+    features.rms = getFloat(in + 12);
+    features.peak = getFloat(in + 16);
+    features.crestFactor = getFloat(in + 20);
+    for (int band = 0; band < VIBRATION_BANDS; band++) {
+        features.bandRms[band] = getFloat(in + 24 + band * 4);
+    }
+    return true;
+}
+
+bool decodeTelemetryAcoustic(const uint8_t* data, size_t length, OctaveLevels& levels) {
+    if (!checkType(data, length, TELEMETRY_ACOUSTIC, BINARY_ACOUSTIC_SIZE))
+        return false;
+
+    const uint8_t* in = data + BINARY_TELEMETRY_HEADER_SIZE;
+    if (getUint16(in) != OCTAVE_BANDS)
+        return false;
+
+    levels.timestamp = getUint32(data + 4);
+    levels.samples = 0;
+    levels.sampleRate = getFloat(in + 4);
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        levels.level[band] = getFloat(in + 8 + band * 4);
+    }
+    return true;
+}
+
+uint16_t bufferedBatchCount(const uint8_t* data, size_t length) {
+    if (!checkType(data, length, TELEMETRY_BUFFERED, BINARY_TELEMETRY_HEADER_SIZE + 2))
+        return 0;
+
+    uint16_t count = getUint16(data + BINARY_TELEMETRY_HEADER_SIZE);
+    if (BINARY_TELEMETRY_HEADER_SIZE + 2 + (size_t)count * BINARY_BUFFERED_READING_SIZE > length)
+        return 0;
+
+    return count;
+}
+
+bool decodeBufferedReading(const uint8_t* data, size_t length, uint16_t index,
+                           SensorReading& reading) {
+    if (index >= bufferedBatchCount(data, length))
+        return false;
+
+    const uint8_t* in =
+        data + BINARY_TELEMETRY_HEADER_SIZE + 2 + (size_t)index * BINARY_BUFFERED_READING_SIZE;
+    reading.timestamp = getUint32(in);
+    reading.temperature = getFloat(in + 4);
+    reading.humidity = getFloat(in + 8);
+    reading.accelMagnitude = getFloat(in + 12);
+    reading.gasRatio = getFloat(in + 16);
+    reading.soundLevel = getFloat(in + 20);
+    reading.batteryPercentage = getFloat(in + 24);
+    return true;
+}
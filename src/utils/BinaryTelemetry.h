@@ -0,0 +1,193 @@
+/*
+ * BinaryTelemetry.h
+ * Compact binary payloads for telemetry, buffered data and alerts
+ *
+ * Selected with {"payload_format": "binary"} on the config topic. The
+ * same file is the decoder library for ingestion: it has no Arduino
+ * dependencies and builds on any little- or big-endian host.
+ *
+ * All multi-byte fields are little endian; floats are IEEE 754 binary32.
+ * The device is identified by the MQTT topic, not inside the payload.
+ *
+ * Header (8 bytes, every message):
+ *   byte 0     magic 0xB7
+ *   byte 1     format version (BINARY_TELEMETRY_VERSION; version 1 had
+ *              no omitted channel mask and is still decoded)
+ *   byte 2     message type (TelemetryMessageType)
+ *   byte 3     flags (bit 0: running on battery)
+ *   bytes 4-7  device uptime in ms when the message was built
+ *
+ * TELEMETRY_SNAPSHOT (header + 60 bytes): 15 floats in this order
+ *   battery %, temperature, humidity, heat index,
+ *   accel x, y, z (g), gyro x, y, z (dps),
+ *   gas Rs/R0, CO ppm, CH4 ppm, LPG ppm, sound level (RMS)
+ *
+ * TELEMETRY_BUFFERED (header + 2 + 28 * n bytes):
+ *   uint16 reading count n, then per reading: uint32 timestamp (ms),
+ *   floats temperature, humidity, accel magnitude, gas Rs/R0,
+ *   sound level, battery %
+ *
+ * TELEMETRY_BATCH (header + 8 + 4 * n * (1 + channels) bytes), header
+ * timestamp = first sample:
+ *   uint16 sample count n, uint16 omitted channel mask, float battery %,
+ *   n uint32 sample offsets from the header timestamp (ms), then n floats
+ *   each of temperature, humidity, accel x, y, z, gyro x, y, z,
+ *   gas Rs/R0, sound level (NaN where a sensor gave no reading).
+ *   Channels whose bit (TelemetryChannel) is set in the mask are left
+ *   out (deadband mode); with a mask of 0 every channel is present.
+ *
+ * TELEMETRY_VIBRATION (header + 40 bytes):
+ *   uint16 FFT blocks averaged, uint16 FFT size, floats sample rate (Hz),
+ *   dominant frequency (Hz), RMS (g), peak (g), crest factor, then one
+ *   float RMS (g) per band, bands as in VIBRATION_BAND_EDGES
+ *
+ * TELEMETRY_ACOUSTIC (header + 8 + 4 * OCTAVE_BANDS bytes):
+ *   uint16 band count, uint16 reserved, float sample rate (Hz), then one
+ *   float level (dBFS) per octave band, lowest first (octaveBandCentre)
+ *
+ * TELEMETRY_ALERT (header + 16 bytes):
+ *   uint8 alert kind (TelemetryAlertKind), uint8 sensor (TelemetrySensor),
+ *   uint16 reserved, float value, float aux1, float aux2
+ *   low battery: value = %, aux1 = voltage
+ *   vibration spike: value = accel magnitude, aux1 = peak, aux2 = RMS vibration
+ *   sound spike: value = sound RMS, aux1 = peak, aux2 = Leq (dBFS)
+ *   anomaly: value, aux1 = window mean, aux2 = window standard deviation
+ *   octave band anomalies report sensor TELEMETRY_SENSOR_OCTAVE_BAND + band
+ */
+
+#ifndef BINARY_TELEMETRY_H
+#define BINARY_TELEMETRY_H
+
+#include "SensorReading.h"
+#include "OctaveBands.h"
+#include "TelemetryBatch.h"
+#include "VibrationSpectrum.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//=====================================================================
+// CONSTANTS
+//=====================================================================
+#define BINARY_TELEMETRY_MAGIC 0xB7
+#define BINARY_TELEMETRY_VERSION 2
+#define BINARY_TELEMETRY_HEADER_SIZE 8
+#define BINARY_SNAPSHOT_SIZE (BINARY_TELEMETRY_HEADER_SIZE + 60)
+#define BINARY_BUFFERED_READING_SIZE 28
+#define BINARY_ALERT_SIZE (BINARY_TELEMETRY_HEADER_SIZE + 16)
+#define BINARY_VIBRATION_SIZE (BINARY_TELEMETRY_HEADER_SIZE + 24 + 4 * VIBRATION_BANDS)
+#define BINARY_ACOUSTIC_SIZE (BINARY_TELEMETRY_HEADER_SIZE + 8 + 4 * OCTAVE_BANDS)
+#define BINARY_BATCH_SAMPLE_SIZE 44
+// Largest batch message, with every channel present
+#define BINARY_BATCH_SIZE(n) \
+    (BINARY_TELEMETRY_HEADER_SIZE + 8 + (size_t)(n) * BINARY_BATCH_SAMPLE_SIZE)
+
+enum TelemetryMessageType : uint8_t {
+    TELEMETRY_SNAPSHOT = 1,
+    TELEMETRY_BUFFERED = 2,
+    TELEMETRY_ALERT = 3,
+    TELEMETRY_BATCH = 4,
+    TELEMETRY_VIBRATION = 5,
+    TELEMETRY_ACOUSTIC = 6,
+};
+
+enum TelemetryAlertKind : uint8_t {
+    ALERT_LOW_BATTERY = 1,
+    ALERT_VIBRATION_SPIKE = 2,
+    ALERT_SOUND_SPIKE = 3,
+    ALERT_ANOMALY = 4,
+};
+
+enum TelemetrySensor : uint8_t {
+    TELEMETRY_SENSOR_NONE = 0,
+    TELEMETRY_SENSOR_TEMPERATURE = 1,
+    TELEMETRY_SENSOR_HUMIDITY = 2,
+    TELEMETRY_SENSOR_ACCEL = 3,
+    TELEMETRY_SENSOR_GAS = 4,
+    TELEMETRY_SENSOR_SOUND = 5,
+    TELEMETRY_SENSOR_BATTERY = 6,
+    TELEMETRY_SENSOR_OCTAVE_BAND = 16, // First of OCTAVE_BANDS values
+};
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct TelemetryHeader {
+    uint8_t version;
+    TelemetryMessageType type;
+    bool onBattery;
+    uint32_t timestamp;
+};
+
+struct TelemetrySnapshot {
+    float battery;
+    float temperature;
+    float humidity;
+    float heatIndex;
+    float accelX, accelY, accelZ;
+    float gyroX, gyroY, gyroZ;
+    float gasRatio;
+    float coPpm;
+    float ch4Ppm;
+    float lpgPpm;
+    float soundLevel;
+};
+
+struct TelemetryAlert {
+    TelemetryAlertKind kind;
+    TelemetrySensor sensor;
+    float value;
+    float aux1;
+    float aux2;
+};
+
+//=====================================================================
+// ENCODING (DEVICE)
+//=====================================================================
+// Each returns the number of bytes written, or 0 if the buffer is too small
+size_t encodeTelemetrySnapshot(uint8_t* buffer, size_t capacity, uint32_t timestamp,
+                               bool onBattery, const TelemetrySnapshot& snapshot);
+
+size_t encodeTelemetryAlert(uint8_t* buffer, size_t capacity, uint32_t timestamp,
+                            bool onBattery, const TelemetryAlert& alert);
+
+// Only the channels in mask are written
+size_t encodeTelemetryBatch(uint8_t* buffer, size_t capacity, bool onBattery, float battery,
+                            const TelemetryBatch& batch,
+                            uint16_t channels = TELEMETRY_ALL_CHANNELS);
+
+size_t encodeTelemetryVibration(uint8_t* buffer, size_t capacity, bool onBattery,
+                                const VibrationFeatures& features);
+
+size_t encodeTelemetryAcoustic(uint8_t* buffer, size_t capacity, bool onBattery,
+                               const OctaveLevels& levels);
+
+// Buffered readings are appended one by one after the header
+size_t beginBufferedBatch(uint8_t* buffer, size_t capacity, uint32_t timestamp, bool onBattery);
+size_t addBufferedReading(uint8_t* buffer, size_t capacity, size_t length,
+                          const SensorReading& reading);
+
+//=====================================================================
+// DECODING (INGESTION)
+//=====================================================================
+bool decodeTelemetryHeader(const uint8_t* data, size_t length, TelemetryHeader& header);
+
+bool decodeTelemetrySnapshot(const uint8_t* data, size_t length, TelemetrySnapshot& snapshot);
+
+bool decodeTelemetryAlert(const uint8_t* data, size_t length, TelemetryAlert& alert);
+
+// Timestamps in the decoded batch are absolute again; omitted channels
+// read as NaN and are cleared in channels if given
+bool decodeTelemetryBatch(const uint8_t* data, size_t length, TelemetryBatch& batch,
+                          float& battery, uint16_t* channels = NULL);
+
+bool decodeTelemetryVibration(const uint8_t* data, size_t length, VibrationFeatures& features);
+
+bool decodeTelemetryAcoustic(const uint8_t* data, size_t length, OctaveLevels& levels);
+
+// Number of readings in a buffered batch, 0 if malformed
+uint16_t bufferedBatchCount(const uint8_t* data, size_t length);
+
+bool decodeBufferedReading(const uint8_t* data, size_t length, uint16_t index,
+                           SensorReading& reading);
+
+#endif // BINARY_TELEMETRY_H
@@ -0,0 +1,91 @@
+/*
+ * ChannelSchedule.cpp
+ * Sensor channel scheduling implementation
+ */
+
+#include "ChannelSchedule.h"
+#include <string.h>
+
+const char* const SENSOR_CHANNEL_NAMES[SENSOR_CHANNELS] = {
+    "environment",
+    "motion",
+    "gas",
+    "sound",
+};
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+// Wrap-safe: true once now is at or past time
+static bool timeReached(unsigned long now, unsigned long time) {
+    return (long)(now - time) >= 0;
+}
+
+//=====================================================================
+// SCHEDULE
+//=====================================================================
+void channelScheduleBegin(ChannelSchedule& schedule, unsigned long now) {
+    memset(&schedule, 0, sizeof(schedule));
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        schedule.nextDue[channel] = now;
+        schedule.lastRead[channel] = now;
+    }
+}
+
+void channelScheduleSetInterval(ChannelSchedule& schedule, uint8_t channel,
+                                unsigned long interval, unsigned long now) {
+    if (channel >= SENSOR_CHANNELS || interval == 0 || schedule.interval[channel] == interval)
+        return;
+
+    // Before the first read the channel stays due straight away
+    bool started = schedule.interval[channel] != 0;
+    schedule.interval[channel] = interval;
+    if (started) {
+        schedule.nextDue[channel] = schedule.lastRead[channel] + interval;
+        if (timeReached(now, schedule.nextDue[channel])) {
+            schedule.nextDue[channel] = now;
+        }
+    }
+}
+
+uint8_t channelScheduleTake(ChannelSchedule& schedule, unsigned long now) {
+    uint8_t due = 0;
+
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        unsigned long interval = schedule.interval[channel];
+        if (interval == 0 || !timeReached(now, schedule.nextDue[channel]))
+            continue;
+
+        unsigned long late = now - schedule.nextDue[channel];
+        if (late > schedule.maxLate[channel]) {
+            schedule.maxLate[channel] = late;
+        }
+
+        due |= 1 << channel;
+        schedule.reads[channel]++;
+        schedule.lastRead[channel] = now;
+
+        // Skip whole periods already past instead of bursting
+        unsigned long skipped = late / interval;
+        schedule.missed[channel] += skipped;
+        schedule.nextDue[channel] += (skipped + 1) * interval;
+    }
+    return due;
+}
+
+unsigned long channelScheduleUntilNext(const ChannelSchedule& schedule, unsigned long now) {
+    unsigned long wait = (unsigned long)-1;
+
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        if (schedule.interval[channel] == 0)
+            continue;
+        if (timeReached(now, schedule.nextDue[channel]))
+            return 0;
+
+        unsigned long untilDue = schedule.nextDue[channel] - now;
+        if (untilDue < wait) {
+            wait = untilDue;
+        }
+    }
+    return wait;
+}
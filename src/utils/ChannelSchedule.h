@@ -0,0 +1,73 @@
+/*
+ * ChannelSchedule.h
+ * Independent read intervals for the sensor channels
+ *
+ * Each channel has its own interval and due time. Due times advance by
+ * whole intervals from the first read, so channels whose intervals are
+ * multiples of each other stay in phase and are read in the same pass,
+ * into one sample; a pass reads only the channels that are due. A
+ * channel that falls behind skips the periods it missed rather than
+ * reading in a burst.
+ *
+ * No Arduino dependencies, so the scheduling can be run on a host
+ * against a fake clock.
+ */
+
+#ifndef CHANNEL_SCHEDULE_H
+#define CHANNEL_SCHEDULE_H
+
+#include "Constants.h"
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SENSOR_INTERVAL_MIN 10 // ms, shortest channel interval accepted from config
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Bits of a channel mask, and indices of config.channelInterval
+enum SensorChannel : uint8_t {
+    SENSOR_ENVIRONMENT, // DHT11 temperature and humidity
+    SENSOR_MOTION,      // IMU acceleration, rotation and vibration
+    SENSOR_GAS,
+    SENSOR_SOUND,
+};
+
+struct ChannelSchedule {
+    unsigned long interval[SENSOR_CHANNELS]; // ms, 0 until first set
+    unsigned long nextDue[SENSOR_CHANNELS];
+    unsigned long lastRead[SENSOR_CHANNELS];
+
+    // Statistics since begin
+    uint32_t reads[SENSOR_CHANNELS];
+    uint32_t missed[SENSOR_CHANNELS];       // Whole intervals skipped
+    unsigned long maxLate[SENSOR_CHANNELS]; // ms, read time minus due time
+};
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+// Config key prefix of each channel ("<name>_interval")
+extern const char* const SENSOR_CHANNEL_NAMES[SENSOR_CHANNELS];
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Every channel due at now, once its interval is set
+void channelScheduleBegin(ChannelSchedule& schedule, unsigned long now);
+
+// Change a channel's interval. The next read is re-based on the last one,
+// or due at now if that time has already passed.
+void channelScheduleSetInterval(ChannelSchedule& schedule, uint8_t channel,
+                                unsigned long interval, unsigned long now);
+
+// Mask of the channels due at now. Their due times move on, so the
+// caller must read every channel returned.
+uint8_t channelScheduleTake(ChannelSchedule& schedule, unsigned long now);
+
+// ms until the next channel is due, 0 if one already is
+unsigned long channelScheduleUntilNext(const ChannelSchedule& schedule, unsigned long now);
+
+#endif // CHANNEL_SCHEDULE_H
@@ -4,17 +4,227 @@
  */
 
 #include "Communication.h"
+#include "Buffer.h"
+#include "ChannelSchedule.h"
 #include "Config.h"
+#include "Deadband.h"
+#include "DhtPio.h"
+#include "HealthMetrics.h"
+#include "LedPatterns.h"
+#include "LineProtocol.h"
+#include "Network.h"
+#include "Pipeline.h"
+#include "PowerSave.h"
+#include "Profiler.h"
+#include "Scheduler.h"
 #include "Sensors.h"
-#include <ArduinoJson.h>
+#include "TelemetryBatch.h"
 
 //=====================================================================
 // EXTERNAL VARIABLES
 //=====================================================================
 // From Network.cpp
-extern PubSubClient mqttClient;
 extern bool networkConnected;
 
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+// Last reported value and time of each telemetry channel
+static DeadbandState deadbandState;
+
+//=====================================================================
+// BINARY PAYLOADS
+//=====================================================================
+bool binaryPayloadsEnabled() {
+    return config.payloadFormat == PAYLOAD_FORMAT_BINARY;
+}
+
+bool publishBinaryAlert(const char* topic, TelemetryAlertKind kind, TelemetrySensor sensor,
+                        float value, float aux1, float aux2) {
+    TelemetryAlert alert;
+    alert.kind = kind;
+    alert.sensor = sensor;
+    alert.value = value;
+    alert.aux1 = aux1;
+    alert.aux2 = aux2;
+
+    uint8_t payload[BINARY_ALERT_SIZE];
+    size_t length = encodeTelemetryAlert(payload, sizeof(payload), millis(), isOnBattery, alert);
+    return outboundQueue(topic, payload, length);
+}
+
+static bool publishBinarySnapshot() {
+    TelemetrySnapshot snapshot;
+    snapshot.battery = batteryPercentage;
+    snapshot.temperature = temperature;
+    snapshot.humidity = humidity;
+    snapshot.heatIndex = heatIndex;
+    snapshot.accelX = Ax;
+    snapshot.accelY = Ay;
+    snapshot.accelZ = Az;
+    snapshot.gyroX = Gx;
+    snapshot.gyroY = Gy;
+    snapshot.gyroZ = Gz;
+    snapshot.gasRatio = gasRatio;
+    snapshot.coPpm = coPpmFromAdc(gasAdc);
+    snapshot.ch4Ppm = ch4PpmFromAdc(gasAdc);
+    snapshot.lpgPpm = lpgPpmFromAdc(gasAdc);
+    snapshot.soundLevel = soundLevel;
+
+    uint8_t payload[BINARY_SNAPSHOT_SIZE];
+    size_t length =
+        encodeTelemetrySnapshot(payload, sizeof(payload), millis(), isOnBattery, snapshot);
+    return mqttClient.publish(MQTT_TOPIC_BASE, payload, length);
+}
+
+static bool publishBinaryBatch(uint16_t channels) {
+    // Static: a full batch is too large for the stack, and too large for
+    // PubSubClient's packet buffer, so it is streamed with beginPublish
+    static uint8_t payload[BINARY_BATCH_SIZE(TELEMETRY_BATCH_CAPACITY)];
+    size_t length = encodeTelemetryBatch(payload, sizeof(payload), isOnBattery, batteryPercentage,
+                                         telemetryBatch, channels);
+
+    if (length == 0 || !mqttClient.beginPublish(MQTT_TOPIC_BASE, length, false))
+        return false;
+
+    mqttClient.write(payload, length);
+    return mqttClient.endPublish();
+}
+
+//=====================================================================
+// INFLUXDB LINE PROTOCOL
+//=====================================================================
+// Measurement, field and decimals of each telemetry channel. Channels of
+// one measurement are adjacent, so a batch sample is one point each.
+struct InfluxChannel {
+    const char* measurement;
+    const char* field;
+    uint8_t decimals;
+};
+
+static const InfluxChannel INFLUX_CHANNELS[TELEMETRY_CHANNELS] = {
+    {"environment", "temperature", 2},
+    {"environment", "humidity", 2},
+    {"imu", "accel_x", 4},
+    {"imu", "accel_y", 4},
+    {"imu", "accel_z", 4},
+    {"imu", "gyro_x", 3},
+    {"imu", "gyro_y", 3},
+    {"imu", "gyro_z", 3},
+    {"gas", "rs_ratio", 3},
+    {"sound", "level", 1},
+};
+
+static void writeInfluxBattery(LineProtocolWriter& influx, unsigned long timestamp) {
+    influx.beginLine("battery");
+    influx.field("percentage", batteryPercentage, 1);
+    influx.field("voltage", batteryVoltage, 3);
+    influx.field("on_battery", isOnBattery);
+    influx.endLine(timestamp);
+}
+
+// Every channel of the current readings as one point per measurement
+static bool publishInfluxSnapshot(unsigned long timestamp) {
+    LineProtocolWriter influx(mqttClient, MQTT_INFLUX_TOPIC, config.influxMessageSize);
+
+    influx.beginLine("environment");
+    influx.field("temperature", temperature, 2);
+    influx.field("humidity", humidity, 2);
+    influx.field("heat_index", heatIndex, 2);
+    influx.endLine(timestamp);
+
+    influx.beginLine("imu");
+    influx.field("accel_x", Ax, 4);
+    influx.field("accel_y", Ay, 4);
+    influx.field("accel_z", Az, 4);
+    influx.field("accel_magnitude", sqrtf(Ax * Ax + Ay * Ay + Az * Az), 4);
+    influx.field("vibration_peak", vibrationPeak, 4);
+    influx.field("vibration_rms", vibrationRms, 4);
+    influx.field("gyro_x", Gx, 3);
+    influx.field("gyro_y", Gy, 3);
+    influx.field("gyro_z", Gz, 3);
+    influx.endLine(timestamp);
+
+    influx.beginLine("gas");
+    influx.field("rs_ratio", gasRatio, 3);
+    influx.field("co_ppm", coPpmFromAdc(gasAdc), 1);
+    influx.field("ch4_ppm", ch4PpmFromAdc(gasAdc), 1);
+    influx.field("lpg_ppm", lpgPpmFromAdc(gasAdc), 1);
+    influx.endLine(timestamp);
+
+    influx.beginLine("sound");
+    influx.field("level", soundLevel, 1);
+    influx.field("peak", soundPeak, 1);
+    influx.field("leq", soundLeq, 1);
+    influx.endLine(timestamp);
+
+    writeInfluxBattery(influx, timestamp);
+    return influx.finish();
+}
+
+// Every sample of a batch at its own time, for the channels sent. Without
+// the time they would all land at the arrival time, so only the newest goes.
+static bool publishInfluxBatch(const TelemetryBatch& batch, uint16_t channels) {
+    LineProtocolWriter influx(mqttClient, MQTT_INFLUX_TOPIC, config.influxMessageSize);
+
+    uint16_t first = influx.timestamped() ? 0 : batch.count - 1;
+    for (uint16_t i = first; i < batch.count; i++) {
+        const char* measurement = NULL;
+        for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+            const InfluxChannel& influxChannel = INFLUX_CHANNELS[channel];
+            if (influxChannel.measurement != measurement) {
+                if (measurement != NULL) {
+                    influx.endLine(batch.timestamps[i]);
+                }
+                measurement = influxChannel.measurement;
+                influx.beginLine(measurement);
+            }
+
+            if (channels & (1 << channel)) {
+                influx.field(influxChannel.field, telemetryBatchColumn(batch, channel)[i],
+                             influxChannel.decimals);
+            }
+        }
+        influx.endLine(batch.timestamps[i]);
+    }
+
+    writeInfluxBattery(influx, batch.timestamps[batch.count - 1]);
+    return influx.finish();
+}
+
+size_t publishInfluxReadings(const SensorReading* readings, int count,
+                             const EpochReference& clock) {
+    LineProtocolWriter influx(mqttClient, MQTT_INFLUX_TOPIC, config.influxMessageSize);
+    influx.setClock(clock);
+
+    for (int i = 0; i < count; i++) {
+        const SensorReading& reading = readings[i];
+
+        influx.beginLine("environment");
+        influx.field("temperature", reading.temperature, 2);
+        influx.field("humidity", reading.humidity, 2);
+        influx.endLine(reading.timestamp);
+
+        influx.beginLine("imu");
+        influx.field("accel_magnitude", reading.accelMagnitude, 4);
+        influx.endLine(reading.timestamp);
+
+        influx.beginLine("gas");
+        influx.field("rs_ratio", reading.gasRatio, 3);
+        influx.endLine(reading.timestamp);
+
+        influx.beginLine("sound");
+        influx.field("level", reading.soundLevel, 1);
+        influx.endLine(reading.timestamp);
+
+        influx.beginLine("battery");
+        influx.field("percentage", reading.batteryPercentage, 1);
+        influx.endLine(reading.timestamp);
+    }
+
+    return influx.finish() ? influx.length() : 0;
+}
+
 //=====================================================================
 // MQTT PUBLISHING FUNCTIONS
 //=====================================================================
@@ -22,70 +232,122 @@ void publishDeviceStatus() {
     if (!networkConnected)
         return;
 
-    StaticJsonDocument<512> jsonDoc;
-    jsonDoc["device_id"] = MQTT_CLIENT_ID;
-    jsonDoc["status"] = "online";
-    jsonDoc["firmware_version"] = "1.1.0";
-    jsonDoc["battery"] = batteryPercentage;
-
-    JsonObject configObj = jsonDoc.createNestedObject("config");
-    configObj["accel_threshold"] = config.accelSpikeThreshold;
-    configObj["sound_threshold"] = config.soundSpikeThreshold;
-    configObj["sensor_interval"] = config.sensorReadInterval;
-    configObj["publish_interval"] = config.mqttPublishInterval;
-    configObj["anomaly_detection"] = config.anomalyDetectionEnabled;
-    configObj["buffer_size"] = config.offlineBufferSize;
+    publishJson(
+        MQTT_STATUS_TOPIC,
+        [](JsonStream& json) {
+            json.beginObject();
+            json.field("device_id", MQTT_CLIENT_ID);
+            json.field("status", "online");
+            json.field("firmware_version", "1.1.0");
+            json.field("battery", batteryPercentage);
 
-    char jsonBuffer[512];
-    serializeJson(jsonDoc, jsonBuffer);
-    mqttClient.publish(MQTT_STATUS_TOPIC, jsonBuffer, true);
+            json.beginObject("config");
+            json.field("accel_threshold", config.accelSpikeThreshold);
+            json.field("sound_threshold", config.soundSpikeThreshold);
+            json.field("sensor_interval", config.sensorReadInterval);
+            json.field("publish_interval", config.mqttPublishInterval);
+            json.field("anomaly_detection", config.anomalyDetectionEnabled);
+            json.field("buffer_size", config.offlineBufferSize);
+            json.field("batch_size", config.telemetryBatchSize);
+            json.field("imu_fifo", config.imuFifoEnabled);
+            json.field("payload_format", binaryPayloadsEnabled() ? "binary" : "json");
+            json.field("deadband", config.deadbandEnabled);
+            json.field("heartbeat_interval", config.heartbeatInterval);
+            for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+                char key[32];
+                snprintf(key, sizeof(key), "deadband_%s", TELEMETRY_CHANNEL_NAMES[channel]);
+                json.field(key, config.deadbandAbsolute[channel]);
+                strncat(key, "_pct", sizeof(key) - strlen(key) - 1);
+                json.field(key, config.deadbandPercent[channel], 1);
+            }
+            json.field("adaptive_sampling", config.adaptiveSamplingEnabled);
+            json.field("min_interval", config.minSensorReadInterval);
+            json.field("max_interval", config.maxSensorReadInterval);
+            json.field("quiet_reads", (unsigned int)config.adaptiveQuietReads);
+            json.field("activity_threshold", config.activityThreshold, 2);
+            json.field("power_save", powerSaveModeName(config.powerSaveMode));
+            json.field("upload_interval", config.uploadInterval);
+            json.field("drain_rate", config.drainRate);
+            json.field("influx_message_size", (unsigned int)config.influxMessageSize);
+            for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+                char key[32];
+                snprintf(key, sizeof(key), "%s_interval", SENSOR_CHANNEL_NAMES[channel]);
+                json.field(key, config.channelInterval[channel]);
+            }
+            json.endObject();
+            json.endObject();
+        },
+        true);
 }
 
 void publishLowBatteryAlert() {
-    if (!networkConnected)
-        return;
-
-    StaticJsonDocument<256> jsonDoc;
-    jsonDoc["device_id"] = MQTT_CLIENT_ID;
-    jsonDoc["alert"] = "low_battery";
-    jsonDoc["battery_percentage"] = batteryPercentage;
-    jsonDoc["battery_voltage"] = batteryVoltage;
+    unsigned long timestamp = millis();
 
-    char jsonBuffer[256];
-    serializeJson(jsonDoc, jsonBuffer);
-    mqttClient.publish(MQTT_ALERTS_TOPIC, jsonBuffer);
+    if (binaryPayloadsEnabled()) {
+        publishBinaryAlert(MQTT_ALERTS_TOPIC, ALERT_LOW_BATTERY, TELEMETRY_SENSOR_BATTERY,
+                           batteryPercentage, batteryVoltage);
+    } else {
+        queueJson(MQTT_ALERTS_TOPIC, [&](JsonStream& json, uint32_t sequence) {
+            json.beginObject();
+            json.field("device_id", MQTT_CLIENT_ID);
+            json.field("seq", (unsigned long)sequence);
+            json.field("timestamp", timestamp);
+            json.field("alert", "low_battery");
+            json.field("battery_percentage", batteryPercentage);
+            json.field("battery_voltage", batteryVoltage);
+            json.endObject();
+        });
+    }
 
-    Serial.println("Low battery alert published");
+    Serial.println("Low battery alert queued");
 }
 
 void publishSpikeAlert() {
-    if (!networkConnected)
-        return;
-
-    StaticJsonDocument<256> jsonDoc;
-    jsonDoc["device_id"] = MQTT_CLIENT_ID;
-    jsonDoc["timestamp"] = millis();
+    unsigned long timestamp = millis();
+    bool binary = binaryPayloadsEnabled();
 
     if (vibrationSpikeDetected) {
-        jsonDoc["alert"] = "vibration_spike";
-        jsonDoc["acceleration_magnitude"] = sqrt(Ax * Ax + Ay * Ay + Az * Az);
+        float magnitude = sqrt(Ax * Ax + Ay * Ay + Az * Az);
 
-        char jsonBuffer[256];
-        serializeJson(jsonDoc, jsonBuffer);
-        mqttClient.publish(MQTT_ALERTS_TOPIC, jsonBuffer);
+        if (binary) {
+            publishBinaryAlert(MQTT_ALERTS_TOPIC, ALERT_VIBRATION_SPIKE, TELEMETRY_SENSOR_ACCEL,
+                               magnitude, vibrationPeak, vibrationRms);
+        } else {
+            queueJson(MQTT_ALERTS_TOPIC, [&](JsonStream& json, uint32_t sequence) {
+                json.beginObject();
+                json.field("device_id", MQTT_CLIENT_ID);
+                json.field("seq", (unsigned long)sequence);
+                json.field("timestamp", timestamp);
+                json.field("alert", "vibration_spike");
+                json.field("acceleration_magnitude", magnitude);
+                json.field("vibration_peak", vibrationPeak);
+                json.field("vibration_rms", vibrationRms);
+                json.endObject();
+            });
+        }
 
-        Serial.println("Vibration spike alert published");
+        Serial.println("Vibration spike alert queued");
     }
 
     if (soundSpikeDetected) {
-        jsonDoc["alert"] = "sound_spike";
-        jsonDoc["sound_level"] = soundLevel;
-
-        char jsonBuffer[256];
-        serializeJson(jsonDoc, jsonBuffer);
-        mqttClient.publish(MQTT_ALERTS_TOPIC, jsonBuffer);
+        if (binary) {
+            publishBinaryAlert(MQTT_ALERTS_TOPIC, ALERT_SOUND_SPIKE, TELEMETRY_SENSOR_SOUND,
+                               soundLevel, soundPeak, soundLeq);
+        } else {
+            queueJson(MQTT_ALERTS_TOPIC, [&](JsonStream& json, uint32_t sequence) {
+                json.beginObject();
+                json.field("device_id", MQTT_CLIENT_ID);
+                json.field("seq", (unsigned long)sequence);
+                json.field("timestamp", timestamp);
+                json.field("alert", "sound_spike");
+                json.field("sound_level", soundLevel);
+                json.field("sound_peak", soundPeak);
+                json.field("sound_leq", soundLeq);
+                json.endObject();
+            });
+        }
 
-        Serial.println("Sound spike alert published");
+        Serial.println("Sound spike alert queued");
     }
 }
 
@@ -93,56 +355,472 @@ void publishToMQTT() {
     if (!networkConnected || !mqttClient.connected())
         return;
 
-    StaticJsonDocument<768> jsonDoc;
+    PROFILE_SCOPE(PROFILE_PUBLISH);
 
-    jsonDoc["device_id"] = MQTT_CLIENT_ID;
-    jsonDoc["timestamp"] = millis();
-    jsonDoc["battery"] = batteryPercentage;
-    jsonDoc["on_battery"] = isOnBattery;
-
-    JsonObject envData = jsonDoc.createNestedObject("environment");
-    envData["temperature"] = temperature;
-    envData["humidity"] = humidity;
-    envData["heat_index"] = heatIndex;
+    // Read the clock once: the payload is emitted twice and must not change
+    unsigned long timestamp = millis();
+    bool published;
 
-    JsonObject imuData = jsonDoc.createNestedObject("imu");
-    imuData["accel_x"] = Ax;
-    imuData["accel_y"] = Ay;
-    imuData["accel_z"] = Az;
-    imuData["accel_magnitude"] = sqrt(Ax * Ax + Ay * Ay + Az * Az);
-    imuData["gyro_x"] = Gx;
-    imuData["gyro_y"] = Gy;
-    imuData["gyro_z"] = Gz;
+    if (binaryPayloadsEnabled()) {
+        published = publishBinarySnapshot();
+    } else {
+        published = publishJson(MQTT_TOPIC_BASE, [&](JsonStream& json) {
+            json.beginObject();
+            json.field("device_id", MQTT_CLIENT_ID);
+            json.field("timestamp", timestamp);
+            json.field("battery", batteryPercentage);
+            json.field("on_battery", isOnBattery);
 
-    JsonObject gasData = jsonDoc.createNestedObject("gas");
-    gasData["rs_ratio"] = gasRatio;
-    gasData["co_ppm"] = getCO_ppm(gasRatio);
-    gasData["ch4_ppm"] = getCH4_ppm(gasRatio);
-    gasData["lpg_ppm"] = getLPG_ppm(gasRatio);
+            json.beginObject("environment");
+            json.field("temperature", temperature);
+            json.field("humidity", humidity);
+            json.field("heat_index", heatIndex);
+            json.endObject();
 
-    JsonObject soundData = jsonDoc.createNestedObject("sound");
-    soundData["level"] = soundLevel;
+            json.beginObject("imu");
+            json.field("accel_x", Ax);
+            json.field("accel_y", Ay);
+            json.field("accel_z", Az);
+            json.field("accel_magnitude", sqrt(Ax * Ax + Ay * Ay + Az * Az));
+            json.field("vibration_peak", vibrationPeak);
+            json.field("vibration_rms", vibrationRms);
+            json.field("gyro_x", Gx);
+            json.field("gyro_y", Gy);
+            json.field("gyro_z", Gz);
+            json.endObject();
 
-    char jsonBuffer[768];
-    serializeJson(jsonDoc, jsonBuffer);
+            json.beginObject("gas");
+            json.field("rs_ratio", gasRatio);
+            json.field("co_ppm", coPpmFromAdc(gasAdc));
+            json.field("ch4_ppm", ch4PpmFromAdc(gasAdc));
+            json.field("lpg_ppm", lpgPpmFromAdc(gasAdc));
+            json.endObject();
 
-    bool published = mqttClient.publish(MQTT_TOPIC_BASE, jsonBuffer);
+            json.beginObject("sound");
+            json.field("level", soundLevel);
+            json.field("peak", soundPeak);
+            json.field("leq", soundLeq);
+            json.endObject();
+            json.endObject();
+        });
+    }
 
     if (published) {
-        digitalWrite(LEDG, HIGH);
-        delay(LED_BLINK_SHORT);
-        digitalWrite(LEDG, LOW);
+        startLedPattern(LEDG, 1, LED_BLINK_SHORT, 0);
+    }
+
+    publishInfluxSnapshot(timestamp);
+}
+
+void resetTelemetryDeadband() {
+    deadbandReset(deadbandState);
+}
+
+bool publishTelemetryBatch() {
+    if (!networkConnected || !mqttClient.connected() || telemetryBatch.count == 0)
+        return false;
+
+    // Alerts waiting in the outbound queue go first
+    if (!outboundService())
+        return false;
+
+    PROFILE_SCOPE(PROFILE_PUBLISH_BATCH);
+
+    const TelemetryBatch& batch = telemetryBatch;
+    unsigned long now = millis();
+    bool published;
+
+    uint16_t channels = TELEMETRY_ALL_CHANNELS;
+    if (config.deadbandEnabled) {
+        channels = deadbandSelect(deadbandState, batch, config.deadbandAbsolute,
+                                  config.deadbandPercent, config.heartbeatInterval, now);
+
+        // Nothing moved and no heartbeat due: the window needs no message
+        if (channels == 0) {
+            telemetryBatchClear();
+            return true;
+        }
+    }
+
+    if (binaryPayloadsEnabled()) {
+        published = publishBinaryBatch(channels);
+    } else {
+        published = publishJson(MQTT_TOPIC_BASE, [&](JsonStream& json) {
+            unsigned long base = batch.timestamps[0];
+
+            json.beginObject();
+            json.field("device_id", MQTT_CLIENT_ID);
+            json.field("timestamp", base);
+            json.field("battery", batteryPercentage);
+            json.field("on_battery", isOnBattery);
+            json.field("count", (unsigned int)batch.count);
+
+            // Sample times as ms offsets from the timestamp above
+            json.beginArray("t");
+            for (uint16_t i = 0; i < batch.count; i++) {
+                json.element((unsigned long)(batch.timestamps[i] - base));
+            }
+            json.endArray();
+
+            // Channels left out by the deadband are simply absent
+            for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+                if ((channels & (1 << channel)) == 0)
+                    continue;
+
+                const float* values = telemetryBatchColumn(batch, channel);
+                json.beginArray(TELEMETRY_CHANNEL_NAMES[channel]);
+                for (uint16_t i = 0; i < batch.count; i++) {
+                    json.element(values[i]);
+                }
+                json.endArray();
+            }
+            json.endObject();
+        });
+    }
+
+    if (!published)
+        return false;
+
+    // Samples stay batched until the broker has taken them
+    deadbandCommit(deadbandState, batch, channels, now);
+    publishInfluxBatch(batch, channels);
+    telemetryBatchClear();
+    startLedPattern(LEDG, 1, LED_BLINK_SHORT, 0);
+    return true;
+}
+
+bool publishVibrationFeatures(const VibrationFeatures& features) {
+    if (!networkConnected || !mqttClient.connected())
+        return false;
+
+    if (binaryPayloadsEnabled()) {
+        uint8_t payload[BINARY_VIBRATION_SIZE];
+        size_t length = encodeTelemetryVibration(payload, sizeof(payload), isOnBattery, features);
+        return mqttClient.publish(MQTT_VIBRATION_TOPIC, payload, length);
     }
 
-    // Publish in InfluxDB line protocol format
+    return publishJson(MQTT_VIBRATION_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("timestamp", features.timestamp);
+        json.field("sample_rate", features.sampleRate, 1);
+        json.field("fft_size", VIBRATION_FFT_SIZE);
+        json.field("blocks", (unsigned int)features.blocks);
+        json.field("dominant_frequency", features.dominantFrequency, 2);
+        json.field("rms", features.rms, 4);
+        json.field("peak", features.peak, 4);
+        json.field("crest_factor", features.crestFactor, 2);
+
+        json.beginArray("bands");
+        for (int band = 0; band < VIBRATION_BANDS; band++) {
+            json.beginObject();
+            json.field("low_hz", VIBRATION_BAND_EDGES[band], 1);
+            json.field("high_hz", band + 1 < VIBRATION_BANDS ? VIBRATION_BAND_EDGES[band + 1]
+                                                             : features.sampleRate / 2,
+                       1);
+            json.field("rms", features.bandRms[band], 4);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    });
+}
+
+bool publishOctaveLevels(const OctaveLevels& levels) {
+    if (!networkConnected || !mqttClient.connected())
+        return false;
+
+    if (binaryPayloadsEnabled()) {
+        uint8_t payload[BINARY_ACOUSTIC_SIZE];
+        size_t length = encodeTelemetryAcoustic(payload, sizeof(payload), isOnBattery, levels);
+        return mqttClient.publish(MQTT_ACOUSTIC_TOPIC, payload, length);
+    }
+
+    return publishJson(MQTT_ACOUSTIC_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("timestamp", levels.timestamp);
+        json.field("sample_rate", levels.sampleRate, 1);
+        json.field("samples", (unsigned long)levels.samples);
+
+        json.beginArray("bands");
+        for (int band = 0; band < OCTAVE_BANDS; band++) {
+            json.beginObject();
+            json.field("centre_hz", octaveBandCentre(levels.sampleRate, band), 1);
+            json.field("level_dbfs", levels.level[band], 1);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    });
+}
+
+static float ratio(unsigned long part, unsigned long whole) {
+    return whole > 0 ? (float)part / whole : 1.0f;
+}
+
+static void writePowerSaveStats(JsonStream& json, const PowerSaveStats& power) {
+    json.field("mode", powerSaveModeName(config.powerSaveMode));
+    json.field("active", power.active);
+    json.field("period_ms", power.elapsed);
+    json.field("awake_ratio_core0", 1.0f - ratio(power.asleep[0], power.elapsed), 3);
+#if SENSORHUB_DUAL_CORE
+    json.field("awake_ratio_core1", 1.0f - ratio(power.asleep[1], power.elapsed), 3);
+#endif
+    json.field("radio_on_ratio", ratio(power.radioOn, power.elapsed), 3);
+    json.field("sleeps", (unsigned long)power.sleeps);
+    json.field("motion_wakes", (unsigned long)power.motionWakes);
+    json.field("upload_windows", (unsigned long)power.uploadWindows);
+}
+
+static void writeNetworkStats(JsonStream& json, const NetworkStats& network) {
+    json.field("wifi_attempts", (unsigned long)network.wifiAttempts);
+    json.field("wifi_failures", (unsigned long)network.wifiFailures);
+    json.field("wifi_drops", (unsigned long)network.wifiDrops);
+    json.field("mqtt_attempts", (unsigned long)network.mqttAttempts);
+    json.field("mqtt_failures", (unsigned long)network.mqttFailures);
+    json.field("mqtt_drops", (unsigned long)network.mqttDrops);
+    json.field("blocked_ms", network.blockedTime);
+    json.field("max_blocked_ms", network.maxBlocked);
+    json.field("offline_ms", network.offlineTime);
+    json.field("longest_outage_ms", network.longestOutage);
+    json.field("wifi_state", wifiStateName(wifiState()));
+    json.field("mqtt_state", mqttStateName(mqttState()));
+    json.field("next_retry_ms", network.nextRetry);
+}
+
+static void writeOutboundStats(JsonStream& json, const OutboundStats& outbound) {
+    json.field("queued", (unsigned long)outbound.queued);
+    json.field("delivered", (unsigned long)outbound.delivered);
+    json.field("resent", (unsigned long)outbound.resent);
+    json.field("failures", (unsigned long)outbound.failures);
+    json.field("buffered", (unsigned long)outbound.buffered);
+    json.field("lost", (unsigned long)outbound.lost);
+    json.field("pending", (unsigned int)outbound.pending);
+    json.field("mean_latency_ms", outbound.published > 0
+                                      ? (float)outbound.totalLatency / outbound.published
+                                      : 0.0f,
+               1);
+    json.field("max_latency_ms", outbound.maxLatency);
+}
+
+static void writeDrainStats(JsonStream& json, const DrainStats& drain) {
+    json.field("pending", bufferCount);
+    json.field("unconfirmed", drain.unconfirmed);
+    json.field("batches", (unsigned long)drain.batches);
+    json.field("bytes", (unsigned long)drain.bytes);
+    json.field("rewinds", (unsigned long)drain.rewinds);
+    json.field("resent", (unsigned long)drain.resent);
+    json.field("rate_limit", config.drainRate);
+}
+
+bool publishHealthMetrics() {
+    // Taken even when offline so each window covers one interval
+    HealthMetrics metrics;
+    metricsTake(metrics);
+
+    if (!networkConnected || !mqttClient.connected())
+        return false;
+
+    uint32_t queueDrops = sampleQueue.droppedCount();
+    PowerSaveStats power;
+    powerSaveTake(power);
+    NetworkStats network;
+    networkTakeStats(network);
+    OutboundStats outbound;
+    outboundTakeStats(outbound);
+    DrainStats drain;
+    bufferDrainTakeStats(drain);
+    // Copied: core1 keeps reading channels while the emitter runs twice
+    ChannelSchedule schedule = channelSchedule;
+    DhtPioStats dhtReads;
+    dhtPioTakeStats(dhtReads);
+
+    return publishJson(MQTT_METRICS_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("timestamp", metrics.windowEnd);
+        json.field("window_ms", metrics.windowEnd - metrics.windowStart);
+
+        const LoopMetrics& loop = metrics.loop;
+        json.beginObject("loop");
+        json.field("iterations", (unsigned long)loop.iterations);
+        json.field("mean_us",
+                   (unsigned long)(loop.iterations > 0 ? loop.totalUs / loop.iterations : 0));
+        json.field("max_us", (unsigned long)loop.maxUs);
+        json.endObject();
+
+        const SensorReadMetrics& reads = metrics.reads;
+        json.beginObject("sensor_reads");
+        json.field("count", (unsigned long)reads.count);
+        json.field("nominal_ms", reads.nominal);
+        json.field("mean_abs_jitter_ms",
+                   reads.count > 0 ? (float)reads.totalAbsJitter / reads.count : 0.0f, 1);
+        json.field("min_jitter_ms", reads.minJitter);
+        json.field("max_jitter_ms", reads.maxJitter);
+        json.field("late", (unsigned long)reads.late);
+        json.field("missed", (unsigned long)reads.missed);
+        json.field("queue_drops", (unsigned long)queueDrops);
+
+        // Per channel since boot
+        json.beginArray("channels");
+        for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+            json.beginObject();
+            json.field("name", SENSOR_CHANNEL_NAMES[channel]);
+            json.field("interval_ms", schedule.interval[channel]);
+            json.field("reads", (unsigned long)schedule.reads[channel]);
+            json.field("missed", (unsigned long)schedule.missed[channel]);
+            json.field("max_late_ms", schedule.maxLate[channel]);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+
+        // DHT transfers since boot by outcome (PIO driver only)
+        json.beginObject("dht");
+        json.field("driver", dhtReads.active ? "pio" : "library");
+        if (dhtReads.active) {
+            json.field("transfers", (unsigned long)dhtReads.transfers);
+            for (int status = 0; status < DHT_STATUS_COUNT; status++) {
+                json.field(dhtStatusName((DhtStatus)status),
+                           (unsigned long)dhtReads.results[status]);
+            }
+        }
+        json.endObject();
+
+        // Since adaptive sampling was last turned on: reads taken against
+        // what the fixed interval would have taken, and activity events
+        const AdaptiveSampler& sampler = adaptiveSampler;
+        json.beginObject("sampling");
+        json.field("adaptive", config.adaptiveSamplingEnabled);
+        json.field("interval_ms", currentReadInterval());
+        if (config.adaptiveSamplingEnabled) {
+            json.field("reads", (unsigned long)sampler.reads);
+            json.field("fixed_rate_reads",
+                       (unsigned long)adaptiveSamplerFixedReads(sampler, config.sensorReadInterval));
+            json.field("active_reads", (unsigned long)sampler.activeReads);
+            json.field("events", (unsigned long)sampler.events);
+        }
+        json.endObject();
+
+        // Since the power-save mode last changed: the share of time each
+        // core was awake and the WiFi module powered
+        json.beginObject("power");
+        writePowerSaveStats(json, power);
+        json.endObject();
+
+        // Connection attempts and time lost to outages since boot
+        json.beginObject("network");
+        writeNetworkStats(json, network);
+        json.endObject();
+
+        // Alerts through the priority lane since boot
+        json.beginObject("outbound");
+        writeOutboundStats(json, outbound);
+        json.endObject();
+
+        // Offline backlog still to send, and what draining it has cost
+        json.beginObject("backlog");
+        writeDrainStats(json, drain);
+        json.endObject();
+
+        // Scheduler counters run from boot so dashboards can difference them
+        json.beginArray("tasks");
+        for (int i = 0; i < getTaskCount(); i++) {
+            const ScheduledTask* task = getTask(i);
+            if (task == NULL || !task->active || task->period == 0)
+                continue;
+
+            json.beginObject();
+            json.field("name", task->name);
+            json.field("runs", task->runCount);
+            json.field("max_jitter_ms", task->maxJitter);
+            json.field("max_duration_ms", task->maxDuration);
+            json.field("overruns", task->overrunCount);
+            json.field("missed", task->missedCount);
+            json.endObject();
+        }
+        json.endArray();
+
+        json.beginObject("memory");
+        json.field("heap_used", (unsigned long)metrics.heapUsed);
+        json.field("heap_peak", (unsigned long)metrics.heapPeak);
+        json.field("stack_core0", (unsigned long)metrics.stackUsed[0]);
+        if (metrics.stackUsed[1] > 0) {
+            json.field("stack_core1", (unsigned long)metrics.stackUsed[1]);
+        }
+        json.endObject();
+        json.endObject();
+    });
+}
+
+bool publishPowerSaveStatus() {
+    // A command reply: the client is connected even if the network task
+    // has not noticed yet
+    PowerSaveStats power;
+    powerSaveTake(power);
+
+    const char* status = "power_save_auto";
+    if (config.powerSaveMode == POWER_SAVE_OFF) {
+        status = "power_save_disabled";
+    } else if (config.powerSaveMode == POWER_SAVE_ON) {
+        status = "power_save_enabled";
+    }
+
+    return publishJson(MQTT_STATUS_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("status", status);
+        json.field("on_battery", isOnBattery);
+        writePowerSaveStats(json, power);
+        json.endObject();
+    });
+}
+
+bool publishProfileReport() {
+    if (!networkConnected || !mqttClient.connected())
+        return false;
+
+    // Snapshot first: the emitter runs twice and core1 keeps recording
+    ProfileStats scopes[PROFILE_SCOPE_COUNT];
+    for (int scope = 0; scope < PROFILE_SCOPE_COUNT; scope++) {
+        profileSnapshot((ProfileScopeId)scope, scopes[scope]);
+    }
     unsigned long timestamp = millis();
-    char buffer[256];
-
-    // Environment data in InfluxDB format
-    snprintf(
-        buffer, sizeof(buffer),
-        "environment,device=%s,on_battery=%s temperature=%.2f,humidity=%.2f,heat_index=%.2f %lu",
-        MQTT_CLIENT_ID, isOnBattery ? "true" : "false", temperature, humidity, heatIndex,
-        timestamp);
-    mqttClient.publish(MQTT_INFLUX_TOPIC, buffer);
+
+    return publishJson(MQTT_PROFILE_TOPIC, [&](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("timestamp", timestamp);
+        json.field("enabled", SENSORHUB_PROFILE != 0);
+
+        json.beginArray("scopes");
+        for (int scope = 0; scope < PROFILE_SCOPE_COUNT; scope++) {
+            const ProfileStats& stats = scopes[scope];
+            if (stats.count == 0)
+                continue;
+
+            json.beginObject();
+            json.field("name", profileScopeName((ProfileScopeId)scope));
+            json.field("count", (unsigned long)stats.count);
+            json.field("min_us", (unsigned long)stats.minUs);
+            json.field("avg_us", (unsigned long)(stats.totalUs / stats.count));
+            json.field("max_us", (unsigned long)stats.maxUs);
+
+            // Bucket k counts durations of 2^k to 2^(k+1) us; trailing
+            // empty buckets are left out
+            int buckets = PROFILE_HISTOGRAM_BUCKETS;
+            while (buckets > 0 && stats.histogram[buckets - 1] == 0) {
+                buckets--;
+            }
+            json.beginArray("histogram");
+            for (int bucket = 0; bucket < buckets; bucket++) {
+                json.element((unsigned long)stats.histogram[bucket]);
+            }
+            json.endArray();
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    });
 }
@@ -6,8 +6,14 @@
 #ifndef COMMUNICATION_H
 #define COMMUNICATION_H
 
+#include "BinaryTelemetry.h"
 #include "Constants.h"
+#include "JsonStream.h"
+#include "OutboundQueue.h"
 #include <Arduino.h>
+#include <PubSubClient.h>
+
+extern PubSubClient mqttClient;
 
 //=====================================================================
 // FUNCTION PROTOTYPES
@@ -15,13 +21,83 @@
 // Publish device status
 void publishDeviceStatus();
 
-// Publish low battery alert
+// Queue a low battery alert
 void publishLowBatteryAlert();
 
-// Publish sensor spike alerts
+// Queue sensor spike alerts
 void publishSpikeAlert();
 
 // Publish all sensor data to MQTT
 void publishToMQTT();
 
+// Publish and clear the samples batched since the last telemetry message
+bool publishTelemetryBatch();
+
+// Publish buffered readings as line protocol at their own timestamps,
+// converted through clock. Returns the payload bytes sent, 0 if a message
+// failed.
+struct SensorReading;
+struct EpochReference;
+size_t publishInfluxReadings(const SensorReading* readings, int count,
+                             const EpochReference& clock);
+
+// Make the next telemetry message carry every channel in deadband mode
+void resetTelemetryDeadband();
+
+// Publish vibration spectrum features on the vibration topic
+bool publishVibrationFeatures(const VibrationFeatures& features);
+
+// Publish octave band sound levels on the acoustic topic
+bool publishOctaveLevels(const OctaveLevels& levels);
+
+// Publish loop, sampling, scheduler and memory health for the last window
+bool publishHealthMetrics();
+
+// Publish the power-save mode and its savings so far on the status topic
+bool publishPowerSaveStatus();
+
+// Publish the profiling statistics of every instrumented scope
+bool publishProfileReport();
+
+// True when config selects the binary payload format
+bool binaryPayloadsEnabled();
+
+// Publish the JSON written by emit(JsonStream&) without buffering it.
+// emit runs twice, first to measure the payload, and must produce the
+// same output both times. The payload size is stored in *length if given.
+template <typename Emitter>
+bool publishJson(const char* topic, Emitter emit, bool retained = false, size_t* length = NULL) {
+    JsonStream counter(NULL);
+    emit(counter);
+    counter.flush();
+    if (length != NULL) {
+        *length = counter.length();
+    }
+
+    if (!mqttClient.beginPublish(topic, counter.length(), retained))
+        return false;
+
+    JsonStream stream(&mqttClient);
+    emit(stream);
+    stream.flush();
+    return mqttClient.endPublish();
+}
+
+// Queue the JSON written by emit(JsonStream&, uint32_t sequence) in the
+// outbound queue, ahead of routine traffic. The sequence number lets
+// consumers drop a message delivered twice.
+template <typename Emitter>
+bool queueJson(const char* topic, Emitter emit) {
+    OutboundMessage& message = outboundReserve(topic);
+    OutboundWriter writer(message);
+    JsonStream stream(&writer);
+    emit(stream, message.sequence);
+    stream.flush();
+    return outboundCommit(message, writer.overflowed());
+}
+
+// Queue an alert in the binary payload format
+bool publishBinaryAlert(const char* topic, TelemetryAlertKind kind, TelemetrySensor sensor,
+                        float value, float aux1 = 0, float aux2 = 0);
+
 #endif // COMMUNICATION_H
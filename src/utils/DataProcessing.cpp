@@ -4,125 +4,146 @@
  */
 
 #include "DataProcessing.h"
+#include "Communication.h"
 #include "Config.h"
+#include "LedPatterns.h"
+#include "Profiler.h"
 #include "Sensors.h"
-#include <ArduinoJson.h>
 #include <math.h>
 
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
 // Anomaly Detection Variables
-float tempHistory[HISTORY_SIZE] = {0};
-float humidityHistory[HISTORY_SIZE] = {0};
-float accelHistory[HISTORY_SIZE] = {0};
-float soundHistory[HISTORY_SIZE] = {0};
-float gasHistory[HISTORY_SIZE] = {0};
-int historyIndex = 0;
-bool historyFilled = false;
-
-// External MQTT client
-extern PubSubClient mqttClient;
+RollingStats tempStats;
+RollingStats humidityStats;
+RollingStats accelStats;
+RollingStats soundStats;
+RollingStats gasStats;
+RollingStats octaveBandStats[OCTAVE_BANDS]; // dBFS, one level per publish window
 
 //=====================================================================
-// DATA ANALYSIS FUNCTIONS
+// HELPERS
 //=====================================================================
-void updateSensorHistory(float value, float* history) {
-    history[historyIndex] = value;
-    historyIndex = (historyIndex + 1) % HISTORY_SIZE;
-    if (historyIndex == 0) {
-        historyFilled = true;
-    }
-}
-
-float calculateMean(float* history) {
-    float sum = 0.0;
-    int count = historyFilled ? HISTORY_SIZE : historyIndex;
-
-    if (count == 0)
-        return 0.0;
-
-    for (int i = 0; i < count; i++) {
-        sum += history[i];
+static void publishAnomaly(const char* sensor, TelemetrySensor sensorId, float value, float mean,
+                           float stdDev) {
+    if (binaryPayloadsEnabled()) {
+        publishBinaryAlert(MQTT_ANOMALIES_TOPIC, ALERT_ANOMALY, sensorId, value, mean, stdDev);
+        return;
     }
 
-    return sum / count;
+    unsigned long timestamp = millis();
+    queueJson(MQTT_ANOMALIES_TOPIC, [&](JsonStream& json, uint32_t sequence) {
+        json.beginObject();
+        json.field("device_id", MQTT_CLIENT_ID);
+        json.field("seq", (unsigned long)sequence);
+        json.field("timestamp", timestamp);
+        json.field("alert", "anomaly_detected");
+        json.field("sensor", sensor);
+        json.field("value", value);
+        json.field("mean", mean);
+        json.field("std_dev", stdDev);
+        json.field("z_score", (value - mean) / stdDev);
+        json.endObject();
+    });
 }
 
-float calculateStdDev(float* history) {
-    float mean = calculateMean(history);
-    float sumSquaredDiff = 0.0;
-    int count = historyFilled ? HISTORY_SIZE : historyIndex;
+static bool deviates(const RollingStats& stats, float value, float minStdDev) {
+    if (!rollingStatsFull(stats))
+        return false;
 
-    if (count == 0)
-        return 0.0;
+    float stdDev = rollingStatsStdDev(stats);
+    return stdDev > minStdDev &&
+           abs(value - rollingStatsMean(stats)) > config.activityThreshold * stdDev;
+}
 
-    for (int i = 0; i < count; i++) {
-        float diff = history[i] - mean;
-        sumSquaredDiff += diff * diff;
+//=====================================================================
+// DATA ANALYSIS FUNCTIONS
+//=====================================================================
+void initializeSensorHistory() {
+    rollingStatsReset(tempStats);
+    rollingStatsReset(humidityStats);
+    rollingStatsReset(accelStats);
+    rollingStatsReset(soundStats);
+    rollingStatsReset(gasStats);
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        rollingStatsReset(octaveBandStats[band]);
     }
-
-    return sqrt(sumSquaredDiff / count);
 }
 
-void checkForAnomalies() {
+void checkForAnomalies(const SensorSample& sample) {
+    PROFILE_SCOPE(PROFILE_ANOMALIES);
+
     // Get current values
-    float tempMean = calculateMean(tempHistory);
-    float tempStdDev = calculateStdDev(tempHistory);
-    float humidityMean = calculateMean(humidityHistory);
-    float humidityStdDev = calculateStdDev(humidityHistory);
-    float accelMean = calculateMean(accelHistory);
-    float accelStdDev = calculateStdDev(accelHistory);
-    float gasMean = calculateMean(gasHistory);
-    float gasStdDev = calculateStdDev(gasHistory);
+    float tempMean = rollingStatsMean(tempStats);
+    float tempStdDev = rollingStatsStdDev(tempStats);
+    float gasMean = rollingStatsMean(gasStats);
+    float gasStdDev = rollingStatsStdDev(gasStats);
 
     // Temperature anomaly check
-    if (abs(temperature - tempMean) > config.anomalyThresholdMultiplier * tempStdDev &&
+    if (sample.environmentValid && rollingStatsFull(tempStats) &&
+        abs(temperature - tempMean) > config.anomalyThresholdMultiplier * tempStdDev &&
         tempStdDev > MIN_TEMP_STD_DEV) {
 
-        StaticJsonDocument<256> jsonDoc;
-        jsonDoc["device_id"] = MQTT_CLIENT_ID;
-        jsonDoc["alert"] = "anomaly_detected";
-        jsonDoc["sensor"] = "temperature";
-        jsonDoc["value"] = temperature;
-        jsonDoc["mean"] = tempMean;
-        jsonDoc["std_dev"] = tempStdDev;
-        jsonDoc["z_score"] = (temperature - tempMean) / tempStdDev;
-
-        char jsonBuffer[256];
-        serializeJson(jsonDoc, jsonBuffer);
-        mqttClient.publish(MQTT_ANOMALIES_TOPIC, jsonBuffer);
+        publishAnomaly("temperature", TELEMETRY_SENSOR_TEMPERATURE, temperature, tempMean,
+                       tempStdDev);
 
         Serial.println("Temperature anomaly detected!");
     }
 
     // Gas anomaly check - particularly important for safety
-    if (abs(gasRatio - gasMean) > config.anomalyThresholdMultiplier * gasStdDev &&
+    // The gas history holds CO ppm, so compare in ppm as well
+    float co_ppm = coPpmFromAdc(gasAdc);
+    if (sample.gasValid && rollingStatsFull(gasStats) &&
+        abs(co_ppm - gasMean) > config.anomalyThresholdMultiplier * gasStdDev &&
         gasStdDev > MIN_GAS_STD_DEV) {
 
-        float co_ppm = getCO_ppm(gasRatio);
-
-        StaticJsonDocument<256> jsonDoc;
-        jsonDoc["device_id"] = MQTT_CLIENT_ID;
-        jsonDoc["alert"] = "anomaly_detected";
-        jsonDoc["sensor"] = "gas";
-        jsonDoc["value"] = co_ppm;
-        jsonDoc["mean"] = getCO_ppm(gasMean);
-        jsonDoc["std_dev"] = gasStdDev;
-        jsonDoc["z_score"] = (gasRatio - gasMean) / gasStdDev;
-
-        char jsonBuffer[256];
-        serializeJson(jsonDoc, jsonBuffer);
-        mqttClient.publish(MQTT_ANOMALIES_TOPIC, jsonBuffer);
+        publishAnomaly("gas", TELEMETRY_SENSOR_GAS, co_ppm, gasMean, gasStdDev);
 
         // Flash warning LED for gas anomalies
-        for (int i = 0; i < 3; i++) {
-            digitalWrite(LEDR, HIGH);
-            delay(LED_BLINK_MEDIUM);
-            digitalWrite(LEDR, LOW);
-            delay(LED_BLINK_MEDIUM);
-        }
+        startLedPattern(LEDR, 3, LED_BLINK_MEDIUM, LED_BLINK_MEDIUM);
 
         Serial.println("Gas level anomaly detected!");
     }
 }
+
+bool detectActivity() {
+    if (vibrationSpikeDetected || soundSpikeDetected)
+        return true;
+
+    return deviates(accelStats, sqrt(Ax * Ax + Ay * Ay + Az * Az), MIN_ACCEL_STD_DEV) ||
+           deviates(soundStats, soundLevel, MIN_SOUND_STD_DEV) ||
+           deviates(tempStats, temperature, MIN_TEMP_STD_DEV) ||
+           deviates(gasStats, coPpmFromAdc(gasAdc), MIN_GAS_STD_DEV);
+}
+
+void updateAcousticHistory(const OctaveLevels& levels) {
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        rollingStatsAdd(octaveBandStats[band], levels.level[band]);
+    }
+}
+
+void checkForAcousticAnomalies(const OctaveLevels& levels) {
+    // A change in one band (a bearing whine, a new fan) can stand out
+    // while the overall sound level barely moves
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        const RollingStats& stats = octaveBandStats[band];
+        float mean = rollingStatsMean(stats);
+        float stdDev = rollingStatsStdDev(stats);
+        float level = levels.level[band];
+
+        if (rollingStatsFull(stats) &&
+            abs(level - mean) > config.anomalyThresholdMultiplier * stdDev &&
+            stdDev > MIN_SOUND_BAND_STD_DEV) {
+
+            char sensor[24];
+            snprintf(sensor, sizeof(sensor), "sound_%ldhz",
+                     lround(octaveBandCentre(levels.sampleRate, band)));
+            publishAnomaly(sensor, (TelemetrySensor)(TELEMETRY_SENSOR_OCTAVE_BAND + band), level,
+                           mean, stdDev);
+
+            Serial.print("Sound band anomaly detected: ");
+            Serial.println(sensor);
+        }
+    }
+}
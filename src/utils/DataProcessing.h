@@ -7,33 +7,40 @@
 #define DATA_PROCESSING_H
 
 #include "Constants.h"
+#include "OctaveBands.h"
+#include "RollingStats.h"
 #include <Arduino.h>
 
 //=====================================================================
 // GLOBAL VARIABLES
 //=====================================================================
 // Anomaly Detection Variables
-extern float tempHistory[HISTORY_SIZE];
-extern float humidityHistory[HISTORY_SIZE];
-extern float accelHistory[HISTORY_SIZE];
-extern float soundHistory[HISTORY_SIZE];
-extern float gasHistory[HISTORY_SIZE];
-extern int historyIndex;
-extern bool historyFilled;
+extern RollingStats tempStats;
+extern RollingStats humidityStats;
+extern RollingStats accelStats;
+extern RollingStats soundStats;
+extern RollingStats gasStats;
+extern RollingStats octaveBandStats[OCTAVE_BANDS];
 
 //=====================================================================
 // FUNCTION PROTOTYPES
 //=====================================================================
-// Update sensor history arrays
-void updateSensorHistory(float value, float* history);
+// Reset all rolling statistics windows
+void initializeSensorHistory();
 
-// Calculate mean of history array
-float calculateMean(float* history);
+// Check the channels a sample read for anomalies
+struct SensorSample;
+void checkForAnomalies(const SensorSample& sample);
 
-// Calculate standard deviation of history array
-float calculateStdDev(float* history);
+// True if the latest sample shows activity: a vibration or sound spike,
+// or a reading more than config.activityThreshold std devs from its
+// rolling mean
+bool detectActivity();
 
-// Check for anomalies in sensor data
-void checkForAnomalies();
+// Add a window of octave band levels to their history
+void updateAcousticHistory(const OctaveLevels& levels);
+
+// Check each octave band level against its history
+void checkForAcousticAnomalies(const OctaveLevels& levels);
 
 #endif // DATA_PROCESSING_H
@@ -0,0 +1,63 @@
+/*
+ * Deadband.cpp
+ * Report-by-exception channel selection implementation
+ */
+
+#include "Deadband.h"
+#include <math.h>
+#include <string.h>
+
+void deadbandReset(DeadbandState& state) {
+    memset(&state, 0, sizeof(state));
+}
+
+bool deadbandExceeded(float last, float value, float absolute, float percent) {
+    if (isnan(last) || isnan(value))
+        return isnan(last) != isnan(value);
+
+    if (absolute <= 0 && percent <= 0)
+        return true;
+
+    float change = fabsf(value - last);
+    return (absolute > 0 && change > absolute) ||
+           (percent > 0 && change > fabsf(last) * percent / 100.0f);
+}
+
+uint16_t deadbandSelect(const DeadbandState& state, const TelemetryBatch& batch,
+                        const float* absolute, const float* percent, unsigned long heartbeat,
+                        unsigned long now) {
+    uint16_t mask = 0;
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        const DeadbandChannel& last = state.channels[channel];
+        if (!last.reported || now - last.lastReport >= heartbeat) {
+            mask |= 1 << channel;
+            continue;
+        }
+
+        const float* values = telemetryBatchColumn(batch, channel);
+        for (uint16_t i = 0; i < batch.count; i++) {
+            if (deadbandExceeded(last.lastValue, values[i], absolute[channel], percent[channel])) {
+                mask |= 1 << channel;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+void deadbandCommit(DeadbandState& state, const TelemetryBatch& batch, uint16_t mask,
+                    unsigned long now) {
+    if (batch.count == 0)
+        return;
+
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        if ((mask & (1 << channel)) == 0)
+            continue;
+
+        DeadbandChannel& last = state.channels[channel];
+        last.lastValue = telemetryBatchColumn(batch, channel)[batch.count - 1];
+        last.lastReport = now;
+        last.reported = true;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Deadband.h
+ * Report-by-exception selection of telemetry channels
+ *
+ * In deadband mode a telemetry message carries only the channels that
+ * have moved since they were last reported: some sample in the window
+ * differs from the last reported value by more than the channel's
+ * absolute threshold or by more than its percentage of that value
+ * (a threshold of 0 is off; with both off the channel is always sent).
+ * A reading appearing or disappearing counts as movement, and every
+ * channel is sent at least once per heartbeat interval so consumers can
+ * tell a steady value from a silent device.
+ *
+ * No Arduino dependencies.
+ */
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include "Constants.h"
+#include "TelemetryBatch.h"
+#include <stdint.h>
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct DeadbandChannel {
+    float lastValue; // NaN if the last report had no reading
+    unsigned long lastReport;
+    bool reported;
+};
+
+struct DeadbandState {
+    DeadbandChannel channels[TELEMETRY_CHANNELS];
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Forget every report, so the next window sends every channel
+void deadbandReset(DeadbandState& state);
+
+// True if value has moved out of the band around last
+bool deadbandExceeded(float last, float value, float absolute, float percent);
+
+// Mask of the channels (bit = TelemetryChannel) the batch must carry
+uint16_t deadbandSelect(const DeadbandState& state, const TelemetryBatch& batch,
+                        const float* absolute, const float* percent, unsigned long heartbeat,
+                        unsigned long now);
+
+// Record the channels in mask as reported, once the message is out
+void deadbandCommit(DeadbandState& state, const TelemetryBatch& batch, uint16_t mask,
+                    unsigned long now);
+
+#endif // DEADBAND_H
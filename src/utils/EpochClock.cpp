@@ -0,0 +1,53 @@
+/*
+ * EpochClock.cpp
+ * Device clock to Unix time implementation
+ */
+
+#include "EpochClock.h"
+
+//=====================================================================
+// STATE
+//=====================================================================
+static EpochReference reference = {0, 0};
+static bool queried = false;
+static unsigned long lastQuery = 0;
+
+//=====================================================================
+// CLOCK
+//=====================================================================
+uint64_t epochAt(const EpochReference& clock, unsigned long deviceMs) {
+    if (clock.epochMs == 0)
+        return 0;
+
+    // Signed, so timestamps taken before the reference convert too
+    return clock.epochMs + (int32_t)(deviceMs - clock.deviceMs);
+}
+
+bool epochClockDue(unsigned long now) {
+    if (!queried)
+        return true;
+
+    unsigned long interval = reference.epochMs != 0 ? EPOCH_RESYNC_INTERVAL : EPOCH_QUERY_INTERVAL;
+    return now - lastQuery >= interval;
+}
+
+void epochClockUpdate(uint32_t epochSeconds, unsigned long now) {
+    queried = true;
+    lastQuery = now;
+    if (epochSeconds == 0)
+        return;
+
+    // The reported second started up to EPOCH_RESOLUTION ago; take its middle
+    uint64_t reported = (uint64_t)epochSeconds * 1000 + EPOCH_RESOLUTION / 2;
+    uint64_t current = epochAt(reference, now);
+
+    if (current == 0 || current + EPOCH_RESOLUTION < reported ||
+        current > reported + EPOCH_RESOLUTION) {
+        reference.epochMs = reported;
+        reference.deviceMs = now;
+    }
+}
+
+const EpochReference& epochClock() {
+    return reference;
+}
@@ -0,0 +1,52 @@
+/*
+ * EpochClock.h
+ * Unix time for the device's millisecond clock
+ *
+ * millis() starts from zero at every boot, so on its own it only orders
+ * points within one boot. Once the WiFi module has the time (its NTP
+ * client, read with WiFi.getTime() at one second resolution) a reference
+ * pair ties a device timestamp to Unix time in ms, and any timestamp
+ * within about 24 days of it converts by difference, across a millis()
+ * wrap too. The time is read again every EPOCH_RESYNC_INTERVAL, but the
+ * reference only moves when the two clocks have drifted further apart
+ * than that resolution, so successive points never step back.
+ *
+ * No Arduino dependencies; the caller passes both clocks.
+ */
+
+#ifndef EPOCH_CLOCK_H
+#define EPOCH_CLOCK_H
+
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define EPOCH_QUERY_INTERVAL 10000       // ms between reads until the time is known
+#define EPOCH_RESYNC_INTERVAL 3600000UL  // ms between reads once it is
+#define EPOCH_RESOLUTION 1000            // ms, of the time the module reports
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct EpochReference {
+    uint64_t epochMs; // Unix time in ms at deviceMs, 0 if not known
+    unsigned long deviceMs;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Unix time in ms of a device timestamp, 0 if the reference is not known
+uint64_t epochAt(const EpochReference& reference, unsigned long deviceMs);
+
+// True when the time should be read again
+bool epochClockDue(unsigned long now);
+
+// The time was read at now: Unix seconds, or 0 if the module has none yet
+void epochClockUpdate(uint32_t epochSeconds, unsigned long now);
+
+// The current reference; its epochMs is 0 until the first answer
+const EpochReference& epochClock();
+
+#endif // EPOCH_CLOCK_H
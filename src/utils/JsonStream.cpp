@@ -0,0 +1,181 @@
+/*
+ * JsonStream.cpp
+ * Streaming JSON writer implementation
+ */
+
+#include "JsonStream.h"
+#include "LineProtocol.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+JsonStream::JsonStream(Print* output) : output(output), written(0), staged(0), first(true) {}
+
+//=====================================================================
+// OUTPUT
+//=====================================================================
+void JsonStream::flush() {
+    if (staged == 0)
+        return;
+
+    if (output != NULL) {
+        output->write((const uint8_t*)chunk, staged);
+    }
+    written += staged;
+    staged = 0;
+}
+
+void JsonStream::rawChar(char c) {
+    if (staged == sizeof(chunk)) {
+        flush();
+    }
+    chunk[staged++] = c;
+}
+
+void JsonStream::raw(const char* text) {
+    while (*text) {
+        rawChar(*text++);
+    }
+}
+
+void JsonStream::quoted(const char* text) {
+    rawChar('"');
+    for (; *text; text++) {
+        char c = *text;
+        if (c == '"' || c == '\\') {
+            rawChar('\\');
+            rawChar(c);
+        } else if ((uint8_t)c < 0x20) {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", (uint8_t)c);
+            raw(escape);
+        } else {
+            rawChar(c);
+        }
+    }
+    rawChar('"');
+}
+
+void JsonStream::number(const char* format, ...) {
+    char text[48];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    raw(text);
+}
+
+// The integer formatter of the line protocol writer rather than printf:
+// publishJson() formats every value twice, once to count and once to send
+void JsonStream::decimal(float value, uint8_t decimals) {
+    char text[24];
+
+    // NaN and infinity have no JSON representation
+    if (formatDecimal(text, value, decimals) == 0) {
+        raw("null");
+    } else {
+        raw(text);
+    }
+}
+
+//=====================================================================
+// STRUCTURE
+//=====================================================================
+void JsonStream::separator() {
+    if (!first) {
+        rawChar(',');
+    }
+    first = false;
+}
+
+void JsonStream::key(const char* name) {
+    separator();
+    quoted(name);
+    rawChar(':');
+}
+
+void JsonStream::beginObject() {
+    separator();
+    rawChar('{');
+    first = true;
+}
+
+void JsonStream::beginObject(const char* name) {
+    key(name);
+    rawChar('{');
+    first = true;
+}
+
+void JsonStream::endObject() {
+    rawChar('}');
+    first = false;
+}
+
+void JsonStream::beginArray(const char* name) {
+    key(name);
+    rawChar('[');
+    first = true;
+}
+
+void JsonStream::endArray() {
+    rawChar(']');
+    first = false;
+}
+
+//=====================================================================
+// FIELDS
+//=====================================================================
+void JsonStream::field(const char* name, const char* value) {
+    key(name);
+    if (value == NULL) {
+        raw("null");
+    } else {
+        quoted(value);
+    }
+}
+
+void JsonStream::field(const char* name, bool value) {
+    key(name);
+    raw(value ? "true" : "false");
+}
+
+void JsonStream::field(const char* name, int value) {
+    key(name);
+    number("%d", value);
+}
+
+void JsonStream::field(const char* name, unsigned int value) {
+    key(name);
+    number("%u", value);
+}
+
+void JsonStream::field(const char* name, long value) {
+    key(name);
+    number("%ld", value);
+}
+
+void JsonStream::field(const char* name, unsigned long value) {
+    key(name);
+    number("%lu", value);
+}
+
+void JsonStream::field(const char* name, float value, uint8_t decimals) {
+    key(name);
+    decimal(value, decimals);
+}
+
+void JsonStream::field(const char* name, double value, uint8_t decimals) {
+    field(name, (float)value, decimals);
+}
+
+//=====================================================================
+// ARRAY ELEMENTS
+//=====================================================================
+void JsonStream::element(unsigned long value) {
+    separator();
+    number("%lu", value);
+}
+
+void JsonStream::element(float value, uint8_t decimals) {
+    separator();
+    decimal(value, decimals);
+}
@@ -0,0 +1,69 @@
+/*
+ * JsonStream.h
+ * Streaming JSON writer for MQTT payloads
+ *
+ * Writes JSON straight to a Print (the MQTT client) through a small
+ * staging buffer, so no document or serialized copy is held in RAM.
+ * A stream without an output only counts bytes; publishJson() in
+ * Communication.h runs the same emitter once to count and once to send,
+ * since an MQTT packet must announce its length before the payload.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+
+#define JSON_STREAM_CHUNK_SIZE 64
+
+class JsonStream {
+  public:
+    // Pass NULL to count the output without writing it anywhere
+    explicit JsonStream(Print* output);
+
+    // Objects and arrays; the keyed forms open a member of the current object
+    void beginObject();
+    void beginObject(const char* key);
+    void endObject();
+    void beginArray(const char* key);
+    void endArray();
+
+    // Members of the current object
+    void field(const char* key, const char* value);
+    void field(const char* key, bool value);
+    void field(const char* key, int value);
+    void field(const char* key, unsigned int value);
+    void field(const char* key, long value);
+    void field(const char* key, unsigned long value);
+    // At most decimals (0-6) fractional digits, trailing zeros dropped;
+    // doubles are written at float precision
+    void field(const char* key, float value, uint8_t decimals = 3);
+    void field(const char* key, double value, uint8_t decimals = 3);
+
+    // Elements of the current array
+    void element(unsigned long value);
+    void element(float value, uint8_t decimals = 3);
+
+    // Send whatever is still staged
+    void flush();
+
+    // Bytes produced so far, including anything still staged
+    size_t length() const { return written + staged; }
+
+  private:
+    void separator();
+    void key(const char* name);
+    void raw(const char* text);
+    void rawChar(char c);
+    void quoted(const char* text);
+    void number(const char* format, ...);
+    void decimal(float value, uint8_t decimals);
+
+    Print* output;
+    size_t written;
+    size_t staged;
+    bool first;
+    char chunk[JSON_STREAM_CHUNK_SIZE];
+};
+
+#endif // JSON_STREAM_H
@@ -0,0 +1,64 @@
+/*
+ * LedPatterns.cpp
+ * Non-blocking LED blink pattern implementation
+ */
+
+#include "LedPatterns.h"
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct LedPattern {
+    int pin;
+    int remainingToggles; // Each blink is an on and an off toggle
+    unsigned long onTime;
+    unsigned long offTime;
+    unsigned long nextToggle;
+    bool ledOn;
+};
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+static LedPattern patterns[] = {
+    {LEDR, 0, 0, 0, 0, false},
+    {LEDG, 0, 0, 0, 0, false},
+    {LEDB, 0, 0, 0, 0, false},
+};
+static const int PATTERN_COUNT = sizeof(patterns) / sizeof(patterns[0]);
+
+//=====================================================================
+// LED PATTERN FUNCTIONS
+//=====================================================================
+void startLedPattern(int pin, int blinks, unsigned long onTime, unsigned long offTime) {
+    if (blinks <= 0)
+        return;
+
+    for (int i = 0; i < PATTERN_COUNT; i++) {
+        if (patterns[i].pin != pin)
+            continue;
+
+        patterns[i].remainingToggles = blinks * 2 - 1;
+        patterns[i].onTime = onTime;
+        patterns[i].offTime = offTime;
+        patterns[i].nextToggle = millis() + onTime;
+        patterns[i].ledOn = true;
+        digitalWrite(pin, HIGH);
+        return;
+    }
+}
+
+void updateLedPatterns() {
+    unsigned long now = millis();
+
+    for (int i = 0; i < PATTERN_COUNT; i++) {
+        LedPattern& pattern = patterns[i];
+        if (pattern.remainingToggles <= 0 || (long)(now - pattern.nextToggle) < 0)
+            continue;
+
+        pattern.ledOn = !pattern.ledOn;
+        digitalWrite(pattern.pin, pattern.ledOn ? HIGH : LOW);
+        pattern.remainingToggles--;
+        pattern.nextToggle = now + (pattern.ledOn ? pattern.onTime : pattern.offTime);
+    }
+}
@@ -0,0 +1,21 @@
+/*
+ * LedPatterns.h
+ * Non-blocking LED blink patterns
+ */
+
+#ifndef LED_PATTERNS_H
+#define LED_PATTERNS_H
+
+#include "Constants.h"
+#include <Arduino.h>
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Start blinking a LED; replaces any pattern already running on that pin
+void startLedPattern(int pin, int blinks, unsigned long onTime, unsigned long offTime);
+
+// Advance all running patterns, called periodically by the scheduler
+void updateLedPatterns();
+
+#endif // LED_PATTERNS_H
@@ -0,0 +1,216 @@
+/*
+ * LineProtocol.cpp
+ * InfluxDB line-protocol writer implementation
+ */
+
+#include "LineProtocol.h"
+#include "Constants.h"
+#include <math.h>
+#include <stdio.h>
+
+//=====================================================================
+// STATE
+//=====================================================================
+// The message being filled; shared by writers, which never overlap
+static char message[LINE_PROTOCOL_MESSAGE_MAX];
+static size_t messageLength = 0;
+static LineProtocolStats stats;
+
+static const uint32_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+//=====================================================================
+// NUMBER FORMATTING
+//=====================================================================
+// Digits of value, most significant first; returns the count
+static size_t formatUnsigned(char* out, uint32_t value) {
+    char digits[10];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+size_t formatDecimal(char* out, float value, uint8_t decimals) {
+    if (isnan(value) || isinf(value))
+        return 0;
+
+    if (decimals > 6) {
+        decimals = 6;
+    }
+    uint32_t scale = POWERS_OF_TEN[decimals];
+
+    // Double so the scaled value keeps every digit asked for
+    double scaled = fabs((double)value) * scale + 0.5;
+    if (scaled >= 4294967295.0) {
+        // Beyond 32 bits; no sensor gets here
+        return snprintf(out, 24, "%.7g", value);
+    }
+
+    uint32_t digits = (uint32_t)scaled;
+    size_t length = 0;
+    if (value < 0 && digits > 0) {
+        out[length++] = '-';
+    }
+    length += formatUnsigned(out + length, digits / scale);
+
+    uint32_t fraction = digits % scale;
+    if (fraction > 0) {
+        // Trailing zeros carry nothing
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            scale /= 10;
+        }
+        out[length++] = '.';
+        for (scale /= 10; scale > 0; scale /= 10) {
+            out[length++] = '0' + fraction / scale % 10;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+//=====================================================================
+// WRITER
+//=====================================================================
+LineProtocolWriter::LineProtocolWriter(PubSubClient& client, const char* topic,
+                                       size_t messageSize)
+    : client(client), topic(topic), messageSize(messageSize), published(0), failed(false),
+      clock(epochClock()), lineLength(0), fields(0), overflow(false) {
+    if (this->messageSize < LINE_PROTOCOL_MESSAGE_MIN) {
+        this->messageSize = LINE_PROTOCOL_MESSAGE_MIN;
+    } else if (this->messageSize > LINE_PROTOCOL_MESSAGE_MAX) {
+        this->messageSize = LINE_PROTOCOL_MESSAGE_MAX;
+    }
+}
+
+void LineProtocolWriter::append(const char* text, size_t length) {
+    if (lineLength + length > sizeof(line)) {
+        overflow = true;
+        return;
+    }
+    memcpy(line + lineLength, text, length);
+    lineLength += length;
+}
+
+void LineProtocolWriter::appendChar(char c) {
+    append(&c, 1);
+}
+
+// Measurement names, tag values and field keys escape the characters
+// that delimit them
+void LineProtocolWriter::appendEscaped(const char* text) {
+    for (; *text; text++) {
+        if (*text == ',' || *text == ' ' || *text == '=') {
+            appendChar('\\');
+        }
+        appendChar(*text);
+    }
+}
+
+void LineProtocolWriter::beginLine(const char* measurement) {
+    lineLength = 0;
+    fields = 0;
+    overflow = false;
+
+    appendEscaped(measurement);
+    append(",device=", 8);
+    appendEscaped(MQTT_CLIENT_ID);
+}
+
+void LineProtocolWriter::key(const char* name) {
+    appendChar(fields++ == 0 ? ' ' : ',');
+    appendEscaped(name);
+    appendChar('=');
+}
+
+void LineProtocolWriter::field(const char* name, float value, uint8_t decimals) {
+    char text[24];
+    size_t length = formatDecimal(text, value, decimals);
+    if (length == 0)
+        return;
+
+    key(name);
+    append(text, length);
+}
+
+void LineProtocolWriter::field(const char* name, unsigned long value) {
+    char text[12];
+    size_t length = formatUnsigned(text, value);
+
+    key(name);
+    append(text, length);
+    appendChar('i');
+}
+
+void LineProtocolWriter::field(const char* name, bool value) {
+    key(name);
+    append(value ? "true" : "false", value ? 4 : 5);
+}
+
+void LineProtocolWriter::endLine(unsigned long timestamp) {
+    uint64_t epoch = epochAt(clock, timestamp);
+    if (epoch != 0) {
+        // Seconds fit 32 bits until 2106; the milliseconds keep their zeros
+        char text[16];
+        size_t length = formatUnsigned(text, (uint32_t)(epoch / 1000));
+        uint32_t millisecond = (uint32_t)(epoch % 1000);
+        text[length++] = '0' + millisecond / 100;
+        text[length++] = '0' + millisecond / 10 % 10;
+        text[length++] = '0' + millisecond % 10;
+
+        appendChar(' ');
+        append(text, length);
+    }
+    appendChar('\n');
+
+    if (overflow) {
+        Serial.println("Line protocol point too long, dropped");
+        return;
+    }
+    if (fields == 0)
+        return;
+
+    if (messageLength + lineLength > messageSize) {
+        publishMessage();
+    }
+    memcpy(message + messageLength, line, lineLength);
+    messageLength += lineLength;
+    stats.lines++;
+}
+
+bool LineProtocolWriter::publishMessage() {
+    if (messageLength == 0)
+        return true;
+
+    bool sent = client.beginPublish(topic, messageLength, false);
+    if (sent) {
+        client.write((const uint8_t*)message, messageLength);
+        sent = client.endPublish();
+    }
+
+    if (sent) {
+        stats.messages++;
+        stats.bytes += messageLength;
+        published += messageLength;
+    } else {
+        stats.failures++;
+        failed = true;
+    }
+    messageLength = 0;
+    return sent;
+}
+
+bool LineProtocolWriter::finish() {
+    publishMessage();
+    return !failed;
+}
+
+void lineProtocolTakeStats(LineProtocolStats& out) {
+    out = stats;
+}
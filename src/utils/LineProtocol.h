@@ -0,0 +1,108 @@
+/*
+ * LineProtocol.h
+ * InfluxDB line-protocol export over MQTT
+ *
+ * Points are written one line each,
+ *
+ *   imu,device=ArduinoSensorHub accel_x=0.0123,accel_y=-0.004 1767225600123
+ *
+ * and packed into messages of up to config.influxMessageSize bytes, so
+ * Telegraf's mqtt_consumer (data_format = "influx", precision = "1ms")
+ * receives bulk writes rather than one point per message. Callers pass
+ * the device's millisecond clock, as in the JSON payloads, and the writer
+ * converts it to Unix time through an EpochReference. Until the device
+ * has the time the timestamp is left out and InfluxDB stamps the point
+ * on arrival, which is only right for a point sent as it is taken.
+ *
+ * Floats are formatted as scaled integers instead of through printf:
+ * a fixed number of decimals, trailing zeros dropped. NaN has no line
+ * protocol representation, so such fields are left out, and a point with
+ * no fields left is dropped.
+ */
+
+#ifndef LINE_PROTOCOL_H
+#define LINE_PROTOCOL_H
+
+#include "EpochClock.h"
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define LINE_PROTOCOL_MESSAGE_MIN 256  // Bytes; config.influxMessageSize is clamped
+#define LINE_PROTOCOL_MESSAGE_MAX 4096 // to this range
+#define LINE_PROTOCOL_LINE_MAX 256     // Longest single point
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+// Counters run from boot so dashboards can difference them
+struct LineProtocolStats {
+    uint32_t lines;
+    uint32_t messages;
+    uint32_t bytes;
+    uint32_t failures; // Messages the client refused; their points are lost
+};
+
+// Writes points into a shared message buffer and publishes it whenever
+// the next point would not fit. Only one writer may be open at a time,
+// from core0.
+class LineProtocolWriter {
+  public:
+    LineProtocolWriter(PubSubClient& client, const char* topic, size_t messageSize);
+
+    // Start a point of measurement, tagged with the device id
+    void beginLine(const char* measurement);
+
+    // Fields of the current point
+    void field(const char* key, float value, uint8_t decimals);
+    void field(const char* key, unsigned long value);
+    void field(const char* key, bool value);
+
+    // Finish the current point at timestamp (device ms)
+    void endLine(unsigned long timestamp);
+
+    // Convert timestamps through reference rather than epochClock()
+    void setClock(const EpochReference& reference) { clock = reference; }
+
+    // Whether points carry a timestamp
+    bool timestamped() const { return clock.epochMs != 0; }
+
+    // Publish the points still held. Returns false if any message of this
+    // writer failed.
+    bool finish();
+
+    // Payload bytes published so far
+    size_t length() const { return published; }
+
+  private:
+    void append(const char* text, size_t length);
+    void appendChar(char c);
+    void appendEscaped(const char* text);
+    void key(const char* name);
+    bool publishMessage();
+
+    PubSubClient& client;
+    const char* topic;
+    size_t messageSize;
+    size_t published;
+    bool failed;
+    EpochReference clock;
+
+    char line[LINE_PROTOCOL_LINE_MAX];
+    size_t lineLength;
+    uint8_t fields;
+    bool overflow;
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Format value with at most decimals (0-6) fractional digits into out,
+// which must hold 24 bytes. Returns the length, 0 for NaN or infinity.
+size_t formatDecimal(char* out, float value, uint8_t decimals);
+
+void lineProtocolTakeStats(LineProtocolStats& stats);
+
+#endif // LINE_PROTOCOL_H
@@ -0,0 +1,96 @@
+/*
+ * Profiler.cpp
+ * Execution time statistics implementation
+ */
+
+#include "Profiler.h"
+#include <string.h>
+
+#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+#include <hardware/timer.h>
+#elif defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+//=====================================================================
+// GLOBAL VARIABLES
+//=====================================================================
+static const char* const SCOPE_NAMES[PROFILE_SCOPE_COUNT] = {
+    "read_sensors", "dht_read",      "imu_service",  "audio_service",
+    "anomalies",    "publish",       "publish_batch", "buffer_drain",
+};
+
+struct ProfileSlot {
+    ProfileStats stats;
+    uint32_t generation; // Matches resetGeneration once cleared since the last reset
+};
+
+static ProfileSlot slots[PROFILE_SCOPE_COUNT];
+static volatile uint32_t resetGeneration = 0;
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static int histogramBucket(uint32_t elapsedUs) {
+    if (elapsedUs < 2)
+        return 0;
+
+    int bucket = 31 - __builtin_clz(elapsedUs);
+    return bucket < PROFILE_HISTOGRAM_BUCKETS ? bucket : PROFILE_HISTOGRAM_BUCKETS - 1;
+}
+
+//=====================================================================
+// PROFILER FUNCTIONS
+//=====================================================================
+uint32_t profileNowUs() {
+#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_MBED_RP2040)
+    return time_us_32();
+#elif defined(ARDUINO)
+    return micros();
+#else
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void profileRecord(ProfileScopeId scope, uint32_t elapsedUs) {
+    if (scope >= PROFILE_SCOPE_COUNT)
+        return;
+
+    ProfileSlot& slot = slots[scope];
+    ProfileStats& stats = slot.stats;
+
+    uint32_t generation = resetGeneration;
+    if (slot.generation != generation) {
+        memset(&stats, 0, sizeof(stats));
+        slot.generation = generation;
+    }
+
+    if (stats.count == 0 || elapsedUs < stats.minUs) {
+        stats.minUs = elapsedUs;
+    }
+    if (elapsedUs > stats.maxUs) {
+        stats.maxUs = elapsedUs;
+    }
+    stats.count++;
+    stats.totalUs += elapsedUs;
+    stats.histogram[histogramBucket(elapsedUs)]++;
+}
+
+void profileSnapshot(ProfileScopeId scope, ProfileStats& stats) {
+    if (scope >= PROFILE_SCOPE_COUNT || slots[scope].generation != resetGeneration) {
+        memset(&stats, 0, sizeof(stats));
+        return;
+    }
+    stats = slots[scope].stats;
+}
+
+const char* profileScopeName(ProfileScopeId scope) {
+    return scope < PROFILE_SCOPE_COUNT ? SCOPE_NAMES[scope] : "unknown";
+}
+
+void profileReset() {
+    resetGeneration = resetGeneration + 1;
+}
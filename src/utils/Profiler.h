@@ -0,0 +1,99 @@
+/*
+ * Profiler.h
+ * Execution time statistics for hot code paths
+ *
+ * PROFILE_SCOPE(id) at the top of a block times it until the block exits
+ * and folds the duration into that scope's count, min/avg/max and a
+ * log2 histogram. Durations come from the RP2040's free-running 1 MHz
+ * timer (the Cortex-M0+ has no cycle counter) and from std::chrono on
+ * the host. Recording is a timer read, a few compares and adds, and one
+ * clz; building with -DSENSORHUB_PROFILE=0 removes the hooks entirely.
+ *
+ * Each scope must only be entered from one core. A report taken while
+ * the other core is recording may be off by the sample in flight.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#ifndef SENSORHUB_PROFILE
+#define SENSORHUB_PROFILE 1
+#endif
+
+// Bucket k counts durations in [2^k, 2^(k+1)) us (bucket 0 also holds
+// 0 us); the last bucket takes everything from about half a second up
+#define PROFILE_HISTOGRAM_BUCKETS 20
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+enum ProfileScopeId : uint8_t {
+    PROFILE_READ_SENSORS,
+    PROFILE_DHT_READ,
+    PROFILE_IMU_SERVICE,
+    PROFILE_AUDIO_SERVICE,
+    PROFILE_ANOMALIES,
+    PROFILE_PUBLISH,
+    PROFILE_PUBLISH_BATCH,
+    PROFILE_BUFFER_DRAIN,
+    PROFILE_SCOPE_COUNT
+};
+
+struct ProfileStats {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Microseconds from the profiling timer (wraps after about 71 minutes)
+uint32_t profileNowUs();
+
+// Add one duration to a scope
+void profileRecord(ProfileScopeId scope, uint32_t elapsedUs);
+
+// Copy of a scope's statistics since the last reset
+void profileSnapshot(ProfileScopeId scope, ProfileStats& stats);
+
+// Name used in reports
+const char* profileScopeName(ProfileScopeId scope);
+
+// Clear every scope. Each scope is cleared by its own core on its next
+// record, so a reset never races a recording in progress.
+void profileReset();
+
+// Times its own lifetime into a scope
+class ProfileTimer {
+  public:
+    explicit ProfileTimer(ProfileScopeId scope) : scope(scope), start(profileNowUs()) {}
+    ~ProfileTimer() { profileRecord(scope, profileNowUs() - start); }
+
+  private:
+    ProfileTimer(const ProfileTimer&);
+    ProfileTimer& operator=(const ProfileTimer&);
+
+    ProfileScopeId scope;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if SENSORHUB_PROFILE
+#define PROFILE_SCOPE(scope) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)(scope)
+#else
+#define PROFILE_SCOPE(scope) \
+    do {                     \
+    } while (0)
+#endif
+
+#endif // PROFILER_H
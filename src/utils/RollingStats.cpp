@@ -0,0 +1,77 @@
+/*
+ * RollingStats.cpp
+ * Incremental windowed statistics implementation
+ */
+
+#include "RollingStats.h"
+#include <math.h>
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+// Exact two-pass recomputation over the window
+static void resync(RollingStats& stats) {
+    float sum = 0.0;
+    for (int i = 0; i < stats.count; i++) {
+        sum += stats.window[i];
+    }
+    stats.mean = sum / stats.count;
+
+    float sumSquaredDiff = 0.0;
+    for (int i = 0; i < stats.count; i++) {
+        float diff = stats.window[i] - stats.mean;
+        sumSquaredDiff += diff * diff;
+    }
+    stats.m2 = sumSquaredDiff;
+    stats.updatesSinceResync = 0;
+}
+
+//=====================================================================
+// ROLLING STATISTICS FUNCTIONS
+//=====================================================================
+void rollingStatsReset(RollingStats& stats) {
+    stats.index = 0;
+    stats.count = 0;
+    stats.updatesSinceResync = 0;
+    stats.mean = 0.0;
+    stats.m2 = 0.0;
+}
+
+void rollingStatsAdd(RollingStats& stats, float value) {
+    if (stats.count < HISTORY_SIZE) {
+        stats.count++;
+        float delta = value - stats.mean;
+        stats.mean += delta / stats.count;
+        stats.m2 += delta * (value - stats.mean);
+    } else {
+        float oldest = stats.window[stats.index];
+        float oldMean = stats.mean;
+        stats.mean += (value - oldest) / HISTORY_SIZE;
+        stats.m2 += (value - oldest) * (value - stats.mean + oldest - oldMean);
+        if (stats.m2 < 0.0) {
+            stats.m2 = 0.0;
+        }
+    }
+
+    stats.window[stats.index] = value;
+    stats.index = (stats.index + 1) % HISTORY_SIZE;
+
+    if (++stats.updatesSinceResync >= HISTORY_SIZE) {
+        resync(stats);
+    }
+}
+
+bool rollingStatsFull(const RollingStats& stats) {
+    return stats.count >= HISTORY_SIZE;
+}
+
+float rollingStatsMean(const RollingStats& stats) {
+    return stats.mean;
+}
+
+float rollingStatsStdDev(const RollingStats& stats) {
+    if (stats.count == 0)
+        return 0.0;
+
+    return sqrt(stats.m2 / stats.count);
+}
@@ -0,0 +1,44 @@
+/*
+ * RollingStats.h
+ * Windowed mean and standard deviation in O(1) per sample
+ *
+ * Each channel keeps its own window, index and fill state. The mean and
+ * sum of squared deviations are updated incrementally (Welford's method,
+ * extended to remove the sample leaving the window) and re-derived
+ * exactly once per window length to stop float rounding from drifting.
+ */
+
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include "Constants.h"
+
+//=====================================================================
+// DATA STRUCTURES
+//=====================================================================
+struct RollingStats {
+    float window[HISTORY_SIZE];
+    int index;
+    int count;
+    int updatesSinceResync;
+    float mean;
+    float m2; // Sum of squared deviations from the mean
+};
+
+//=====================================================================
+// FUNCTION PROTOTYPES
+//=====================================================================
+// Empty the window
+void rollingStatsReset(RollingStats& stats);
+
+// Add a sample, evicting the oldest once the window is full
+void rollingStatsAdd(RollingStats& stats, float value);
+
+// True once HISTORY_SIZE samples have been seen
+bool rollingStatsFull(const RollingStats& stats);
+
+// Mean and population standard deviation of the window
+float rollingStatsMean(const RollingStats& stats);
+float rollingStatsStdDev(const RollingStats& stats);
+
+#endif // ROLLING_STATS_H
@@ -0,0 +1,165 @@
+/*
+ * test_main.cpp
+ * AudioLevel accuracy on synthetic signals, and the per-sample cost of
+ * the block kernel
+ *
+ * The cost is measured on the host, so it only compares versions of the
+ * kernel; the device's own figures come from the audio_service scope of
+ * the profile report.
+ */
+
+#include "AudioLevel.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SAMPLE_RATE 16000
+#define BLOCK_SAMPLES 256 // One PDM callback's worth
+#define SIGNAL_SAMPLES 16384
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static int16_t samples[SIGNAL_SAMPLES];
+
+static void makeSine(float amplitude, float frequency, int16_t offset) {
+    for (int i = 0; i < SIGNAL_SAMPLES; i++) {
+        double phase = 2 * M_PI * frequency * i / SAMPLE_RATE;
+        samples[i] = (int16_t)lround(offset + amplitude * sin(phase));
+    }
+}
+
+static void accumulateBlocks(AudioWindow& window, size_t blockSamples) {
+    for (size_t i = 0; i < SIGNAL_SAMPLES; i += blockSamples) {
+        size_t count = SIGNAL_SAMPLES - i < blockSamples ? SIGNAL_SAMPLES - i : blockSamples;
+        audioWindowAccumulate(window, samples + i, count);
+    }
+}
+
+static float dbfs(double rms) {
+    return 20.0 * log10(rms / AUDIO_FULL_SCALE);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// A 1 kHz tone on top of the microphone's DC offset: the offset is left
+// out of the RMS and Leq, but not the peak
+void test_sine_with_offset() {
+    makeSine(10000, 1000, 500);
+    AudioWindow window;
+    audioWindowReset(window);
+    accumulateBlocks(window, BLOCK_SAMPLES);
+
+    AudioLevels levels;
+    TEST_ASSERT_TRUE(audioWindowLevels(window, levels));
+    TEST_ASSERT_EQUAL_UINT32(SIGNAL_SAMPLES, levels.samples);
+    TEST_ASSERT_EQUAL_UINT32(SIGNAL_SAMPLES / BLOCK_SAMPLES, window.blocks);
+    TEST_ASSERT_FLOAT_WITHIN(10000 / sqrt(2.0) * 1e-3, 10000 / sqrt(2.0), levels.rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, dbfs(10000 / sqrt(2.0)), levels.leq);
+    TEST_ASSERT_FLOAT_WITHIN(1, 10500, levels.peak);
+}
+
+// The levels do not depend on how the stream was split into blocks
+void test_block_size_does_not_matter() {
+    makeSine(3000, 440, -200);
+    AudioWindow window;
+    AudioLevels reference;
+    audioWindowReset(window);
+    accumulateBlocks(window, 1);
+    audioWindowLevels(window, reference);
+
+    const size_t sizes[] = {7, 64, 256, 1000, SIGNAL_SAMPLES};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        audioWindowReset(window);
+        accumulateBlocks(window, sizes[i]);
+
+        AudioLevels levels;
+        audioWindowLevels(window, levels);
+        TEST_ASSERT_EQUAL_FLOAT(reference.rms, levels.rms);
+        TEST_ASSERT_EQUAL_FLOAT(reference.peak, levels.peak);
+    }
+}
+
+// Full-scale square wave including -32768, over a minute of samples:
+// nothing overflows and Leq comes out at 0 dBFS
+void test_full_scale_long_window() {
+    for (int i = 0; i < SIGNAL_SAMPLES; i++) {
+        samples[i] = (i / 8) % 2 ? -32768 : 32767;
+    }
+    AudioWindow window;
+    audioWindowReset(window);
+    for (int pass = 0; pass < 60 * SAMPLE_RATE / SIGNAL_SAMPLES; pass++) {
+        accumulateBlocks(window, BLOCK_SAMPLES);
+    }
+
+    AudioLevels levels;
+    TEST_ASSERT_TRUE(audioWindowLevels(window, levels));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 32767.5, levels.rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.0, levels.leq);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 32768, levels.peak);
+}
+
+void test_silence_and_empty_window() {
+    AudioWindow window;
+    audioWindowReset(window);
+    AudioLevels levels;
+    TEST_ASSERT_FALSE(audioWindowLevels(window, levels));
+    TEST_ASSERT_FLOAT_WITHIN(0, AUDIO_LEQ_FLOOR, levels.leq);
+
+    makeSine(0, 1000, 120); // DC only
+    accumulateBlocks(window, BLOCK_SAMPLES);
+    TEST_ASSERT_TRUE(audioWindowLevels(window, levels));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, levels.rms);
+    TEST_ASSERT_FLOAT_WITHIN(0, AUDIO_LEQ_FLOOR, levels.leq);
+}
+
+// A quiet tone still reads right: one count of amplitude is -96 dBFS
+void test_quiet_tone() {
+    makeSine(8, 250, 0);
+    AudioWindow window;
+    audioWindowReset(window);
+    accumulateBlocks(window, BLOCK_SAMPLES);
+
+    AudioLevels levels;
+    audioWindowLevels(window, levels);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, dbfs(8 / sqrt(2.0)), levels.leq);
+}
+
+void test_cost_per_sample() {
+    makeSine(10000, 1000, 500);
+    AudioWindow window;
+    audioWindowReset(window);
+
+    const int passes = 2000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        accumulateBlocks(window, BLOCK_SAMPLES);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    char message[96];
+    snprintf(message, sizeof(message), "%.2f ns per sample in %d-sample blocks (host)",
+             elapsed.count() / ((double)passes * SIGNAL_SAMPLES), BLOCK_SAMPLES);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)passes * SIGNAL_SAMPLES, window.samples);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sine_with_offset);
+    RUN_TEST(test_block_size_does_not_matter);
+    RUN_TEST(test_full_scale_long_window);
+    RUN_TEST(test_silence_and_empty_window);
+    RUN_TEST(test_quiet_tone);
+    RUN_TEST(test_cost_per_sample);
+    return UNITY_END();
+}
@@ -0,0 +1,367 @@
+/*
+ * test_main.cpp
+ * BinaryTelemetry round trips: every message type encoded and decoded
+ * back bit for bit, batches with channels left out, and a batch recorded
+ * from version 1 firmware, which still has to decode
+ */
+
+#include "BinaryTelemetry.h"
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define MESSAGE_CAPACITY BINARY_BATCH_SIZE(TELEMETRY_BATCH_CAPACITY)
+
+// A low battery alert at uptime 0x01020304 ms, as sent
+static const uint8_t ALERT_BYTES[BINARY_ALERT_SIZE] = {
+    0xB7, 0x02, 0x03, 0x00, 0x04, 0x03, 0x02, 0x01, // Header
+    0x01, 0x06, 0x00, 0x00,                         // Kind, sensor, reserved
+    0x00, 0x00, 0x48, 0x41,                         // 12.5 %
+    0x00, 0x00, 0x50, 0x40,                         // 3.25 V
+    0x00, 0x00, 0x00, 0x00,                         // Unused
+};
+
+// Three samples from version 1 firmware, every channel present
+static const uint8_t V1_BATCH[] = {
+    0xB7, 0x01, 0x04, 0x01, 0xC0, 0xD4, 0x01, 0x00, // Header, version 1, on battery
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xAF, 0x42, // Count, reserved, battery
+    0x00, 0x00, 0x00, 0x00, 0xE8, 0x03, 0x00, 0x00, 0xC4, 0x09, 0x00, 0x00, // Offsets
+    0x00, 0x00, 0xAC, 0x41, 0x00, 0x00, 0xAE, 0x41, 0x00, 0x00, 0xB0, 0x41, // Temperature
+    0x00, 0x00, 0x36, 0x42, 0x00, 0x00, 0xC0, 0x7F, 0x00, 0x00, 0x38, 0x42, // Humidity
+    0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x80, 0x3C, 0x00, 0x00, 0x00, 0xBC, // Accel x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, // Accel y
+    0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x7C, 0x3F, 0x00, 0x00, 0x82, 0x3F, // Accel z
+    0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x80, 0xBE, 0x00, 0x00, 0x00, 0x00, // Gyro x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x80, 0x3E, // Gyro y
+    0x00, 0x00, 0x00, 0xBF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, // Gyro z
+    0x00, 0x00, 0x10, 0x40, 0x00, 0x00, 0x20, 0x40, 0x00, 0x00, 0x18, 0x40, // Gas Rs/R0
+    0x00, 0x00, 0x5C, 0x43, 0x00, 0x80, 0x67, 0x43, 0x00, 0x40, 0x5A, 0x43, // Sound level
+};
+
+// Decoded values of V1_BATCH, by channel; the second humidity is NaN
+static const uint32_t V1_TIMESTAMPS[3] = {120000, 121000, 122500};
+static const float V1_COLUMNS[TELEMETRY_CHANNELS][3] = {
+    {21.5f, 21.75f, 22.0f},
+    {45.5f, NAN, 46.0f},
+    {0.0078125f, 0.015625f, -0.0078125f},
+    {0, 0.0078125f, 0},
+    {1.0f, 0.984375f, 1.015625f},
+    {0.5f, -0.25f, 0},
+    {0, 0.125f, 0.25f},
+    {-0.5f, 0, 0.5f},
+    {2.25f, 2.5f, 2.375f},
+    {220.0f, 231.5f, 218.25f},
+};
+#define V1_BATTERY 87.5f
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static uint8_t message[MESSAGE_CAPACITY];
+static TelemetryBatch batch;
+static TelemetryBatch decoded;
+
+// Same bits, so NaN matches NaN and -0 does not match 0
+static void checkSameFloat(float expected, float actual) {
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &actual, sizeof(float));
+}
+
+// A full window of readings that change every sample, with gaps
+static void fillBatch(uint16_t count) {
+    memset(&batch, 0, sizeof(batch));
+    batch.count = count;
+    for (uint16_t i = 0; i < count; i++) {
+        batch.timestamps[i] = 4000000000UL + i * 1013;
+        for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+            float value = (channel + 1) * 10.0f + i * 0.37f - 3.1f * (i % 5);
+            telemetryBatchColumn(batch, channel)[i] = (i + channel) % 11 == 0 ? NAN : value;
+        }
+    }
+}
+
+static void checkBatch(const TelemetryBatch& expected, uint16_t channels) {
+    TEST_ASSERT_EQUAL_UINT16(expected.count, decoded.count);
+    for (uint16_t i = 0; i < expected.count; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected.timestamps[i], decoded.timestamps[i]);
+    }
+    for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+        for (uint16_t i = 0; i < expected.count; i++) {
+            float value = telemetryBatchColumn(decoded, channel)[i];
+            if (channels & (1 << channel)) {
+                checkSameFloat(telemetryBatchColumn(expected, channel)[i], value);
+            } else {
+                TEST_ASSERT_TRUE(isnan(value));
+            }
+        }
+    }
+}
+
+void setUp() {
+    memset(message, 0, sizeof(message));
+    memset(&decoded, 0xA5, sizeof(decoded));
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// The layout is fixed little endian, whatever the host
+void test_alert_bytes() {
+    TelemetryAlert alert = {ALERT_LOW_BATTERY, TELEMETRY_SENSOR_BATTERY, 12.5f, 3.25f, 0};
+    TEST_ASSERT_EQUAL(BINARY_ALERT_SIZE,
+                      encodeTelemetryAlert(message, sizeof(message), 0x01020304, false, alert));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ALERT_BYTES, message, BINARY_ALERT_SIZE);
+
+    TelemetryHeader header;
+    TEST_ASSERT_TRUE(decodeTelemetryHeader(ALERT_BYTES, sizeof(ALERT_BYTES), header));
+    TEST_ASSERT_EQUAL(BINARY_TELEMETRY_VERSION, header.version);
+    TEST_ASSERT_EQUAL(TELEMETRY_ALERT, header.type);
+    TEST_ASSERT_FALSE(header.onBattery);
+    TEST_ASSERT_EQUAL_UINT32(0x01020304, header.timestamp);
+
+    TelemetryAlert back;
+    TEST_ASSERT_TRUE(decodeTelemetryAlert(ALERT_BYTES, sizeof(ALERT_BYTES), back));
+    TEST_ASSERT_EQUAL(ALERT_LOW_BATTERY, back.kind);
+    TEST_ASSERT_EQUAL(TELEMETRY_SENSOR_BATTERY, back.sensor);
+    checkSameFloat(12.5f, back.value);
+    checkSameFloat(3.25f, back.aux1);
+    checkSameFloat(0, back.aux2);
+}
+
+// Headers from another magic, from a version this decoder does not know,
+// or cut short are refused
+void test_header_rejected() {
+    uint8_t bytes[BINARY_ALERT_SIZE];
+    TelemetryHeader header;
+    TelemetryAlert alert;
+
+    memcpy(bytes, ALERT_BYTES, sizeof(bytes));
+    bytes[0] = 0xB8;
+    TEST_ASSERT_FALSE(decodeTelemetryHeader(bytes, sizeof(bytes), header));
+
+    memcpy(bytes, ALERT_BYTES, sizeof(bytes));
+    bytes[1] = 0;
+    TEST_ASSERT_FALSE(decodeTelemetryHeader(bytes, sizeof(bytes), header));
+    bytes[1] = BINARY_TELEMETRY_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeTelemetryHeader(bytes, sizeof(bytes), header));
+
+    TEST_ASSERT_FALSE(decodeTelemetryHeader(ALERT_BYTES, BINARY_TELEMETRY_HEADER_SIZE - 1, header));
+    TEST_ASSERT_FALSE(decodeTelemetryAlert(ALERT_BYTES, BINARY_ALERT_SIZE - 1, alert));
+
+    // Long enough, but of another type
+    TelemetryAlert alertMessage = {ALERT_ANOMALY, TELEMETRY_SENSOR_GAS, 1, 2, 3};
+    encodeTelemetryAlert(message, sizeof(message), 0, false, alertMessage);
+    TelemetrySnapshot snapshot;
+    TEST_ASSERT_FALSE(decodeTelemetrySnapshot(message, BINARY_SNAPSHOT_SIZE, snapshot));
+}
+
+void test_snapshot_round_trip() {
+    TelemetrySnapshot snapshot = {
+        76.5f, 22.3f, NAN, 23.1f, 0.01f, -0.02f, 1.003f, 0.7f,
+        -0.35f, -0.0f, 2.31f, 3.4e-2f, 1.2e9f, INFINITY, 218.7f,
+    };
+    TEST_ASSERT_EQUAL(BINARY_SNAPSHOT_SIZE,
+                      encodeTelemetrySnapshot(message, sizeof(message), 123456789, true, snapshot));
+    TEST_ASSERT_EQUAL(0, encodeTelemetrySnapshot(message, BINARY_SNAPSHOT_SIZE - 1, 0, true,
+                                                 snapshot));
+
+    TelemetryHeader header;
+    TEST_ASSERT_TRUE(decodeTelemetryHeader(message, BINARY_SNAPSHOT_SIZE, header));
+    TEST_ASSERT_TRUE(header.onBattery);
+    TEST_ASSERT_EQUAL_UINT32(123456789, header.timestamp);
+
+    TelemetrySnapshot back;
+    TEST_ASSERT_TRUE(decodeTelemetrySnapshot(message, BINARY_SNAPSHOT_SIZE, back));
+    TEST_ASSERT_EQUAL_MEMORY(&snapshot, &back, sizeof(snapshot));
+}
+
+void test_batch_round_trip() {
+    fillBatch(TELEMETRY_BATCH_CAPACITY);
+    size_t length = encodeTelemetryBatch(message, sizeof(message), true, 64.25f, batch);
+    TEST_ASSERT_EQUAL(BINARY_BATCH_SIZE(TELEMETRY_BATCH_CAPACITY), length);
+
+    float battery = 0;
+    uint16_t channels = 0;
+    TEST_ASSERT_TRUE(decodeTelemetryBatch(message, length, decoded, battery, &channels));
+    TEST_ASSERT_EQUAL_HEX16(TELEMETRY_ALL_CHANNELS, channels);
+    checkSameFloat(64.25f, battery);
+    checkBatch(batch, TELEMETRY_ALL_CHANNELS);
+
+    // One byte short of the last sample
+    TEST_ASSERT_FALSE(decodeTelemetryBatch(message, length - 1, decoded, battery));
+}
+
+// Channels left out of the mask shrink the message and decode as NaN
+void test_batch_omitted_channels() {
+    fillBatch(7);
+    const uint16_t mask = (1 << CHANNEL_TEMPERATURE) | (1 << CHANNEL_ACCEL_Z) |
+                          (1 << CHANNEL_SOUND_LEVEL);
+    size_t length = encodeTelemetryBatch(message, sizeof(message), false, 50, batch, mask);
+    TEST_ASSERT_EQUAL(BINARY_BATCH_SIZE(0) + 7 * 4 * (1 + 3), length);
+
+    float battery;
+    uint16_t channels = 0;
+    TEST_ASSERT_TRUE(decodeTelemetryBatch(message, length, decoded, battery, &channels));
+    TEST_ASSERT_EQUAL_HEX16(mask, channels);
+    checkBatch(batch, mask);
+
+    // Timestamps only
+    length = encodeTelemetryBatch(message, sizeof(message), false, 50, batch, 0);
+    TEST_ASSERT_EQUAL(BINARY_BATCH_SIZE(0) + 7 * 4, length);
+    TEST_ASSERT_TRUE(decodeTelemetryBatch(message, length, decoded, battery, &channels));
+    TEST_ASSERT_EQUAL_HEX16(0, channels);
+    checkBatch(batch, 0);
+}
+
+void test_batch_limits() {
+    fillBatch(0);
+    TEST_ASSERT_EQUAL(0, encodeTelemetryBatch(message, sizeof(message), false, 0, batch));
+
+    fillBatch(10);
+    TEST_ASSERT_EQUAL(0, encodeTelemetryBatch(message, BINARY_BATCH_SIZE(10) - 1, false, 0,
+                                              batch));
+
+    // A count beyond what a batch holds is refused, not read past
+    size_t length = encodeTelemetryBatch(message, sizeof(message), false, 0, batch);
+    message[BINARY_TELEMETRY_HEADER_SIZE] = TELEMETRY_BATCH_CAPACITY + 1;
+    float battery;
+    TEST_ASSERT_FALSE(decodeTelemetryBatch(message, sizeof(message), decoded, battery));
+    TEST_ASSERT_FALSE(decodeTelemetryBatch(message, length, decoded, battery));
+}
+
+// Version 1 batches had a reserved word where the mask now is, and every
+// channel
+void test_v1_batch() {
+    float battery = 0;
+    uint16_t channels = 0;
+    TEST_ASSERT_TRUE(decodeTelemetryBatch(V1_BATCH, sizeof(V1_BATCH), decoded, battery, &channels));
+    TEST_ASSERT_EQUAL_HEX16(TELEMETRY_ALL_CHANNELS, channels);
+    checkSameFloat(V1_BATTERY, battery);
+
+    TelemetryBatch expected;
+    expected.count = 3;
+    for (int i = 0; i < 3; i++) {
+        expected.timestamps[i] = V1_TIMESTAMPS[i];
+        for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+            telemetryBatchColumn(expected, channel)[i] = V1_COLUMNS[channel][i];
+        }
+    }
+    checkBatch(expected, TELEMETRY_ALL_CHANNELS);
+
+    // Whatever is in the reserved word, nothing is left out
+    uint8_t bytes[sizeof(V1_BATCH)];
+    memcpy(bytes, V1_BATCH, sizeof(bytes));
+    bytes[BINARY_TELEMETRY_HEADER_SIZE + 2] = 0xFF;
+    bytes[BINARY_TELEMETRY_HEADER_SIZE + 3] = 0xFF;
+    TEST_ASSERT_TRUE(decodeTelemetryBatch(bytes, sizeof(bytes), decoded, battery, &channels));
+    TEST_ASSERT_EQUAL_HEX16(TELEMETRY_ALL_CHANNELS, channels);
+    checkBatch(expected, TELEMETRY_ALL_CHANNELS);
+
+    // Version 2 encodes the same batch to the same bytes but the version
+    TEST_ASSERT_EQUAL(sizeof(V1_BATCH),
+                      encodeTelemetryBatch(message, sizeof(message), true, V1_BATTERY, expected));
+    TEST_ASSERT_EQUAL_HEX8(BINARY_TELEMETRY_VERSION, message[1]);
+    message[1] = 1;
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(V1_BATCH, message, sizeof(V1_BATCH));
+}
+
+void test_vibration_round_trip() {
+    VibrationFeatures features = {987654, 417, 12, 48.87f, 0.031f, 0.12f, 3.87f,
+                                  {0.004f, 0.021f, 0.017f, 0.0025f}};
+    TEST_ASSERT_EQUAL(BINARY_VIBRATION_SIZE,
+                      encodeTelemetryVibration(message, sizeof(message), false, features));
+
+    VibrationFeatures back;
+    memset(&back, 0, sizeof(back));
+    TEST_ASSERT_TRUE(decodeTelemetryVibration(message, BINARY_VIBRATION_SIZE, back));
+    TEST_ASSERT_EQUAL_UINT32(features.timestamp, back.timestamp);
+    TEST_ASSERT_EQUAL_UINT16(features.blocks, back.blocks);
+    checkSameFloat(features.sampleRate, back.sampleRate);
+    checkSameFloat(features.dominantFrequency, back.dominantFrequency);
+    checkSameFloat(features.rms, back.rms);
+    checkSameFloat(features.peak, back.peak);
+    checkSameFloat(features.crestFactor, back.crestFactor);
+    TEST_ASSERT_EQUAL_MEMORY(features.bandRms, back.bandRms, sizeof(features.bandRms));
+}
+
+void test_acoustic_round_trip() {
+    OctaveLevels levels;
+    levels.timestamp = 555000;
+    levels.sampleRate = 16000;
+    levels.samples = 960000;
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        levels.level[band] = -80.5f + band * 7.25f;
+    }
+    levels.level[0] = -INFINITY; // Silence in the lowest band
+    TEST_ASSERT_EQUAL(BINARY_ACOUSTIC_SIZE,
+                      encodeTelemetryAcoustic(message, sizeof(message), true, levels));
+
+    OctaveLevels back;
+    TEST_ASSERT_TRUE(decodeTelemetryAcoustic(message, BINARY_ACOUSTIC_SIZE, back));
+    TEST_ASSERT_EQUAL_UINT32(levels.timestamp, back.timestamp);
+    checkSameFloat(levels.sampleRate, back.sampleRate);
+    TEST_ASSERT_EQUAL_MEMORY(levels.level, back.level, sizeof(levels.level));
+
+    // Another band layout cannot be read into this one
+    message[BINARY_TELEMETRY_HEADER_SIZE] = OCTAVE_BANDS + 1;
+    TEST_ASSERT_FALSE(decodeTelemetryAcoustic(message, BINARY_ACOUSTIC_SIZE, back));
+}
+
+// Readings appended one by one until the buffer is full
+void test_buffered_round_trip() {
+    const size_t capacity = BINARY_TELEMETRY_HEADER_SIZE + 2 + 5 * BINARY_BUFFERED_READING_SIZE;
+    size_t length = beginBufferedBatch(message, capacity, 3600000, false);
+    TEST_ASSERT_EQUAL(BINARY_TELEMETRY_HEADER_SIZE + 2, length);
+    TEST_ASSERT_EQUAL(0, bufferedBatchCount(message, length));
+
+    SensorReading readings[5];
+    for (int i = 0; i < 5; i++) {
+        readings[i].timestamp = 3000000 + i * 60000;
+        readings[i].temperature = 19.5f + i;
+        readings[i].humidity = i == 2 ? NAN : 50.0f - i;
+        readings[i].accelMagnitude = 1.0f + i * 0.001f;
+        readings[i].gasRatio = 2.4f;
+        readings[i].soundLevel = 210.0f + i * 3;
+        readings[i].batteryPercentage = 90.0f - i * 0.5f;
+        length = addBufferedReading(message, capacity, length, readings[i]);
+        TEST_ASSERT_EQUAL(BINARY_TELEMETRY_HEADER_SIZE + 2 + (i + 1) * BINARY_BUFFERED_READING_SIZE,
+                          length);
+    }
+    TEST_ASSERT_EQUAL(0, addBufferedReading(message, capacity, length, readings[0]));
+
+    TEST_ASSERT_EQUAL(5, bufferedBatchCount(message, length));
+    TEST_ASSERT_EQUAL(0, bufferedBatchCount(message, length - 1));
+    for (int i = 0; i < 5; i++) {
+        SensorReading back;
+        TEST_ASSERT_TRUE(decodeBufferedReading(message, length, i, back));
+        TEST_ASSERT_EQUAL_UINT32(readings[i].timestamp, back.timestamp);
+        checkSameFloat(readings[i].temperature, back.temperature);
+        checkSameFloat(readings[i].humidity, back.humidity);
+        checkSameFloat(readings[i].accelMagnitude, back.accelMagnitude);
+        checkSameFloat(readings[i].gasRatio, back.gasRatio);
+        checkSameFloat(readings[i].soundLevel, back.soundLevel);
+        checkSameFloat(readings[i].batteryPercentage, back.batteryPercentage);
+    }
+
+    SensorReading back;
+    TEST_ASSERT_FALSE(decodeBufferedReading(message, length, 5, back));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_alert_bytes);
+    RUN_TEST(test_header_rejected);
+    RUN_TEST(test_snapshot_round_trip);
+    RUN_TEST(test_batch_round_trip);
+    RUN_TEST(test_batch_omitted_channels);
+    RUN_TEST(test_batch_limits);
+    RUN_TEST(test_v1_batch);
+    RUN_TEST(test_vibration_round_trip);
+    RUN_TEST(test_acoustic_round_trip);
+    RUN_TEST(test_buffered_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+/*
+ * test_main.cpp
+ * ChannelSchedule against a fake clock: channels on multiples of a base
+ * tick read together, late passes skip the periods they missed, interval
+ * changes re-base on the last read, and the environment channel is held
+ * to DHT_MIN_INTERVAL
+ */
+
+#include "ChannelSchedule.h"
+#include "Config.h"
+#include "Pipeline.h"
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define BASE_TICK 100 // ms
+#define START 1000
+
+//=====================================================================
+// FAKE CLOCK
+//=====================================================================
+static unsigned long fakeNow = 0;
+static ChannelSchedule schedule;
+
+static uint8_t passMasks[256];
+static unsigned long passTimes[256];
+static int passes = 0;
+
+// Sleep until the next channel is due and take it, as the acquisition
+// loop does, up to end
+static void runUntil(unsigned long end) {
+    while (true) {
+        unsigned long wait = channelScheduleUntilNext(schedule, fakeNow);
+        if ((long)(end - fakeNow) < (long)wait)
+            break;
+
+        fakeNow += wait;
+        uint8_t due = channelScheduleTake(schedule, fakeNow);
+        TEST_ASSERT_TRUE(due != 0);
+        if (passes < 256) {
+            passMasks[passes] = due;
+            passTimes[passes] = fakeNow;
+        }
+        passes++;
+    }
+    fakeNow = end;
+}
+
+static void setIntervals(unsigned long environment, unsigned long motion, unsigned long gas,
+                         unsigned long sound) {
+    channelScheduleSetInterval(schedule, SENSOR_ENVIRONMENT, environment, fakeNow);
+    channelScheduleSetInterval(schedule, SENSOR_MOTION, motion, fakeNow);
+    channelScheduleSetInterval(schedule, SENSOR_GAS, gas, fakeNow);
+    channelScheduleSetInterval(schedule, SENSOR_SOUND, sound, fakeNow);
+}
+
+void setUp() {
+    fakeNow = START;
+    passes = 0;
+    channelScheduleBegin(schedule, fakeNow);
+
+    config = DEFAULT_CONFIG;
+    config.adaptiveSamplingEnabled = false;
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// Nothing is due until an interval is set, then everything at once
+void test_first_pass_reads_every_channel() {
+    TEST_ASSERT_EQUAL(0, channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_UINT32((unsigned long)-1, channelScheduleUntilNext(schedule, fakeNow));
+
+    setIntervals(20 * BASE_TICK, BASE_TICK, 2 * BASE_TICK, 4 * BASE_TICK);
+    TEST_ASSERT_EQUAL_UINT32(0, channelScheduleUntilNext(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_HEX8(0x0F, channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL(0, channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_UINT32(BASE_TICK, channelScheduleUntilNext(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_UINT32(BASE_TICK / 2, channelScheduleUntilNext(schedule, fakeNow + 50));
+}
+
+// Channels on multiples of the base tick stay in phase: every pass is on
+// the tick, and a channel is in exactly the passes its multiple divides
+void test_multiples_share_passes() {
+    setIntervals(20 * BASE_TICK, BASE_TICK, 2 * BASE_TICK, 4 * BASE_TICK);
+    runUntil(START + 40 * BASE_TICK);
+
+    TEST_ASSERT_EQUAL(41, passes);
+    for (int pass = 0; pass < passes; pass++) {
+        TEST_ASSERT_EQUAL_UINT32(START + pass * BASE_TICK, passTimes[pass]);
+
+        uint8_t expected = 1 << SENSOR_MOTION;
+        if (pass % 2 == 0) {
+            expected |= 1 << SENSOR_GAS;
+        }
+        if (pass % 4 == 0) {
+            expected |= 1 << SENSOR_SOUND;
+        }
+        if (pass % 20 == 0) {
+            expected |= 1 << SENSOR_ENVIRONMENT;
+        }
+        TEST_ASSERT_EQUAL_HEX8(expected, passMasks[pass]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(3, schedule.reads[SENSOR_ENVIRONMENT]);
+    TEST_ASSERT_EQUAL_UINT32(41, schedule.reads[SENSOR_MOTION]);
+    TEST_ASSERT_EQUAL_UINT32(21, schedule.reads[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(11, schedule.reads[SENSOR_SOUND]);
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        TEST_ASSERT_EQUAL_UINT32(0, schedule.missed[channel]);
+        TEST_ASSERT_EQUAL_UINT32(0, schedule.maxLate[channel]);
+    }
+}
+
+// A pass that comes late reads each channel once and moves it on to the
+// next due time on its grid
+void test_late_pass_skips_missed_periods() {
+    setIntervals(20 * BASE_TICK, BASE_TICK, 2 * BASE_TICK, 4 * BASE_TICK);
+    channelScheduleTake(schedule, fakeNow);
+
+    // Stalled for three and a half ticks
+    fakeNow += 3 * BASE_TICK + BASE_TICK / 2;
+    TEST_ASSERT_EQUAL_HEX8((1 << SENSOR_MOTION) | (1 << SENSOR_GAS),
+                           channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL(0, channelScheduleTake(schedule, fakeNow));
+
+    TEST_ASSERT_EQUAL_UINT32(2, schedule.missed[SENSOR_MOTION]);
+    TEST_ASSERT_EQUAL_UINT32(0, schedule.missed[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(250, schedule.maxLate[SENSOR_MOTION]);
+    TEST_ASSERT_EQUAL_UINT32(150, schedule.maxLate[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(START + 4 * BASE_TICK, schedule.nextDue[SENSOR_MOTION]);
+    TEST_ASSERT_EQUAL_UINT32(START + 4 * BASE_TICK, schedule.nextDue[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(BASE_TICK / 2, channelScheduleUntilNext(schedule, fakeNow));
+
+    // Back on the grid from there, with no burst
+    runUntil(START + 8 * BASE_TICK);
+    TEST_ASSERT_EQUAL(5, passes);
+    for (int pass = 0; pass < passes; pass++) {
+        TEST_ASSERT_EQUAL_UINT32(START + (4 + pass) * BASE_TICK, passTimes[pass]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, schedule.missed[SENSOR_MOTION]);
+}
+
+// Passes stay on the grid across the millis() wrap
+void test_schedule_across_wrap() {
+    fakeNow = 0UL - 2 * BASE_TICK - BASE_TICK / 2;
+    channelScheduleBegin(schedule, fakeNow);
+    unsigned long start = fakeNow;
+    channelScheduleSetInterval(schedule, SENSOR_MOTION, BASE_TICK, fakeNow);
+
+    runUntil(start + 6 * BASE_TICK);
+    TEST_ASSERT_EQUAL(7, passes);
+    for (int pass = 0; pass < passes; pass++) {
+        TEST_ASSERT_EQUAL_UINT32(start + pass * BASE_TICK, passTimes[pass]);
+    }
+}
+
+// A new interval counts from the last read, or is due at once when that
+// time has already passed
+void test_set_interval_rebases() {
+    channelScheduleSetInterval(schedule, SENSOR_GAS, 5 * BASE_TICK, fakeNow);
+    TEST_ASSERT_EQUAL_HEX8(1 << SENSOR_GAS, channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_UINT32(START + 5 * BASE_TICK, schedule.nextDue[SENSOR_GAS]);
+
+    fakeNow += 3 * BASE_TICK;
+    channelScheduleSetInterval(schedule, SENSOR_GAS, 10 * BASE_TICK, fakeNow);
+    TEST_ASSERT_EQUAL_UINT32(7 * BASE_TICK, channelScheduleUntilNext(schedule, fakeNow));
+
+    channelScheduleSetInterval(schedule, SENSOR_GAS, 2 * BASE_TICK, fakeNow);
+    TEST_ASSERT_EQUAL_UINT32(0, channelScheduleUntilNext(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_HEX8(1 << SENSOR_GAS, channelScheduleTake(schedule, fakeNow));
+    TEST_ASSERT_EQUAL_UINT32(0, schedule.maxLate[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(2 * BASE_TICK, channelScheduleUntilNext(schedule, fakeNow));
+
+    // The same interval, 0 and channels out of range change nothing
+    unsigned long due = schedule.nextDue[SENSOR_GAS];
+    channelScheduleSetInterval(schedule, SENSOR_GAS, 2 * BASE_TICK, fakeNow + BASE_TICK);
+    channelScheduleSetInterval(schedule, SENSOR_GAS, 0, fakeNow);
+    channelScheduleSetInterval(schedule, SENSOR_CHANNELS, BASE_TICK, fakeNow);
+    TEST_ASSERT_EQUAL_UINT32(due, schedule.nextDue[SENSOR_GAS]);
+    TEST_ASSERT_EQUAL_UINT32(2 * BASE_TICK, schedule.interval[SENSOR_GAS]);
+}
+
+// However short the environment interval asked, directly or through the
+// shared read interval, the DHT is read at most every DHT_MIN_INTERVAL
+void test_dht_min_interval_clamp() {
+    config.channelInterval[SENSOR_ENVIRONMENT] = 5 * BASE_TICK;
+    TEST_ASSERT_EQUAL_UINT32(DHT_MIN_INTERVAL, channelReadInterval(SENSOR_ENVIRONMENT));
+
+    config.channelInterval[SENSOR_ENVIRONMENT] = 0;
+    config.sensorReadInterval = BASE_TICK;
+    TEST_ASSERT_EQUAL_UINT32(DHT_MIN_INTERVAL, channelReadInterval(SENSOR_ENVIRONMENT));
+    TEST_ASSERT_EQUAL_UINT32(BASE_TICK, channelReadInterval(SENSOR_MOTION));
+
+    config.channelInterval[SENSOR_ENVIRONMENT] = 3 * DHT_MIN_INTERVAL;
+    TEST_ASSERT_EQUAL_UINT32(3 * DHT_MIN_INTERVAL, channelReadInterval(SENSOR_ENVIRONMENT));
+
+    config.channelInterval[SENSOR_ENVIRONMENT] = BASE_TICK;
+    for (int channel = 0; channel < SENSOR_CHANNELS; channel++) {
+        channelScheduleSetInterval(schedule, channel, channelReadInterval(channel), fakeNow);
+    }
+    runUntil(START + 5 * DHT_MIN_INTERVAL);
+
+    TEST_ASSERT_EQUAL_UINT32(6, schedule.reads[SENSOR_ENVIRONMENT]);
+    TEST_ASSERT_EQUAL_UINT32(5 * DHT_MIN_INTERVAL / BASE_TICK + 1, schedule.reads[SENSOR_MOTION]);
+    unsigned long lastEnvironment = 0;
+    bool first = true;
+    for (int pass = 0; pass < passes; pass++) {
+        if (!(passMasks[pass] & (1 << SENSOR_ENVIRONMENT)))
+            continue;
+        if (!first) {
+            TEST_ASSERT_EQUAL_UINT32(DHT_MIN_INTERVAL, passTimes[pass] - lastEnvironment);
+        }
+        lastEnvironment = passTimes[pass];
+        first = false;
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_pass_reads_every_channel);
+    RUN_TEST(test_multiples_share_passes);
+    RUN_TEST(test_late_pass_skips_missed_periods);
+    RUN_TEST(test_schedule_across_wrap);
+    RUN_TEST(test_set_interval_rebases);
+    RUN_TEST(test_dht_min_interval_clamp);
+    return UNITY_END();
+}
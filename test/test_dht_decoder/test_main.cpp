@@ -0,0 +1,178 @@
+/*
+ * test_main.cpp
+ * DhtDecoder on pulse traces in the form the PIO driver captures: the
+ * width of every high pulse in us, with the few us of jitter a sensor
+ * shows from bit to bit
+ */
+
+#include "DhtDecoder.h"
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define DHT_TYPE_DHT22 22 // DHTTYPE, as in the DHT library
+
+// DHT22 reading 45.6 % and 22.3 °C
+static const uint32_t DHT22_FRAME[DHT_FRAME_PULSES] = {
+    81,                             // Response
+    26, 28, 25, 25, 29, 25, 27, 72, // 0x01
+    68, 72, 26, 25, 68, 28, 28, 25, // 0xC8
+    26, 25, 29, 28, 25, 29, 25, 26, // 0x00
+    73, 73, 29, 68, 72, 72, 71, 68, // 0xDF
+    69, 25, 72, 26, 70, 28, 26, 29, // 0xA8 checksum
+};
+static const uint8_t DHT22_BYTES[DHT_FRAME_BYTES] = {0x01, 0xC8, 0x00, 0xDF, 0xA8};
+
+// DHT22 reading 65.0 % and -10.1 °C, the sign in bit 7 of byte 2
+static const uint32_t DHT22_BELOW_ZERO[DHT_FRAME_PULSES] = {
+    79,                             // Response
+    29, 27, 29, 26, 25, 29, 72, 26, // 0x02
+    70, 25, 29, 25, 72, 25, 72, 26, // 0x8A
+    71, 29, 28, 27, 28, 29, 28, 27, // 0x80
+    27, 69, 69, 26, 25, 72, 27, 72, // 0x65
+    28, 70, 73, 71, 27, 29, 25, 68, // 0x71 checksum
+};
+
+// DHT11 reading 45 % and 22 °C
+static const uint32_t DHT11_FRAME[DHT_FRAME_PULSES] = {
+    83,                             // Response
+    28, 26, 70, 26, 71, 71, 25, 73, // 0x2D
+    25, 29, 29, 27, 27, 27, 29, 28, // 0x00
+    29, 28, 25, 68, 27, 71, 73, 25, // 0x16
+    25, 27, 29, 28, 27, 28, 27, 25, // 0x00
+    28, 70, 26, 29, 25, 28, 68, 69, // 0x43 checksum
+};
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static uint32_t trace[DHT_FRAME_PULSES];
+
+static void copyTrace(const uint32_t* frame) {
+    memcpy(trace, frame, sizeof(trace));
+}
+
+// Turn a 0 bit into a 1 or back, as a glitch on the line would
+static void flipBit(int bit) {
+    trace[bit + 1] = trace[bit + 1] > DHT_BIT_ONE_US ? 27 : 70;
+}
+
+static void checkFailed(const DhtReading& reading, DhtStatus status) {
+    TEST_ASSERT_EQUAL(status, reading.status);
+    TEST_ASSERT_TRUE(isnan(reading.temperature));
+    TEST_ASSERT_TRUE(isnan(reading.humidity));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_good_frame() {
+    DhtReading reading;
+    TEST_ASSERT_EQUAL(DHT_OK, dhtDecode(DHT22_FRAME, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(DHT22_BYTES, reading.data, DHT_FRAME_BYTES);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 45.6, reading.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 22.3, reading.temperature);
+}
+
+void test_good_frame_below_zero() {
+    DhtReading reading;
+    TEST_ASSERT_EQUAL(DHT_OK,
+                      dhtDecode(DHT22_BELOW_ZERO, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 65.0, reading.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, -10.1, reading.temperature);
+}
+
+void test_good_dht11_frame() {
+    DhtReading reading;
+    TEST_ASSERT_EQUAL(DHT_OK, dhtDecode(DHT11_FRAME, DHT_FRAME_PULSES, DHT_TYPE_DHT11, reading));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 45, reading.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 22, reading.temperature);
+}
+
+// One flipped bit anywhere in the data bytes fails the checksum, and the
+// bytes are still there to log
+void test_bad_checksum() {
+    for (int bit = 0; bit < 32; bit++) {
+        copyTrace(DHT22_FRAME);
+        flipBit(bit);
+
+        DhtReading reading;
+        TEST_ASSERT_EQUAL(DHT_CHECKSUM,
+                          dhtDecode(trace, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+        checkFailed(reading, DHT_CHECKSUM);
+        TEST_ASSERT_EQUAL_HEX8(DHT22_BYTES[4], reading.data[4]);
+        TEST_ASSERT_EQUAL_HEX8(DHT22_BYTES[bit / 8] ^ (0x80 >> (bit % 8)), reading.data[bit / 8]);
+    }
+
+    // A flip in the checksum byte itself
+    copyTrace(DHT22_FRAME);
+    flipBit(39);
+    DhtReading reading;
+    TEST_ASSERT_EQUAL(DHT_CHECKSUM, dhtDecode(trace, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+}
+
+// A capture that stops early, at every length short of a frame, keeps
+// the bits that did arrive
+void test_truncated() {
+    for (size_t count = 1; count < DHT_FRAME_PULSES; count++) {
+        DhtReading reading;
+        TEST_ASSERT_EQUAL(DHT_TRUNCATED, dhtDecode(DHT22_FRAME, count, DHT_TYPE_DHT22, reading));
+        checkFailed(reading, DHT_TRUNCATED);
+    }
+
+    // Three whole bytes and half of the fourth
+    DhtReading reading;
+    dhtDecode(DHT22_FRAME, 1 + 28, DHT_TYPE_DHT22, reading);
+    const uint8_t expected[DHT_FRAME_BYTES] = {0x01, 0xC8, 0x00, 0x0D, 0x00};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, reading.data, DHT_FRAME_BYTES);
+}
+
+void test_no_response() {
+    DhtReading reading;
+    TEST_ASSERT_EQUAL(DHT_NO_RESPONSE, dhtDecode(DHT22_FRAME, 0, DHT_TYPE_DHT22, reading));
+    checkFailed(reading, DHT_NO_RESPONSE);
+}
+
+// Widths outside a frame's, in the response or in a bit
+void test_bad_pulse() {
+    DhtReading reading;
+
+    copyTrace(DHT22_FRAME);
+    trace[0] = DHT_RESPONSE_MAX_US + 1;
+    TEST_ASSERT_EQUAL(DHT_BAD_PULSE, dhtDecode(trace, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+
+    copyTrace(DHT22_FRAME);
+    trace[17] = DHT_BIT_MIN_US - 1;
+    TEST_ASSERT_EQUAL(DHT_BAD_PULSE, dhtDecode(trace, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+
+    copyTrace(DHT22_FRAME);
+    trace[40] = DHT_BIT_MAX_US + 1;
+    TEST_ASSERT_EQUAL(DHT_BAD_PULSE, dhtDecode(trace, DHT_FRAME_PULSES, DHT_TYPE_DHT22, reading));
+    checkFailed(reading, DHT_BAD_PULSE);
+}
+
+void test_status_names() {
+    TEST_ASSERT_EQUAL_STRING("ok", dhtStatusName(DHT_OK));
+    TEST_ASSERT_EQUAL_STRING("checksum", dhtStatusName(DHT_CHECKSUM));
+    TEST_ASSERT_EQUAL_STRING("unknown", dhtStatusName(DHT_STATUS_COUNT));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_good_frame);
+    RUN_TEST(test_good_frame_below_zero);
+    RUN_TEST(test_good_dht11_frame);
+    RUN_TEST(test_bad_checksum);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_no_response);
+    RUN_TEST(test_bad_pulse);
+    RUN_TEST(test_status_names);
+    return UNITY_END();
+}
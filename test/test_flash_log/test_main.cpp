@@ -0,0 +1,297 @@
+/*
+ * test_main.cpp
+ * FlashLog against the host flash image: torn and truncated records,
+ * ring wrap and consumed-state marking, each checked across a remount
+ * as after a power cut
+ */
+
+#include "FlashLog.h"
+#include "FlashStorage.h"
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define IMAGE_PATH "test_flash_log.img"
+#define SECTOR_HEADER_BYTES 16
+#define RECORD_HEADER_BYTES 8
+#define RECORD_BYTES 40 // Payload length used unless a test says otherwise
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static uint8_t buffer[FLASH_LOG_SECTOR_SIZE];
+
+// Record i: its index followed by a pattern derived from it
+static void fillRecord(uint32_t index, uint16_t length) {
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, &index, sizeof(index));
+    for (uint16_t i = sizeof(index); i < length; i++) {
+        buffer[i] = (uint8_t)(index * 31 + i);
+    }
+}
+
+static void appendRecords(uint32_t first, uint32_t count, uint16_t length = RECORD_BYTES) {
+    for (uint32_t i = first; i < first + count; i++) {
+        fillRecord(i, length);
+        TEST_ASSERT_TRUE(flashLogAppend(buffer, length));
+    }
+}
+
+// Index of the record at the cursor, or -1 at the end; checks its pattern
+static long readIndex(FlashLogCursor& cursor) {
+    static uint8_t record[FLASH_LOG_SECTOR_SIZE];
+    uint16_t length = flashLogRead(cursor, record, sizeof(record));
+    if (length == 0)
+        return -1;
+
+    uint32_t index;
+    memcpy(&index, record, sizeof(index));
+    fillRecord(index, length);
+    TEST_ASSERT_EQUAL_MEMORY(buffer, record, length);
+    return index;
+}
+
+// Power cut: drop the open image and mount the log again from flash
+static void remount() {
+    flashStorageSetImage(IMAGE_PATH);
+    TEST_ASSERT_TRUE(flashLogBegin());
+}
+
+// Rewrite bytes of the image as an unfinished program would leave them
+static void pokeImage(uint32_t offset, uint8_t value, uint32_t length) {
+    flashStorageSetImage(IMAGE_PATH);
+    FILE* file = fopen(IMAGE_PATH, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, offset, SEEK_SET);
+    for (uint32_t i = 0; i < length; i++) {
+        fputc(value, file);
+    }
+    fclose(file);
+}
+
+static uint32_t recordOffset(uint32_t index) {
+    return SECTOR_HEADER_BYTES + index * (RECORD_HEADER_BYTES + RECORD_BYTES);
+}
+
+void setUp() {
+    flashStorageSetImage(IMAGE_PATH);
+    remove(IMAGE_PATH);
+    TEST_ASSERT_TRUE(flashLogBegin());
+}
+
+void tearDown() {
+    flashStorageSetImage(IMAGE_PATH);
+    remove(IMAGE_PATH);
+}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_records_survive_remount() {
+    appendRecords(0, 10);
+    remount();
+
+    TEST_ASSERT_EQUAL_UINT32(10, flashLogPending());
+    TEST_ASSERT_EQUAL_UINT32(0, flashLogStats().corrupt);
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    for (long i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(i, readIndex(cursor));
+    }
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+
+    // Appends continue where the last record ended
+    appendRecords(10, 1);
+    TEST_ASSERT_EQUAL(10, readIndex(cursor));
+}
+
+// Power lost halfway through programming the last record's payload
+void test_torn_record_is_skipped() {
+    appendRecords(0, 3);
+    pokeImage(recordOffset(2) + RECORD_HEADER_BYTES + RECORD_BYTES / 2, 0xFF, RECORD_BYTES / 2);
+    remount();
+
+    TEST_ASSERT_EQUAL_UINT32(1, flashLogStats().corrupt);
+    TEST_ASSERT_EQUAL_UINT32(2, flashLogPending());
+
+    // The writer moves to a fresh sector rather than behind the torn record
+    appendRecords(3, 1);
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(3, flashLogPending());
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(0, readIndex(cursor));
+    TEST_ASSERT_EQUAL(1, readIndex(cursor));
+    TEST_ASSERT_EQUAL(3, readIndex(cursor));
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+}
+
+// Power lost after the header was programmed but before any payload
+void test_header_without_payload_is_skipped() {
+    appendRecords(0, 2);
+    pokeImage(recordOffset(1) + RECORD_HEADER_BYTES, 0xFF, RECORD_BYTES);
+    remount();
+
+    TEST_ASSERT_EQUAL_UINT32(1, flashLogPending());
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(0, readIndex(cursor));
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+}
+
+// Stray programmed bytes beyond the last record: the erased area is not
+// clean, so nothing more is written to that sector
+void test_dirty_tail_moves_writer_on() {
+    appendRecords(0, 2);
+    pokeImage(recordOffset(2) + 100, 0x00, 4);
+    remount();
+
+    TEST_ASSERT_EQUAL_UINT32(1, flashLogStats().corrupt);
+    TEST_ASSERT_EQUAL_UINT32(2, flashLogPending());
+
+    appendRecords(2, 1);
+    remount();
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(0, readIndex(cursor));
+    TEST_ASSERT_EQUAL(1, readIndex(cursor));
+    TEST_ASSERT_EQUAL(2, readIndex(cursor));
+}
+
+// A length field corrupted to point past the sector end
+void test_damaged_length_is_contained() {
+    appendRecords(0, 3);
+    uint16_t bogus = FLASH_LOG_SECTOR_SIZE;
+    flashStorageSetImage(IMAGE_PATH);
+    FILE* file = fopen(IMAGE_PATH, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, recordOffset(1) + 2, SEEK_SET);
+    fwrite(&bogus, sizeof(bogus), 1, file);
+    fclose(file);
+    remount();
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(0, readIndex(cursor));
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+    TEST_ASSERT_GREATER_THAN(0, flashLogStats().corrupt);
+
+    // Still writable
+    appendRecords(3, 1);
+    TEST_ASSERT_EQUAL(3, readIndex(cursor));
+}
+
+void test_consumed_records_stay_consumed() {
+    appendRecords(0, 10);
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    for (long i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(i, readIndex(cursor));
+    }
+    flashLogConsume(cursor);
+    TEST_ASSERT_EQUAL_UINT32(6, flashLogPending());
+    TEST_ASSERT_EQUAL_UINT32(4, flashLogStats().consumed);
+
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(6, flashLogPending());
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(4, readIndex(cursor));
+
+    // Reading ahead without consuming changes nothing on flash
+    readIndex(cursor);
+    remount();
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(4, readIndex(cursor));
+}
+
+// Consuming across sectors retires each finished sector as a whole
+void test_consume_across_sectors() {
+    const uint16_t length = 1000; // Four records per sector
+    appendRecords(0, 10, length);
+
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    for (long i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL(i, readIndex(cursor));
+    }
+    flashLogConsume(cursor);
+    TEST_ASSERT_EQUAL_UINT32(1, flashLogPending());
+
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(1, flashLogPending());
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(9, readIndex(cursor));
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+
+    flashLogConsume(cursor);
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(0, flashLogPending());
+}
+
+void test_clear_discards_everything() {
+    appendRecords(0, 5, 1000);
+    flashLogClear();
+    TEST_ASSERT_EQUAL_UINT32(0, flashLogPending());
+
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(0, flashLogPending());
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+}
+
+// One full-sector record per sector: after the ring wraps, the oldest
+// unconsumed records are dropped and counted, and the rest still read in
+// order after a remount
+void test_ring_wrap_drops_oldest() {
+    const uint16_t length = flashLogMaxRecordLength();
+    const uint32_t total = FLASH_LOG_SECTORS + 5;
+    appendRecords(0, total, length);
+
+    TEST_ASSERT_EQUAL_UINT32(total, flashLogStats().appended);
+    TEST_ASSERT_EQUAL_UINT32(5, flashLogStats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(FLASH_LOG_SECTORS, flashLogPending());
+
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(FLASH_LOG_SECTORS, flashLogPending());
+    FlashLogCursor cursor;
+    flashLogRewind(cursor);
+    for (long i = 5; i < (long)total; i++) {
+        TEST_ASSERT_EQUAL(i, readIndex(cursor));
+    }
+    TEST_ASSERT_EQUAL(-1, readIndex(cursor));
+
+    // Consume half, wrap again: only unconsumed records count as dropped
+    // (the counters restart at each mount)
+    flashLogRewind(cursor);
+    for (uint32_t i = 0; i < FLASH_LOG_SECTORS / 2; i++) {
+        readIndex(cursor);
+    }
+    flashLogConsume(cursor);
+    appendRecords(total, FLASH_LOG_SECTORS / 2 + 3, length);
+    TEST_ASSERT_EQUAL_UINT32(3, flashLogStats().dropped);
+
+    remount();
+    flashLogRewind(cursor);
+    TEST_ASSERT_EQUAL(5 + FLASH_LOG_SECTORS / 2 + 3, readIndex(cursor));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_survive_remount);
+    RUN_TEST(test_torn_record_is_skipped);
+    RUN_TEST(test_header_without_payload_is_skipped);
+    RUN_TEST(test_dirty_tail_moves_writer_on);
+    RUN_TEST(test_damaged_length_is_contained);
+    RUN_TEST(test_consumed_records_stay_consumed);
+    RUN_TEST(test_consume_across_sectors);
+    RUN_TEST(test_clear_discards_everything);
+    RUN_TEST(test_ring_wrap_drops_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+/*
+ * test_main.cpp
+ * GasCurves tables against the analytic curves: every ADC code's entry is
+ * compared with pow() evaluated in double precision on the host
+ */
+
+#include "GasCurves.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+// Entries are rounded to float once, so half a float ulp, plus some
+// slack for the compile-time log and exp series
+#define MAX_RELATIVE_ERROR 1e-7
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static double analyticRatio(int code) {
+    return (double)(GAS_ADC_LEVELS - code) / code / GAS_R0;
+}
+
+static double analyticPpm(int code, double a, double b) {
+    return pow(a / analyticRatio(code), b);
+}
+
+// Worst relative error of a ppm table over every non-zero code
+static void checkCurve(const char* name, float (*lookup)(uint16_t), double a, double b) {
+    double worst = 0;
+    int worstCode = 0;
+    for (int code = 1; code < GAS_ADC_LEVELS; code++) {
+        double expected = analyticPpm(code, a, b);
+        double error = fabs(lookup(code) - expected) / expected;
+        if (error > worst) {
+            worst = error;
+            worstCode = code;
+        }
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "%s: worst relative error %.2g at code %d", name, worst,
+             worstCode);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(MAX_RELATIVE_ERROR, worst);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_ratio_table() {
+    double worst = 0;
+    for (int code = 1; code < GAS_ADC_LEVELS; code++) {
+        double expected = analyticRatio(code);
+        double error = fabs(gasRatioFromAdc(code) - expected) / expected;
+        if (error > worst)
+            worst = error;
+    }
+    TEST_ASSERT_LESS_THAN(MAX_RELATIVE_ERROR, worst);
+}
+
+void test_co_curve() {
+    checkCurve("CO", coPpmFromAdc, GAS_CO_CURVE_A, GAS_CO_CURVE_B);
+}
+
+void test_ch4_curve() {
+    checkCurve("CH4", ch4PpmFromAdc, GAS_CH4_CURVE_A, GAS_CH4_CURVE_B);
+}
+
+void test_lpg_curve() {
+    checkCurve("LPG", lpgPpmFromAdc, GAS_LPG_CURVE_A, GAS_LPG_CURVE_B);
+}
+
+// Code 0 is an open circuit, and codes past the ADC's range clamp to the
+// last entry
+void test_ends_of_the_range() {
+    TEST_ASSERT_TRUE(isinf(gasRatioFromAdc(0)));
+    TEST_ASSERT_FLOAT_WITHIN(0, 0, coPpmFromAdc(0));
+    TEST_ASSERT_FLOAT_WITHIN(0, 0, ch4PpmFromAdc(0));
+    TEST_ASSERT_FLOAT_WITHIN(0, 0, lpgPpmFromAdc(0));
+
+    float last = coPpmFromAdc(GAS_ADC_LEVELS - 1);
+    TEST_ASSERT_TRUE(isfinite(last));
+    TEST_ASSERT_EQUAL_FLOAT(last, coPpmFromAdc(GAS_ADC_LEVELS));
+    TEST_ASSERT_EQUAL_FLOAT(last, coPpmFromAdc(0xffff));
+}
+
+// More gas lowers Rs and raises the ADC code, so ppm rises with the code
+void test_curves_are_monotonic() {
+    for (int code = 2; code < GAS_ADC_LEVELS; code++) {
+        TEST_ASSERT_TRUE(gasRatioFromAdc(code) < gasRatioFromAdc(code - 1));
+        TEST_ASSERT_TRUE(coPpmFromAdc(code) > coPpmFromAdc(code - 1));
+        TEST_ASSERT_TRUE(ch4PpmFromAdc(code) > ch4PpmFromAdc(code - 1));
+        TEST_ASSERT_TRUE(lpgPpmFromAdc(code) > lpgPpmFromAdc(code - 1));
+    }
+}
+
+void test_cost_against_powf() {
+    const int passes = 2000;
+    volatile float sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (uint16_t code = 1; code < GAS_ADC_LEVELS; code++) {
+            sink = sink + coPpmFromAdc(code);
+        }
+    }
+    std::chrono::duration<double, std::nano> table = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int code = 1; code < GAS_ADC_LEVELS; code++) {
+            float ratio = (float)(GAS_ADC_LEVELS - code) / code / (float)GAS_R0;
+            sink = sink + powf((float)GAS_CO_CURVE_A / ratio, (float)GAS_CO_CURVE_B);
+        }
+    }
+    std::chrono::duration<double, std::nano> direct = std::chrono::steady_clock::now() - start;
+
+    double lookups = (double)passes * (GAS_ADC_LEVELS - 1);
+    char message[96];
+    snprintf(message, sizeof(message), "%.2f ns per lookup, %.2f ns per powf() (host)",
+             table.count() / lookups, direct.count() / lookups);
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ratio_table);
+    RUN_TEST(test_co_curve);
+    RUN_TEST(test_ch4_curve);
+    RUN_TEST(test_lpg_curve);
+    RUN_TEST(test_ends_of_the_range);
+    RUN_TEST(test_curves_are_monotonic);
+    RUN_TEST(test_cost_against_powf);
+    return UNITY_END();
+}
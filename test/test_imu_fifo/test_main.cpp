@@ -0,0 +1,223 @@
+/*
+ * test_main.cpp
+ * ImuFifo on FIFO dumps in the form lsm6dsoxFifoDrain() reads them: tag
+ * byte (sensor, slot counter and parity) and three little-endian int16,
+ * gyro and accelerometer batched at the same rate, at the driver's full
+ * scales
+ *
+ * Expected window values were worked out in double precision from the
+ * raw counts.
+ */
+
+#include "ImuFifo.h"
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define ACCEL_SCALE 0.000122f // g per LSB at +-4 g, as IMU_FIFO_ACCEL_SCALE
+#define GYRO_SCALE 0.070f     // dps per LSB at 2000 dps, as IMU_FIFO_GYRO_SCALE
+#define MEAN_TOLERANCE 1e-5f  // Float sums over a burst
+#define VIBRATION_TOLERANCE 1e-6f
+
+// Board lying flat and still, eight slots of a burst
+static const uint8_t REST_DUMP[] = {
+    0x09, 0x05, 0x00, 0xFD, 0xFF, 0x02, 0x00, // Gyro 5 -3 2
+    0x11, 0xD7, 0xFF, 0x39, 0x00, 0x0B, 0x20, // Accel -41 57 8203
+    0x0A, 0x04, 0x00, 0xFE, 0xFF, 0x03, 0x00, // Gyro 4 -2 3
+    0x12, 0xDA, 0xFF, 0x3D, 0x00, 0x07, 0x20, // Accel -38 61 8199
+    0x0C, 0x06, 0x00, 0xFD, 0xFF, 0x01, 0x00, // Gyro 6 -3 1
+    0x14, 0xD4, 0xFF, 0x37, 0x00, 0x12, 0x20, // Accel -44 55 8210
+    0x0F, 0x05, 0x00, 0xFC, 0xFF, 0x02, 0x00, // Gyro 5 -4 2
+    0x17, 0xD8, 0xFF, 0x3A, 0x00, 0x03, 0x20, // Accel -40 58 8195
+    0x09, 0x03, 0x00, 0xFD, 0xFF, 0x02, 0x00, // Gyro 3 -3 2
+    0x11, 0xD6, 0xFF, 0x36, 0x00, 0x0E, 0x20, // Accel -42 54 8206
+    0x0A, 0x05, 0x00, 0xFE, 0xFF, 0x03, 0x00, // Gyro 5 -2 3
+    0x12, 0xD9, 0xFF, 0x3C, 0x00, 0x09, 0x20, // Accel -39 60 8201
+    0x0C, 0x06, 0x00, 0xFD, 0xFF, 0x02, 0x00, // Gyro 6 -3 2
+    0x14, 0xD5, 0xFF, 0x38, 0x00, 0x06, 0x20, // Accel -43 56 8198
+    0x0F, 0x04, 0x00, 0xFD, 0xFF, 0x01, 0x00, // Gyro 4 -3 1
+    0x17, 0xD8, 0xFF, 0x3B, 0x00, 0x0C, 0x20, // Accel -40 59 8204
+};
+static const ImuSample REST_MEAN = {-0.00498675f, 0.007015f, 1.000644f, 0.3325f, -0.20125f, 0.14f};
+#define REST_PEAK 0.001656859f
+#define REST_RMS 0.0008724223f
+
+// A knock on the enclosure in the third slot, ringing down over three more
+static const uint8_t KNOCK_DUMP[] = {
+    0x09, 0x05, 0x00, 0xFD, 0xFF, 0x02, 0x00, // Gyro 5 -3 2
+    0x11, 0xD7, 0xFF, 0x39, 0x00, 0x0B, 0x20, // Accel -41 57 8203
+    0x0A, 0x04, 0x00, 0xFE, 0xFF, 0x03, 0x00, // Gyro 4 -2 3
+    0x12, 0xDA, 0xFF, 0x3D, 0x00, 0x07, 0x20, // Accel -38 61 8199
+    0x0C, 0x3D, 0x00, 0x74, 0xFF, 0x16, 0x00, // Gyro 61 -140 22
+    0x14, 0x36, 0x01, 0x33, 0xFF, 0x7E, 0x36, // Accel 310 -205 13950
+    0x0F, 0xA8, 0xFF, 0xC4, 0x00, 0xDD, 0xFF, // Gyro -88 196 -35
+    0x17, 0xFC, 0xFE, 0xAA, 0x00, 0xB0, 0x09, // Accel -260 170 2480
+    0x09, 0x28, 0x00, 0xB8, 0xFF, 0x0F, 0x00, // Gyro 40 -72 15
+    0x11, 0x78, 0x00, 0xC0, 0xFF, 0x88, 0x27, // Accel 120 -64 10120
+    0x0A, 0xF4, 0xFF, 0x19, 0x00, 0xFC, 0xFF, // Gyro -12 25 -4
+    0x12, 0xBA, 0xFF, 0x50, 0x00, 0xBA, 0x1D, // Accel -70 80 7610
+    0x0C, 0x06, 0x00, 0xFD, 0xFF, 0x02, 0x00, // Gyro 6 -3 2
+    0x14, 0xD5, 0xFF, 0x38, 0x00, 0x06, 0x20, // Accel -43 56 8198
+    0x0F, 0x04, 0x00, 0xFD, 0xFF, 0x01, 0x00, // Gyro 4 -3 1
+    0x17, 0xD8, 0xFF, 0x3B, 0x00, 0x0C, 0x20, // Accel -40 59 8204
+};
+static const ImuSample KNOCK_MEAN = {-0.0009455f, 0.0032635f, 1.021201f, 0.175f, -0.0175f, 0.0525f};
+#define KNOCK_PEAK 0.7025039f // The rebound at 2480 counts
+#define KNOCK_RMS 0.3600108f
+
+// Words the parser does not turn into samples among the sensor words, and
+// a gyro word lost before the last accelerometer word
+static const uint8_t ODD_DUMP[] = {
+    0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, // Accel 0 0 8192, before any gyro
+    0x22, 0x10, 0x27, 0x00, 0x00, 0x00, 0x00, // Timestamp
+    0x0A, 0x0A, 0x00, 0xEC, 0xFF, 0x1E, 0x00, // Gyro 10 -20 30
+    0x1B, 0x40, 0x01, 0x00, 0x00, 0x00, 0x00, // Temperature
+    0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, // Accel 0 0 10240
+    0x2D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Configuration change
+    0xF8, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // Unknown tag
+    0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, // Accel 0 0 6144, its gyro word lost
+};
+#define ODD_SENSOR_WORDS 4 // Accelerometer and gyro
+#define ODD_OTHER_WORDS 4
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static ImuFifoParser parser;
+static ImuWindow window;
+
+static void checkMean(const ImuSample& expected) {
+    ImuSample mean;
+    TEST_ASSERT_TRUE(imuWindowMean(window, mean));
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.ax, mean.ax);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.ay, mean.ay);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.az, mean.az);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.gx, mean.gx);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.gy, mean.gy);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, expected.gz, mean.gz);
+}
+
+void setUp() {
+    imuFifoParserBegin(parser, ACCEL_SCALE, GYRO_SCALE);
+    imuWindowReset(window);
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// The sensor is in the top five bits, whatever the slot counter and parity
+void test_tag_decoding() {
+    TEST_ASSERT_EQUAL(8, imuFifoParse(parser, REST_DUMP, sizeof(REST_DUMP), window));
+    TEST_ASSERT_EQUAL_UINT32(8, parser.accelWords);
+    TEST_ASSERT_EQUAL_UINT32(8, parser.gyroWords);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.otherWords);
+    TEST_ASSERT_EQUAL_UINT32(8, window.samples);
+}
+
+// Each accelerometer word takes the gyro word just before it
+void test_gyro_accel_pairing() {
+    const size_t slot = 2 * IMU_FIFO_WORD_SIZE;
+    for (size_t offset = 0; offset < sizeof(KNOCK_DUMP); offset += slot) {
+        imuWindowReset(window);
+        TEST_ASSERT_EQUAL(1, imuFifoParse(parser, KNOCK_DUMP + offset, slot, window));
+
+        const uint8_t* gyro = KNOCK_DUMP + offset + 1;
+        ImuSample mean;
+        imuWindowMean(window, mean);
+        TEST_ASSERT_EQUAL_FLOAT((int16_t)(gyro[0] | gyro[1] << 8) * GYRO_SCALE, mean.gx);
+        TEST_ASSERT_EQUAL_FLOAT((int16_t)(gyro[2] | gyro[3] << 8) * GYRO_SCALE, mean.gy);
+        TEST_ASSERT_EQUAL_FLOAT((int16_t)(gyro[4] | gyro[5] << 8) * GYRO_SCALE, mean.gz);
+    }
+}
+
+// Other words are counted and skipped, an accelerometer word before any
+// gyro reads no rotation, and one whose gyro word was lost keeps the last
+void test_odd_and_dropped_tags() {
+    TEST_ASSERT_EQUAL(3, imuFifoParse(parser, ODD_DUMP, sizeof(ODD_DUMP), window));
+    TEST_ASSERT_EQUAL_UINT32(ODD_SENSOR_WORDS, parser.accelWords + parser.gyroWords);
+    TEST_ASSERT_EQUAL_UINT32(ODD_OTHER_WORDS, parser.otherWords);
+
+    ImuSample mean;
+    imuWindowMean(window, mean);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, (0 + 10 + 10) * GYRO_SCALE / 3, mean.gx);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, (0 - 20 - 20) * GYRO_SCALE / 3, mean.gy);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, (0 + 30 + 30) * GYRO_SCALE / 3, mean.gz);
+    TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, (8192 + 10240 + 6144) * ACCEL_SCALE / 3, mean.az);
+}
+
+// A partial word at the end of a read is left alone
+void test_partial_word() {
+    TEST_ASSERT_EQUAL(0, imuFifoParse(parser, REST_DUMP, IMU_FIFO_WORD_SIZE - 1, window));
+    TEST_ASSERT_EQUAL(1, imuFifoParse(parser, REST_DUMP, 3 * IMU_FIFO_WORD_SIZE - 1, window));
+    TEST_ASSERT_EQUAL_UINT32(1, parser.accelWords);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.gyroWords);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.otherWords);
+}
+
+void test_rest_window() {
+    imuFifoParse(parser, REST_DUMP, sizeof(REST_DUMP), window);
+    checkMean(REST_MEAN);
+    TEST_ASSERT_FLOAT_WITHIN(VIBRATION_TOLERANCE, REST_PEAK, window.peakVibration);
+    TEST_ASSERT_FLOAT_WITHIN(VIBRATION_TOLERANCE, REST_RMS, imuWindowVibrationRms(window));
+}
+
+void test_knock_window() {
+    imuFifoParse(parser, KNOCK_DUMP, sizeof(KNOCK_DUMP), window);
+    checkMean(KNOCK_MEAN);
+    TEST_ASSERT_FLOAT_WITHIN(VIBRATION_TOLERANCE, KNOCK_PEAK, window.peakVibration);
+    TEST_ASSERT_FLOAT_WITHIN(VIBRATION_TOLERANCE, KNOCK_RMS, imuWindowVibrationRms(window));
+}
+
+// Reads split at any word boundary add up to the same window
+void test_split_bursts() {
+    for (size_t split = 0; split <= sizeof(KNOCK_DUMP); split += IMU_FIFO_WORD_SIZE) {
+        imuFifoParserBegin(parser, ACCEL_SCALE, GYRO_SCALE);
+        imuWindowReset(window);
+        imuFifoParse(parser, KNOCK_DUMP, split, window);
+        imuFifoParse(parser, KNOCK_DUMP + split, sizeof(KNOCK_DUMP) - split, window);
+
+        TEST_ASSERT_EQUAL_UINT32(8, window.samples);
+        checkMean(KNOCK_MEAN);
+        TEST_ASSERT_FLOAT_WITHIN(VIBRATION_TOLERANCE, KNOCK_PEAK, window.peakVibration);
+    }
+}
+
+void test_empty_window() {
+    ImuSample mean;
+    TEST_ASSERT_FALSE(imuWindowMean(window, mean));
+    TEST_ASSERT_EQUAL_FLOAT(0, imuWindowVibrationRms(window));
+}
+
+// With a spectrum attached, it gets the magnitude of every sample
+void test_spectrum_attached() {
+    static VibrationSpectrum spectrum;
+    vibrationSpectrumBegin(spectrum, 417);
+    parser.spectrum = &spectrum;
+    imuFifoParse(parser, KNOCK_DUMP, sizeof(KNOCK_DUMP), window);
+
+    TEST_ASSERT_EQUAL(8, spectrum.fill);
+    float x = 310 * ACCEL_SCALE;
+    float y = -205 * ACCEL_SCALE;
+    float z = 13950 * ACCEL_SCALE;
+    TEST_ASSERT_INT_WITHIN(1, (int)(sqrtf(x * x + y * y + z * z) * VIBRATION_COUNTS_PER_G),
+                           spectrum.block[2]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tag_decoding);
+    RUN_TEST(test_gyro_accel_pairing);
+    RUN_TEST(test_odd_and_dropped_tags);
+    RUN_TEST(test_partial_word);
+    RUN_TEST(test_rest_window);
+    RUN_TEST(test_knock_window);
+    RUN_TEST(test_split_bursts);
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_spectrum_attached);
+    return UNITY_END();
+}
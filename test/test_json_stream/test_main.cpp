@@ -0,0 +1,135 @@
+/*
+ * test_main.cpp
+ * JsonStream output and counting: the counting pass publishJson() uses
+ * to announce the payload length must match what is then written
+ */
+
+#include "JsonStream.h"
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+class StringPrint : public Print {
+  public:
+    StringPrint() : length(0) { text[0] = '\0'; }
+
+    size_t write(uint8_t c) override {
+        if (length + 1 < sizeof(text)) {
+            text[length++] = (char)c;
+            text[length] = '\0';
+        }
+        return 1;
+    }
+
+    char text[2048];
+    size_t length;
+};
+
+// Emit once into a counter and once into a string, as publishJson() does
+template <typename Emitter>
+static void emitBoth(Emitter emit, StringPrint& output) {
+    JsonStream counter(NULL);
+    emit(counter);
+    counter.flush();
+
+    JsonStream stream(&output);
+    emit(stream);
+    stream.flush();
+
+    TEST_ASSERT_EQUAL_UINT32(counter.length(), output.length);
+    TEST_ASSERT_EQUAL_UINT32(stream.length(), output.length);
+}
+
+static void checkField(float value, uint8_t decimals, const char* expected) {
+    StringPrint output;
+    emitBoth([&](JsonStream& json) {
+        json.beginObject();
+        json.field("v", value, decimals);
+        json.endObject();
+    }, output);
+
+    char text[64];
+    snprintf(text, sizeof(text), "{\"v\":%s}", expected);
+    TEST_ASSERT_EQUAL_STRING(text, output.text);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_decimals_without_trailing_zeros() {
+    checkField(23.456f, 3, "23.456");
+    checkField(1.5f, 3, "1.5");
+    checkField(20.0f, 2, "20");
+    checkField(0.0f, 3, "0");
+    checkField(-4.25f, 2, "-4.25");
+    checkField(0.00049f, 3, "0");
+    checkField(-0.0004f, 3, "0");
+    checkField(9.9996f, 3, "10");
+    checkField(0.0123f, 4, "0.0123");
+    checkField(1013.25f, 1, "1013.3");
+}
+
+void test_non_finite_values_are_null() {
+    checkField(NAN, 3, "null");
+    checkField(INFINITY, 3, "null");
+    checkField(-INFINITY, 1, "null");
+}
+
+// Values too large for the scaled integer path still come out as JSON
+// numbers, e.g. the CO ppm of a saturated gas sensor
+void test_huge_values_stay_numbers() {
+    StringPrint output;
+    emitBoth([](JsonStream& json) {
+        json.beginObject();
+        json.field("v", 1.77e9f, 3);
+        json.endObject();
+    }, output);
+
+    double parsed = 0;
+    TEST_ASSERT_EQUAL(1, sscanf(output.text, "{\"v\":%lf}", &parsed));
+    TEST_ASSERT_FLOAT_WITHIN(1e3, 1.77e9, parsed);
+}
+
+// Counted and written lengths agree over many values and across the
+// staging chunk boundary
+void test_count_matches_output() {
+    StringPrint output;
+    emitBoth([](JsonStream& json) {
+        json.beginObject();
+        json.field("device_id", "hub \"one\"\n");
+        json.field("uptime", 123456789UL);
+        json.field("online", true);
+        json.beginArray("values");
+        for (int i = 0; i < 200; i++) {
+            json.element(sinf(i * 0.1f) * powf(10.0f, (float)(i % 9) - 3), i % 7);
+        }
+        json.endArray();
+        json.beginObject("nested");
+        json.field("offset", -12L);
+        json.field("ratio", 0.333333, 6);
+        json.endObject();
+        json.endObject();
+    }, output);
+
+    TEST_ASSERT_GREATER_THAN(JSON_STREAM_CHUNK_SIZE * 4, output.length);
+    TEST_ASSERT_EQUAL('{', output.text[0]);
+    TEST_ASSERT_EQUAL('}', output.text[output.length - 1]);
+    TEST_ASSERT_NOT_NULL(strstr(output.text, "\"device_id\":\"hub \\\"one\\\"\\u000a\""));
+    TEST_ASSERT_NOT_NULL(strstr(output.text, "\"ratio\":0.333333"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_decimals_without_trailing_zeros);
+    RUN_TEST(test_non_finite_values_are_null);
+    RUN_TEST(test_huge_values_stay_numbers);
+    RUN_TEST(test_count_matches_output);
+    return UNITY_END();
+}
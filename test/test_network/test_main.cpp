@@ -0,0 +1,331 @@
+/*
+ * test_main.cpp
+ * Network state machines over a flaky simulated link: WiFi and broker
+ * failures scripted through the NativeHal scenario, with the attempts,
+ * their jittered backoff and the outage accounting checked against what
+ * the link actually did
+ *
+ * The network is serviced on its NETWORK_SERVICE_INTERVAL grid, as the
+ * scheduler runs it. Statistics run from boot, so each test compares
+ * them with a snapshot taken when it starts.
+ */
+
+#include "Network.h"
+#include "Simulation.h"
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define MAX_EVENTS 128
+#define MQTT_BLOCK_MS (MQTT_CONNECT_TIMEOUT * 1000UL) // A connect() to no broker
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+struct LinkLog {
+    unsigned long wifiAttempts[MAX_EVENTS]; // Clock at each begin()
+    int wifiCount;
+    unsigned long mqttAttempts[MAX_EVENTS]; // Clock at each connect()
+    int mqttCount;
+    unsigned long changes[MAX_EVENTS]; // Clock at each networkConnected change
+    int changeCount;
+};
+
+static LinkLog trace;
+static NetworkStats startStats;
+
+static void record(unsigned long* times, int& count, unsigned long time) {
+    if (count < MAX_EVENTS) {
+        times[count++] = time;
+    }
+}
+
+// Service the network on its grid until the clock reaches end, logging
+// each attempt and each change of networkConnected
+static void runUntil(unsigned long end) {
+    while (millis() < end) {
+        unsigned long start = millis();
+        bool wasConnected = networkConnected;
+
+        NetworkStats before;
+        networkTakeStats(before);
+        serviceNetwork();
+        NetworkStats after;
+        networkTakeStats(after);
+
+        if (after.wifiAttempts != before.wifiAttempts) {
+            record(trace.wifiAttempts, trace.wifiCount, start);
+        }
+        if (after.mqttAttempts != before.mqttAttempts) {
+            record(trace.mqttAttempts, trace.mqttCount, start);
+        }
+        if (networkConnected != wasConnected) {
+            record(trace.changes, trace.changeCount, millis());
+        }
+
+        // A blocking connect() moves the clock past grid points; the
+        // scheduler skips those rather than running late ones
+        unsigned long next = start + NETWORK_SERVICE_INTERVAL;
+        while (next <= millis()) {
+            next += NETWORK_SERVICE_INTERVAL;
+        }
+        simAdvance(next - millis());
+    }
+}
+
+// Offline time as seen from outside. The link starts down, so it comes
+// up at even-numbered changes and goes down at odd ones.
+static unsigned long observedOffline() {
+    unsigned long offline = 0;
+    unsigned long since = 0;
+    for (int i = 0; i < trace.changeCount; i++) {
+        if (i % 2 == 0) {
+            offline += trace.changes[i] - since;
+        } else {
+            since = trace.changes[i];
+        }
+    }
+    if (trace.changeCount % 2 == 0) {
+        offline += millis() - since;
+    }
+    return offline;
+}
+
+static unsigned long retryCeiling(int failures, unsigned long minDelay, unsigned long maxDelay) {
+    unsigned long ceiling = minDelay;
+    for (int i = 1; i < failures && ceiling < maxDelay; i++) {
+        ceiling *= 2;
+    }
+    return ceiling < maxDelay ? ceiling : maxDelay;
+}
+
+// Gaps between consecutive failed attempts: the time the attempt took
+// to fail, then a backoff delay between half and all of the doubling
+// ceiling, rounded up to the service grid. Returns the mean position of
+// the delays within their jitter range (0 at half the ceiling, 1 at it).
+static double checkRetryGaps(const unsigned long* attempts, int failed, unsigned long failTime,
+                             unsigned long minDelay, unsigned long maxDelay) {
+    double positions = 0;
+    for (int i = 1; i < failed; i++) {
+        unsigned long ceiling = retryCeiling(i, minDelay, maxDelay);
+        unsigned long gap = attempts[i] - attempts[i - 1];
+
+        TEST_ASSERT_GREATER_OR_EQUAL(failTime + ceiling / 2, gap);
+        TEST_ASSERT_LESS_OR_EQUAL(failTime + ceiling + NETWORK_SERVICE_INTERVAL, gap);
+        positions += (double)(gap - failTime - ceiling / 2) / (ceiling / 2);
+    }
+    return failed > 1 ? positions / (failed - 1) : 0.5;
+}
+
+// After a restore the link comes back at the first retry: whatever
+// backoff was pending, plus the time to connect
+static void checkRecovery(unsigned long restoredAt, unsigned long pendingRetry,
+                          unsigned long connectTime) {
+    TEST_ASSERT_TRUE(networkConnected);
+    TEST_ASSERT_EQUAL(1, trace.changeCount % 2);
+
+    unsigned long connectedAt = trace.changes[trace.changeCount - 1];
+    TEST_ASSERT_GREATER_OR_EQUAL(restoredAt + pendingRetry, connectedAt);
+    TEST_ASSERT_LESS_OR_EQUAL(restoredAt + pendingRetry + connectTime +
+                                  2 * NETWORK_SERVICE_INTERVAL,
+                              connectedAt);
+}
+
+static unsigned long pendingRetry() {
+    NetworkStats stats;
+    networkTakeStats(stats);
+    return stats.nextRetry;
+}
+
+// Change the scenario and note when, as the script runner would
+static unsigned long setLink(const char* key, const char* value) {
+    TEST_ASSERT_TRUE(simSet(key, value));
+    return millis();
+}
+
+static NetworkStats statsSinceStart() {
+    NetworkStats now;
+    networkTakeStats(now);
+
+    NetworkStats delta = now;
+    delta.wifiAttempts -= startStats.wifiAttempts;
+    delta.wifiFailures -= startStats.wifiFailures;
+    delta.wifiDrops -= startStats.wifiDrops;
+    delta.mqttAttempts -= startStats.mqttAttempts;
+    delta.mqttFailures -= startStats.mqttFailures;
+    delta.mqttDrops -= startStats.mqttDrops;
+    delta.blockedTime -= startStats.blockedTime;
+    delta.offlineTime -= startStats.offlineTime;
+    return delta;
+}
+
+void setUp() {
+    // Power-cycle the radio on a fresh scenario and clock: both state
+    // machines start over with no failures behind them
+    suspendNetwork();
+    simReset();
+    networkTakeStats(startStats);
+    memset(&trace, 0, sizeof(trace));
+
+    resumeNetwork(false);
+    record(trace.wifiAttempts, trace.wifiCount, 0);
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_clean_link_connects_once() {
+    runUntil(10000);
+
+    NetworkStats stats = statsSinceStart();
+    TEST_ASSERT_TRUE(networkConnected);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.wifiAttempts);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.wifiFailures);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.mqttAttempts);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.mqttFailures);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.blockedTime);
+
+    // Offline only while the join took
+    TEST_ASSERT_EQUAL(1, trace.changeCount);
+    TEST_ASSERT_UINT32_WITHIN(NETWORK_SERVICE_INTERVAL, SIM_WIFI_JOIN_MS, trace.changes[0]);
+    TEST_ASSERT_EQUAL_UINT32(observedOffline(), stats.offlineTime);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.nextRetry);
+}
+
+// No access point for ten minutes: joins back off to the cap with
+// jitter, and the first retry after it returns connects
+void test_wifi_outage_backs_off() {
+    setLink("wifi", "0");
+    runUntil(600000);
+
+    NetworkStats stats = statsSinceStart();
+    TEST_ASSERT_FALSE(networkConnected);
+    TEST_ASSERT_EQUAL_UINT32(trace.wifiCount, stats.wifiAttempts);
+    TEST_ASSERT_UINT32_WITHIN(1, stats.wifiAttempts, stats.wifiFailures);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.mqttAttempts);
+
+    // A failed join shows at the next poll
+    double jitter = checkRetryGaps(trace.wifiAttempts, trace.wifiCount, NETWORK_SERVICE_INTERVAL,
+                                   WIFI_RETRY_MIN, WIFI_RETRY_MAX);
+    TEST_ASSERT_GREATER_OR_EQUAL(WIFI_RETRY_MAX / 2, trace.wifiAttempts[trace.wifiCount - 1] -
+                                                         trace.wifiAttempts[trace.wifiCount - 2]);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%d joins in 10 min, mean jitter position %.2f",
+             trace.wifiCount, jitter);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN(0.2, jitter);
+    TEST_ASSERT_LESS_THAN(0.8, jitter);
+
+    unsigned long pending = pendingRetry();
+    unsigned long restoredAt = setLink("wifi", "1");
+    runUntil(restoredAt + WIFI_RETRY_MAX + 10000);
+
+    stats = statsSinceStart();
+    checkRecovery(restoredAt, pending, SIM_WIFI_JOIN_MS);
+    TEST_ASSERT_EQUAL_UINT32(stats.wifiAttempts - 1, stats.wifiFailures);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.mqttAttempts);
+    TEST_ASSERT_EQUAL_UINT32(observedOffline(), stats.offlineTime);
+}
+
+// Access point up but no broker for five minutes: each connect() blocks
+// for its timeout, and the blocked time is counted
+void test_broker_outage_backs_off() {
+    setLink("broker", "0");
+    runUntil(300000);
+
+    NetworkStats stats = statsSinceStart();
+    TEST_ASSERT_FALSE(networkConnected);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.wifiAttempts);
+    TEST_ASSERT_EQUAL_UINT32(trace.mqttCount, stats.mqttAttempts);
+    TEST_ASSERT_EQUAL_UINT32(stats.mqttAttempts, stats.mqttFailures);
+    TEST_ASSERT_EQUAL_UINT32(stats.mqttFailures * MQTT_BLOCK_MS, stats.blockedTime);
+    TEST_ASSERT_EQUAL_UINT32(MQTT_BLOCK_MS, stats.maxBlocked);
+
+    // The delay starts when the blocked connect() returns
+    double jitter = checkRetryGaps(trace.mqttAttempts, trace.mqttCount, MQTT_BLOCK_MS,
+                                   MQTT_RETRY_MIN, MQTT_RETRY_MAX);
+    TEST_ASSERT_GREATER_THAN(0.2, jitter);
+    TEST_ASSERT_LESS_THAN(0.8, jitter);
+
+    unsigned long pending = pendingRetry();
+    unsigned long restoredAt = setLink("broker", "1");
+    runUntil(restoredAt + MQTT_RETRY_MAX + 10000);
+
+    stats = statsSinceStart();
+    checkRecovery(restoredAt, pending, 0);
+    TEST_ASSERT_EQUAL_UINT32(stats.mqttAttempts - 1, stats.mqttFailures);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.wifiFailures);
+    TEST_ASSERT_EQUAL_UINT32(observedOffline(), stats.offlineTime);
+}
+
+// A connected link that keeps failing in different ways: each drop is
+// counted at the layer that failed, and each outage is accounted from
+// when it was noticed to when the link came back
+void test_flapping_link() {
+    runUntil(10000);
+    TEST_ASSERT_TRUE(networkConnected);
+
+    // Each starts ten seconds after the link is back from the last
+    struct Outage {
+        const char* key;
+        unsigned long length;
+        unsigned long noticed; // Delay before the drop can be seen
+        unsigned long connect; // Time to come back once a retry starts
+    };
+    const Outage outages[] = {
+        {"broker", 20000, 0, 0},
+        {"wifi", 45000, 0, SIM_WIFI_JOIN_MS},
+        {"broker", 5000, 0, 0},
+        {"link", 40000, SIM_LINK_DETECT_TIME, 0},
+    };
+    const int count = sizeof(outages) / sizeof(outages[0]);
+
+    for (int i = 0; i < count; i++) {
+        runUntil(millis() + 10000);
+        unsigned long start = setLink(outages[i].key, "0");
+        runUntil(start + outages[i].length);
+
+        // The drop is seen at the first poll once it is detectable
+        unsigned long droppedAt = trace.changes[trace.changeCount - 1];
+        TEST_ASSERT_EQUAL(0, trace.changeCount % 2);
+        TEST_ASSERT_UINT32_WITHIN(NETWORK_SERVICE_INTERVAL, start + outages[i].noticed,
+                                  droppedAt);
+
+        unsigned long pending = pendingRetry();
+        unsigned long restoredAt = setLink(outages[i].key, "1");
+        runUntil(restoredAt + pending + outages[i].connect + MQTT_BLOCK_MS);
+        checkRecovery(restoredAt, pending, outages[i].connect);
+    }
+
+    NetworkStats stats = statsSinceStart();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.wifiDrops);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.mqttDrops);
+    // Every join failed but the first and the one after the WiFi outage
+    TEST_ASSERT_EQUAL_UINT32(stats.wifiAttempts - 2, stats.wifiFailures);
+    TEST_ASSERT_EQUAL_UINT32(2 * count + 1, trace.changeCount);
+    TEST_ASSERT_EQUAL_UINT32(observedOffline(), stats.offlineTime);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%d outages: %lu ms offline, %lu ms blocked", count,
+             stats.offlineTime, stats.blockedTime);
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    simReset();
+    simSetSerialEcho(false);
+    setupNetworking();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_link_connects_once);
+    RUN_TEST(test_wifi_outage_backs_off);
+    RUN_TEST(test_broker_outage_backs_off);
+    RUN_TEST(test_flapping_link);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+/*
+ * test_main.cpp
+ * OctaveBands accuracy on synthetic tones, and the per-sample cost of
+ * the filter bank against the 16 kHz real-time budget
+ *
+ * The cost is a host figure for comparing versions of the bank; on the
+ * device the audio_service scope of the profile report includes it.
+ */
+
+#include "AudioLevel.h"
+#include "OctaveBands.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SAMPLE_RATE 16000.0f
+#define BLOCK_SAMPLES 256
+#define TONE_AMPLITUDE 8000.0
+#define SETTLE_SECONDS 1 // Lowest band's filters settle before measuring
+#define MEASURE_SECONDS 2
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static double tonePhase = 0;
+
+// Feed seconds of a tone in PDM-sized blocks
+static void feedTone(OctaveFilterBank& bank, double frequency, double amplitude, int seconds) {
+    int16_t block[BLOCK_SAMPLES];
+    int blocks = (int)(seconds * SAMPLE_RATE / BLOCK_SAMPLES);
+
+    for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < BLOCK_SAMPLES; i++) {
+            block[i] = (int16_t)lround(amplitude * sin(tonePhase));
+            tonePhase += 2 * M_PI * frequency / SAMPLE_RATE;
+        }
+        octaveBankProcess(bank, block, BLOCK_SAMPLES);
+    }
+}
+
+static void measureTone(double frequency, double amplitude, OctaveLevels& levels) {
+    OctaveFilterBank bank;
+    octaveBankBegin(bank, SAMPLE_RATE);
+    tonePhase = 0;
+
+    feedTone(bank, frequency, amplitude, SETTLE_SECONDS);
+    octaveBankTake(bank, levels);
+    feedTone(bank, frequency, amplitude, MEASURE_SECONDS);
+    TEST_ASSERT_TRUE(octaveBankTake(bank, levels));
+}
+
+static double sineDbfs(double amplitude) {
+    return 20.0 * log10(amplitude / sqrt(2.0) / AUDIO_FULL_SCALE);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_band_centres() {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 62.5, octaveBandCentre(SAMPLE_RATE, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1000, octaveBandCentre(SAMPLE_RATE, 4));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 4000, octaveBandCentre(SAMPLE_RATE, OCTAVE_BANDS - 1));
+}
+
+// A tone at each centre reads at its own level in its band, within
+// 0.5 dB, and well down in every other band
+void test_tone_at_each_centre() {
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        OctaveLevels levels;
+        double centre = octaveBandCentre(SAMPLE_RATE, band);
+        measureTone(centre, TONE_AMPLITUDE, levels);
+
+        char message[128];
+        int length = snprintf(message, sizeof(message), "%6.1f Hz:", centre);
+        for (int other = 0; other < OCTAVE_BANDS; other++) {
+            length += snprintf(message + length, sizeof(message) - length, " %6.1f",
+                               levels.level[other]);
+        }
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_FLOAT_WITHIN(0.5, sineDbfs(TONE_AMPLITUDE), levels.level[band]);
+        for (int other = 0; other < OCTAVE_BANDS; other++) {
+            if (other == band)
+                continue;
+
+            // Neighbours share a band edge; the rest are further down
+            float rejection = abs(other - band) == 1 ? 10 : 25;
+            TEST_ASSERT_LESS_THAN(levels.level[band] - rejection, levels.level[other]);
+        }
+    }
+}
+
+// At a band edge (centre times sqrt 2) the two bands either side read
+// about 3 dB down, so a tone is never lost between them
+void test_tone_at_band_edge() {
+    for (int band = 0; band < OCTAVE_BANDS - 1; band++) {
+        OctaveLevels levels;
+        measureTone(octaveBandCentre(SAMPLE_RATE, band) * sqrt(2.0), TONE_AMPLITUDE, levels);
+
+        TEST_ASSERT_FLOAT_WITHIN(1.0, sineDbfs(TONE_AMPLITUDE) - 3, levels.level[band]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0, sineDbfs(TONE_AMPLITUDE) - 3, levels.level[band + 1]);
+    }
+}
+
+// Levels track the amplitude over the microphone's range
+void test_level_linearity() {
+    const double amplitudes[] = {30, 300, 3000, 30000};
+    for (double amplitude : amplitudes) {
+        OctaveLevels levels;
+        measureTone(1000, amplitude, levels);
+        TEST_ASSERT_FLOAT_WITHIN(0.5, sineDbfs(amplitude), levels.level[4]);
+    }
+}
+
+void test_silence_reads_floor() {
+    OctaveFilterBank bank;
+    octaveBankBegin(bank, SAMPLE_RATE);
+    OctaveLevels levels;
+    TEST_ASSERT_FALSE(octaveBankTake(bank, levels));
+
+    feedTone(bank, 1000, 0, 1);
+    TEST_ASSERT_TRUE(octaveBankTake(bank, levels));
+    for (int band = 0; band < OCTAVE_BANDS; band++) {
+        TEST_ASSERT_FLOAT_WITHIN(0, AUDIO_LEQ_FLOOR, levels.level[band]);
+    }
+}
+
+void test_cost_per_sample() {
+    OctaveFilterBank bank;
+    octaveBankBegin(bank, SAMPLE_RATE);
+    tonePhase = 0;
+
+    const int seconds = 20;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    feedTone(bank, 1000, TONE_AMPLITUDE, seconds);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    // Includes generating the tone, so an upper bound on the bank's share
+    char message[96];
+    snprintf(message, sizeof(message), "%.1f ns per sample (host); real time allows %.0f ns",
+             elapsed.count() / (seconds * SAMPLE_RATE), 1e9 / SAMPLE_RATE);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(seconds * SAMPLE_RATE / BLOCK_SAMPLES) * BLOCK_SAMPLES,
+                             bank.samples);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_band_centres);
+    RUN_TEST(test_tone_at_each_centre);
+    RUN_TEST(test_tone_at_band_edge);
+    RUN_TEST(test_level_linearity);
+    RUN_TEST(test_silence_reads_floor);
+    RUN_TEST(test_cost_per_sample);
+    return UNITY_END();
+}
@@ -0,0 +1,319 @@
+/*
+ * test_main.cpp
+ * OutboundQueue end to end against the simulated broker: alerts raised
+ * during a broker outage and while a full backlog drains, checked for
+ * order, for the ones evicted into the offline buffer, and for the time
+ * from raising an alert to the broker receiving it
+ *
+ * The network and the drain run on their 100 ms grids, as the scheduler
+ * runs them. Alerts are the low battery alert, whose JSON carries the
+ * sequence number and the time it was raised.
+ */
+
+#include "Buffer.h"
+#include "Communication.h"
+#include "Config.h"
+#include "FlashStorage.h"
+#include "JsonStream.h"
+#include "Network.h"
+#include "OutboundQueue.h"
+#include "Scheduler.h"
+#include "Sensors.h"
+#include "Simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define IMAGE_PATH "test_outbound.img"
+#define MAX_MESSAGES 4096
+#define BACKLOG_READINGS 3000   // A few minutes of draining
+#define EVICTED_ALERTS 4        // Raised offline beyond the queue's slots
+#define DRAIN_ALERT_PERIOD 5000 // ms between alerts raised while the backlog drains
+
+// Queued alerts go out at the first drain run once the link is up, and
+// alerts raised online at once: a drain tick covers both
+#define ALERT_LATENCY_BOUND BUFFER_DRAIN_INTERVAL
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+enum MessageKind { MESSAGE_ALERT, MESSAGE_BACKLOG, MESSAGE_OTHER };
+
+struct Received {
+    unsigned long time;
+    MessageKind kind;
+    unsigned long sequence; // Alerts only
+    unsigned long raisedAt;
+};
+
+static Received received[MAX_MESSAGES];
+static int receivedCount = 0;
+
+// Value of a numeric JSON field, or 0
+static unsigned long jsonNumber(const SimMessage& message, const char* key) {
+    char text[OUTBOUND_PAYLOAD_SIZE + 1];
+    size_t length = message.length < OUTBOUND_PAYLOAD_SIZE ? message.length : OUTBOUND_PAYLOAD_SIZE;
+    memcpy(text, message.payload, length);
+    text[length] = '\0';
+
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* found = strstr(text, pattern);
+    return found != NULL ? strtoul(found + strlen(pattern), NULL, 10) : 0;
+}
+
+static void onMessage(const SimMessage& message) {
+    if (receivedCount >= MAX_MESSAGES)
+        return;
+
+    Received& entry = received[receivedCount++];
+    entry.time = message.time;
+    entry.sequence = 0;
+    entry.raisedAt = 0;
+    if (strcmp(message.topic, MQTT_ALERTS_TOPIC) == 0) {
+        entry.kind = MESSAGE_ALERT;
+        entry.sequence = jsonNumber(message, "seq");
+        entry.raisedAt = jsonNumber(message, "timestamp");
+    } else if (strcmp(message.topic, MQTT_BUFFERED_DATA_TOPIC) == 0) {
+        entry.kind = MESSAGE_BACKLOG;
+    } else {
+        entry.kind = MESSAGE_OTHER;
+    }
+}
+
+// Service the network and the drain on their grid until end
+static void runUntil(unsigned long end) {
+    while (millis() < end) {
+        unsigned long start = millis();
+        serviceNetwork();
+        if (networkConnected) {
+            sendBufferedData();
+        }
+
+        // A blocking connect() moves the clock past grid points
+        unsigned long next = start + NETWORK_SERVICE_INTERVAL;
+        while (next <= millis()) {
+            next += NETWORK_SERVICE_INTERVAL;
+        }
+        simAdvance(next - millis());
+    }
+}
+
+static void storeBacklog(int count) {
+    SensorSample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.environmentValid = true;
+    sample.accelValid = true;
+    sample.gasValid = true;
+    sample.soundValid = true;
+
+    for (int i = 0; i < count; i++) {
+        sample.timestamp = millis() - (count - i) * 1000UL;
+        sample.temperature = 21 + 0.1f * (i % 10);
+        sample.humidity = 45;
+        sample.Az = 1;
+        sample.gasRatio = 2;
+        sample.soundLevel = 220;
+        storeReadingInBuffer(sample);
+    }
+}
+
+static int firstOfKind(MessageKind kind, unsigned long from) {
+    for (int i = 0; i < receivedCount; i++) {
+        if (received[i].kind == kind && received[i].time >= from)
+            return i;
+    }
+    return -1;
+}
+
+void setUp() {
+    simSetSerialEcho(false);
+    suspendNetwork();
+    simReset();
+    config = DEFAULT_CONFIG;
+    initScheduler(millis); // Buffering a reading schedules its block flush
+
+    flashStorageSetImage(IMAGE_PATH);
+    remove(IMAGE_PATH);
+    initializeOfflineBuffer();
+
+    receivedCount = 0;
+    simSetMessageCallback(onMessage);
+    resumeNetwork(false);
+}
+
+void tearDown() {
+    simSetMessageCallback(NULL);
+    flashStorageSetImage(IMAGE_PATH);
+    remove(IMAGE_PATH);
+}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// The widest JSON alert, every field at its widest, fits a slot
+void test_largest_alert_fits() {
+    OutboundMessage& message = outboundReserve(MQTT_ANOMALIES_TOPIC);
+    OutboundWriter writer(message);
+    JsonStream json(&writer);
+    json.beginObject();
+    json.field("device_id", MQTT_CLIENT_ID);
+    json.field("seq", 4294967295UL);
+    json.field("timestamp", 4294967295UL);
+    json.field("alert", "anomaly_detected");
+    json.field("sensor", "sound_4000hz");
+    json.field("value", -1.234567e9f);
+    json.field("mean", -1.234567e9f);
+    json.field("std_dev", -1.234567e9f);
+    json.field("z_score", -1.234567e9f);
+    json.endObject();
+    json.flush();
+
+    char text[64];
+    snprintf(text, sizeof(text), "widest anomaly: %u of %d bytes", message.length,
+             OUTBOUND_PAYLOAD_SIZE);
+    TEST_MESSAGE(text);
+    TEST_ASSERT_FALSE(writer.overflowed());
+
+    // Give the slot back unsent
+    outboundCommit(message, true);
+}
+
+// Alerts raised through a broker outage, more than the queue holds, then
+// the broker returns to a full backlog with more alerts raised as it
+// drains
+void test_alerts_ahead_of_backlog() {
+    runUntil(10000);
+    TEST_ASSERT_TRUE(networkConnected);
+
+    OutboundStats before;
+    outboundTakeStats(before);
+
+    simSet("broker", "0");
+    runUntil(millis() + 30000);
+    TEST_ASSERT_FALSE(networkConnected);
+
+    storeBacklog(BACKLOG_READINGS);
+    for (int i = 0; i < OUTBOUND_QUEUE_SLOTS + EVICTED_ALERTS; i++) {
+        publishLowBatteryAlert();
+        runUntil(millis() + 1000);
+    }
+
+    // The oldest went to the offline buffer to make room
+    OutboundStats offline;
+    outboundTakeStats(offline);
+    TEST_ASSERT_EQUAL_UINT32(EVICTED_ALERTS, offline.buffered - before.buffered);
+    TEST_ASSERT_EQUAL(OUTBOUND_QUEUE_SLOTS, offline.pending);
+
+    simSet("broker", "1");
+    unsigned long restoredAt = millis();
+    unsigned long end = restoredAt + 5 * 60000UL;
+    while (millis() < end && (bufferCount > 0 || !networkConnected)) {
+        runUntil(millis() + DRAIN_ALERT_PERIOD);
+        publishLowBatteryAlert();
+    }
+    runUntil(millis() + MQTT_CONFIRM_TIME + 1000);
+    TEST_ASSERT_EQUAL(0, bufferCount);
+
+    // Every alert still queued arrives, in sequence order, before the
+    // first backlog batch, within a drain tick of the connection
+    int firstBacklog = firstOfKind(MESSAGE_BACKLOG, restoredAt);
+    int firstAlert = firstOfKind(MESSAGE_ALERT, restoredAt);
+    TEST_ASSERT_TRUE(firstBacklog > 0);
+    TEST_ASSERT_TRUE(firstAlert >= 0 && firstAlert < firstBacklog);
+
+    // Numbered from the first raised offline
+    unsigned long firstSequence = received[firstAlert].sequence - EVICTED_ALERTS;
+    unsigned long expected = firstSequence + EVICTED_ALERTS;
+    for (int i = firstAlert; i < firstAlert + OUTBOUND_QUEUE_SLOTS; i++) {
+        TEST_ASSERT_EQUAL(MESSAGE_ALERT, received[i].kind);
+        TEST_ASSERT_EQUAL_UINT32(expected++, received[i].sequence);
+        TEST_ASSERT_LESS_OR_EQUAL(received[firstAlert].time + ALERT_LATENCY_BOUND,
+                                  received[i].time);
+    }
+
+    // The evicted ones come with the backlog, in order; alerts raised as
+    // it drains reach the broker within the bound, ahead of it
+    unsigned long evicted = firstSequence;
+    unsigned long worst = 0;
+    int drainAlerts = 0;
+    for (int i = firstAlert + OUTBOUND_QUEUE_SLOTS; i < receivedCount; i++) {
+        const Received& entry = received[i];
+        if (entry.kind != MESSAGE_ALERT)
+            continue;
+
+        if (entry.sequence < firstSequence + EVICTED_ALERTS) {
+            TEST_ASSERT_EQUAL_UINT32(evicted++, entry.sequence);
+        } else if (entry.sequence >= firstSequence + OUTBOUND_QUEUE_SLOTS + EVICTED_ALERTS) {
+            unsigned long latency = entry.time - entry.raisedAt;
+            TEST_ASSERT_LESS_OR_EQUAL(ALERT_LATENCY_BOUND, latency);
+            if (latency > worst) {
+                worst = latency;
+            }
+            drainAlerts++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(firstSequence + EVICTED_ALERTS, evicted);
+    TEST_ASSERT_TRUE(drainAlerts > 0);
+
+    int backlogMessages = 0;
+    for (int i = 0; i < receivedCount; i++) {
+        if (received[i].kind == MESSAGE_BACKLOG) {
+            backlogMessages++;
+        }
+    }
+    char text[128];
+    snprintf(text, sizeof(text),
+             "queued alerts out %lu ms after the broker returned; %d raised during a "
+             "%d-message drain, worst latency %lu ms",
+             received[firstAlert].time - restoredAt, drainAlerts, backlogMessages, worst);
+    TEST_MESSAGE(text);
+
+    // All confirmed once their session has lasted
+    OutboundStats after;
+    outboundTakeStats(after);
+    TEST_ASSERT_EQUAL(0, after.pending);
+    TEST_ASSERT_EQUAL_UINT32(0, after.lost - before.lost);
+}
+
+// A broker that drops the session before it is confirmed gets the alert
+// again, with the same sequence number
+void test_lost_session_resends() {
+    runUntil(10000);
+    TEST_ASSERT_TRUE(networkConnected);
+
+    OutboundStats before;
+    outboundTakeStats(before);
+
+    unsigned long raisedAt = millis();
+    publishLowBatteryAlert();
+    int sent = firstOfKind(MESSAGE_ALERT, raisedAt);
+    TEST_ASSERT_TRUE(sent >= 0);
+
+    simSet("broker", "0");
+    runUntil(millis() + 30000);
+    simSet("broker", "1");
+    runUntil(millis() + MQTT_CONFIRM_TIME + 30000);
+
+    int resent = firstOfKind(MESSAGE_ALERT, received[sent].time + 1);
+    TEST_ASSERT_TRUE(resent > sent);
+    TEST_ASSERT_EQUAL_UINT32(received[sent].sequence, received[resent].sequence);
+
+    OutboundStats after;
+    outboundTakeStats(after);
+    TEST_ASSERT_EQUAL_UINT32(1, after.resent - before.resent);
+    TEST_ASSERT_EQUAL_UINT32(1, after.delivered - before.delivered);
+    TEST_ASSERT_EQUAL(0, after.pending);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_largest_alert_fits);
+    RUN_TEST(test_alerts_ahead_of_backlog);
+    RUN_TEST(test_lost_session_resends);
+    return UNITY_END();
+}
@@ -0,0 +1,361 @@
+/*
+ * test_main.cpp
+ * ReadingCodec round trips and edge cases, and the compression ratio and
+ * per-sample cost on a day-long trace shaped like the sensors' output
+ *
+ * The cost is a host figure for comparing versions of the codec; on the
+ * device the drain scope of the profile report includes decoding.
+ */
+
+#include "GasCurves.h"
+#include "ReadingCodec.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define TRACE_READINGS 86400   // A day at the default 1 s interval
+#define READING_DEVICE_SIZE 28 // sizeof(SensorReading) on the RP2040
+#define TARGET_RATIO 10.0      // Asked of the format; not met, see the ratio test
+#define MIN_RATIO 2.5          // What these traces get, less some margin
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static SensorReading trace[TRACE_READINGS];
+static uint8_t block[COMPRESSED_BLOCK_SIZE];
+static uint32_t noiseState = 1;
+
+// Deterministic noise in [-1, 1)
+static float noise() {
+    noiseState = noiseState * 1103515245 + 12345;
+    return (float)((noiseState >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+static float quantize(float value, float step) {
+    return roundf(value / step) * step;
+}
+
+static SensorReading makeReading(unsigned long timestamp, float value) {
+    SensorReading reading;
+    reading.timestamp = timestamp;
+    reading.temperature = value;
+    reading.humidity = value;
+    reading.accelMagnitude = value;
+    reading.gasRatio = value;
+    reading.soundLevel = value;
+    reading.batteryPercentage = value;
+    return reading;
+}
+
+// What each channel's driver hands over: DHT22 tenths, a 10-bit gas code
+// wandering by a code or two, the IMU magnitude with its noise, a sound
+// level in counts, and the battery steady on USB. The scheduler keeps a
+// 1 s grid with the odd late run.
+static void makeTrace() {
+    noiseState = 1;
+    unsigned long timestamp = 1200;
+    int gasCode = 300;
+
+    for (int i = 0; i < TRACE_READINGS; i++) {
+        double hours = i / 3600.0;
+        SensorReading& reading = trace[i];
+
+        reading.timestamp = timestamp;
+        reading.temperature = quantize(22 + 1.5f * sin(2 * M_PI * hours / 24), 0.1f);
+        reading.humidity = quantize(45 - 3 * sin(2 * M_PI * hours / 24) + 0.2f * noise(), 0.1f);
+        reading.accelMagnitude = 1.0f + 0.002f * noise();
+        if (noise() > 0.9f) {
+            gasCode += noise() > 0 ? 1 : -1;
+        }
+        reading.gasRatio = gasRatioFromAdc(gasCode);
+        reading.soundLevel = 220 + 15 * noise();
+        reading.batteryPercentage = 100;
+
+        timestamp += noise() > 0.95f ? 1000 + (int)(20 * (noise() + 1)) : 1000;
+    }
+}
+
+// Same bits, so NaN compares equal to NaN
+static void checkSame(const SensorReading& expected, const SensorReading& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.timestamp, actual.timestamp);
+    TEST_ASSERT_EQUAL_MEMORY(&expected.temperature, &actual.temperature,
+                             READING_CODEC_CHANNELS * sizeof(float));
+}
+
+// Encode readings into as many blocks as they take, decode every block
+// and compare. Returns the bytes used.
+static size_t roundTrip(const SensorReading* readings, int count) {
+    static uint8_t blocks[TRACE_READINGS / 8][COMPRESSED_BLOCK_SIZE];
+    static uint16_t lengths[TRACE_READINGS / 8];
+    int blockCount = 0;
+
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, blocks[0]);
+    for (int i = 0; i < count; i++) {
+        if (!blockEncoderAdd(encoder, readings[i])) {
+            lengths[blockCount++] = blockEncoderSize(encoder);
+            blockEncoderBegin(encoder, blocks[blockCount]);
+            TEST_ASSERT_TRUE(blockEncoderAdd(encoder, readings[i]));
+        }
+    }
+    lengths[blockCount++] = blockEncoderSize(encoder);
+
+    size_t bytes = 0;
+    int index = 0;
+    for (int b = 0; b < blockCount; b++) {
+        BlockDecoder decoder;
+        SensorReading reading;
+        TEST_ASSERT_TRUE(blockDecoderBegin(decoder, blocks[b], lengths[b]));
+        while (blockDecoderNext(decoder, reading)) {
+            checkSame(readings[index++], reading);
+        }
+        TEST_ASSERT_EQUAL(decoder.count, decoder.index);
+        bytes += lengths[b];
+    }
+    TEST_ASSERT_EQUAL(count, index);
+    return bytes;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_trace_round_trip() {
+    makeTrace();
+    roundTrip(trace, TRACE_READINGS);
+}
+
+// Channels not read in a pass are NaN, alone or in runs, and some
+// readings have nothing but the battery
+void test_nan_channels() {
+    SensorReading readings[200];
+    for (int i = 0; i < 200; i++) {
+        readings[i] = makeReading(1000 * i, 20 + 0.1f * (i % 7));
+        if (i % 2) {
+            readings[i].temperature = NAN;
+            readings[i].humidity = NAN;
+        }
+        if (i % 5 != 0) {
+            readings[i].gasRatio = NAN;
+        }
+        if (i >= 50 && i < 80) {
+            readings[i].accelMagnitude = NAN;
+            readings[i].soundLevel = NAN;
+            readings[i].gasRatio = NAN;
+        }
+        if (i == 100) {
+            readings[i].soundLevel = -NAN;
+        }
+    }
+    roundTrip(readings, 200);
+}
+
+// Delta-of-delta at both ends of every prefix range, past them, and
+// across a millis() wrap
+void test_timestamp_ranges() {
+    const int32_t dods[] = {0,     1,     -1,    64,    -63,   65,      -64,       256,
+                            -255,  257,   -256,  2048,  -2047, 2049,    -2048,     60000,
+                            -6000, 86400, 0,     -1000, 0,     3600000, -100000000, 0};
+    const int count = sizeof(dods) / sizeof(dods[0]) + 1;
+
+    SensorReading readings[count];
+    uint32_t timestamp = 0xFFFF0000;
+    int32_t delta = 1000;
+    readings[0] = makeReading(timestamp, 1);
+    for (int i = 1; i < count; i++) {
+        delta += dods[i - 1];
+        timestamp += delta;
+        readings[i] = makeReading(timestamp, 1);
+    }
+    roundTrip(readings, count);
+}
+
+// A reading that does not fit leaves the block as it was: same size,
+// same count, and every reading before it still decodes
+void test_rollback_when_full() {
+    makeTrace();
+
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, block);
+    int added = 0;
+    while (blockEncoderAdd(encoder, trace[added])) {
+        added++;
+    }
+    TEST_ASSERT_TRUE(added > 1);
+    TEST_ASSERT_TRUE(blockEncoderSize(encoder) <= COMPRESSED_BLOCK_SIZE);
+
+    uint16_t size = blockEncoderSize(encoder);
+    uint8_t before[COMPRESSED_BLOCK_SIZE];
+    memcpy(before, block, size);
+    TEST_ASSERT_FALSE(blockEncoderAdd(encoder, trace[added]));
+    TEST_ASSERT_EQUAL(size, blockEncoderSize(encoder));
+    TEST_ASSERT_EQUAL(added, encoder.count);
+    TEST_ASSERT_EQUAL_MEMORY(before, block, size);
+
+    BlockDecoder decoder;
+    SensorReading reading;
+    TEST_ASSERT_TRUE(blockDecoderBegin(decoder, block, size));
+    for (int i = 0; i < added; i++) {
+        TEST_ASSERT_TRUE(blockDecoderNext(decoder, reading));
+        checkSame(trace[i], reading);
+    }
+    TEST_ASSERT_FALSE(blockDecoderNext(decoder, reading));
+}
+
+// A block flushed part full is written at blockEncoderSize() and decodes
+// from exactly those bytes
+void test_partial_block() {
+    makeTrace();
+
+    for (int count = 1; count <= 8; count++) {
+        BlockEncoder encoder;
+        blockEncoderBegin(encoder, block);
+        for (int i = 0; i < count; i++) {
+            TEST_ASSERT_TRUE(blockEncoderAdd(encoder, trace[i]));
+        }
+
+        uint8_t flushed[COMPRESSED_BLOCK_SIZE];
+        uint16_t size = blockEncoderSize(encoder);
+        memcpy(flushed, block, size);
+
+        BlockDecoder decoder;
+        SensorReading reading;
+        TEST_ASSERT_TRUE(blockDecoderBegin(decoder, flushed, size));
+        TEST_ASSERT_EQUAL(count, decoder.count);
+        for (int i = 0; i < count; i++) {
+            TEST_ASSERT_TRUE(blockDecoderNext(decoder, reading));
+            checkSame(trace[i], reading);
+        }
+        TEST_ASSERT_FALSE(blockDecoderNext(decoder, reading));
+    }
+
+    BlockEncoder empty;
+    blockEncoderBegin(empty, block);
+    TEST_ASSERT_EQUAL(READING_CODEC_HEADER_SIZE, blockEncoderSize(empty));
+}
+
+// The boot and the 48-bit Unix time in the version 2 header
+void test_v2_header() {
+    makeTrace();
+
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, block);
+    for (int i = 0; i < 10; i++) {
+        blockEncoderAdd(encoder, trace[i]);
+    }
+    blockEncoderSetOrigin(encoder, 0xBEEF, 0xFEDCBA987654ULL);
+
+    BlockDecoder decoder;
+    TEST_ASSERT_TRUE(blockDecoderBegin(decoder, block, blockEncoderSize(encoder)));
+    TEST_ASSERT_EQUAL(READING_CODEC_VERSION, block[0]);
+    TEST_ASSERT_EQUAL(0xBEEF, decoder.boot);
+    TEST_ASSERT_TRUE(decoder.firstEpoch == 0xFEDCBA987654ULL);
+    TEST_ASSERT_EQUAL_UINT32(trace[0].timestamp, decoder.firstTimestamp);
+}
+
+// A version 1 block, as logged before the boot and Unix time were added:
+// the same bit stream after an 8-byte header
+void test_v1_header() {
+    makeTrace();
+
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, block);
+    for (int i = 0; i < 20; i++) {
+        blockEncoderAdd(encoder, trace[i]);
+    }
+    blockEncoderSetOrigin(encoder, 7, 1767225600000ULL);
+
+    uint16_t size = blockEncoderSize(encoder);
+    uint8_t v1[COMPRESSED_BLOCK_SIZE];
+    memcpy(v1, block, READING_CODEC_V1_HEADER_SIZE);
+    memcpy(v1 + READING_CODEC_V1_HEADER_SIZE, block + READING_CODEC_HEADER_SIZE,
+           size - READING_CODEC_HEADER_SIZE);
+    v1[0] = 1;
+
+    BlockDecoder decoder;
+    SensorReading reading;
+    uint16_t v1Size = size - (READING_CODEC_HEADER_SIZE - READING_CODEC_V1_HEADER_SIZE);
+    TEST_ASSERT_TRUE(blockDecoderBegin(decoder, v1, v1Size));
+    TEST_ASSERT_EQUAL(0, decoder.boot);
+    TEST_ASSERT_TRUE(decoder.firstEpoch == 0);
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(blockDecoderNext(decoder, reading));
+        checkSame(trace[i], reading);
+    }
+    TEST_ASSERT_FALSE(blockDecoderNext(decoder, reading));
+}
+
+void test_rejects_unknown_blocks() {
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, block);
+    blockEncoderAdd(encoder, makeReading(0, 1));
+
+    BlockDecoder decoder;
+    TEST_ASSERT_FALSE(blockDecoderBegin(decoder, block, 0));
+    TEST_ASSERT_FALSE(blockDecoderBegin(decoder, block, READING_CODEC_HEADER_SIZE - 1));
+
+    block[0] = 0;
+    TEST_ASSERT_FALSE(blockDecoderBegin(decoder, block, blockEncoderSize(encoder)));
+    block[0] = READING_CODEC_VERSION + 1;
+    TEST_ASSERT_FALSE(blockDecoderBegin(decoder, block, blockEncoderSize(encoder)));
+}
+
+// The format was asked to hold 10x the raw records. The IMU and sound
+// channels change in most mantissa bits every reading, so these traces
+// get about 3x, and the output says so.
+void test_ratio_and_cost() {
+    makeTrace();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t bytes = roundTrip(trace, TRACE_READINGS);
+    std::chrono::duration<double, std::nano> both = std::chrono::steady_clock::now() - start;
+
+    // Encoding alone, to split the round trip's cost
+    start = std::chrono::steady_clock::now();
+    BlockEncoder encoder;
+    blockEncoderBegin(encoder, block);
+    for (int i = 0; i < TRACE_READINGS; i++) {
+        if (!blockEncoderAdd(encoder, trace[i])) {
+            blockEncoderBegin(encoder, block);
+            blockEncoderAdd(encoder, trace[i]);
+        }
+    }
+    std::chrono::duration<double, std::nano> encode = std::chrono::steady_clock::now() - start;
+
+    double ratio = (double)TRACE_READINGS * READING_DEVICE_SIZE / bytes;
+    char message[128];
+    snprintf(message, sizeof(message),
+             "%.2f bytes per reading, %.1fx against %d-byte records (target %.0fx: %s)",
+             (double)bytes / TRACE_READINGS, ratio, READING_DEVICE_SIZE, TARGET_RATIO,
+             ratio >= TARGET_RATIO ? "met" : "not met");
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message),
+             "%.1f ns per reading to encode, %.1f ns to decode and compare (host)",
+             encode.count() / TRACE_READINGS, (both.count() - encode.count()) / TRACE_READINGS);
+    TEST_MESSAGE(message);
+
+    // Keeps a regression in the format from going unnoticed
+    TEST_ASSERT_TRUE(ratio > MIN_RATIO);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_trace_round_trip);
+    RUN_TEST(test_nan_channels);
+    RUN_TEST(test_timestamp_ranges);
+    RUN_TEST(test_rollback_when_full);
+    RUN_TEST(test_partial_block);
+    RUN_TEST(test_v2_header);
+    RUN_TEST(test_v1_header);
+    RUN_TEST(test_rejects_unknown_blocks);
+    RUN_TEST(test_ratio_and_cost);
+    return UNITY_END();
+}
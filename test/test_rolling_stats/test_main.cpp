@@ -0,0 +1,176 @@
+/*
+ * test_main.cpp
+ * RollingStats against a brute-force reference: a double precision
+ * two-pass mean and standard deviation over the same window, checked
+ * after every sample of long runs
+ */
+
+#include "RollingStats.h"
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+//=====================================================================
+// REFERENCE
+//=====================================================================
+static float history[100000];
+
+struct Reference {
+    double mean;
+    double stdDev;
+};
+
+// Population statistics of the last HISTORY_SIZE values up to end
+static Reference reference(int end) {
+    int first = end > HISTORY_SIZE ? end - HISTORY_SIZE : 0;
+    int count = end - first;
+
+    double sum = 0.0;
+    for (int i = first; i < end; i++) {
+        sum += history[i];
+    }
+    Reference result;
+    result.mean = sum / count;
+
+    double squares = 0.0;
+    for (int i = first; i < end; i++) {
+        squares += (history[i] - result.mean) * (history[i] - result.mean);
+    }
+    result.stdDev = sqrt(squares / count);
+    return result;
+}
+
+static uint32_t randomState = 1;
+
+// Uniform in [-1, 1), repeatable across runs
+static double uniform() {
+    randomState = randomState * 1664525u + 1013904223u;
+    return (randomState >> 8) / 8388608.0 - 1.0;
+}
+
+// Feed count values and compare with the reference after each. Errors
+// are allowed relative to the window's spread and magnitude, as float
+// rounding of values near offset leaves about 1e-7 of offset.
+static void checkAgainstReference(int count, double offset, double spread,
+                                  double (*generate)(int, double, double)) {
+    RollingStats stats;
+    rollingStatsReset(stats);
+
+    double worstMean = 0.0;
+    double worstStdDev = 0.0;
+    for (int i = 0; i < count; i++) {
+        history[i] = (float)generate(i, offset, spread);
+        rollingStatsAdd(stats, history[i]);
+
+        Reference expected = reference(i + 1);
+        double scale = fabs(offset) + spread;
+        double meanError = fabs(rollingStatsMean(stats) - expected.mean) / scale;
+        double stdDevError = fabs(rollingStatsStdDev(stats) - expected.stdDev) / scale;
+        if (meanError > worstMean)
+            worstMean = meanError;
+        if (stdDevError > worstStdDev)
+            worstStdDev = stdDevError;
+
+        TEST_ASSERT_EQUAL(i + 1 >= HISTORY_SIZE, rollingStatsFull(stats));
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "worst relative error: mean %.2g, std dev %.2g", worstMean,
+             worstStdDev);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(1e-5, worstMean);
+    TEST_ASSERT_LESS_THAN(1e-3, worstStdDev);
+}
+
+static double noise(int i, double offset, double spread) {
+    (void)i;
+    return offset + spread * uniform();
+}
+
+// A slow ramp with noise, then a step, as a warming sensor or a leak
+static double rampAndStep(int i, double offset, double spread) {
+    double value = offset + spread * (0.2 * uniform() + (i % 5000) / 5000.0);
+    return i % 20000 >= 15000 ? value + 10 * spread : value;
+}
+
+// Long flat stretches broken by single outliers: the update that removes
+// an outlier from the window must not leave a negative variance behind
+static double flatWithOutliers(int i, double offset, double spread) {
+    return i % 997 == 0 ? offset + 50 * spread : offset;
+}
+
+void setUp() {
+    randomState = 1;
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_noise_around_zero() {
+    checkAgainstReference(50000, 0.0, 1.0, noise);
+}
+
+// CO ppm near a typical indoor level, one ADC code of noise
+void test_gas_ppm_noise() {
+    checkAgainstReference(50000, 17.0, 0.33, noise);
+}
+
+// Large offset relative to the spread: where a naive sum of squares
+// would cancel catastrophically in float
+void test_large_offset_small_spread() {
+    checkAgainstReference(50000, 1000.0, 0.5, noise);
+}
+
+void test_ramp_and_step() {
+    checkAgainstReference(100000, 25.0, 2.0, rampAndStep);
+}
+
+void test_flat_with_outliers() {
+    checkAgainstReference(20000, 0.8, 0.01, flatWithOutliers);
+
+    // Once an outlier has left, the incremental update leaves rounding
+    // residue in proportion to it, until the next resync clears it
+    RollingStats stats;
+    rollingStatsReset(stats);
+    rollingStatsAdd(stats, 100.0f);
+    for (int i = 0; i < HISTORY_SIZE; i++) {
+        rollingStatsAdd(stats, 0.8f);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.8, rollingStatsMean(stats));
+    TEST_ASSERT_LESS_THAN(100.0 * 1e-3, rollingStatsStdDev(stats));
+
+    for (int i = 0; i < HISTORY_SIZE; i++) {
+        rollingStatsAdd(stats, 0.8f);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.8, rollingStatsMean(stats));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, rollingStatsStdDev(stats));
+}
+
+void test_reset_empties_window() {
+    RollingStats stats;
+    rollingStatsReset(stats);
+    TEST_ASSERT_FLOAT_WITHIN(0.0, 0.0, rollingStatsStdDev(stats));
+
+    for (int i = 0; i < 2 * HISTORY_SIZE; i++) {
+        rollingStatsAdd(stats, (float)i);
+    }
+    rollingStatsReset(stats);
+    TEST_ASSERT_FALSE(rollingStatsFull(stats));
+    rollingStatsAdd(stats, 5.0f);
+    rollingStatsAdd(stats, 7.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 6.0, rollingStatsMean(stats));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0, rollingStatsStdDev(stats));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_noise_around_zero);
+    RUN_TEST(test_gas_ppm_noise);
+    RUN_TEST(test_large_offset_small_spread);
+    RUN_TEST(test_ramp_and_step);
+    RUN_TEST(test_flat_with_outliers);
+    RUN_TEST(test_reset_empties_window);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+/*
+ * test_main.cpp
+ * SampleQueue under a producer and a consumer thread: every item arrives
+ * once, in order and untorn, and drops are counted exactly
+ */
+
+#include "SampleQueue.h"
+#include <atomic>
+#include <thread>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define STRESS_ITEMS 2000000UL
+
+// Several words, so a slot read while it is being written shows up as
+// a mismatch between them
+struct StressItem {
+    uint32_t sequence;
+    uint32_t inverse;
+    uint64_t product;
+    float value;
+};
+
+static StressItem makeItem(uint32_t sequence) {
+    StressItem item;
+    item.sequence = sequence;
+    item.inverse = ~sequence;
+    item.product = (uint64_t)sequence * 2654435761u;
+    item.value = (float)(sequence & 0xFFFF);
+    return item;
+}
+
+static bool intact(const StressItem& item) {
+    return item.inverse == ~item.sequence &&
+           item.product == (uint64_t)item.sequence * 2654435761u &&
+           item.value == (float)(item.sequence & 0xFFFF);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+void test_fill_and_drain_single_thread() {
+    SampleQueue<StressItem, 8> queue;
+    StressItem item;
+
+    TEST_ASSERT_FALSE(queue.pop(item));
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.push(makeItem(i)));
+    }
+    TEST_ASSERT_FALSE(queue.push(makeItem(8)));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(8, queue.size());
+
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item.sequence);
+    }
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, queue.size());
+}
+
+// The producer retries when full, so nothing may be lost or reordered
+void test_two_threads_lossless() {
+    static SampleQueue<StressItem, 16> queue;
+    uint32_t torn = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t received = 0;
+
+    std::thread producer([]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            while (!queue.push(makeItem(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    StressItem item;
+    while (received < STRESS_ITEMS) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!intact(item))
+            torn++;
+        if (item.sequence != received)
+            outOfOrder++;
+        received++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_FALSE(queue.pop(item));
+}
+
+// The producer never waits, as on the acquisition core: items may be
+// dropped, but those that arrive are increasing and every one pushed is
+// either received or counted as dropped
+void test_two_threads_with_drops() {
+    static SampleQueue<StressItem, 8> queue;
+    static std::atomic<bool> producing;
+    uint32_t torn = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t received = 0;
+    int64_t last = -1;
+
+    producing = true;
+    std::thread producer([]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+            queue.push(makeItem(i));
+        }
+        producing.store(false, std::memory_order_release);
+    });
+
+    StressItem item;
+    for (;;) {
+        bool done = !producing.load(std::memory_order_acquire);
+        if (!queue.pop(item)) {
+            if (done)
+                break;
+            continue;
+        }
+        if (!intact(item))
+            torn++;
+        if ((int64_t)item.sequence <= last)
+            outOfOrder++;
+        last = item.sequence;
+        received++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, received + queue.droppedCount());
+    TEST_ASSERT_GREATER_THAN(0, received);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fill_and_drain_single_thread);
+    RUN_TEST(test_two_threads_lossless);
+    RUN_TEST(test_two_threads_with_drops);
+    return UNITY_END();
+}
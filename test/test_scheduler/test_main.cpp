@@ -0,0 +1,186 @@
+/*
+ * test_main.cpp
+ * Scheduler timing against a fake clock: period drift, skipped periods,
+ * triggerTask, setTaskPeriod and one-shot debouncing
+ */
+
+#include "Scheduler.h"
+#include <unity.h>
+
+//=====================================================================
+// FAKE CLOCK
+//=====================================================================
+static unsigned long fakeNow = 0;
+static unsigned long callbackCost = 0; // ms each run takes
+static unsigned long runTimes[64];
+static int runs = 0;
+
+static unsigned long fakeClock() {
+    return fakeNow;
+}
+
+static void recordRun() {
+    if (runs < 64) {
+        runTimes[runs] = fakeNow;
+    }
+    runs++;
+    fakeNow += callbackCost;
+}
+
+// Step the clock 1 ms at a time up to end, running whatever is due
+static void runUntil(unsigned long end) {
+    while ((long)(end - fakeNow) > 0) {
+        runScheduler();
+        fakeNow++;
+    }
+}
+
+void setUp() {
+    fakeNow = 1000;
+    callbackCost = 0;
+    runs = 0;
+    initScheduler(fakeClock);
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// Runs stay on the period grid however long each takes or how late the
+// loop gets to them, so lateness never accumulates
+void test_period_does_not_drift() {
+    int id = schedulePeriodic("drift", recordRun, 100, 50);
+    callbackCost = 7;
+
+    for (int i = 0; i < 50; i++) {
+        fakeNow += i % 3; // The loop reaches the task 0-2 ms late
+        runScheduler();
+        fakeNow = 1000 + (i + 1) * 100;
+    }
+
+    TEST_ASSERT_EQUAL(50, runs);
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_EQUAL_UINT32(1000 + i * 100 + i % 3, runTimes[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1000 + 50 * 100, getTask(id)->nextRun);
+    TEST_ASSERT_EQUAL_UINT32(0, getTask(id)->missedCount);
+    TEST_ASSERT_EQUAL_UINT32(2, getTask(id)->maxJitter);
+}
+
+void test_late_run_skips_whole_periods() {
+    int id = schedulePeriodic("slow", recordRun, 100, 50);
+
+    callbackCost = 350; // First run overruns three and a half periods
+    runScheduler();
+    callbackCost = 0;
+
+    const ScheduledTask* task = getTask(id);
+    TEST_ASSERT_EQUAL_UINT32(1, task->overrunCount);
+    TEST_ASSERT_EQUAL_UINT32(2, task->missedCount);
+    TEST_ASSERT_EQUAL_UINT32(1300, task->nextRun);
+
+    // One catch-up run, not a burst of the skipped ones
+    runUntil(1400);
+    TEST_ASSERT_EQUAL(2, runs);
+    TEST_ASSERT_EQUAL_UINT32(1350, runTimes[1]);
+    TEST_ASSERT_EQUAL_UINT32(50, task->lastJitter);
+    TEST_ASSERT_EQUAL_UINT32(1400, task->nextRun);
+}
+
+void test_one_period_late_is_not_missed() {
+    int id = schedulePeriodic("late", recordRun, 100, 500);
+
+    callbackCost = 150; // Past the next due time but not the one after
+    runScheduler();
+
+    TEST_ASSERT_EQUAL_UINT32(0, getTask(id)->missedCount);
+    TEST_ASSERT_EQUAL_UINT32(1100, getTask(id)->nextRun);
+}
+
+void test_trigger_makes_task_due_now() {
+    int id = schedulePeriodic("trigger", recordRun, 1000, 50, 1000);
+
+    TEST_ASSERT_EQUAL_UINT32(1000, runScheduler());
+    fakeNow = 1300;
+    triggerTask(id);
+    TEST_ASSERT_EQUAL_UINT32(1300, getTask(id)->nextRun);
+
+    // The period then counts from the triggered run
+    TEST_ASSERT_EQUAL_UINT32(1000, runScheduler());
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL_UINT32(2300, getTask(id)->nextRun);
+
+    // Cancelled tasks cannot be triggered
+    cancelTask(id);
+    triggerTask(id);
+    runScheduler();
+    TEST_ASSERT_EQUAL(1, runs);
+}
+
+void test_set_period_rebases_on_now() {
+    int id = schedulePeriodic("period", recordRun, 1000, 50);
+    runScheduler();
+    TEST_ASSERT_EQUAL_UINT32(2000, getTask(id)->nextRun);
+
+    fakeNow = 1400;
+    setTaskPeriod(id, 200);
+    TEST_ASSERT_EQUAL_UINT32(200, getTask(id)->period);
+    TEST_ASSERT_EQUAL_UINT32(1600, getTask(id)->nextRun);
+
+    runUntil(2001);
+    TEST_ASSERT_EQUAL(4, runs); // 1000, 1600, 1800, 2000
+    TEST_ASSERT_EQUAL_UINT32(1600, runTimes[1]);
+    TEST_ASSERT_EQUAL_UINT32(2000, runTimes[3]);
+}
+
+void test_set_period_unchanged_keeps_due_time() {
+    int id = schedulePeriodic("same", recordRun, 500, 50);
+    runScheduler();
+
+    fakeNow = 1300;
+    setTaskPeriod(id, 500);
+    TEST_ASSERT_EQUAL_UINT32(1500, getTask(id)->nextRun);
+
+    // A zero period would turn the task into a one-shot; it is refused
+    setTaskPeriod(id, 0);
+    TEST_ASSERT_EQUAL_UINT32(500, getTask(id)->period);
+}
+
+void test_one_shot_runs_once_and_debounces() {
+    int first = scheduleOnce("save", recordRun, 100, 50);
+    fakeNow = 1050;
+    int second = scheduleOnce("save", recordRun, 100, 50);
+
+    TEST_ASSERT_EQUAL(first, second);
+    TEST_ASSERT_EQUAL_UINT32(1150, getTask(first)->nextRun);
+
+    runUntil(1500);
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL_UINT32(1150, runTimes[0]);
+    TEST_ASSERT_FALSE(getTask(first)->active);
+    TEST_ASSERT_EQUAL_UINT32((unsigned long)-1, runScheduler());
+}
+
+void test_due_times_survive_clock_wrap() {
+    fakeNow = (unsigned long)-150;
+    int id = schedulePeriodic("wrap", recordRun, 100, 50);
+
+    runUntil(250);
+    TEST_ASSERT_EQUAL(4, runs);
+    TEST_ASSERT_EQUAL_UINT32(0, getTask(id)->missedCount);
+    TEST_ASSERT_EQUAL_UINT32(250, getTask(id)->nextRun);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_period_does_not_drift);
+    RUN_TEST(test_late_run_skips_whole_periods);
+    RUN_TEST(test_one_period_late_is_not_missed);
+    RUN_TEST(test_trigger_makes_task_due_now);
+    RUN_TEST(test_set_period_rebases_on_now);
+    RUN_TEST(test_set_period_unchanged_keeps_due_time);
+    RUN_TEST(test_one_shot_runs_once_and_debounces);
+    RUN_TEST(test_due_times_survive_clock_wrap);
+    return UNITY_END();
+}
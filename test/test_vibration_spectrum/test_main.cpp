@@ -0,0 +1,220 @@
+/*
+ * test_main.cpp
+ * VibrationSpectrum accuracy: the Q15 FFT against a double precision
+ * DFT, and features of synthetic vibration tones. Also times the FFT at
+ * each size.
+ *
+ * Times are host figures for comparing versions of the kernel; on the
+ * device the imu_service scope of the profile report includes it.
+ */
+
+#include "VibrationSpectrum.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+//=====================================================================
+// CONFIGURATION
+//=====================================================================
+#define SAMPLE_RATE 417.0f // IMU FIFO output data rate
+#define WINDOW_BLOCKS 8
+
+//=====================================================================
+// HELPERS
+//=====================================================================
+static uint32_t randomState = 1;
+
+static int16_t randomSample(int16_t amplitude) {
+    randomState = randomState * 1664525u + 1013904223u;
+    return (int16_t)((int32_t)(randomState >> 16) % (2 * amplitude + 1) - amplitude);
+}
+
+// Largest error of fftQ15 against the exact transform, scaled by 1/n as
+// fftQ15 is, in Q15 counts
+static double fftError(uint8_t log2n, int16_t amplitude) {
+    const int n = 1 << log2n;
+    int16_t re[VIBRATION_FFT_SIZE];
+    int16_t im[VIBRATION_FFT_SIZE];
+    int16_t input[VIBRATION_FFT_SIZE];
+
+    for (int i = 0; i < n; i++) {
+        input[i] = randomSample(amplitude);
+        re[i] = input[i];
+        im[i] = 0;
+    }
+    fftQ15(re, im, log2n);
+
+    double worst = 0;
+    for (int k = 0; k < n; k++) {
+        double sumRe = 0, sumIm = 0;
+        for (int i = 0; i < n; i++) {
+            double angle = -2 * M_PI * k * i / n;
+            sumRe += input[i] * cos(angle);
+            sumIm += input[i] * sin(angle);
+        }
+        double error = hypot(re[k] - sumRe / n, im[k] - sumIm / n);
+        if (error > worst)
+            worst = error;
+    }
+    return worst;
+}
+
+// Gravity plus a tone, as magnitudes for vibrationSpectrumAdd()
+static void addTone(VibrationSpectrum& spectrum, float amplitude, float frequency, int samples) {
+    for (int i = 0; i < samples; i++) {
+        float phase = 2 * M_PI * frequency * i / SAMPLE_RATE;
+        vibrationSpectrumAdd(spectrum, 1.0f + amplitude * sinf(phase));
+    }
+}
+
+static int bandOf(float frequency) {
+    int band = VIBRATION_BANDS - 1;
+    while (band > 0 && frequency < VIBRATION_BAND_EDGES[band]) {
+        band--;
+    }
+    return band;
+}
+
+void setUp() {
+    randomState = 1;
+}
+
+void tearDown() {}
+
+//=====================================================================
+// TESTS
+//=====================================================================
+// Each stage halves and rounds, so the error grows by about half a count
+// per stage
+void test_fft_matches_dft() {
+    for (uint8_t log2n = 2; log2n <= VIBRATION_FFT_LOG2; log2n++) {
+        double error = fftError(log2n, 16000);
+        char message[64];
+        snprintf(message, sizeof(message), "%d points: worst error %.2f counts", 1 << log2n,
+                 error);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_LESS_THAN(0.5 * log2n + 1, error);
+    }
+}
+
+void test_fft_of_full_scale_input_does_not_overflow() {
+    int16_t re[VIBRATION_FFT_SIZE];
+    int16_t im[VIBRATION_FFT_SIZE];
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        re[i] = 32767;
+        im[i] = -32768;
+    }
+    fftQ15(re, im, VIBRATION_FFT_LOG2);
+
+    TEST_ASSERT_INT_WITHIN(VIBRATION_FFT_LOG2, 32767, re[0]);
+    TEST_ASSERT_INT_WITHIN(VIBRATION_FFT_LOG2, -32768, im[0]);
+    for (int k = 1; k < VIBRATION_FFT_SIZE; k++) {
+        TEST_ASSERT_INT_WITHIN(VIBRATION_FFT_LOG2, 0, re[k]);
+        TEST_ASSERT_INT_WITHIN(VIBRATION_FFT_LOG2, 0, im[k]);
+    }
+}
+
+// Tones in every band: dominant frequency within a quarter of a bin (the
+// parabolic fit on Hann power is biased by up to about a tenth), RMS and
+// crest factor of a sine, energy in the right band
+void test_tone_features() {
+    const float frequencies[] = {6.5f, 29.3f, 77.0f, 150.2f};
+    const float binWidth = SAMPLE_RATE / VIBRATION_FFT_SIZE;
+    const double toneRms = 0.2 / sqrt(2.0);
+
+    for (float frequency : frequencies) {
+        VibrationSpectrum spectrum;
+        vibrationSpectrumBegin(spectrum, SAMPLE_RATE);
+        addTone(spectrum, 0.2f, frequency, WINDOW_BLOCKS * VIBRATION_FFT_SIZE);
+
+        VibrationFeatures features;
+        TEST_ASSERT_TRUE(vibrationSpectrumTake(spectrum, features));
+        TEST_ASSERT_EQUAL(WINDOW_BLOCKS, features.blocks);
+
+        TEST_ASSERT_FLOAT_WITHIN(0.25 * binWidth, frequency, features.dominantFrequency);
+        TEST_ASSERT_FLOAT_WITHIN(toneRms * 0.03, toneRms, features.rms);
+        TEST_ASSERT_FLOAT_WITHIN(0.1, sqrt(2.0), features.crestFactor);
+
+        int band = bandOf(frequency);
+        TEST_ASSERT_FLOAT_WITHIN(toneRms * 0.05, toneRms, features.bandRms[band]);
+        for (int other = 0; other < VIBRATION_BANDS; other++) {
+            if (other != band) {
+                TEST_ASSERT_LESS_THAN(features.bandRms[band] * 0.1, features.bandRms[other]);
+            }
+        }
+    }
+}
+
+// A small vibration stands out against the noise of the others, and the
+// band RMS values add up to the overall RMS
+void test_two_tones() {
+    VibrationSpectrum spectrum;
+    vibrationSpectrumBegin(spectrum, SAMPLE_RATE);
+    for (int i = 0; i < WINDOW_BLOCKS * VIBRATION_FFT_SIZE; i++) {
+        float t = i / SAMPLE_RATE;
+        vibrationSpectrumAdd(spectrum, 1.0f + 0.05f * sinf(2 * M_PI * 25 * t) +
+                                           0.02f * sinf(2 * M_PI * 120 * t));
+    }
+
+    VibrationFeatures features;
+    TEST_ASSERT_TRUE(vibrationSpectrumTake(spectrum, features));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 25, features.dominantFrequency);
+    TEST_ASSERT_FLOAT_WITHIN(0.05 / sqrt(2.0) * 0.05, 0.05 / sqrt(2.0), features.bandRms[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.02 / sqrt(2.0) * 0.05, 0.02 / sqrt(2.0), features.bandRms[3]);
+
+    double bandSquares = 0;
+    for (int band = 0; band < VIBRATION_BANDS; band++) {
+        bandSquares += features.bandRms[band] * features.bandRms[band];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(features.rms * 0.05, features.rms, sqrt(bandSquares));
+}
+
+void test_take_without_a_block() {
+    VibrationSpectrum spectrum;
+    vibrationSpectrumBegin(spectrum, SAMPLE_RATE);
+    addTone(spectrum, 0.1f, 30, VIBRATION_FFT_SIZE - 1);
+
+    VibrationFeatures features;
+    TEST_ASSERT_FALSE(vibrationSpectrumTake(spectrum, features));
+    addTone(spectrum, 0.1f, 30, 1);
+    TEST_ASSERT_TRUE(vibrationSpectrumTake(spectrum, features));
+    TEST_ASSERT_EQUAL(1, features.blocks);
+}
+
+void test_fft_cost_per_size() {
+    int16_t re[VIBRATION_FFT_SIZE];
+    int16_t im[VIBRATION_FFT_SIZE];
+    const int runs = 20000;
+
+    for (uint8_t log2n = 4; log2n <= VIBRATION_FFT_LOG2; log2n++) {
+        int n = 1 << log2n;
+        int64_t checksum = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs; run++) {
+            for (int i = 0; i < n; i++) {
+                re[i] = randomSample(8000);
+                im[i] = 0;
+            }
+            fftQ15(re, im, log2n);
+            checksum += re[1];
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        char message[96];
+        snprintf(message, sizeof(message), "%3d points: %.0f ns per block (host) [%lld]", n,
+                 elapsed.count() / runs, (long long)checksum);
+        TEST_MESSAGE(message);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fft_matches_dft);
+    RUN_TEST(test_fft_of_full_scale_input_does_not_overflow);
+    RUN_TEST(test_tone_features);
+    RUN_TEST(test_two_tones);
+    RUN_TEST(test_take_without_a_block);
+    RUN_TEST(test_fft_cost_per_size);
+    return UNITY_END();
+}